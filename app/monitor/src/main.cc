@@ -1,8 +1,15 @@
 #include <M5Unified.h>
+#include <atomic>
 #include <freertos/FreeRTOS.h>
 #include <freertos/stream_buffer.h>
 #include <lvgl.h>
 #include <okdcc.h>
+#include <esp_idf_version.h>
+#if ESP_IDF_VERSION_VAL(5, 3, 0) <= ESP_IDF_VERSION
+#include <driver/uart_vfs.h>
+#else
+#include <esp_vfs_dev.h>
+#endif
 
 // 最後に include する
 #include <M5GFX.h>
@@ -14,9 +21,41 @@
 #define SCREEN_WIDTH 320
 #define SCREEN_HEIGHT 240
 #define BYTE_PER_PIXEL (LV_COLOR_FORMAT_GET_SIZE(LV_COLOR_FORMAT_RGB565))
-#define SIGNAL_BUFFER_SIZE 1024
+// 16ビットの継続時間で記録するので、時刻で記録するのと同じメモリーで倍以上の電圧変化を保持できる
+#define PERIOD_BUFFER_SIZE (1024 * sizeof(dcc_TimeMicroSec) / sizeof(dcc_HalfBitPeriod))
+#define PACKETS_SIZE 16
+#define PACKET_QUEUE_SIZE 64
 #define LOG_STREAM_BUFFER_SIZE (4 * 1024)
 #define VOLTAGE_GPIO GPIO_NUM_5
+// 統計を出力する間隔
+#define METRICS_INTERVAL_MS 10000
+// 電圧変化の取得とデコードは UI とログの出力とは別のコアで動かして、描画に止められないようにする
+#define DECODE_CORE 1
+#define UI_CORE 0
+// 取得の通知がなくてもデコードを試みる間隔
+#define DECODE_WAIT_MS 10
+// 1 なら RMT 受信器で、0 なら GPIO 割り込みで電圧変化を取得する
+// DMA もピンポン受信もない RMT 受信器はメモリーがいっぱいになるたびに変化を失うので、元の ESP32 では GPIO を既定にする
+#ifndef USE_RMT_CAPTURE
+#if SOC_RMT_SUPPORT_DMA || (SOC_RMT_SUPPORT_RX_PINGPONG && ESP_IDF_VERSION_VAL(5, 3, 0) <= ESP_IDF_VERSION)
+#define USE_RMT_CAPTURE 1
+#else
+#define USE_RMT_CAPTURE 0
+#endif
+#endif
+// 1 ならライブラリーのデバッグログを整形せずに記録し、優先度の低いタスクで整形して出力する
+// ライブラリーを DCC_LOG_LEVEL_DEBUG でビルドしたときだけ記録される
+#ifndef USE_DEFERRED_DEBUG_LOG
+#define USE_DEFERRED_DEBUG_LOG 0
+#endif
+#define DEFERRED_LOG_SIZE 256
+// 独自の受信のタイミングを `{ 46UL, 70UL, 80UL, 10000UL, 10UL, 12000UL }` のように定義すると、切り替えの候補に加える
+// C ボタンの長押しで既定、厳密、許容、独自の順に切り替える
+// #define CUSTOM_RECEIVE_TIMING { ... }
+// 1 なら半ビットの継続時間のヒストグラムを取り、画面に描画してシリアルに JSON で出力する
+#ifndef USE_TIMING_PROFILE
+#define USE_TIMING_PROFILE 1
+#endif
 
 #define LOG(...)                                                \
   do {                                                          \
@@ -25,10 +64,11 @@
 
 extern "C" {
 void app_main(void);
-void loopTask(void *);
+void decodeTask(void *);
+void uiTask(void *);
 void displayFlush(lv_display_t *display, const lv_area_t *area, uint8_t *px_map);
 void readButtons(lv_indev_t *indev, lv_indev_data_t *data);
-void onVoltageChange(void *);
+void onPeriodsCaptured(dcc_HalfBitPeriod const *const periods, size_t const size, void *const context);
 [[noreturn]] void errorLoop(void);
 int printDebugLog(char const *const file, int const line, char const *func, char const *format, ...);
 void printErrorLog(char const *const file, int const line, char const *func, char const *format, ...);
@@ -37,25 +77,93 @@ void printLog(char const *const level, char const *const file, int const line, c
 void printLogVa(char const *const level, char const *const file, int const line, char const *func, char const *format,
                 va_list vlist);
 void printLogTask(void *);
+void printDeferredLogTask(void *);
 }
 
 #if LV_USE_LOG
 void printLvLog(lv_log_level_t level, const char *buf);
 #endif
 
+#if USE_TIMING_PROFILE
+static void createTimingChart(void);
+#endif
+
 static M5GFX gfx;
-static dcc_TimeMicroSec signalBufferValues[SIGNAL_BUFFER_SIZE];
-static struct dcc_Decoder decoder = dcc_initializeDecoder(signalBufferValues, SIGNAL_BUFFER_SIZE);
+static dcc_HalfBitPeriod periodBufferValues[PERIOD_BUFFER_SIZE];
+static struct dcc_PeriodBuffer periodBuffer = dcc_initializePeriodBuffer(periodBufferValues, PERIOD_BUFFER_SIZE);
+static struct dcc_Decoder decoder = dcc_initializeDecoder(NULL, 0);
 static StreamBufferHandle_t logStreamBuffer = NULL;
 static char logStreamBufferStorage[LOG_STREAM_BUFFER_SIZE + 1] = { 0 };  // StreamBuffer が 1 バイト余分に要求する
 static StaticStreamBuffer_t logStreamBufferStruct;
+static struct dcc_electric_Capture capture;
+static TaskHandle_t decodeTaskHandle = NULL;
+
+// デコードタスクから UI などの読み出し側にパケットを配るキュー
+// デコードタスクは読み出し側を待たずに書き込み、遅れた読み出し側は古い記録を失う
+static struct dcc_PacketRecord packetRecords[PACKET_QUEUE_SIZE];
+static struct dcc_PacketQueue packetQueue = dcc_initializePacketQueue(packetRecords, PACKET_QUEUE_SIZE);
+
+// パイプラインの段ごとの統計
+// それぞれの値を増やすのは1つのタスクか割り込みだけで、UI タスクが出力するときに0に戻す
+static struct {
+  std::atomic<uint32_t> lostPeriodsCount;
+  std::atomic<uint32_t> decodedPeriodsCount;
+  std::atomic<uint32_t> decodedPacketsCount;
+  std::atomic<uint32_t> failedPacketsCount;
+  std::atomic<uint32_t> maxPeriodBufferDepth;
+  std::atomic<uint32_t> maxPacketQueueDepth;
+  std::atomic<uint32_t> shownPacketsCount;
+  std::atomic<uint32_t> errorsCount;
+} metrics;
+#if USE_DEFERRED_DEBUG_LOG
+static struct dcc_DeferredLogEntry deferredLogEntries[DEFERRED_LOG_SIZE];
+static struct dcc_DeferredLog deferredLog = dcc_initializeDeferredLog(deferredLogEntries, DEFERRED_LOG_SIZE);
+#endif
+// 受信のタイミングの候補で、NULL はライブラリーに組み込まれた既定値
+// adaptive は既定値を基準にプリアンブルから学習するクロック再生を使う
+// UI タスクが添字を書き換え、デコードタスクが次の読み出しから使う
+#ifdef CUSTOM_RECEIVE_TIMING
+static struct dcc_ReceiveTiming const customReceiveTiming = CUSTOM_RECEIVE_TIMING;
+#endif
+static struct {
+  char const *name;
+  struct dcc_ReceiveTiming const *timing;
+  bool adaptive;
+} const receiveTimings[] = {
+  { "default", NULL, false },
+  { "strict", &dcc_strictReceiveTiming, false },
+  { "tolerant", &dcc_tolerantReceiveTiming, false },
+#ifdef CUSTOM_RECEIVE_TIMING
+  { "custom", &customReceiveTiming, false },
+#endif
+  { "adaptive", NULL, true },
+};
+static std::atomic<size_t> receiveTimingIndex(0);
+#if USE_TIMING_PROFILE
+// デコードタスクが更新し、UI タスクがスナップショットの差を描画する
+static struct dcc_TimingProfile timingProfile = dcc_initializeTimingProfile();
+static lv_obj_t *timingChart = NULL;
+static lv_chart_series_t *timingChartSeries[3] = { NULL };
+#endif
+#if USE_RMT_CAPTURE
+static struct dcc_electric_RmtCapture rmtCapture;
+#else
+static struct dcc_electric_GpioCapture gpioCapture;
+#endif
 
 void app_main(void) {
   M5.begin();
   gfx.init();
   lv_init();
+  // パケットログのフレームの 0x0A が CRLF に変換されて壊れないように、標準出力の改行を変換しない
+#if ESP_IDF_VERSION_VAL(5, 3, 0) <= ESP_IDF_VERSION
+  uart_vfs_dev_port_set_tx_line_endings(CONFIG_ESP_CONSOLE_UART_NUM, ESP_LINE_ENDINGS_LF);
+#else
+  esp_vfs_dev_uart_port_set_tx_line_endings(CONFIG_ESP_CONSOLE_UART_NUM, ESP_LINE_ENDINGS_LF);
+#endif
   printf("OKDCC v0.0 (%s %s)\n", __DATE__, __TIME__);
   printf("LVGL v%d.%d.%d\n", lv_version_major(), lv_version_minor(), lv_version_patch());
+  printf("Packets are written as binary frames. Expand them with examples/packetlog.\n");
 
   lv_init();
 
@@ -77,86 +185,293 @@ void app_main(void) {
   logStreamBuffer =
     xStreamBufferCreateStatic(LOG_STREAM_BUFFER_SIZE, 1, (uint8_t *) logStreamBufferStorage, &logStreamBufferStruct);
   dcc_error_log = printErrorLog;
+#if USE_DEFERRED_DEBUG_LOG
+  dcc_deferred_log = &deferredLog;
+  dcc_debug_log = dcc_deferLog;
+#endif
 
   struct dcc_ui_Model_Command modelCommand = dcc_ui_init(buttonsIndev);
   dcc_ui_view(modelCommand.model);
+#if USE_TIMING_PROFILE
+  createTimingChart();
+#endif
+#ifdef CUSTOM_RECEIVE_TIMING
+  if (dcc_Failure == dcc_validateReceiveTiming(&customReceiveTiming)) {
+    LOG("Invalid CUSTOM_RECEIVE_TIMING");
+    errorLoop();
+  }
+#endif
 
   {
-    gpio_config_t config = { .pin_bit_mask = BIT(1) << VOLTAGE_GPIO,
-                             .mode = GPIO_MODE_INPUT,
-                             .pull_up_en = GPIO_PULLUP_DISABLE,
-                             .pull_down_en = GPIO_PULLDOWN_ENABLE,
-                             .intr_type = GPIO_INTR_ANYEDGE };
-    esp_err_t const result = gpio_config(&config);
-    if (ESP_OK != result) {
-      LOG("Failed to configure GPIO %d: %s", VOLTAGE_GPIO, esp_err_to_name(result));
+    TaskHandle_t printLogTaskHandle = NULL;
+    BaseType_t printLogTaskCreationResult = xTaskCreatePinnedToCore(
+      printLogTask, "printLogTask", /* stack size */ 8 * 1096, NULL, 2, &printLogTaskHandle, UI_CORE);
+    if (pdPASS != printLogTaskCreationResult) {
+      LOG("Failed to create \"printLogTask\" task");
       errorLoop();
     }
   }
+
+#if USE_DEFERRED_DEBUG_LOG
   {
-    esp_err_t const result = gpio_install_isr_service(ESP_INTR_FLAG_LOWMED);
-    if (ESP_OK != result) {
-      LOG("Failed to install ISR service: %s", esp_err_to_name(result));
+    // 他のタスクが動いていない時間だけ整形する
+    BaseType_t printDeferredLogTaskCreationResult = xTaskCreatePinnedToCore(
+      printDeferredLogTask, "printDeferredLogTask", /* stack size */ 4 * 1024, NULL, 0, NULL, UI_CORE);
+    if (pdPASS != printDeferredLogTaskCreationResult) {
+      LOG("Failed to create \"printDeferredLogTask\" task");
       errorLoop();
     }
   }
+#endif
+
   {
-    esp_err_t const result = gpio_isr_handler_add(VOLTAGE_GPIO, onVoltageChange, NULL);
-    if (ESP_OK != result) {
-      LOG("Failed to add ISR handler on GPIO %d: %s", VOLTAGE_GPIO, esp_err_to_name(result));
+    // 割り込みハンドラーは取得を開いたコアに割り当てられるので、デコードタスクの中で取得を開く
+    BaseType_t decodeTaskCreationResult =
+      xTaskCreatePinnedToCore(decodeTask, "decodeTask", /* stack size */ 8 * 1024, NULL, 3, NULL, DECODE_CORE);
+    if (pdPASS != decodeTaskCreationResult) {
+      LOG("Failed to create \"decodeTask\" task");
       errorLoop();
     }
   }
 
   {
-    TaskHandle_t printLogTaskHandle = NULL;
-    BaseType_t printLogTaskCreationResult =
-      xTaskCreate(printLogTask, "printLogTask", /* stack size */ 8 * 1096, NULL, 2, &printLogTaskHandle);
-    if (pdPASS != printLogTaskCreationResult) {
-      LOG("Failed to create \"printLogTask\" task");
+    TaskHandle_t uiTaskHandle = NULL;
+    BaseType_t uiTaskCreationResult =
+      xTaskCreatePinnedToCore(uiTask, "uiTask", /* stack size */ 16 * 1024, NULL, 1, &uiTaskHandle, UI_CORE);
+    if (pdPASS != uiTaskCreationResult) {
+      LOG("Failed to create \"uiTask\" task");
       errorLoop();
     }
   }
+}
+
+#if USE_TIMING_PROFILE
+// 3つのヒストグラムを区間の添字を横軸にした棒グラフで重ねて描く
+// 区間の数が同じなので、系列ごとに自分の最大値に対する割合で描けば形を比べられる
+static void createTimingChart(void) {
+  timingChart = lv_chart_create(lv_screen_active());
+  lv_obj_set_size(timingChart, lv_pct(100), 64);
+  lv_chart_set_type(timingChart, LV_CHART_TYPE_BAR);
+  lv_chart_set_point_count(timingChart, DCC_TIMING_PROFILE_BUCKETS_COUNT);
+  lv_chart_set_range(timingChart, LV_CHART_AXIS_PRIMARY_Y, 0, 100);
+  lv_chart_set_div_line_count(timingChart, 0, 0);
+  timingChartSeries[0] = lv_chart_add_series(timingChart, lv_palette_main(LV_PALETTE_BLUE), LV_CHART_AXIS_PRIMARY_Y);
+  timingChartSeries[1] = lv_chart_add_series(timingChart, lv_palette_main(LV_PALETTE_GREEN), LV_CHART_AXIS_PRIMARY_Y);
+  timingChartSeries[2] = lv_chart_add_series(timingChart, lv_palette_main(LV_PALETTE_RED), LV_CHART_AXIS_PRIMARY_Y);
+}
 
+static void setTimingChartSeries(lv_chart_series_t *const series, size_t const *const counts) {
+  size_t max = 0;
+  for (size_t i = 0; i < DCC_TIMING_PROFILE_BUCKETS_COUNT; i++) max = max < counts[i] ? counts[i] : max;
+  for (size_t i = 0; i < DCC_TIMING_PROFILE_BUCKETS_COUNT; i++) {
+    lv_chart_set_value_by_id(
+      timingChart, series, (uint32_t) i, max == 0 ? 0 : (int32_t) ((uint64_t) counts[i] * 100 / max));
+  }
+}
+
+// 前回からの差を描画し、ホストでプロットできるように JSON の行で出力する
+// 行は 216 バイトのログに収まらないので、ログを通さずに書き込む
+static void showTimingProfile(void) {
+  static struct dcc_TimingProfile since = {};
+  struct dcc_TimingProfile const until = dcc_getTimingProfile(&timingProfile);
+  struct dcc_TimingProfile const profile = dcc_subtractTimingProfile(&until, &since);
+  since = until;
+  setTimingChartSeries(timingChartSeries[0], profile.oneHalfBitCounts);
+  setTimingChartSeries(timingChartSeries[1], profile.zeroHalfBitCounts);
+  setTimingChartSeries(timingChartSeries[2], profile.oneBitAsymmetryCounts);
+  lv_chart_refresh(timingChart);
+  static char text[1024];
+  int const size = dcc_showTimingProfile(text, sizeof text, &profile);
+  if (size < 0 || sizeof text <= (size_t) size) return;
+  printf("timing profile: %s\n", text);
+  fflush(stdout);
+}
+#endif
+
+// 最大値を更新する
+static void updateMax(std::atomic<uint32_t> &max, uint32_t const value) {
+  if (max.load(std::memory_order_relaxed) < value) max.store(value, std::memory_order_relaxed);
+}
+
+void decodeTask(void *) {
+  // 作成した側がハンドルを書き込む前に割り込みが通知しないように、ここで書き込む
+  decodeTaskHandle = xTaskGetCurrentTaskHandle();
+  {
+#if USE_RMT_CAPTURE
+    enum dcc_Result const result =
+      dcc_electric_openRmtCapture(&capture, &rmtCapture, VOLTAGE_GPIO, onPeriodsCaptured, NULL);
+#else
+    enum dcc_Result const result =
+      dcc_electric_openGpioCapture(&capture, &gpioCapture, VOLTAGE_GPIO, onPeriodsCaptured, NULL);
+#endif
+    if (dcc_Failure == result) {
+      LOG("Failed to open %s capture on GPIO %d: %s",
+          capture.backend->name,
+          VOLTAGE_GPIO,
+          esp_err_to_name(capture.error));
+      errorLoop();
+    }
+  }
   {
-    TaskHandle_t loopTaskHandle = NULL;
-    BaseType_t loopTaskCreationResult =
-      xTaskCreate(loopTask, "loopTask", /* stack size */ 16 * 1024, NULL, 1, &loopTaskHandle);
-    if (pdPASS != loopTaskCreationResult) {
-      LOG("Failed to create \"loopTask\" task");
+    if (dcc_Failure == dcc_electric_startCapture(&capture)) {
+      LOG("Failed to start %s capture: %s", capture.backend->name, esp_err_to_name(capture.error));
       errorLoop();
     }
   }
+#if USE_TIMING_PROFILE
+  decoder.signalStreamParser.timingProfile = &timingProfile;
+#endif
+  struct dcc_ClockRecovery clockRecovery = dcc_initializeClockRecovery(&dcc_defaultReceiveTiming);
+  // 取得を始めてからの時間を半ビットの継続時間の和で表す
+  dcc_TimeMicroSec time = 0;
+  while (true) {
+    ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(DECODE_WAIT_MS));
+    // パーサーはこのタスクだけが触るので、ビットの間で切り替えてよい
+    // クロック再生は取り付けたままなら学習した値を引き継ぐ
+    {
+      auto const &receiveTiming = receiveTimings[receiveTimingIndex.load(std::memory_order_relaxed)];
+      if (!receiveTiming.adaptive) {
+        dcc_attachClockRecovery(&decoder.signalStreamParser, NULL);
+        decoder.signalStreamParser.receiveTiming = receiveTiming.timing;
+      } else if (decoder.signalStreamParser.clockRecovery == NULL) {
+        dcc_attachClockRecovery(&decoder.signalStreamParser, &clockRecovery);
+      }
+    }
+    struct dcc_PeriodSpan spans[2];
+    size_t const spansCount = dcc_readPeriodBufferSpans(&periodBuffer, spans);
+    {
+      size_t depth = 0;
+      for (size_t i = 0; i < spansCount; i++) depth += spans[i].size;
+      updateMax(metrics.maxPeriodBufferDepth, (uint32_t) depth);
+    }
+    for (size_t i = 0; i < spansCount; i++) {
+      for (size_t j = 0; j < spans[i].size; j++) {
+        time += spans[i].periods[j];
+        struct dcc_Packet packet;
+        struct dcc_BytesView bytes = { .bytes = NULL, .size = 0 };
+        enum dcc_StreamParserResult const result = dcc_decodePeriodView(&decoder, spans[i].periods[j], &packet, &bytes);
+        if (dcc_StreamParserResult_Continue == result) continue;
+        // 枠が揃わずにバイト列が設定されなかった失敗は記録しない
+        struct dcc_PacketRecord record;
+        if (dcc_Failure == dcc_makePacketRecord(result, &packet, bytes, time, &record)) continue;
+        if (dcc_StreamParserResult_Success == result) {
+          metrics.decodedPacketsCount.fetch_add(1, std::memory_order_relaxed);
+        } else {
+          metrics.failedPacketsCount.fetch_add(1, std::memory_order_relaxed);
+        }
+        // 読み出し側が追いつかなくてもデコードは止めない
+        dcc_pushPacketQueue(&packetQueue, &record);
+      }
+      dcc_releasePeriodBuffer(&periodBuffer, spans[i].size);
+      metrics.decodedPeriodsCount.fetch_add((uint32_t) spans[i].size, std::memory_order_relaxed);
+    }
+  }
+  vTaskDelete(NULL);
+}
+
+// 段ごとの毎秒の処理量とキューの深さを出力して、計数をリセットする
+// デコードのタスクが動かしているデコーダーの統計を、前回のスナップショットとの差から毎秒の回数にして出力する
+static void printDecoderStats(double const seconds) {
+  static struct dcc_DecoderStats since = {};
+  struct dcc_DecoderStats const until = dcc_getDecoderStats(&decoder);
+  struct dcc_DecoderStats const stats = dcc_subtractDecoderStats(&until, &since);
+  since = until;
+  size_t packetsCount = 0;
+  for (size_t i = 0; i < DCC_PACKET_TAGS_COUNT; i++) packetsCount += stats.packetsCounts[i];
+  LOG("decoder: %.0f edges/s, %.0f bits/s, %.1f timing rejects/s, %.1f preamble resyncs/s, %.1f timing resyncs/s, "
+      "%.1f framing errors/s",
+      (double) stats.edgesCount / seconds,
+      (double) stats.bitsCount / seconds,
+      (double) stats.timingRejectsCount / seconds,
+      (double) stats.preambleResyncsCount / seconds,
+      (double) stats.timingResyncsCount / seconds,
+      (double) stats.framingErrorsCount / seconds);
+  LOG("decoder: %.1f packets/s, %.1f checksum failures/s, unparsed/s: broadcast %.1f, short %.1f, accessory %.1f, "
+      "long %.1f, reserved %.1f, idle %.1f",
+      (double) packetsCount / seconds,
+      (double) stats.checksumFailuresCount / seconds,
+      (double) stats.unparsedPacketsCounts[dcc_AddressClass_Broadcast] / seconds,
+      (double) stats.unparsedPacketsCounts[dcc_AddressClass_ShortAddress] / seconds,
+      (double) stats.unparsedPacketsCounts[dcc_AddressClass_Accessory] / seconds,
+      (double) stats.unparsedPacketsCounts[dcc_AddressClass_LongAddress] / seconds,
+      (double) stats.unparsedPacketsCounts[dcc_AddressClass_Reserved] / seconds,
+      (double) stats.unparsedPacketsCounts[dcc_AddressClass_Idle] / seconds);
 }
 
-void loopTask(void *) {
+static void printMetrics(TickType_t const elapsedTicks, struct dcc_PacketQueueReader *const reader) {
+  double const seconds = (double) elapsedTicks / configTICK_RATE_HZ;
+  struct dcc_electric_CaptureStats const stats = dcc_electric_getCaptureStats(&capture);
+  dcc_electric_resetCaptureStats(&capture);
+  // バックエンドを比べるために電圧変化が失われたかもしれない箇所と CPU 負荷を出力する
+  LOG("%s capture: %.0f periods/s, %lu batches (max %lu), %lu gaps, %.2f%% CPU, %lu lost",
+      capture.backend->name,
+      (double) stats.periodsCount / seconds,
+      (unsigned long) stats.batchesCount,
+      (unsigned long) stats.maxBatchSize,
+      (unsigned long) stats.gapsCount,
+      stats.elapsedNanoSec == 0 ? 0.0 : 100.0 * (double) stats.busyNanoSec / (double) stats.elapsedNanoSec,
+      (unsigned long) metrics.lostPeriodsCount.exchange(0, std::memory_order_relaxed));
+  LOG("decode: %.0f periods/s, %.1f packets/s, %.1f failed/s, period buffer max %lu/%u, %lu errors recovered",
+      (double) metrics.decodedPeriodsCount.exchange(0, std::memory_order_relaxed) / seconds,
+      (double) metrics.decodedPacketsCount.exchange(0, std::memory_order_relaxed) / seconds,
+      (double) metrics.failedPacketsCount.exchange(0, std::memory_order_relaxed) / seconds,
+      (unsigned long) metrics.maxPeriodBufferDepth.exchange(0, std::memory_order_relaxed),
+      (unsigned int) PERIOD_BUFFER_SIZE,
+      (unsigned long) metrics.errorsCount.exchange(0, std::memory_order_relaxed));
+  printDecoderStats(seconds);
+  LOG("ui: %.1f packets/s, packet queue %u (max %lu)/%u, %lu lost",
+      (double) metrics.shownPacketsCount.exchange(0, std::memory_order_relaxed) / seconds,
+      (unsigned int) dcc_getPacketQueueDepth(reader),
+      (unsigned long) metrics.maxPacketQueueDepth.exchange(0, std::memory_order_relaxed),
+      (unsigned int) PACKET_QUEUE_SIZE,
+      (unsigned long) reader->lostCount);
+  reader->lostCount = 0;
+}
+
+void uiTask(void *) {
+  TickType_t lastMetricsTick = xTaskGetTickCount();
+  struct dcc_PacketQueueReader reader = dcc_initializePacketQueueReader(&packetQueue);
+  struct dcc_PacketLog packetLog = dcc_initializePacketLog();
   while (true) {
     M5.update();
+    if (M5.BtnC.wasHold()) {
+      size_t const index =
+        (receiveTimingIndex.load(std::memory_order_relaxed) + 1) % (sizeof receiveTimings / sizeof receiveTimings[0]);
+      receiveTimingIndex.store(index, std::memory_order_relaxed);
+      LOG("receive timing: %s", receiveTimings[index].name);
+    }
     lv_timer_handler();
     {
-      dcc_TimeMicroSec signal;
-      char buffer[512] = { 0 };
-      dcc_showSignalBuffer(buffer, sizeof buffer, decoder.signalBuffer);
-      while (dcc_Success == dcc_readSignalBuffer(&decoder.signalBuffer, &signal)) {
-        dcc_showSignalBuffer(buffer, sizeof buffer, decoder.signalBuffer);
-        struct dcc_Packet packet;
-        enum dcc_StreamParserResult result = dcc_decode(&decoder, signal, &packet);
-        switch (result) {
-          case dcc_StreamParserResult_Failure:
-            LOG("decode error");
-            continue;
-          case dcc_StreamParserResult_Continue:
-            // LOG("decode continue");
-            continue;
-          case dcc_StreamParserResult_Success: {
-            char buffer[512] = { 0 };
-            dcc_showPacket(buffer, sizeof buffer, packet);
-            LOG("packet: %s", buffer);
-            continue;
-          }
+      updateMax(metrics.maxPacketQueueDepth, (uint32_t) dcc_getPacketQueueDepth(&reader));
+      struct dcc_PacketRecord records[PACKETS_SIZE];
+      size_t const recordsCount = dcc_popPacketQueue(&reader, records, PACKETS_SIZE);
+      // JSON に整形せずにバイナリーのフレームをまとめて書き込み、ホストの examples/packetlog で展開する
+      dcc_Byte frames[PACKETS_SIZE * DCC_PACKET_LOG_FRAME_CAPACITY];
+      size_t framesSize = 0;
+      for (size_t i = 0; i < recordsCount; i++) {
+        size_t size;
+        if (dcc_Success ==
+            dcc_writePacketLog(&packetLog, &records[i], frames + framesSize, sizeof frames - framesSize, &size)) {
+          framesSize += size;
         }
       }
+      if (framesSize != 0) {
+        // ログのテキストとは行の単位で混ざり、読み出し側は区切りでフレームを見分ける
+        fwrite(frames, 1, framesSize, stdout);
+        fflush(stdout);
+      }
+      metrics.shownPacketsCount.fetch_add((uint32_t) recordsCount, std::memory_order_relaxed);
     }
+    TickType_t const elapsedTicks = xTaskGetTickCount() - lastMetricsTick;
+    if (pdMS_TO_TICKS(METRICS_INTERVAL_MS) <= elapsedTicks) {
+      lastMetricsTick += elapsedTicks;
+      printMetrics(elapsedTicks, &reader);
+#if USE_TIMING_PROFILE
+      showTimingProfile();
+#endif
+    }
+    // 同じコアの低い優先度のタスクにも時間を渡す
+    vTaskDelay(1);
   }
   vTaskDelete(NULL);
 }
@@ -189,16 +504,17 @@ void readButtons(lv_indev_t *indev, lv_indev_data_t *data) {
   index = (index + 1) % 3;
 }
 
-enum dcc_Result readSignalBuffer(struct dcc_SignalBuffer *const buffer, dcc_TimeMicroSec *const signal) {
-  gpio_intr_disable(VOLTAGE_GPIO);
-  enum dcc_Result result = dcc_readSignalBuffer(buffer, signal);
-  gpio_intr_enable(VOLTAGE_GPIO);
-  return result;
-}
-
-void onVoltageChange(void *) {
-  unsigned long const now = esp_timer_get_time();
-  if (dcc_Failure == dcc_writeSignalBuffer(&decoder.signalBuffer, now)) LOG("Failed to write signal buffer");
+void onPeriodsCaptured(dcc_HalfBitPeriod const *const periods, size_t const size, void *const context) {
+  for (size_t i = 0; i < size; i++) {
+    if (dcc_Failure == dcc_writePeriodBuffer(&periodBuffer, periods[i])) {
+      // 割り込みの中では出力せずに数えるだけにする
+      metrics.lostPeriodsCount.fetch_add((uint32_t) (size - i), std::memory_order_relaxed);
+      break;
+    }
+  }
+  BaseType_t higherPriorityTaskWoken = pdFALSE;
+  vTaskNotifyGiveFromISR(decodeTaskHandle, &higherPriorityTaskWoken);
+  portYIELD_FROM_ISR(higherPriorityTaskWoken);
 }
 
 void errorLoop(void) {
@@ -208,16 +524,38 @@ void errorLoop(void) {
 }
 
 void printLogTask(void *) {
-  char buffer[LOG_STREAM_BUFFER_SIZE + 1] = { 0 };  // 終端ヌル文字の1文字分を余分に確保する
+  char buffer[LOG_STREAM_BUFFER_SIZE] = { 0 };
   while (true) {
     assert(logStreamBuffer != NULL);
     size_t const read = xStreamBufferReceive(logStreamBuffer, buffer, LOG_STREAM_BUFFER_SIZE, portMAX_DELAY);
-    buffer[read] = '\0';
-    printf(buffer);
+    // パケットログのフレームとは行の単位で混ざる
+    fwrite(buffer, 1, read, stdout);
   }
   vTaskDelete(NULL);
 }
 
+void printDeferredLogTask(void *) {
+#if USE_DEFERRED_DEBUG_LOG
+  size_t lastLostCount = 0;
+  while (true) {
+    struct dcc_DeferredLogEntry entry;
+    if (dcc_Failure == dcc_popDeferredLog(&deferredLog, &entry)) {
+      size_t const lostCount = __atomic_load_n(&deferredLog.lostCount, __ATOMIC_RELAXED);
+      if (lostCount != lastLostCount) {
+        LOG("%lu debug logs lost", (unsigned long) (lostCount - lastLostCount));
+        lastLostCount = lostCount;
+      }
+      vTaskDelay(1);
+      continue;
+    }
+    char message[216];
+    dcc_formatDeferredLog(message, sizeof message, &entry);
+    printLog("DEBUG", entry.file, entry.line, entry.func, "%s", message);
+  }
+#endif
+  vTaskDelete(NULL);
+}
+
 #if LV_USE_LOG
 void printLvLog(lv_log_level_t level, const char *buf) {
   static const char *lvl_prefix[] = { "TRACE", "INFO", "WARN", "ERROR", "USER" };
@@ -238,7 +576,8 @@ void printErrorLog(char const *const file, int const line, char const *func, cha
   va_start(vlist, format);
   printLogVa("ERROR", file, line, func, format, vlist);
   va_end(vlist);
-  exit(EXIT_FAILURE);
+  // ライブラリーは状態を戻して処理を続けるので、止めずに数えるだけにする
+  metrics.errorsCount.fetch_add(1, std::memory_order_relaxed);
 }
 
 void printLog(char const *const level, char const *const file, int const line, char const *func, char const *format,
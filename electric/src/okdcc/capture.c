@@ -0,0 +1,119 @@
+#include "electric_internal.h"
+
+#if defined(ESP_PLATFORM)
+#include <esp_rom_sys.h>
+#include <esp_timer.h>
+#if 5 <= ESP_IDF_VERSION_MAJOR
+#include <esp_cpu.h>
+#else
+#include <hal/cpu_hal.h>
+#endif
+#else
+#include <time.h>
+#endif
+
+#if defined(ESP_PLATFORM)
+
+uint32_t dcc_electric_ticks(void) {
+  // CPU のサイクル数で数マイクロ秒の割り込みも計れる
+#if 5 <= ESP_IDF_VERSION_MAJOR
+  return (uint32_t) esp_cpu_get_cycle_count();
+#else
+  return cpu_hal_get_cycle_count();
+#endif
+}
+
+uint64_t dcc_electric_ticksToNanoSec(uint32_t const ticks) {
+  return (uint64_t) ticks * UINT64_C(1000) / esp_rom_get_cpu_ticks_per_us();
+}
+
+uint64_t dcc_electric_nowNanoSec(void) { return (uint64_t) esp_timer_get_time() * UINT64_C(1000); }
+
+#define LOCK_STATS(capture) portENTER_CRITICAL_SAFE(&(capture)->statsLock)
+#define UNLOCK_STATS(capture) portEXIT_CRITICAL_SAFE(&(capture)->statsLock)
+
+#else
+
+uint64_t dcc_electric_nowNanoSec(void) {
+  struct timespec time;
+  clock_gettime(CLOCK_MONOTONIC, &time);
+  return (uint64_t) time.tv_sec * UINT64_C(1000000000) + (uint64_t) time.tv_nsec;
+}
+
+uint32_t dcc_electric_ticks(void) { return (uint32_t) dcc_electric_nowNanoSec(); }
+
+uint64_t dcc_electric_ticksToNanoSec(uint32_t const ticks) { return ticks; }
+
+// 再生は呼び出したスレッドで動くので排他しない
+#define LOCK_STATS(capture) ((void) (capture))
+#define UNLOCK_STATS(capture) ((void) (capture))
+
+#endif
+
+void dcc_electric_initializeCapture(struct dcc_electric_Capture *const capture,
+                                    struct dcc_electric_CaptureBackend const *const backend, void *const state,
+                                    dcc_electric_PeriodsCallback const callback, void *const context) {
+  capture->backend = backend;
+  capture->state = state;
+  capture->callback = callback;
+  capture->context = context;
+  capture->error = 0;
+  capture->stats = (struct dcc_electric_CaptureStats){ 0 };
+  capture->statsResetNanoSec = dcc_electric_nowNanoSec();
+#if defined(ESP_PLATFORM)
+  portMUX_INITIALIZE(&capture->statsLock);
+#endif
+}
+
+void dcc_electric_deliverPeriods(struct dcc_electric_Capture *const capture, dcc_HalfBitPeriod const *const periods,
+                                 size_t const size, uint32_t const since) {
+  if (size != 0) capture->callback(periods, size, capture->context);
+  uint32_t gapsCount = 0;
+  for (size_t i = 0; i < size; i++) {
+    if (periods[i] == DCC_HALF_BIT_PERIOD_MAX) gapsCount++;
+  }
+  uint64_t const busy = dcc_electric_ticksToNanoSec(dcc_electric_ticks() - since);
+  LOCK_STATS(capture);
+  struct dcc_electric_CaptureStats *const stats = &capture->stats;
+  stats->batchesCount++;
+  stats->periodsCount += size;
+  stats->gapsCount += gapsCount;
+  if (stats->maxBatchSize < size) stats->maxBatchSize = (uint32_t) size;
+  stats->busyNanoSec += busy;
+  UNLOCK_STATS(capture);
+}
+
+enum dcc_Result dcc_electric_startCapture(struct dcc_electric_Capture *const capture) {
+  return capture->backend->start(capture);
+}
+
+enum dcc_Result dcc_electric_pollCapture(struct dcc_electric_Capture *const capture) {
+  if (capture->backend->poll == NULL) return dcc_Success;
+  return capture->backend->poll(capture);
+}
+
+enum dcc_Result dcc_electric_stopCapture(struct dcc_electric_Capture *const capture) {
+  return capture->backend->stop(capture);
+}
+
+enum dcc_Result dcc_electric_closeCapture(struct dcc_electric_Capture *const capture) {
+  return capture->backend->close(capture);
+}
+
+struct dcc_electric_CaptureStats dcc_electric_getCaptureStats(struct dcc_electric_Capture *const capture) {
+  uint64_t const now = dcc_electric_nowNanoSec();
+  LOCK_STATS(capture);
+  struct dcc_electric_CaptureStats stats = capture->stats;
+  uint64_t const since = capture->statsResetNanoSec;
+  UNLOCK_STATS(capture);
+  stats.elapsedNanoSec = now - since;
+  return stats;
+}
+
+void dcc_electric_resetCaptureStats(struct dcc_electric_Capture *const capture) {
+  uint64_t const now = dcc_electric_nowNanoSec();
+  LOCK_STATS(capture);
+  capture->stats = (struct dcc_electric_CaptureStats){ 0 };
+  capture->statsResetNanoSec = now;
+  UNLOCK_STATS(capture);
+}
@@ -1 +1,26 @@
 #include "electric.h"
+
+// ティックの数をマイクロ秒に直す
+// `DCC_HALF_BIT_PERIOD_MAX` を超える場合は飽和させる
+static dcc_HalfBitPeriod ticksToPeriod(uint32_t const ticks, uint32_t const resolutionHz) {
+  uint64_t const microSec =
+    resolutionHz == UINT32_C(1000000) ? ticks : (uint64_t) ticks * UINT64_C(1000000) / resolutionHz;
+  return DCC_HALF_BIT_PERIOD_MAX < microSec ? DCC_HALF_BIT_PERIOD_MAX : (dcc_HalfBitPeriod) microSec;
+}
+
+size_t dcc_electric_convertRmtSymbols(uint32_t const *const symbols, size_t const symbolsSize,
+                                      uint32_t const resolutionHz, bool const frameEnd,
+                                      dcc_HalfBitPeriod *const periods) {
+  size_t size = 0;
+  for (size_t i = 0; i < symbolsSize; i++) {
+    uint32_t const duration0 = symbols[i] & UINT32_C(0x7FFF);
+    uint32_t const duration1 = (symbols[i] >> 16) & UINT32_C(0x7FFF);
+    // 継続時間 0 は終わりの印
+    if (duration0 == 0) break;
+    periods[size++] = ticksToPeriod(duration0, resolutionHz);
+    if (duration1 == 0) break;
+    periods[size++] = ticksToPeriod(duration1, resolutionHz);
+  }
+  if (frameEnd) periods[size++] = DCC_HALF_BIT_PERIOD_MAX;
+  return size;
+}
@@ -0,0 +1,394 @@
+#ifndef DCC_ELECTRIC_H
+#define DCC_ELECTRIC_H
+
+#include <okdcc/logic.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#if defined(ESP_PLATFORM)
+#include <driver/gpio.h>
+#include <esp_idf_version.h>
+#include <freertos/FreeRTOS.h>
+#include <soc/soc_caps.h>
+#else
+#include <stdio.h>
+#endif
+
+/// \~english
+/// \brief Whether the RMT capture backend is available. It requires the RMT driver of ESP-IDF v5.
+/// \~japanese
+/// \brief RMT による取得のバックエンドが使えるかどうか。ESP-IDF v5 の RMT ドライバーが必要である。
+#if defined(ESP_PLATFORM) && 5 <= ESP_IDF_VERSION_MAJOR
+#define DCC_ELECTRIC_RMT_CAPTURE 1
+#include <driver/rmt_rx.h>
+#else
+#define DCC_ELECTRIC_RMT_CAPTURE 0
+#endif
+
+/// \~english
+/// \brief The resolution of the RMT receiver. One tick is one microsecond.
+/// \~japanese
+/// \brief RMT 受信器の分解能。1ティックが1マイクロ秒である。
+#define DCC_ELECTRIC_RMT_RESOLUTION_HZ UINT32_C(1000000)
+
+/// \~english
+/// \brief The number of RMT symbols received at once.
+/// \~japanese
+/// \brief 一度に受信する RMT シンボルの数。
+#if defined(ESP_PLATFORM) && !SOC_RMT_SUPPORT_DMA && !SOC_RMT_SUPPORT_RX_PINGPONG
+// DMA もピンポン受信もない ESP32 では RMT のメモリーをすべて使う
+#define DCC_ELECTRIC_RMT_SYMBOLS_SIZE 512
+#else
+#define DCC_ELECTRIC_RMT_SYMBOLS_SIZE 1024
+#endif
+
+/// \~english
+/// \brief The maximum number of durations that `dcc_electric_convertRmtSymbols` writes for
+/// `DCC_ELECTRIC_RMT_SYMBOLS_SIZE` symbols.
+/// \~japanese
+/// \brief `DCC_ELECTRIC_RMT_SYMBOLS_SIZE` 個のシンボルに対して `dcc_electric_convertRmtSymbols` が書き込む継続時間の最大数。
+#define DCC_ELECTRIC_RMT_PERIODS_SIZE (2 * DCC_ELECTRIC_RMT_SYMBOLS_SIZE + 1)
+
+/// \~english
+/// \brief To convert RMT symbols into durations of half bits.
+///
+/// A symbol is a 32-bit word of the RMT peripheral: the duration of the first level in bits 0–14, the first level in
+/// bit 15, the duration of the second level in bits 16–30 and the second level in bit 31. A duration of `0` marks the
+/// end of the received data. Since a DCC signal changes its level at every half bit, each duration is the duration of
+/// a half bit regardless of the level.
+///
+/// When `frameEnd` is true, `DCC_HALF_BIT_PERIOD_MAX` is appended so that the decoder does not join the half bits
+/// before and after the edges lost between frames.
+/// \param symbols The symbols.
+/// \param symbolsSize The number of elements in `symbols`.
+/// \param resolutionHz The resolution of the ticks of the durations.
+/// \param frameEnd Whether the edges after `symbols` are lost.
+/// \param periods The durations of half bits (output). It needs `2 * symbolsSize + 1` elements.
+/// \return The number of durations written.
+/// \~japanese
+/// \brief RMT シンボルを半ビットの継続時間に変換する。
+///
+/// シンボルは RMT ペリフェラルの32ビットの語で、ビット0～14が最初のレベルの継続時間、ビット15が最初のレベル、ビット16～30が2番目のレベルの継続時間、ビット31が2番目のレベルである。
+/// 継続時間 `0` は受信したデータの終わりを表す。DCC の信号は半ビットごとにレベルが変わるので、レベルによらずそれぞれの継続時間が半ビットの継続時間である。
+///
+/// `frameEnd` が真のときは、フレームの間で失われた電圧変化の前後の半ビットをデコーダーがつなげないように `DCC_HALF_BIT_PERIOD_MAX` を追加する。
+/// \param symbols シンボルの列。
+/// \param symbolsSize `symbols` の要素数。
+/// \param resolutionHz 継続時間のティックの分解能。
+/// \param frameEnd `symbols` の後の電圧変化が失われているかどうか。
+/// \param periods 半ビットの継続時間（出力）。`2 * symbolsSize + 1` 個の要素が必要。
+/// \return 書き込んだ継続時間の数。
+size_t dcc_electric_convertRmtSymbols(uint32_t const *const symbols, size_t const symbolsSize,
+                                      uint32_t const resolutionHz, bool const frameEnd,
+                                      dcc_HalfBitPeriod *const periods);
+
+/// \~english
+/// \brief A function called with durations of half bits captured.
+///
+/// The hardware backends call it in an interrupt context. The replay backend calls it in `dcc_electric_pollCapture`.
+/// \~japanese
+/// \brief 取得した半ビットの継続時間とともに呼び出される関数。
+///
+/// ハードウェアのバックエンドは割り込みコンテキストで呼び出す。再生のバックエンドは `dcc_electric_pollCapture` の中で呼び出す。
+typedef void (*dcc_electric_PeriodsCallback)(dcc_HalfBitPeriod const *const periods, size_t const size,
+                                             void *const context);
+
+/// \~english
+/// \brief Statistics of a capture to compare backends.
+///
+/// A duration of `DCC_HALF_BIT_PERIOD_MAX` marks edges lost or a signal stopped, so `gapsCount` counts the places where
+/// edges may be lost. `busyNanoSec / elapsedNanoSec` is the share of the CPU time that the capture takes, including
+/// the callback.
+/// \~japanese
+/// \brief バックエンドを比べるための取得の統計。
+///
+/// 継続時間 `DCC_HALF_BIT_PERIOD_MAX` は電圧変化が失われたか信号が止まったことを表すので、`gapsCount`
+/// は電圧変化が失われたかもしれない箇所を数える。`busyNanoSec / elapsedNanoSec` はコールバックを含めて取得が使う CPU 時間の割合である。
+struct dcc_electric_CaptureStats {
+  /// \~english
+  /// \brief The number of times the callback is called.
+  /// \~japanese
+  /// \brief コールバックを呼び出した回数。
+  uint32_t batchesCount;
+  /// \~english
+  /// \brief The number of durations delivered.
+  /// \~japanese
+  /// \brief 渡した継続時間の数。
+  uint64_t periodsCount;
+  /// \~english
+  /// \brief The number of durations of `DCC_HALF_BIT_PERIOD_MAX` delivered.
+  /// \~japanese
+  /// \brief 渡した `DCC_HALF_BIT_PERIOD_MAX` の継続時間の数。
+  uint32_t gapsCount;
+  /// \~english
+  /// \brief The maximum number of durations delivered at once.
+  /// \~japanese
+  /// \brief 一度に渡した継続時間の最大数。
+  uint32_t maxBatchSize;
+  /// \~english
+  /// \brief The time spent in the backend and the callback.
+  /// \~japanese
+  /// \brief バックエンドとコールバックで費やした時間。
+  uint64_t busyNanoSec;
+  /// \~english
+  /// \brief The time since the statistics are reset.
+  /// \~japanese
+  /// \brief 統計をリセットしてからの時間。
+  uint64_t elapsedNanoSec;
+};
+
+struct dcc_electric_Capture;
+
+/// \~english
+/// \brief The operations of a capture backend.
+///
+/// Each operation returns `dcc_Failure` with `error` of the capture set on failure.
+/// \~japanese
+/// \brief 取得のバックエンドの操作。
+///
+/// それぞれの操作は失敗すると取得の `error` を設定して `dcc_Failure` を返す。
+struct dcc_electric_CaptureBackend {
+  /// \~english
+  /// \brief The name to show.
+  /// \~japanese
+  /// \brief 表示する名前。
+  char const *name;
+  enum dcc_Result (*start)(struct dcc_electric_Capture *const capture);
+  /// \~english
+  /// \brief It is `NULL` for backends driven by interrupts.
+  /// \~japanese
+  /// \brief 割り込みで動くバックエンドでは `NULL` である。
+  enum dcc_Result (*poll)(struct dcc_electric_Capture *const capture);
+  enum dcc_Result (*stop)(struct dcc_electric_Capture *const capture);
+  enum dcc_Result (*close)(struct dcc_electric_Capture *const capture);
+};
+
+/// \~english
+/// \brief A capture of edges through a backend.
+///
+/// It is opened by the function of each backend such as `dcc_electric_openRmtCapture`. The rest of the operations do
+/// not depend on the backend, so the same decoding pipeline runs on hardware and on a PC.
+/// \~japanese
+/// \brief バックエンドを通した電圧変化の取得。
+///
+/// `dcc_electric_openRmtCapture` などのそれぞれのバックエンドの関数で開く。それ以外の操作はバックエンドによらないので、同じデコードの流れがハードウェアでも
+/// PC でも動く。
+struct dcc_electric_Capture {
+  struct dcc_electric_CaptureBackend const *backend;
+  /// \~english
+  /// \brief The state of the backend.
+  /// \~japanese
+  /// \brief バックエンドの状態。
+  void *state;
+  dcc_electric_PeriodsCallback callback;
+  void *context;
+  /// \~english
+  /// \brief The error of the last failed operation: `esp_err_t` on ESP-IDF, `errno` otherwise, and `0` at the end of a
+  /// replay.
+  /// \~japanese
+  /// \brief 最後に失敗した操作のエラー。ESP-IDF では `esp_err_t`、それ以外では `errno`、再生の終わりでは `0` である。
+  int error;
+  struct dcc_electric_CaptureStats stats;
+  uint64_t statsResetNanoSec;
+#if defined(ESP_PLATFORM)
+  portMUX_TYPE statsLock;
+#endif
+};
+
+/// \~english
+/// \brief To start capturing.
+/// \~japanese
+/// \brief 取得を開始する。
+enum dcc_Result dcc_electric_startCapture(struct dcc_electric_Capture *const capture);
+
+/// \~english
+/// \brief To capture edges that the backend does not get by interrupts.
+///
+/// It does nothing for backends driven by interrupts.
+/// \return `dcc_Failure` on error or at the end of a replay.
+/// \~japanese
+/// \brief バックエンドが割り込みで得ない電圧変化を取得する。
+///
+/// 割り込みで動くバックエンドでは何もしない。
+/// \return エラーのときか再生の終わりで `dcc_Failure`。
+enum dcc_Result dcc_electric_pollCapture(struct dcc_electric_Capture *const capture);
+
+/// \~english
+/// \brief To stop capturing.
+/// \~japanese
+/// \brief 取得を停止する。
+enum dcc_Result dcc_electric_stopCapture(struct dcc_electric_Capture *const capture);
+
+/// \~english
+/// \brief To close the capture.
+/// \~japanese
+/// \brief 取得を閉じる。
+enum dcc_Result dcc_electric_closeCapture(struct dcc_electric_Capture *const capture);
+
+/// \~english
+/// \brief To get a snapshot of the statistics.
+///
+/// It can be called while capturing.
+/// \~japanese
+/// \brief 統計のスナップショットを得る。
+///
+/// 取得中に呼び出してよい。
+struct dcc_electric_CaptureStats dcc_electric_getCaptureStats(struct dcc_electric_Capture *const capture);
+
+/// \~english
+/// \brief To reset the statistics.
+/// \~japanese
+/// \brief 統計をリセットする。
+void dcc_electric_resetCaptureStats(struct dcc_electric_Capture *const capture);
+
+#if defined(ESP_PLATFORM)
+
+/// \~english
+/// \brief A structure that holds the state of capturing edges with GPIO interrupts.
+///
+/// An interrupt occurs at every edge and the durations include the jitter of the interrupt latency.
+/// \~japanese
+/// \brief GPIO 割り込みで電圧変化を取得する状態を保持する構造体。
+///
+/// 電圧変化ごとに割り込みが起こり、継続時間には割り込み遅延の揺らぎが含まれる。
+struct dcc_electric_GpioCapture {
+  gpio_num_t gpio;
+  dcc_TimeMicroSec lastSignal;
+  bool lastSignalExists;
+};
+
+/// \~english
+/// \brief To open a capture with GPIO interrupts.
+/// \param capture The capture to open.
+/// \param state The place to store the state of the backend. It must live until it is closed.
+/// \param gpio The GPIO of the DCC signal.
+/// \param callback The function called with the captured durations.
+/// \param context The value passed to `callback`.
+/// \~japanese
+/// \brief GPIO 割り込みによる取得を開く。
+/// \param capture 開く取得。
+/// \param state バックエンドの状態を保持する場所。閉じるまで存在しなければならない。
+/// \param gpio DCC 信号の GPIO。
+/// \param callback 取得した継続時間とともに呼び出される関数。
+/// \param context `callback` に渡される値。
+enum dcc_Result dcc_electric_openGpioCapture(struct dcc_electric_Capture *const capture,
+                                             struct dcc_electric_GpioCapture *const state, gpio_num_t const gpio,
+                                             dcc_electric_PeriodsCallback const callback, void *const context);
+
+#endif
+
+#if DCC_ELECTRIC_RMT_CAPTURE
+
+/// \~english
+/// \brief A structure that holds the state of capturing edges with the RMT receiver.
+///
+/// The RMT peripheral timestamps the edges in hardware, so the durations have no interrupt latency jitter and an
+/// interrupt occurs only once per block of symbols. DMA is used on chips that support it. Chips without DMA but with
+/// ping-pong reception receive continuously through the RMT memory. On the original ESP32, which has neither, a few
+/// edges are lost each time the memory is full.
+///
+/// The callback and the conversion run from flash in the RMT interrupt, so the IRAM-safe RMT ISR configuration
+/// (`CONFIG_RMT_ISR_IRAM_SAFE`) is not supported and is rejected at compile time.
+/// \~japanese
+/// \brief RMT 受信器で電圧変化を取得する状態を保持する構造体。
+///
+/// RMT ペリフェラルがハードウェアで電圧変化の時刻を記録するので継続時間に割り込み遅延の揺らぎがなく、割り込みはシンボルの塊ごとに1回しか起こらない。DMA
+/// に対応したチップでは DMA を使う。DMA はないがピンポン受信に対応したチップでは RMT のメモリーを通して途切れなく受信する。どちらもない初代 ESP32
+/// ではメモリーがいっぱいになるたびにいくつかの電圧変化が失われる。
+///
+/// コールバックや変換は RMT の割り込みの中でフラッシュから実行されるので、IRAM に置いた RMT の割り込み処理の設定（`CONFIG_RMT_ISR_IRAM_SAFE`）には対応せず、コンパイル時に拒否する。
+struct dcc_electric_RmtCapture {
+  rmt_channel_handle_t channel;
+  rmt_symbol_word_t symbols[DCC_ELECTRIC_RMT_SYMBOLS_SIZE];
+  dcc_HalfBitPeriod periods[DCC_ELECTRIC_RMT_PERIODS_SIZE];
+};
+
+/// \~english
+/// \brief To open a capture with the RMT receiver.
+/// \param capture The capture to open.
+/// \param state The place to store the state of the backend. It must live until it is closed.
+/// \param gpio The GPIO of the DCC signal.
+/// \param callback The function called with the captured durations.
+/// \param context The value passed to `callback`.
+/// \~japanese
+/// \brief RMT 受信器による取得を開く。
+/// \param capture 開く取得。
+/// \param state バックエンドの状態を保持する場所。閉じるまで存在しなければならない。
+/// \param gpio DCC 信号の GPIO。
+/// \param callback 取得した継続時間とともに呼び出される関数。
+/// \param context `callback` に渡される値。
+enum dcc_Result dcc_electric_openRmtCapture(struct dcc_electric_Capture *const capture,
+                                            struct dcc_electric_RmtCapture *const state, gpio_num_t const gpio,
+                                            dcc_electric_PeriodsCallback const callback, void *const context);
+
+#endif
+
+#if !defined(ESP_PLATFORM)
+
+/// \~english
+/// \brief The format of a recording to replay.
+/// \~japanese
+/// \brief 再生する記録の形式。
+enum dcc_electric_ReplayFormat {
+  /// \~english
+  /// \brief Durations of half bits in microseconds as 16-bit little endian integers.
+  /// \~japanese
+  /// \brief マイクロ秒単位の半ビットの継続時間を16ビットのリトルエンディアンの整数で並べたもの。
+  dcc_electric_ReplayFormat_Periods,
+  /// \~english
+  /// \brief RMT symbols of `DCC_ELECTRIC_RMT_RESOLUTION_HZ` as 32-bit little endian integers.
+  /// \~japanese
+  /// \brief `DCC_ELECTRIC_RMT_RESOLUTION_HZ` の RMT シンボルを32ビットのリトルエンディアンの整数で並べたもの。
+  dcc_electric_ReplayFormat_RmtSymbols,
+};
+
+/// \~english
+/// \brief The number of bytes read from a recording at once.
+/// \~japanese
+/// \brief 記録から一度に読むバイト数。
+#define DCC_ELECTRIC_REPLAY_CHUNK_SIZE (4 * DCC_ELECTRIC_RMT_SYMBOLS_SIZE)
+
+/// \~english
+/// \brief A structure that holds the state of replaying a recording from a file or a pipe.
+/// \~japanese
+/// \brief ファイルかパイプから記録を再生する状態を保持する構造体。
+struct dcc_electric_ReplayCapture {
+  FILE *stream;
+  enum dcc_electric_ReplayFormat format;
+  bool running;
+  uint8_t bytes[DCC_ELECTRIC_REPLAY_CHUNK_SIZE];
+  size_t bytesSize;
+  uint32_t symbols[DCC_ELECTRIC_RMT_SYMBOLS_SIZE];
+  dcc_HalfBitPeriod periods[DCC_ELECTRIC_RMT_PERIODS_SIZE];
+};
+
+/// \~english
+/// \brief To open a capture that replays a recording.
+///
+/// Each call of `dcc_electric_pollCapture` reads a chunk of `stream` and calls `callback` with it. It blocks until
+/// the chunk is filled or the stream ends.
+/// \param capture The capture to open.
+/// \param state The place to store the state of the backend. It must live until it is closed.
+/// \param stream The recording. It is not closed by the capture.
+/// \param format The format of the recording.
+/// \param callback The function called with the captured durations.
+/// \param context The value passed to `callback`.
+/// \~japanese
+/// \brief 記録を再生する取得を開く。
+///
+/// `dcc_electric_pollCapture` を呼び出すたびに `stream` の塊を読んで `callback` を呼び出す。塊が埋まるかストリームが終わるまで待つ。
+/// \param capture 開く取得。
+/// \param state バックエンドの状態を保持する場所。閉じるまで存在しなければならない。
+/// \param stream 記録。取得はこれを閉じない。
+/// \param format 記録の形式。
+/// \param callback 取得した継続時間とともに呼び出される関数。
+/// \param context `callback` に渡される値。
+enum dcc_Result dcc_electric_openReplayCapture(struct dcc_electric_Capture *const capture,
+                                               struct dcc_electric_ReplayCapture *const state, FILE *const stream,
+                                               enum dcc_electric_ReplayFormat const format,
+                                               dcc_electric_PeriodsCallback const callback, void *const context);
+
+#endif
+
+#endif
@@ -0,0 +1,26 @@
+#ifndef DCC_ELECTRIC_INTERNAL_H
+#define DCC_ELECTRIC_INTERNAL_H
+
+#include "electric.h"
+
+// 短い区間を計るための刻み
+// 一周するので差だけに使う
+uint32_t dcc_electric_ticks(void);
+
+// 刻みの差をナノ秒に直す
+uint64_t dcc_electric_ticksToNanoSec(uint32_t const ticks);
+
+// 長い区間を計るための時刻
+uint64_t dcc_electric_nowNanoSec(void);
+
+// 取得の共通の部分を初期化する
+void dcc_electric_initializeCapture(struct dcc_electric_Capture *const capture,
+                                    struct dcc_electric_CaptureBackend const *const backend, void *const state,
+                                    dcc_electric_PeriodsCallback const callback, void *const context);
+
+// コールバックに継続時間を渡して統計を更新する
+// `since` はバックエンドが処理を始めたときの刻み
+void dcc_electric_deliverPeriods(struct dcc_electric_Capture *const capture, dcc_HalfBitPeriod const *const periods,
+                                 size_t const size, uint32_t const since);
+
+#endif
@@ -0,0 +1,92 @@
+#if defined(ESP_PLATFORM)
+
+#include <esp_timer.h>
+
+#include "electric_internal.h"
+
+static void onVoltageChange(void *const arg) {
+  struct dcc_electric_Capture *const capture = arg;
+  uint32_t const since = dcc_electric_ticks();
+  struct dcc_electric_GpioCapture *const state = capture->state;
+  // 32ビットに切り詰められて約71分ごとに一周するが、`dcc_elapsedTime` は一周を考慮して継続時間を求める
+  dcc_TimeMicroSec const now = (dcc_TimeMicroSec) esp_timer_get_time();
+  bool const lastSignalExists = state->lastSignalExists;
+  dcc_TimeMicroSec const elapsed = dcc_elapsedTime(state->lastSignal, now);
+  state->lastSignal = now;
+  state->lastSignalExists = true;
+  if (!lastSignalExists) return;
+  dcc_HalfBitPeriod const period =
+    DCC_HALF_BIT_PERIOD_MAX < elapsed ? DCC_HALF_BIT_PERIOD_MAX : (dcc_HalfBitPeriod) elapsed;
+  dcc_electric_deliverPeriods(capture, &period, 1, since);
+}
+
+static enum dcc_Result startCapture(struct dcc_electric_Capture *const capture) {
+  struct dcc_electric_GpioCapture *const state = capture->state;
+  state->lastSignalExists = false;
+  esp_err_t const result = gpio_intr_enable(state->gpio);
+  if (ESP_OK == result) return dcc_Success;
+  capture->error = result;
+  return dcc_Failure;
+}
+
+static enum dcc_Result stopCapture(struct dcc_electric_Capture *const capture) {
+  struct dcc_electric_GpioCapture *const state = capture->state;
+  esp_err_t const result = gpio_intr_disable(state->gpio);
+  if (ESP_OK == result) return dcc_Success;
+  capture->error = result;
+  return dcc_Failure;
+}
+
+static enum dcc_Result closeCapture(struct dcc_electric_Capture *const capture) {
+  struct dcc_electric_GpioCapture *const state = capture->state;
+  esp_err_t const result = gpio_isr_handler_remove(state->gpio);
+  if (ESP_OK == result) return dcc_Success;
+  capture->error = result;
+  return dcc_Failure;
+}
+
+static struct dcc_electric_CaptureBackend const backend = {
+  .name = "GPIO",
+  .start = startCapture,
+  .poll = NULL,
+  .stop = stopCapture,
+  .close = closeCapture,
+};
+
+enum dcc_Result dcc_electric_openGpioCapture(struct dcc_electric_Capture *const capture,
+                                             struct dcc_electric_GpioCapture *const state, gpio_num_t const gpio,
+                                             dcc_electric_PeriodsCallback const callback, void *const context) {
+  dcc_electric_initializeCapture(capture, &backend, state, callback, context);
+  state->gpio = gpio;
+  state->lastSignalExists = false;
+  gpio_config_t const config = { .pin_bit_mask = BIT64(gpio),
+                                 .mode = GPIO_MODE_INPUT,
+                                 .pull_up_en = GPIO_PULLUP_DISABLE,
+                                 .pull_down_en = GPIO_PULLDOWN_ENABLE,
+                                 .intr_type = GPIO_INTR_ANYEDGE };
+  esp_err_t result = gpio_config(&config);
+  if (ESP_OK != result) {
+    capture->error = result;
+    return dcc_Failure;
+  }
+  // 開始するまで割り込みを止めておく
+  result = gpio_intr_disable(gpio);
+  if (ESP_OK != result) {
+    capture->error = result;
+    return dcc_Failure;
+  }
+  // ほかで ISR サービスがすでにインストールされていてもよい
+  result = gpio_install_isr_service(ESP_INTR_FLAG_LOWMED);
+  if (ESP_OK != result && ESP_ERR_INVALID_STATE != result) {
+    capture->error = result;
+    return dcc_Failure;
+  }
+  result = gpio_isr_handler_add(gpio, onVoltageChange, capture);
+  if (ESP_OK != result) {
+    capture->error = result;
+    return dcc_Failure;
+  }
+  return dcc_Success;
+}
+
+#endif
@@ -0,0 +1,92 @@
+#if !defined(ESP_PLATFORM)
+
+#include <errno.h>
+#include <string.h>
+
+#include "electric_internal.h"
+
+static size_t unitSize(enum dcc_electric_ReplayFormat const format) {
+  return format == dcc_electric_ReplayFormat_Periods ? 2 : 4;
+}
+
+static enum dcc_Result pollCapture(struct dcc_electric_Capture *const capture) {
+  struct dcc_electric_ReplayCapture *const state = capture->state;
+  if (!state->running) return dcc_Success;
+  size_t const read =
+    fread(state->bytes + state->bytesSize, 1, DCC_ELECTRIC_REPLAY_CHUNK_SIZE - state->bytesSize, state->stream);
+  if (read == 0) {
+    // 終わりに残った半端なバイトは捨てる
+    capture->error = ferror(state->stream) ? (errno == 0 ? EIO : errno) : 0;
+    return dcc_Failure;
+  }
+  uint32_t const since = dcc_electric_ticks();
+  state->bytesSize += read;
+  size_t const unit = unitSize(state->format);
+  size_t const count = state->bytesSize / unit;
+  uint8_t const *const bytes = state->bytes;
+  size_t size;
+  if (state->format == dcc_electric_ReplayFormat_Periods) {
+    for (size_t i = 0; i < count; i++) {
+      state->periods[i] = (dcc_HalfBitPeriod) (bytes[2 * i] | bytes[2 * i + 1] << 8);
+    }
+    size = count;
+  } else {
+    for (size_t i = 0; i < count; i++) {
+      state->symbols[i] = (uint32_t) bytes[4 * i] | (uint32_t) bytes[4 * i + 1] << 8 |
+                          (uint32_t) bytes[4 * i + 2] << 16 | (uint32_t) bytes[4 * i + 3] << 24;
+    }
+    size =
+      dcc_electric_convertRmtSymbols(state->symbols, count, DCC_ELECTRIC_RMT_RESOLUTION_HZ, false, state->periods);
+  }
+  // 単位に満たないバイトは次に読んだバイトとつなげる
+  size_t const rest = state->bytesSize - count * unit;
+  memmove(state->bytes, bytes + count * unit, rest);
+  state->bytesSize = rest;
+  dcc_electric_deliverPeriods(capture, state->periods, size, since);
+  return dcc_Success;
+}
+
+static enum dcc_Result startCapture(struct dcc_electric_Capture *const capture) {
+  struct dcc_electric_ReplayCapture *const state = capture->state;
+  state->running = true;
+  return dcc_Success;
+}
+
+static enum dcc_Result stopCapture(struct dcc_electric_Capture *const capture) {
+  struct dcc_electric_ReplayCapture *const state = capture->state;
+  state->running = false;
+  return dcc_Success;
+}
+
+static enum dcc_Result closeCapture(struct dcc_electric_Capture *const capture) {
+  struct dcc_electric_ReplayCapture *const state = capture->state;
+  state->running = false;
+  state->stream = NULL;
+  return dcc_Success;
+}
+
+static struct dcc_electric_CaptureBackend const backend = {
+  .name = "replay",
+  .start = startCapture,
+  .poll = pollCapture,
+  .stop = stopCapture,
+  .close = closeCapture,
+};
+
+enum dcc_Result dcc_electric_openReplayCapture(struct dcc_electric_Capture *const capture,
+                                               struct dcc_electric_ReplayCapture *const state, FILE *const stream,
+                                               enum dcc_electric_ReplayFormat const format,
+                                               dcc_electric_PeriodsCallback const callback, void *const context) {
+  dcc_electric_initializeCapture(capture, &backend, state, callback, context);
+  if (stream == NULL) {
+    capture->error = EINVAL;
+    return dcc_Failure;
+  }
+  state->stream = stream;
+  state->format = format;
+  state->running = false;
+  state->bytesSize = 0;
+  return dcc_Success;
+}
+
+#endif
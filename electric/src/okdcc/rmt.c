@@ -0,0 +1,115 @@
+#include "electric_internal.h"
+
+#if DCC_ELECTRIC_RMT_CAPTURE
+
+// 受信のコールバックから呼ぶ変換、配送、利用者のコールバックはフラッシュに置かれるので、
+// フラッシュの操作中でも割り込みを処理する設定には対応しない
+#if CONFIG_RMT_ISR_IRAM_SAFE || CONFIG_RMT_RX_ISR_CACHE_SAFE
+#error "The RMT capture backend does not support the IRAM-safe RMT ISR."
+#endif
+
+// ピンポン受信は ESP-IDF v5.3 から使える
+#define PARTIAL_RX (SOC_RMT_SUPPORT_RX_PINGPONG && ESP_IDF_VERSION_VAL(5, 3, 0) <= ESP_IDF_VERSION)
+
+// これより短いパルスはノイズとして捨てる
+#define SIGNAL_RANGE_MIN_NS 2000
+// これより長く電圧が変化しなければフレームの終わりとする
+// 引き伸ばされた `0` ビットより長くする
+#define SIGNAL_RANGE_MAX_NS 20000000
+
+static rmt_receive_config_t const receiveConfig = {
+  .signal_range_min_ns = SIGNAL_RANGE_MIN_NS,
+  .signal_range_max_ns = SIGNAL_RANGE_MAX_NS,
+#if PARTIAL_RX
+  .flags = { .en_partial_rx = true },
+#endif
+};
+
+static bool onReceiveDone(rmt_channel_handle_t channel, rmt_rx_done_event_data_t const *const data,
+                          void *const userData) {
+  uint32_t const since = dcc_electric_ticks();
+  struct dcc_electric_Capture *const capture = userData;
+  struct dcc_electric_RmtCapture *const state = capture->state;
+#if PARTIAL_RX
+  bool const frameEnd = data->flags.is_last;
+#else
+  // ピンポン受信ができなければメモリーがいっぱいになるたびに受信し直すので、その間の電圧変化は失われる
+  bool const frameEnd = true;
+#endif
+  size_t const size = dcc_electric_convertRmtSymbols((uint32_t const *) data->received_symbols,
+                                                     data->num_symbols,
+                                                     DCC_ELECTRIC_RMT_RESOLUTION_HZ,
+                                                     frameEnd,
+                                                     state->periods);
+  if (frameEnd) rmt_receive(channel, state->symbols, sizeof(state->symbols), &receiveConfig);
+  dcc_electric_deliverPeriods(capture, state->periods, size, since);
+  return false;
+}
+
+static enum dcc_Result startCapture(struct dcc_electric_Capture *const capture) {
+  struct dcc_electric_RmtCapture *const state = capture->state;
+  esp_err_t result = rmt_enable(state->channel);
+  if (ESP_OK == result) result = rmt_receive(state->channel, state->symbols, sizeof(state->symbols), &receiveConfig);
+  if (ESP_OK == result) return dcc_Success;
+  capture->error = result;
+  return dcc_Failure;
+}
+
+static enum dcc_Result stopCapture(struct dcc_electric_Capture *const capture) {
+  struct dcc_electric_RmtCapture *const state = capture->state;
+  esp_err_t const result = rmt_disable(state->channel);
+  if (ESP_OK == result) return dcc_Success;
+  capture->error = result;
+  return dcc_Failure;
+}
+
+static enum dcc_Result closeCapture(struct dcc_electric_Capture *const capture) {
+  struct dcc_electric_RmtCapture *const state = capture->state;
+  esp_err_t const result = rmt_del_channel(state->channel);
+  if (ESP_OK == result) return dcc_Success;
+  capture->error = result;
+  return dcc_Failure;
+}
+
+static struct dcc_electric_CaptureBackend const backend = {
+  .name = "RMT",
+  .start = startCapture,
+  .poll = NULL,
+  .stop = stopCapture,
+  .close = closeCapture,
+};
+
+enum dcc_Result dcc_electric_openRmtCapture(struct dcc_electric_Capture *const capture,
+                                            struct dcc_electric_RmtCapture *const state, gpio_num_t const gpio,
+                                            dcc_electric_PeriodsCallback const callback, void *const context) {
+  dcc_electric_initializeCapture(capture, &backend, state, callback, context);
+  rmt_rx_channel_config_t const channelConfig = {
+    .gpio_num = gpio,
+    .clk_src = RMT_CLK_SRC_DEFAULT,
+    .resolution_hz = DCC_ELECTRIC_RMT_RESOLUTION_HZ,
+#if SOC_RMT_SUPPORT_DMA
+    .mem_block_symbols = DCC_ELECTRIC_RMT_SYMBOLS_SIZE,
+    .flags = { .with_dma = true },
+#elif PARTIAL_RX
+    // ピンポン受信では1ブロックのメモリーを半分ずつ使う
+    .mem_block_symbols = SOC_RMT_MEM_WORDS_PER_CHANNEL,
+#else
+    .mem_block_symbols = DCC_ELECTRIC_RMT_SYMBOLS_SIZE,
+#endif
+  };
+  esp_err_t result = rmt_new_rx_channel(&channelConfig, &state->channel);
+  if (ESP_OK != result) {
+    capture->error = result;
+    return dcc_Failure;
+  }
+  rmt_rx_event_callbacks_t const callbacks = { .on_recv_done = onReceiveDone };
+  result = rmt_rx_register_event_callbacks(state->channel, &callbacks, capture);
+  if (ESP_OK != result) {
+    rmt_del_channel(state->channel);
+    capture->error = result;
+    return dcc_Failure;
+  }
+  return dcc_Success;
+}
+
+#endif
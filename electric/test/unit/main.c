@@ -0,0 +1,334 @@
+#include <munit.h>
+#include <okdcc/electric.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+
+// RMT シンボルを作る
+static uint32_t makeSymbol(uint32_t const duration0, bool const level0, uint32_t const duration1, bool const level1) {
+  return duration0 | (uint32_t) level0 << 15 | duration1 << 16 | (uint32_t) level1 << 31;
+}
+
+static MunitResult test_convertRmtSymbols_splits_symbols(MunitParameter const params[], void *fixture) {
+  uint32_t const symbols[] = { makeSymbol(58, true, 58, false), makeSymbol(100, true, 101, false) };
+  dcc_HalfBitPeriod periods[5];
+  munit_assert_size(4, ==, dcc_electric_convertRmtSymbols(symbols, 2, DCC_ELECTRIC_RMT_RESOLUTION_HZ, false, periods));
+  munit_assert_uint16(58, ==, periods[0]);
+  munit_assert_uint16(58, ==, periods[1]);
+  munit_assert_uint16(100, ==, periods[2]);
+  munit_assert_uint16(101, ==, periods[3]);
+  return MUNIT_OK;
+}
+
+static MunitResult test_convertRmtSymbols_stops_at_end_marker(MunitParameter const params[], void *fixture) {
+  uint32_t const symbols[] = { makeSymbol(58, true, 58, false), makeSymbol(100, true, 0, false),
+                               makeSymbol(58, true, 58, false) };
+  dcc_HalfBitPeriod periods[7];
+  munit_assert_size(4, ==, dcc_electric_convertRmtSymbols(symbols, 3, DCC_ELECTRIC_RMT_RESOLUTION_HZ, true, periods));
+  munit_assert_uint16(100, ==, periods[2]);
+  munit_assert_uint16(DCC_HALF_BIT_PERIOD_MAX, ==, periods[3]);
+  return MUNIT_OK;
+}
+
+static MunitResult test_convertRmtSymbols_scales_resolution(MunitParameter const params[], void *fixture) {
+  uint32_t const symbols[] = { makeSymbol(580, true, 1000, false) };
+  dcc_HalfBitPeriod periods[3];
+  munit_assert_size(2, ==, dcc_electric_convertRmtSymbols(symbols, 1, UINT32_C(10000000), false, periods));
+  munit_assert_uint16(58, ==, periods[0]);
+  munit_assert_uint16(100, ==, periods[1]);
+  munit_assert_size(2, ==, dcc_electric_convertRmtSymbols(symbols, 1, UINT32_C(1000), false, periods));
+  munit_assert_uint16(DCC_HALF_BIT_PERIOD_MAX, ==, periods[0]);
+  return MUNIT_OK;
+}
+
+#define REPLAY_PACKETS_SIZE 64
+#define REPLAY_SYMBOLS_CAPACITY (REPLAY_PACKETS_SIZE * DCC_WAVEFORM_PERIODS_CAPACITY / 2)
+
+// 速度パケットの列を RMT が記録するシンボルの列にする
+// 半ビットの継続時間には ±2 µs の揺らぎを加える
+static size_t makeRecordedSymbols(uint32_t *const symbols) {
+  size_t symbolsSize = 0;
+  uint32_t pending = 0;
+  bool level = true;
+  for (size_t i = 0; i < REPLAY_PACKETS_SIZE; i++) {
+    struct dcc_Packet const packet = {
+      .tag = dcc_SpeedAndDirectionPacketForMultiFunctionDecodersTag,
+      .speedAndDirectionPacketForMultiFunctionDecoders = { .address = (dcc_AddressForExtendedPacket) (1000 + i),
+                                                           .direction = dcc_Forward,
+                                                           .speed5Bit = (dcc_Speed5Bit) (i % 28 + 1) },
+    };
+    dcc_Byte bytes[DCC_BIT_STREAM_PARSER_BYTES_CAPACITY];
+    size_t bytesSize;
+    munit_assert_int(dcc_Success, ==, dcc_encodePacket(packet, bytes, &bytesSize));
+    struct dcc_WaveformGenerator generator =
+      dcc_initializeWaveformGenerator(bytes, bytesSize, DCC_PREAMBLE_SENT_BITS_COUNT);
+    dcc_HalfBitPeriod periods[DCC_WAVEFORM_PERIODS_CAPACITY];
+    size_t const periodsSize = dcc_generateHalfBitPeriods(&generator, periods, DCC_WAVEFORM_PERIODS_CAPACITY);
+    for (size_t j = 0; j < periodsSize; j++) {
+      uint32_t const duration = (uint32_t) (periods[j] + munit_rand_int_range(-2, 2));
+      if (pending == 0) {
+        pending = duration | (uint32_t) level << 15;
+      } else {
+        symbols[symbolsSize++] = pending | (duration | (uint32_t) level << 15) << 16;
+        pending = 0;
+      }
+      level = !level;
+    }
+  }
+  return symbolsSize;
+}
+
+// 記録したシンボルの塊を変換してデコーダーに入力し、すべてのパケットが得られることを確かめる
+static MunitResult test_replay_decodes_every_packet(MunitParameter const params[], void *fixture) {
+  static uint32_t symbols[REPLAY_SYMBOLS_CAPACITY];
+  size_t const symbolsSize = makeRecordedSymbols(symbols);
+  struct dcc_Decoder decoder = dcc_initializeDecoder(NULL, 0);
+  size_t decodedCount = 0;
+  size_t index = 0;
+  while (index < symbolsSize) {
+    // 割り込みごとに届く塊の大きさは一定でない
+    size_t blockSize = (size_t) munit_rand_int_range(1, 64);
+    if (symbolsSize - index < blockSize) blockSize = symbolsSize - index;
+    dcc_HalfBitPeriod periods[2 * 64 + 1];
+    size_t const periodsSize =
+      dcc_electric_convertRmtSymbols(symbols + index, blockSize, DCC_ELECTRIC_RMT_RESOLUTION_HZ, false, periods);
+    index += blockSize;
+    size_t consumed = 0;
+    while (consumed < periodsSize) {
+      struct dcc_Packet packets[4];
+      size_t packetsCount;
+      consumed +=
+        dcc_decodePeriodBatch(&decoder, periods + consumed, periodsSize - consumed, packets, 4, &packetsCount);
+      for (size_t i = 0; i < packetsCount; i++) {
+        munit_assert_int(dcc_SpeedAndDirectionPacketForMultiFunctionDecodersTag, ==, packets[i].tag);
+        munit_assert_size(1000 + decodedCount, ==, packets[i].speedAndDirectionPacketForMultiFunctionDecoders.address);
+        decodedCount++;
+      }
+    }
+  }
+  munit_assert_size(REPLAY_PACKETS_SIZE, ==, decodedCount);
+  return MUNIT_OK;
+}
+
+// フレームの終わりで失われた電圧変化をまたいでパケットをつなげないことを確かめる
+static MunitResult test_replay_frame_end_drops_only_broken_packet(MunitParameter const params[], void *fixture) {
+  static uint32_t symbols[REPLAY_SYMBOLS_CAPACITY];
+  size_t const symbolsSize = makeRecordedSymbols(symbols);
+  struct dcc_Decoder decoder = dcc_initializeDecoder(NULL, 0);
+  size_t decodedCount = 0;
+  // 途中の 2 つのシンボルを失う
+  size_t const lostIndex = symbolsSize / 2;
+  size_t const starts[2] = { 0, lostIndex + 2 };
+  size_t const ends[2] = { lostIndex, symbolsSize };
+  for (size_t k = 0; k < 2; k++) {
+    static dcc_HalfBitPeriod periods[2 * REPLAY_SYMBOLS_CAPACITY + 1];
+    size_t const periodsSize = dcc_electric_convertRmtSymbols(
+      symbols + starts[k], ends[k] - starts[k], DCC_ELECTRIC_RMT_RESOLUTION_HZ, k == 0, periods);
+    for (size_t i = 0; i < periodsSize; i++) {
+      struct dcc_Packet packet;
+      if (dcc_StreamParserResult_Success != dcc_decodePeriod(&decoder, periods[i], &packet)) continue;
+      munit_assert_int(dcc_SpeedAndDirectionPacketForMultiFunctionDecodersTag, ==, packet.tag);
+      decodedCount++;
+    }
+  }
+  munit_assert_size(REPLAY_PACKETS_SIZE - 1, ==, decodedCount);
+  return MUNIT_OK;
+}
+
+// 再生した継続時間をデコードする
+struct ReplayDecoding {
+  struct dcc_Decoder decoder;
+  size_t decodedCount;
+  size_t periodsCount;
+};
+
+static void onReplayPeriods(dcc_HalfBitPeriod const *const periods, size_t const size, void *const context) {
+  struct ReplayDecoding *const decoding = context;
+  decoding->periodsCount += size;
+  size_t consumed = 0;
+  while (consumed < size) {
+    struct dcc_Packet packets[4];
+    size_t packetsCount;
+    consumed +=
+      dcc_decodePeriodBatch(&decoding->decoder, periods + consumed, size - consumed, packets, 4, &packetsCount);
+    for (size_t i = 0; i < packetsCount; i++) {
+      munit_assert_int(dcc_SpeedAndDirectionPacketForMultiFunctionDecodersTag, ==, packets[i].tag);
+      munit_assert_size(
+        1000 + decoding->decodedCount, ==, packets[i].speedAndDirectionPacketForMultiFunctionDecoders.address);
+      decoding->decodedCount++;
+    }
+  }
+}
+
+// 記録を最後まで再生する
+static struct ReplayDecoding replay(FILE *const stream, enum dcc_electric_ReplayFormat const format,
+                                    struct dcc_electric_CaptureStats *const stats) {
+  static struct dcc_electric_ReplayCapture state;
+  struct dcc_electric_Capture capture;
+  struct ReplayDecoding decoding = { .decoder = dcc_initializeDecoder(NULL, 0), .decodedCount = 0, .periodsCount = 0 };
+  rewind(stream);
+  munit_assert_int(
+    dcc_Success, ==, dcc_electric_openReplayCapture(&capture, &state, stream, format, onReplayPeriods, &decoding));
+  munit_assert_int(dcc_Success, ==, dcc_electric_startCapture(&capture));
+  while (dcc_Success == dcc_electric_pollCapture(&capture)) continue;
+  munit_assert_int(0, ==, capture.error);
+  *stats = dcc_electric_getCaptureStats(&capture);
+  munit_assert_int(dcc_Success, ==, dcc_electric_stopCapture(&capture));
+  munit_assert_int(dcc_Success, ==, dcc_electric_closeCapture(&capture));
+  return decoding;
+}
+
+static MunitResult test_replayCapture_rmt_symbols_decodes_every_packet(MunitParameter const params[],
+                                                                       void *fixture) {
+  static uint32_t symbols[REPLAY_SYMBOLS_CAPACITY];
+  size_t const symbolsSize = makeRecordedSymbols(symbols);
+  FILE *const stream = tmpfile();
+  munit_assert_not_null(stream);
+  for (size_t i = 0; i < symbolsSize; i++) {
+    uint8_t const bytes[4] = { (uint8_t) symbols[i], (uint8_t) (symbols[i] >> 8), (uint8_t) (symbols[i] >> 16),
+                               (uint8_t) (symbols[i] >> 24) };
+    munit_assert_size(4, ==, fwrite(bytes, 1, 4, stream));
+  }
+  struct dcc_electric_CaptureStats stats;
+  struct ReplayDecoding const decoding = replay(stream, dcc_electric_ReplayFormat_RmtSymbols, &stats);
+  fclose(stream);
+  munit_assert_size(REPLAY_PACKETS_SIZE, ==, decoding.decodedCount);
+  munit_assert_size(2 * symbolsSize, ==, decoding.periodsCount);
+  munit_assert_size(2 * symbolsSize, ==, stats.periodsCount);
+  munit_assert_size((4 * symbolsSize + DCC_ELECTRIC_REPLAY_CHUNK_SIZE - 1) / DCC_ELECTRIC_REPLAY_CHUNK_SIZE, ==,
+                    stats.batchesCount);
+  munit_assert_size(2 * DCC_ELECTRIC_REPLAY_CHUNK_SIZE / 4, ==, stats.maxBatchSize);
+  munit_assert_size(0, ==, stats.gapsCount);
+  munit_assert_size(stats.busyNanoSec, <=, stats.elapsedNanoSec);
+  return MUNIT_OK;
+}
+
+// 16ビットの継続時間の記録は途中で切れていても、読めた分をデコードする
+static MunitResult test_replayCapture_periods_counts_gaps(MunitParameter const params[], void *fixture) {
+  static uint32_t symbols[REPLAY_SYMBOLS_CAPACITY];
+  size_t const symbolsSize = makeRecordedSymbols(symbols);
+  static dcc_HalfBitPeriod periods[2 * REPLAY_SYMBOLS_CAPACITY + 1];
+  size_t const periodsSize =
+    dcc_electric_convertRmtSymbols(symbols, symbolsSize, DCC_ELECTRIC_RMT_RESOLUTION_HZ, true, periods);
+  FILE *const stream = tmpfile();
+  munit_assert_not_null(stream);
+  for (size_t i = 0; i < periodsSize; i++) {
+    uint8_t const bytes[2] = { (uint8_t) periods[i], (uint8_t) (periods[i] >> 8) };
+    munit_assert_size(2, ==, fwrite(bytes, 1, 2, stream));
+  }
+  // 半端なバイトは捨てられる
+  munit_assert_int(0, ==, fputc(0, stream));
+  struct dcc_electric_CaptureStats stats;
+  struct ReplayDecoding const decoding = replay(stream, dcc_electric_ReplayFormat_Periods, &stats);
+  fclose(stream);
+  munit_assert_size(REPLAY_PACKETS_SIZE, ==, decoding.decodedCount);
+  munit_assert_size(periodsSize, ==, stats.periodsCount);
+  munit_assert_size(1, ==, stats.gapsCount);
+  return MUNIT_OK;
+}
+
+static void ignorePeriods(dcc_HalfBitPeriod const *const periods, size_t const size, void *const context) {}
+
+static MunitResult test_replayCapture_resets_stats(MunitParameter const params[], void *fixture) {
+  FILE *const stream = tmpfile();
+  munit_assert_not_null(stream);
+  uint8_t const bytes[] = { 58, 0, 58, 0, 100, 0 };
+  munit_assert_size(sizeof bytes, ==, fwrite(bytes, 1, sizeof bytes, stream));
+  rewind(stream);
+  static struct dcc_electric_ReplayCapture state;
+  struct dcc_electric_Capture capture;
+  enum dcc_Result const opened =
+    dcc_electric_openReplayCapture(&capture, &state, stream, dcc_electric_ReplayFormat_Periods, ignorePeriods, NULL);
+  munit_assert_int(dcc_Success, ==, opened);
+  // 開始するまでは読まない
+  munit_assert_int(dcc_Success, ==, dcc_electric_pollCapture(&capture));
+  munit_assert_size(0, ==, dcc_electric_getCaptureStats(&capture).periodsCount);
+  munit_assert_int(dcc_Success, ==, dcc_electric_startCapture(&capture));
+  munit_assert_int(dcc_Success, ==, dcc_electric_pollCapture(&capture));
+  munit_assert_size(3, ==, dcc_electric_getCaptureStats(&capture).periodsCount);
+  dcc_electric_resetCaptureStats(&capture);
+  struct dcc_electric_CaptureStats const stats = dcc_electric_getCaptureStats(&capture);
+  munit_assert_size(0, ==, stats.periodsCount);
+  munit_assert_size(0, ==, stats.batchesCount);
+  munit_assert_size(0, ==, stats.busyNanoSec);
+  munit_assert_int(dcc_Failure, ==, dcc_electric_pollCapture(&capture));
+  munit_assert_int(0, ==, capture.error);
+  munit_assert_int(dcc_Success, ==, dcc_electric_closeCapture(&capture));
+  fclose(stream);
+  return MUNIT_OK;
+}
+
+static MunitSuite const suite = {
+  "/okdcc/electric",
+  NULL,
+  (MunitSuite[]){
+    { // name, tests, suites, iterations, options
+      "/dcc_electric_convertRmtSymbols",
+      (MunitTest[]){ { "/splits symbols",
+                       test_convertRmtSymbols_splits_symbols,
+                       NULL,
+                       NULL,
+                       MUNIT_TEST_OPTION_NONE,
+                       NULL },
+                     { "/stops at end marker",
+                       test_convertRmtSymbols_stops_at_end_marker,
+                       NULL,
+                       NULL,
+                       MUNIT_TEST_OPTION_NONE,
+                       NULL },
+                     { "/scales resolution",
+                       test_convertRmtSymbols_scales_resolution,
+                       NULL,
+                       NULL,
+                       MUNIT_TEST_OPTION_NONE,
+                       NULL },
+                     { NULL, NULL, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL } },
+      NULL,
+      1,
+      MUNIT_SUITE_OPTION_NONE },
+    { "/replay",
+      (MunitTest[]){ { "/decodes every packet",
+                       test_replay_decodes_every_packet,
+                       NULL,
+                       NULL,
+                       MUNIT_TEST_OPTION_NONE,
+                       NULL },
+                     { "(frame end)/drops only broken packet",
+                       test_replay_frame_end_drops_only_broken_packet,
+                       NULL,
+                       NULL,
+                       MUNIT_TEST_OPTION_NONE,
+                       NULL },
+                     { NULL, NULL, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL } },
+      NULL,
+      1,
+      MUNIT_SUITE_OPTION_NONE },
+    { "/dcc_electric_openReplayCapture",
+      (MunitTest[]){ { "(RMT symbols)/decodes every packet",
+                       test_replayCapture_rmt_symbols_decodes_every_packet,
+                       NULL,
+                       NULL,
+                       MUNIT_TEST_OPTION_NONE,
+                       NULL },
+                     { "(periods)/counts gaps",
+                       test_replayCapture_periods_counts_gaps,
+                       NULL,
+                       NULL,
+                       MUNIT_TEST_OPTION_NONE,
+                       NULL },
+                     { "/resets stats",
+                       test_replayCapture_resets_stats,
+                       NULL,
+                       NULL,
+                       MUNIT_TEST_OPTION_NONE,
+                       NULL },
+                     { NULL, NULL, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL } },
+      NULL,
+      1,
+      MUNIT_SUITE_OPTION_NONE },
+    { NULL, NULL, NULL, 0, MUNIT_SUITE_OPTION_NONE } },
+  1,
+  MUNIT_SUITE_OPTION_NONE
+};
+
+int main(int argc, char *const argv[]) { return munit_suite_main(&suite, NULL, argc, argv); }
@@ -8,6 +8,7 @@
 #define LINE_SIZE 1024
 #define SIGNAL_BUFFER_SIZE 256
 #define LOG_BUFFER_SIZE 1024
+#define PACKETS_SIZE 16
 
 #define LOG(...)                                             \
   {                                                          \
@@ -33,7 +34,6 @@ void error_log(char const *const file, int const line, char const *func, char co
   vfprintf(stderr, format, args);
   va_end(args);
   fprintf(stderr, "\n");
-  exit(EXIT_FAILURE);
 }
 
 char *readTimeMicroSec(char *line, dcc_TimeMicroSec *const timeMicroSec) {
@@ -42,6 +42,15 @@ char *readTimeMicroSec(char *line, dcc_TimeMicroSec *const timeMicroSec) {
   return line + readCharsCount;
 }
 
+// dcc_decode が dcc_StreamParserResult_Failure を返した回数
+// dcc_decodeBatch は失敗を返さないので、統計の各段の失敗の数を足し合わせる
+static size_t countDecodeErrors(struct dcc_DecoderStats const *const stats) {
+  size_t count = stats->timingResyncsCount + stats->preambleResyncsCount + stats->framingErrorsCount +
+                 stats->checksumFailuresCount;
+  for (size_t i = 0; i < DCC_ADDRESS_CLASSES_COUNT; i++) count += stats->unparsedPacketsCounts[i];
+  return count;
+}
+
 int main(void) {
   dcc_debug_log = debug_log;
   dcc_error_log = error_log;
@@ -65,22 +74,30 @@ int main(void) {
     {
       // ここは、マイコンに実装する場合はメインループで実行される部分
       LOG("main loop");
-      dcc_TimeMicroSec signal;
-      while (dcc_Success == dcc_readSignalBuffer(&decoder.signalBuffer, &signal)) {
-        struct dcc_Packet packet;
-        enum dcc_StreamParserResult result = dcc_decode(&decoder, signal, &packet);
-        switch (result) {
-          case dcc_StreamParserResult_Failure:
-            LOG("decode error");
-            continue;
-          case dcc_StreamParserResult_Continue:
-            LOG("decode continue");
-            continue;
-          case dcc_StreamParserResult_Success:
-            dcc_showPacket(logBuffer, LOG_BUFFER_SIZE, packet);
+      struct dcc_SignalSpan spans[2];
+      size_t const spansCount = dcc_readSignalBufferSpans(&decoder.signalBuffer, spans);
+      for (size_t i = 0; i < spansCount; i++) {
+        size_t decodedSize = 0;
+        while (decodedSize < spans[i].size) {
+          struct dcc_Packet packets[PACKETS_SIZE];
+          size_t packetsCount;
+          struct dcc_DecoderStats const since = dcc_getDecoderStats(&decoder);
+          decodedSize += dcc_decodeBatch(&decoder,
+                                         spans[i].signals + decodedSize,
+                                         spans[i].size - decodedSize,
+                                         packets,
+                                         PACKETS_SIZE,
+                                         &packetsCount);
+          struct dcc_DecoderStats const until = dcc_getDecoderStats(&decoder);
+          struct dcc_DecoderStats const stats = dcc_subtractDecoderStats(&until, &since);
+          size_t const errorsCount = countDecodeErrors(&stats);
+          for (size_t j = 0; j < errorsCount; j++) LOG("decode error");
+          for (size_t j = 0; j < packetsCount; j++) {
+            dcc_showPacket(logBuffer, LOG_BUFFER_SIZE, packets[j]);
             LOG("packet: %s", logBuffer);
-            continue;
+          }
         }
+        dcc_releaseSignalBuffer(&decoder.signalBuffer, spans[i].size);
       }
     }
   }
@@ -0,0 +1,79 @@
+#include <okdcc/logic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define BUFFER_SIZE 4096
+
+// app/monitor がテキストで出力していたのと同じ形で出力する
+static void printRecord(struct dcc_PacketRecord const *const record) {
+  char buffer[512] = { 0 };
+  if (record->errors == 0) {
+    dcc_showPacket(buffer, sizeof buffer, record->packet);
+    printf("packet: %lu %s\n", (unsigned long) record->time, buffer);
+  } else {
+    dcc_showBytes(buffer, sizeof buffer, record->bytes, record->bytesSize);
+    printf("failed packet: %lu %s (errors: %u)\n", (unsigned long) record->time, buffer, (unsigned int) record->errors);
+  }
+}
+
+int main(int argc, char *argv[]) {
+  if (2 < argc) {
+    fprintf(stderr,
+            "Usage: %s [FILE]\n"
+            "\n"
+            "FILE is the serial output of app/monitor, which contains binary packet log frames between text lines.\n"
+            "The frames are expanded into the JSON of the packets and the text is copied as is.\n"
+            "It is read from the standard input without FILE.\n",
+            argv[0]);
+    return EXIT_FAILURE;
+  }
+  FILE *const stream = argc == 2 ? fopen(argv[1], "rb") : stdin;
+  if (stream == NULL) {
+    perror(argv[1]);
+    return EXIT_FAILURE;
+  }
+  static dcc_Byte buffer[BUFFER_SIZE];
+  size_t size = 0;
+  struct dcc_PacketLog log = dcc_initializePacketLog();
+  unsigned long recordsCount = 0;
+  unsigned long brokenCount = 0;
+  while (true) {
+    size_t const read = fread(buffer + size, 1, sizeof buffer - size, stream);
+    size += read;
+    size_t offset = 0;
+    while (offset < size) {
+      // フレームの間のテキストはそのまま出力する
+      if (buffer[offset] != DCC_PACKET_LOG_FRAME_MARKER) {
+        dcc_Byte const *const marker = memchr(buffer + offset, DCC_PACKET_LOG_FRAME_MARKER, size - offset);
+        size_t const end = marker == NULL ? size : (size_t) (marker - buffer);
+        fwrite(buffer + offset, 1, end - offset, stdout);
+        offset = end;
+        continue;
+      }
+      struct dcc_PacketRecord record;
+      size_t consumed;
+      enum dcc_StreamParserResult const result =
+        dcc_readPacketLog(&log, buffer + offset, size - offset, &record, &consumed);
+      if (dcc_StreamParserResult_Continue == result) break;
+      if (dcc_StreamParserResult_Success == result) {
+        printRecord(&record);
+        recordsCount++;
+      } else {
+        brokenCount++;
+      }
+      offset += consumed;
+    }
+    memmove(buffer, buffer + offset, size - offset);
+    size -= offset;
+    if (read == 0) break;
+  }
+  if (ferror(stream)) {
+    perror(argc == 2 ? argv[1] : "stdin");
+    return EXIT_FAILURE;
+  }
+  // 途中で終わったフレームも壊れたものとして数える
+  if (size != 0) brokenCount++;
+  fprintf(stderr, "%lu records, %lu broken frames\n", recordsCount, brokenCount);
+  return EXIT_SUCCESS;
+}
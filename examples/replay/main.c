@@ -0,0 +1,96 @@
+#include <okdcc/electric.h>
+#include <okdcc/logic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// 2の冪で、一度に再生する継続時間より多くする
+#define PERIOD_BUFFER_SIZE 4096
+#define PACKETS_SIZE 16
+#define LOG_BUFFER_SIZE 1024
+
+// app/monitor と同じく取得した継続時間をバッファーに書き込む
+void onPeriodsCaptured(dcc_HalfBitPeriod const *const periods, size_t const size, void *const context) {
+  struct dcc_PeriodBuffer *const periodBuffer = context;
+  for (size_t i = 0; i < size; i++) {
+    if (dcc_Failure == dcc_writePeriodBuffer(periodBuffer, periods[i])) {
+      fprintf(stderr, "Failed to write period buffer\n");
+      return;
+    }
+  }
+}
+
+int main(int argc, char *argv[]) {
+  enum dcc_electric_ReplayFormat format = dcc_electric_ReplayFormat_Periods;
+  char const *path = NULL;
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--rmt") == 0) format = dcc_electric_ReplayFormat_RmtSymbols;
+    else if (path == NULL) path = argv[i];
+    else path = "";
+  }
+  if (path != NULL && path[0] == '\0') {
+    fprintf(stderr,
+            "Usage: %s [--rmt] [FILE]\n"
+            "\n"
+            "FILE is a recording of 16-bit little endian durations of half bits, or of RMT symbols with `--rmt`.\n"
+            "It is read from the standard input without FILE.\n",
+            argv[0]);
+    return EXIT_FAILURE;
+  }
+  FILE *const stream = path == NULL ? stdin : fopen(path, "rb");
+  if (stream == NULL) {
+    perror(path);
+    return EXIT_FAILURE;
+  }
+  static dcc_HalfBitPeriod periodBufferValues[PERIOD_BUFFER_SIZE];
+  struct dcc_PeriodBuffer periodBuffer = dcc_initializePeriodBuffer(periodBufferValues, PERIOD_BUFFER_SIZE);
+  struct dcc_Decoder decoder = dcc_initializeDecoder(NULL, 0);
+  static struct dcc_electric_ReplayCapture state;
+  struct dcc_electric_Capture capture;
+  if (dcc_Failure == dcc_electric_openReplayCapture(&capture, &state, stream, format, onPeriodsCaptured, &periodBuffer) ||
+      dcc_Failure == dcc_electric_startCapture(&capture)) {
+    fprintf(stderr, "Failed to open capture: %s\n", strerror(capture.error));
+    return EXIT_FAILURE;
+  }
+  char logBuffer[LOG_BUFFER_SIZE] = { 0 };
+  while (dcc_Success == dcc_electric_pollCapture(&capture)) {
+    struct dcc_PeriodSpan spans[2];
+    size_t const spansCount = dcc_readPeriodBufferSpans(&periodBuffer, spans);
+    for (size_t i = 0; i < spansCount; i++) {
+      size_t decodedSize = 0;
+      while (decodedSize < spans[i].size) {
+        struct dcc_Packet packets[PACKETS_SIZE];
+        size_t packetsCount;
+        decodedSize += dcc_decodePeriodBatch(&decoder,
+                                             spans[i].periods + decodedSize,
+                                             spans[i].size - decodedSize,
+                                             packets,
+                                             PACKETS_SIZE,
+                                             &packetsCount);
+        for (size_t j = 0; j < packetsCount; j++) {
+          dcc_showPacket(logBuffer, LOG_BUFFER_SIZE, packets[j]);
+          printf("%s\n", logBuffer);
+        }
+      }
+      dcc_releasePeriodBuffer(&periodBuffer, spans[i].size);
+    }
+  }
+  int const error = capture.error;
+  struct dcc_electric_CaptureStats const stats = dcc_electric_getCaptureStats(&capture);
+  dcc_electric_closeCapture(&capture);
+  if (stream != stdin) fclose(stream);
+  fprintf(stderr,
+          "%s capture: %llu periods, %lu batches (max %lu), %lu gaps, %llu ns busy in %llu ns\n",
+          capture.backend->name,
+          (unsigned long long) stats.periodsCount,
+          (unsigned long) stats.batchesCount,
+          (unsigned long) stats.maxBatchSize,
+          (unsigned long) stats.gapsCount,
+          (unsigned long long) stats.busyNanoSec,
+          (unsigned long long) stats.elapsedNanoSec);
+  if (error != 0) {
+    fprintf(stderr, "Failed to read: %s\n", strerror(error));
+    return EXIT_FAILURE;
+  }
+  return EXIT_SUCCESS;
+}
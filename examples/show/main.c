@@ -85,6 +85,89 @@ size_t makeExamplePackets(enum dcc_PacketTag const tag, struct dcc_Packet packet
         (struct dcc_Packet){ .tag = dcc_SetExtendedAddressingPacketForMultiFunctionDecodersTag,
                              .setExtendedAddressingPacketForMultiFunctionDecoders = { .address = 2355, .set = true } };
       return i;
+    case dcc_DecoderAcknowledgementRequestPacketForMultiFunctionDecodersTag:
+      packets[i++] = (struct dcc_Packet){
+        .tag = dcc_DecoderAcknowledgementRequestPacketForMultiFunctionDecodersTag,
+        .decoderAcknowledgementRequestPacketForMultiFunctionDecoders = { .address = 2355, .set = true }
+      };
+      return i;
+    case dcc_ConsistControlPacketForMultiFunctionDecodersTag:
+      packets[i++] = (struct dcc_Packet){ .tag = dcc_ConsistControlPacketForMultiFunctionDecodersTag,
+                                          .consistControlPacketForMultiFunctionDecoders = {
+                                            .address = 2355, .direction = dcc_Forward, .consistAddress = 23 } };
+      return i;
+    case dcc_SpeedStep128ControlPacketForMultiFunctionDecodersTag:
+      packets[i++] = (struct dcc_Packet){
+        .tag = dcc_SpeedStep128ControlPacketForMultiFunctionDecodersTag,
+        .speedStep128ControlPacket = { .address = 2355, .direction = dcc_Forward, .speed = 100, .emergencyStop = false }
+      };
+      return i;
+    case dcc_RestrictedSpeedStepPacketForMultiFunctionDecodersTag:
+      packets[i++] = (struct dcc_Packet){
+        .tag = dcc_RestrictedSpeedStepPacketForMultiFunctionDecodersTag,
+        .restrictedSpeedStepPacketForMultiFunctionDecoders = { .address = 2355,
+                                                               .enabled = true,
+                                                               .flControl = false,
+                                                               .speed5Bit = 12 }
+      };
+      return i;
+    case dcc_AnalogFunctionPacketForMultiFunctionDecodersTag:
+      packets[i++] = (struct dcc_Packet){
+        .tag = dcc_AnalogFunctionPacketForMultiFunctionDecodersTag,
+        .analogFunctionPacketForMultiFunctionDecoders = { .address = 2355, .output = 1, .data = 128 }
+      };
+      return i;
+    case dcc_SpeedAndDirectionPacketForMultiFunctionDecodersTag:
+      packets[i++] = (struct dcc_Packet){
+        .tag = dcc_SpeedAndDirectionPacketForMultiFunctionDecodersTag,
+        .speedAndDirectionPacketForMultiFunctionDecoders = { .address = 2355,
+                                                             .direction = dcc_Forward,
+                                                             .flControl = false,
+                                                             .speed5Bit = 23,
+                                                             .emergencyStop = false,
+                                                             .directionMayBeIgnored = false },
+      };
+      return i;
+    case dcc_FunctionGroup1PacketForMultiFunctionDecodersTag:
+      packets[i++] = (struct dcc_Packet){
+        .tag = dcc_FunctionGroup1PacketForMultiFunctionDecodersTag,
+        .functionGroup1PacketForMultiFunctionDecoders = {
+          .address = 2355, .flControl = true, .fl = true, .f1 = true, .f2 = false, .f3 = false, .f4 = true }
+      };
+      return i;
+    case dcc_FunctionGroup2PacketForMultiFunctionDecodersTag:
+      packets[i++] = (struct dcc_Packet){
+        .tag = dcc_FunctionGroup2PacketForMultiFunctionDecodersTag,
+        .functionGroup2PacketForMultiFunctionDecoders = {
+          .address = 2355,
+          .group = dcc_FunctionGroup2Group_F5_F8,
+          .functions = { .f5 = true, .f6 = false, .f7 = true, .f8 = false } }
+      };
+      return i;
+    case dcc_BinaryStateControlLongFormPacketTag:
+      packets[i++] = (struct dcc_Packet){
+        .tag = dcc_BinaryStateControlLongFormPacketTag,
+        .binaryStateControlLongFormPacket = { .address = 2355, .stateAddress = 261, .state = true }
+      };
+      return i;
+    case dcc_BinaryStateControlShortFormPacketTag:
+      packets[i++] = (struct dcc_Packet){
+        .tag = dcc_BinaryStateControlShortFormPacketTag,
+        .binaryStateControlShortFormPacket = { .address = 2355, .stateAddress = 10, .state = false }
+      };
+      return i;
+    case dcc_FunctionControlF13F20PacketTag:
+      packets[i++] = (struct dcc_Packet){
+        .tag = dcc_FunctionControlF13F20PacketTag,
+        .functionControlF13F20Packet = { .address = 2355, .f13 = true, .f20 = true },
+      };
+      return i;
+    case dcc_FunctionControlF21F28PacketTag:
+      packets[i++] = (struct dcc_Packet){
+        .tag = dcc_FunctionControlF21F28PacketTag,
+        .functionControlF21F28Packet = { .address = 2355, .f21 = true, .f28 = true },
+      };
+      return i;
     default:
       fprintf(stderr, "Unsupported packet tag: %d\n", tag);
       exit(EXIT_FAILURE);
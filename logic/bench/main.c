@@ -0,0 +1,654 @@
+// ベンチマーク
+//
+// ホストでは `make bench` で実行する。
+// ESP-IDF のプロジェクトに組み込む場合は ESP_PLATFORM が定義され、app_main から実行される。
+// ただし、このリポジトリにはベンチマークを ESP32 向けにビルドする環境がなく、ESP32 での計測値はまだ得ていない。
+// 計測値はホストでは TSC（x86）またはナノ秒、ESP32 ではCPUサイクル数である。
+
+#include <okdcc/logic_internal.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#if defined(ESP_PLATFORM)
+#include <esp_cpu.h>
+typedef uint32_t Ticks;
+#define TICKS_UNIT "cycles"
+static Ticks now(void) { return esp_cpu_get_cycle_count(); }
+#elif defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+typedef uint64_t Ticks;
+#define TICKS_UNIT "TSC ticks"
+static Ticks now(void) { return __rdtsc(); }
+#else
+typedef uint64_t Ticks;
+#define TICKS_UNIT "ns"
+static Ticks now(void) {
+  struct timespec time;
+  clock_gettime(CLOCK_MONOTONIC, &time);
+  return (Ticks) time.tv_sec * UINT64_C(1000000000) + (Ticks) time.tv_nsec;
+}
+#endif
+
+// ESP32 では入力の配列が DRAM に収まるように小さくする
+#if defined(ESP_PLATFORM)
+#define PERIODS_SIZE (1 << 11)
+#else
+#define PERIODS_SIZE (1 << 20)
+#endif
+#define ITERATIONS 16
+
+// 最適化で計算が消されないように結果を書き込む先
+static volatile unsigned sink;
+
+// 1要素（`item` は "edge" や "bit" など）あたりの計測値を表示する
+static void report(char const *const name, Ticks const ticks, size_t const count, char const *const item) {
+  printf("%-40s %8.2f %s/%s\n", name, (double) ticks / (double) count, TICKS_UNIT, item);
+}
+
+// 再現性のために固定の種を使う線形合同法
+static uint32_t randomState = UINT32_C(1);
+
+static uint32_t nextRandom(void) {
+  randomState = randomState * UINT32_C(1664525) + UINT32_C(1013904223);
+  return randomState >> 8;
+}
+
+// `1` と `0` の半ビットに揺らぎと雑音を混ぜた継続時間の列を作る
+static void makePeriods(dcc_TimeMicroSec *const periods, size_t const size) {
+  for (size_t i = 0; i + 1 < size; i += 2) {
+    uint32_t const r = nextRandom();
+    switch (r % 8) {
+      case 0:  // 雑音
+        periods[i] = nextRandom() % 200;
+        periods[i + 1] = nextRandom() % 200;
+        break;
+      case 1:
+      case 2:
+      case 3:  // `0`
+        periods[i] = 95 + nextRandom() % 10;
+        periods[i + 1] = 95 + nextRandom() % 10;
+        break;
+      default:  // `1`
+        periods[i] = 55 + nextRandom() % 7;
+        periods[i + 1] = 55 + nextRandom() % 7;
+        break;
+    }
+  }
+}
+
+// 比較対象として、範囲の比較を順に行う以前の dcc_decodeSignal を同じ定数で再現したもの
+__attribute__((noinline)) static enum dcc_Result decodeSignalBranchy(dcc_TimeMicroSec const period1,
+                                                                     dcc_TimeMicroSec const period2,
+                                                                     dcc_Bit *const bit) {
+  dcc_TimeMicroSec const diff = period1 > period2 ? period1 - period2 : period2 - period1;
+  if (period1 >= 52UL && period1 <= 64UL && diff <= 6UL) {
+    *bit = 1;
+    return dcc_Success;
+  }
+  if (period1 >= 90UL && period1 <= 10000UL && period2 >= 90UL && period2 <= 10000UL && period1 + period2 <= 12000UL) {
+    *bit = 0;
+    return dcc_Success;
+  }
+  return dcc_Failure;
+}
+
+static void benchDecodeSignal(void) {
+  static dcc_TimeMicroSec periods[PERIODS_SIZE];
+  makePeriods(periods, PERIODS_SIZE);
+  {
+    unsigned result = 0;
+    Ticks const start = now();
+    for (int n = 0; n < ITERATIONS; n++) {
+      for (size_t i = 0; i + 1 < PERIODS_SIZE; i++) {
+        dcc_Bit bit = 0;
+        result += (unsigned) decodeSignalBranchy(periods[i], periods[i + 1], &bit) + bit;
+      }
+    }
+    Ticks const end = now();
+    sink = result;
+    report("dcc_decodeSignal (branchy baseline)", end - start, (size_t) ITERATIONS * (PERIODS_SIZE - 1), "edge");
+  }
+  {
+    unsigned result = 0;
+    Ticks const start = now();
+    for (int n = 0; n < ITERATIONS; n++) {
+      for (size_t i = 0; i + 1 < PERIODS_SIZE; i++) {
+        dcc_Bit bit = 0;
+        result += (unsigned) dcc_decodeSignal(periods[i], periods[i + 1], &bit) + bit;
+      }
+    }
+    Ticks const end = now();
+    sink = result;
+    report("dcc_decodeSignal", end - start, (size_t) ITERATIONS * (PERIODS_SIZE - 1), "edge");
+  }
+}
+
+// プリアンブル、パケット開始ビット、データバイト、パケット終了ビットからなるパケットの半ビットの継続時間の列を作る
+static size_t makePacketPeriods(dcc_Byte const *const bytes, size_t const bytesSize, dcc_HalfBitPeriod *const periods) {
+  size_t size = 0;
+#define PUSH_BIT(bit)                                                               \
+  do {                                                                              \
+    dcc_HalfBitPeriod const halfBit =                                               \
+      (dcc_HalfBitPeriod) ((bit) ? 55 + nextRandom() % 7 : 95 + nextRandom() % 10); \
+    periods[size++] = halfBit;                                                      \
+    periods[size++] = halfBit;                                                      \
+  } while (0)
+  for (int i = 0; i < 14; i++) PUSH_BIT(1);
+  for (size_t i = 0; i < bytesSize; i++) {
+    PUSH_BIT(0);
+    for (int j = 7; 0 <= j; j--) PUSH_BIT((bytes[i] >> j) & 1);
+  }
+  PUSH_BIT(1);
+#undef PUSH_BIT
+  return size;
+}
+
+// 速度とアイドルのパケットが交互に続く信号をデコーダー全体に通す
+static void benchDecodePeriodBatch(void) {
+  static dcc_HalfBitPeriod periods[PERIODS_SIZE];
+  dcc_Byte const packets[2][3] = { { 0x01, 0x6A, 0x6B }, { 0xFF, 0x00, 0xFF } };
+  size_t size = 0;
+  for (size_t i = 0; size + 128 <= PERIODS_SIZE; i++) size += makePacketPeriods(packets[i % 2], 3, periods + size);
+  struct dcc_Decoder decoder = dcc_initializeDecoder(NULL, 0);
+  size_t total = 0;
+  Ticks const start = now();
+  for (int n = 0; n < ITERATIONS; n++) {
+    size_t consumed = 0;
+    while (consumed < size) {
+      struct dcc_Packet decoded[16];
+      size_t count;
+      consumed += dcc_decodePeriodBatch(&decoder, periods + consumed, size - consumed, decoded, 16, &count);
+      total += count;
+    }
+  }
+  Ticks const end = now();
+  sink = (unsigned) total;
+  report("dcc_decodePeriodBatch", end - start, (size_t) ITERATIONS * size, "edge");
+}
+
+// 記録した信号を後から解析する場合を想定し、時刻の列をビットの列にする
+static void benchDecodeSignalsToBits(void) {
+  static dcc_HalfBitPeriod periods[PERIODS_SIZE];
+  static dcc_TimeMicroSec signals[PERIODS_SIZE];
+  static uint32_t bits[PERIODS_SIZE / 32];
+  dcc_Byte const packets[2][3] = { { 0x01, 0x6A, 0x6B }, { 0xFF, 0x00, 0xFF } };
+  size_t size = 0;
+  for (size_t i = 0; size + 128 <= PERIODS_SIZE; i++) size += makePacketPeriods(packets[i % 2], 3, periods + size);
+  dcc_TimeMicroSec time = 0;
+  for (size_t i = 0; i < size; i++) signals[i] = time += periods[i];
+  {
+    struct dcc_SignalStreamParser parser = dcc_initializeSignalStreamParser();
+    size_t total = 0;
+    Ticks const start = now();
+    for (int n = 0; n < ITERATIONS; n++) {
+      for (size_t i = 0; i < size; i++) {
+        dcc_Bit bit;
+        if (dcc_StreamParserResult_Success == dcc_feedSignal(&parser, signals[i], &bit)) total += bit;
+      }
+    }
+    Ticks const end = now();
+    sink = (unsigned) total;
+    report("dcc_feedSignal (one by one)", end - start, (size_t) ITERATIONS * size, "edge");
+  }
+  {
+    struct dcc_SignalStreamParser parser = dcc_initializeSignalStreamParser();
+    struct dcc_ClockRecovery recovery = dcc_initializeClockRecovery(&dcc_defaultReceiveTiming);
+    dcc_attachClockRecovery(&parser, &recovery);
+    size_t total = 0;
+    Ticks const start = now();
+    for (int n = 0; n < ITERATIONS; n++) {
+      for (size_t i = 0; i < size; i++) {
+        dcc_Bit bit;
+        if (dcc_StreamParserResult_Success == dcc_feedSignal(&parser, signals[i], &bit)) total += bit;
+      }
+    }
+    Ticks const end = now();
+    sink = (unsigned) total;
+    report("dcc_feedSignal (clock recovery)", end - start, (size_t) ITERATIONS * size, "edge");
+  }
+  {
+    struct dcc_SignalStreamParser parser = dcc_initializeSignalStreamParser();
+    size_t total = 0;
+    Ticks const start = now();
+    for (int n = 0; n < ITERATIONS; n++) {
+      size_t consumed = 0;
+      while (consumed < size) {
+        size_t bitsSize;
+        consumed += dcc_decodeSignalsToBits(&parser, signals + consumed, size - consumed, bits, size, &bitsSize);
+        total += bitsSize;
+      }
+    }
+    Ticks const end = now();
+    sink = (unsigned) total;
+    report("dcc_decodeSignalsToBits", end - start, (size_t) ITERATIONS * size, "edge");
+  }
+}
+
+// デコードしたビットの列からパケットのバイトを取り出す
+static void benchFeedBits(void) {
+  static dcc_HalfBitPeriod periods[PERIODS_SIZE];
+  static dcc_TimeMicroSec signals[PERIODS_SIZE];
+  static uint32_t bits[PERIODS_SIZE / 32];
+  dcc_Byte const packets[2][3] = { { 0x01, 0x6A, 0x6B }, { 0xFF, 0x00, 0xFF } };
+  size_t size = 0;
+  for (size_t i = 0; size + 128 <= PERIODS_SIZE; i++) size += makePacketPeriods(packets[i % 2], 3, periods + size);
+  dcc_TimeMicroSec time = 0;
+  for (size_t i = 0; i < size; i++) signals[i] = time += periods[i];
+  struct dcc_SignalStreamParser signalParser = dcc_initializeSignalStreamParser();
+  size_t bitsSize;
+  dcc_decodeSignalsToBits(&signalParser, signals, size, bits, PERIODS_SIZE, &bitsSize);
+  {
+    struct dcc_BitStreamParser parser = dcc_initializeBitStreamParser();
+    size_t total = 0;
+    Ticks const start = now();
+    for (int n = 0; n < ITERATIONS; n++) {
+      for (size_t i = 0; i < bitsSize; i++) {
+        dcc_Byte bytes[DCC_BIT_STREAM_PARSER_BYTES_CAPACITY];
+        size_t bytesSize;
+        dcc_Bit const bit = (bits[i / 32] >> (31 - i % 32)) & 1;
+        if (dcc_StreamParserResult_Success == dcc_feedBit(&parser, bit, bytes, &bytesSize)) total += bytesSize;
+      }
+    }
+    Ticks const end = now();
+    sink = (unsigned) total;
+    report("dcc_feedBit (one by one)", end - start, (size_t) ITERATIONS * bitsSize, "bit");
+  }
+  {
+    struct dcc_BitStreamParser parser = dcc_initializeBitStreamParser();
+    size_t total = 0;
+    Ticks const start = now();
+    for (int n = 0; n < ITERATIONS; n++) {
+      size_t position = 0;
+      while (position < bitsSize) {
+        dcc_Byte bytes[DCC_BIT_STREAM_PARSER_BYTES_CAPACITY];
+        size_t bytesSize;
+        if (dcc_StreamParserResult_Success == dcc_feedBits(&parser, bits, &position, bitsSize, bytes, &bytesSize)) {
+          total += bytesSize;
+        }
+      }
+    }
+    Ticks const end = now();
+    sink = (unsigned) total;
+    report("dcc_feedBits", end - start, (size_t) ITERATIONS * bitsSize, "bit");
+  }
+}
+
+// 以前の dcc_parsePacket と同じくパーサーを決まった順に試す比較対象
+__attribute__((noinline)) static enum dcc_Result parsePacketSequential(dcc_Byte const *const bytes,
+                                                                       size_t const bytesSize,
+                                                                       struct dcc_Packet *const packet) {
+  if (dcc_Success == dcc_parseSpeedAndDirectionPacketForLocomotiveDecoders(
+                       bytes, bytesSize, false, &packet->speedAndDirectionPacketForLocomotiveDecoders)) {
+    return dcc_Success;
+  }
+  if (dcc_Success == dcc_parseResetPacketForAllDecoders(bytes, bytesSize)) return dcc_Success;
+  if (dcc_Success == dcc_parseIdlePacketForAllDecoders(bytes, bytesSize)) return dcc_Success;
+  if (dcc_Success ==
+      dcc_parseResetPacketForMultiFunctionDecoders(bytes, bytesSize, &packet->resetPacketForMultiFunctionDecoders)) {
+    return dcc_Success;
+  }
+  if (dcc_Success == dcc_parseHardResetPacketForMultiFunctionDecoders(
+                       bytes, bytesSize, &packet->hardResetPacketForMultiFunctionDecoders)) {
+    return dcc_Success;
+  }
+  if (dcc_Success == dcc_parseDecoderAcknowledgementRequestPacket(
+                       bytes, bytesSize, &packet->decoderAcknowledgementRequestPacketForMultiFunctionDecoders)) {
+    return dcc_Success;
+  }
+  if (dcc_Success == dcc_parseFactoryTestInstructionPacketForMultiFunctionDecoders(
+                       bytes, bytesSize, &packet->factoryTestInstructionPacketForMultiFunctionDecoders)) {
+    return dcc_Success;
+  }
+  if (dcc_Success ==
+      dcc_parseConsistControlPacket(bytes, bytesSize, &packet->consistControlPacketForMultiFunctionDecoders)) {
+    return dcc_Success;
+  }
+  if (dcc_Success == dcc_parseSpeedStep128ControlPacket(bytes, bytesSize, &packet->speedStep128ControlPacket)) {
+    return dcc_Success;
+  }
+  return dcc_Failure;
+}
+
+#if defined(ESP_PLATFORM)
+#define PACKETS_SIZE (1 << 10)
+#else
+#define PACKETS_SIZE (1 << 16)
+#endif
+#define PACKET_BYTES_CAPACITY 6
+
+// 線路上の典型的な構成に近い、速度、ファンクション、アイドルの各パケットを混ぜた列を作る
+// 長さはチェックサムを含む
+static void makePacketMix(dcc_Byte (*const packets)[PACKET_BYTES_CAPACITY], size_t *const sizes, size_t const size) {
+  for (size_t i = 0; i < size; i++) {
+    dcc_Byte *const bytes = packets[i];
+    uint32_t const r = nextRandom();
+    dcc_Byte const shortAddress = (dcc_Byte) (1 + nextRandom() % 127);
+    dcc_Byte const longAddressHigh = (dcc_Byte) (0xC0 | nextRandom() % 0x28);
+    dcc_Byte const longAddressLow = (dcc_Byte) nextRandom();
+    size_t n = 0;
+    switch (r % 16) {
+      case 0:
+      case 1:
+      case 2:
+      case 3:  // アイドル
+        bytes[n++] = 0xFF;
+        bytes[n++] = 0x00;
+        break;
+      case 4:
+      case 5:  // 基本パケットの速度・方向
+        bytes[n++] = shortAddress;
+        bytes[n++] = (dcc_Byte) (0x40 | nextRandom() % 0x40);
+        break;
+      case 6:
+      case 7:
+      case 8:  // 短いアドレスの 128 段階速度
+        bytes[n++] = shortAddress;
+        bytes[n++] = 0x3F;
+        bytes[n++] = (dcc_Byte) nextRandom();
+        break;
+      case 9:
+      case 10:
+      case 11:  // 長いアドレスの 128 段階速度
+        bytes[n++] = longAddressHigh;
+        bytes[n++] = longAddressLow;
+        bytes[n++] = 0x3F;
+        bytes[n++] = (dcc_Byte) nextRandom();
+        break;
+      case 12:
+      case 13:  // 短いアドレスのファンクション
+        bytes[n++] = shortAddress;
+        bytes[n++] = (dcc_Byte) (0x80 | nextRandom() % 0x40);
+        break;
+      default:  // 長いアドレスのファンクション
+        bytes[n++] = longAddressHigh;
+        bytes[n++] = longAddressLow;
+        bytes[n++] = (dcc_Byte) (0x80 | nextRandom() % 0x40);
+        break;
+    }
+    dcc_Byte checksum = 0;
+    for (size_t j = 0; j < n; j++) checksum ^= bytes[j];
+    bytes[n++] = checksum;
+    sizes[i] = n;
+  }
+}
+
+// パケットの種類の判定とパース
+static void benchParsePacket(void) {
+  static dcc_Byte packets[PACKETS_SIZE][PACKET_BYTES_CAPACITY];
+  static size_t sizes[PACKETS_SIZE];
+  makePacketMix(packets, sizes, PACKETS_SIZE);
+  {
+    unsigned result = 0;
+    Ticks const start = now();
+    for (int n = 0; n < ITERATIONS; n++) {
+      for (size_t i = 0; i < PACKETS_SIZE; i++) {
+        struct dcc_Packet packet;
+        result += (unsigned) parsePacketSequential(packets[i], sizes[i], &packet);
+      }
+    }
+    Ticks const end = now();
+    sink = result;
+    report("dcc_parsePacket (sequential baseline)", end - start, (size_t) ITERATIONS * PACKETS_SIZE, "packet");
+  }
+  {
+    unsigned result = 0;
+    Ticks const start = now();
+    for (int n = 0; n < ITERATIONS; n++) {
+      for (size_t i = 0; i < PACKETS_SIZE; i++) {
+        struct dcc_Packet packet;
+        result += (unsigned) dcc_parsePacket(packets[i], sizes[i], &packet);
+      }
+    }
+    Ticks const end = now();
+    sink = result;
+    report("dcc_parsePacket", end - start, (size_t) ITERATIONS * PACKETS_SIZE, "packet");
+  }
+}
+
+#if defined(ESP_PLATFORM)
+#define LOCOMOTIVES_SIZE 16
+#else
+#define LOCOMOTIVES_SIZE 128
+#endif
+
+// 機関車ごとの速度パケットと機能パケットを繰り返し送るときの波形の用意
+static void benchWaveformCache(void) {
+  static struct dcc_WaveformCacheEntry entries[LOCOMOTIVES_SIZE * 4];
+  struct dcc_Packet packets[LOCOMOTIVES_SIZE * 2];
+  for (size_t i = 0; i < LOCOMOTIVES_SIZE; i++) {
+    dcc_AddressForExtendedPacket const address = (dcc_AddressForExtendedPacket) (1000 + i);
+    packets[2 * i] = (struct dcc_Packet){ .tag = dcc_SpeedAndDirectionPacketForMultiFunctionDecodersTag,
+                                          .speedAndDirectionPacketForMultiFunctionDecoders = {
+                                            .address = address, .direction = dcc_Forward, .speed5Bit = 10 } };
+    packets[2 * i + 1] = (struct dcc_Packet){ .tag = dcc_FunctionGroup1PacketForMultiFunctionDecodersTag,
+                                              .functionGroup1PacketForMultiFunctionDecoders = {
+                                                .address = address, .flControl = true, .fl = true } };
+  }
+  size_t const packetsSize = sizeof(packets) / sizeof(packets[0]);
+  {
+    unsigned result = 0;
+    Ticks const start = now();
+    for (int n = 0; n < ITERATIONS; n++) {
+      for (size_t i = 0; i < packetsSize; i++) {
+        dcc_Byte bytes[DCC_BIT_STREAM_PARSER_BYTES_CAPACITY];
+        size_t bytesSize;
+        dcc_encodePacket(packets[i], bytes, &bytesSize);
+        struct dcc_WaveformGenerator generator =
+          dcc_initializeWaveformGenerator(bytes, bytesSize, DCC_PREAMBLE_SENT_BITS_COUNT);
+        struct dcc_Waveform waveform;
+        waveform.size = dcc_generateHalfBitPeriods(&generator, waveform.periods, DCC_WAVEFORM_PERIODS_CAPACITY);
+        result += waveform.periods[waveform.size - 3];
+      }
+    }
+    Ticks const end = now();
+    sink = result;
+    report("encode and generate waveform", end - start, (size_t) ITERATIONS * packetsSize, "packet");
+  }
+  {
+    struct dcc_WaveformCache cache =
+      dcc_initializeWaveformCache(entries, sizeof(entries) / sizeof(entries[0]), DCC_PREAMBLE_SENT_BITS_COUNT);
+    unsigned result = 0;
+    Ticks const start = now();
+    for (int n = 0; n < ITERATIONS; n++) {
+      for (size_t i = 0; i < packetsSize; i++) {
+        struct dcc_Waveform const *waveform;
+        dcc_getWaveform(&cache, packets[i], &waveform);
+        result += waveform->periods[waveform->size - 3];
+      }
+    }
+    Ticks const end = now();
+    sink = result;
+    report("dcc_getWaveform", end - start, (size_t) ITERATIONS * packetsSize, "packet");
+  }
+}
+
+#if defined(ESP_PLATFORM)
+#define SCHEDULER_ADDRESSES_SIZE 50
+#define SCHEDULER_DECODERS_SIZE 64
+#else
+#define SCHEDULER_ADDRESSES_SIZE 2000
+#define SCHEDULER_DECODERS_SIZE 4096
+#endif
+#define SCHEDULER_STEPS (1 << 18)
+
+// 多数のアドレスを巡回しながら速度を変更し、変更から送信までに送ったパケットの数（遅延）を測る
+// 1ステップでパケットを1つ送り、`changesPer1000` / 1000 の確率でどれかの機関車の速度を変える
+static void simulateScheduler(unsigned const changesPer1000) {
+  static struct dcc_SchedulerDecoder decoders[SCHEDULER_DECODERS_SIZE];
+  static size_t changedSteps[SCHEDULER_ADDRESSES_SIZE];
+  static dcc_Speed5Bit speeds[SCHEDULER_ADDRESSES_SIZE];
+  struct dcc_Scheduler scheduler = dcc_initializeScheduler(decoders, SCHEDULER_DECODERS_SIZE, 2, 1);
+  for (size_t i = 0; i < SCHEDULER_ADDRESSES_SIZE; i++) {
+    dcc_AddressForExtendedPacket const address = (dcc_AddressForExtendedPacket) (1000 + i);
+    speeds[i] = 1;
+    dcc_schedulePacket(&scheduler,
+                       (struct dcc_Packet){ .tag = dcc_SpeedAndDirectionPacketForMultiFunctionDecodersTag,
+                                            .speedAndDirectionPacketForMultiFunctionDecoders = {
+                                              .address = address, .direction = dcc_Forward, .speed5Bit = 1 } });
+    dcc_schedulePacket(&scheduler,
+                       (struct dcc_Packet){ .tag = dcc_FunctionGroup1PacketForMultiFunctionDecodersTag,
+                                            .functionGroup1PacketForMultiFunctionDecoders = { .address = address } });
+    changedSteps[i] = SIZE_MAX;
+  }
+  // 初期の待ち行列を送り切る
+  while (scheduler.queueHead != SIZE_MAX) dcc_nextScheduledPacket(&scheduler);
+  size_t latencySum = 0;
+  size_t latencyMax = 0;
+  size_t latenciesCount = 0;
+  Ticks ticks = 0;
+  for (size_t step = 0; step < SCHEDULER_STEPS; step++) {
+    Ticks const start = now();
+    if (nextRandom() % 1000 < changesPer1000) {
+      size_t const i = nextRandom() % SCHEDULER_ADDRESSES_SIZE;
+      speeds[i] = (dcc_Speed5Bit) (speeds[i] % 28 + 1);
+      dcc_schedulePacket(&scheduler,
+                         (struct dcc_Packet){ .tag = dcc_SpeedAndDirectionPacketForMultiFunctionDecodersTag,
+                                              .speedAndDirectionPacketForMultiFunctionDecoders = {
+                                                .address = (dcc_AddressForExtendedPacket) (1000 + i),
+                                                .direction = dcc_Forward,
+                                                .speed5Bit = speeds[i] } });
+      if (changedSteps[i] == SIZE_MAX) changedSteps[i] = step;
+    }
+    struct dcc_Packet const packet = dcc_nextScheduledPacket(&scheduler);
+    ticks += now() - start;
+    if (packet.tag != dcc_SpeedAndDirectionPacketForMultiFunctionDecodersTag) continue;
+    struct dcc_SpeedAndDirectionPacketForMultiFunctionDecoders const *const speed =
+      &packet.speedAndDirectionPacketForMultiFunctionDecoders;
+    size_t const i = (size_t) speed->address - 1000;
+    if (changedSteps[i] == SIZE_MAX || speed->speed5Bit != speeds[i]) continue;
+    size_t const latency = step - changedSteps[i];
+    latencySum += latency;
+    if (latencyMax < latency) latencyMax = latency;
+    latenciesCount++;
+    changedSteps[i] = SIZE_MAX;
+  }
+  char name[64];
+  snprintf(name, sizeof(name), "dcc_Scheduler (%u changes/1000 packets)", changesPer1000);
+  report(name, ticks, SCHEDULER_STEPS, "packet");
+  printf("%-40s %8.2f packets mean, %zu packets max\n",
+         "  latency",
+         latenciesCount == 0 ? 0.0 : (double) latencySum / (double) latenciesCount,
+         latencyMax);
+}
+
+static void benchScheduler(void) {
+  simulateScheduler(10);
+  simulateScheduler(100);
+  simulateScheduler(400);
+}
+
+#define NOISE_PACKETS_SIZE 20000
+#define NOISE_SPIKE_MAX_WIDTH 10
+
+// 以前のデコーダーは断片を合わせず、失敗した組の後半を次のビットの前半として扱い続け、タイミングの失敗でパケットを捨てない
+struct LegacyDecoder {
+  dcc_TimeMicroSec period;
+  bool periodExists;
+  struct dcc_BitStreamParser bitStreamParser;
+};
+
+static bool decodeLegacy(struct LegacyDecoder *const decoder, dcc_TimeMicroSec const period,
+                         struct dcc_BytesView *const bytes) {
+  if (!decoder->periodExists) {
+    decoder->period = period;
+    decoder->periodExists = true;
+    return false;
+  }
+  dcc_Bit bit;
+  if (dcc_Failure == dcc_decodeSignal(decoder->period, period, &bit)) {
+    decoder->period = period;
+    return false;
+  }
+  decoder->periodExists = false;
+  if (dcc_StreamParserResult_Success != dcc_feedBitView(&decoder->bitStreamParser, bit, bytes)) return false;
+  if (dcc_Failure == dcc_validatePacket(bytes->bytes, bytes->size - 1, bytes->bytes[bytes->size - 1])) return false;
+  struct dcc_Packet packet;
+  return dcc_Success == dcc_parsePacket(bytes->bytes, bytes->size, &packet);
+}
+
+// 送ったパケットのどれかと一致するか
+static bool isSentPacket(dcc_Byte const packets[2][3], struct dcc_BytesView const *const bytes) {
+  return bytes->size == 3 && (memcmp(packets[0], bytes->bytes, 3) == 0 || memcmp(packets[1], bytes->bytes, 3) == 0);
+}
+
+// 半ビットに `spikesPer10000` / 10000 の確率で幅の狭いスパイクを入れ、以前のデコーダーと今のデコーダーが失うパケットの割合を測る
+// スパイクは半ビットを3つに分けるので、電圧変化が2つ増える
+static void simulateNoise(unsigned const spikesPer10000) {
+  dcc_Byte const packets[2][3] = { { 0x01, 0x6A, 0x6B }, { 0xFF, 0x00, 0xFF } };
+  struct LegacyDecoder legacy = { 0, false, dcc_initializeBitStreamParser() };
+  struct dcc_Decoder decoder = dcc_initializeDecoder(NULL, 0);
+  size_t legacyCount = 0;
+  size_t legacyFalseCount = 0;
+  size_t count = 0;
+  size_t falseCount = 0;
+  for (size_t i = 0; i < NOISE_PACKETS_SIZE; i++) {
+    dcc_HalfBitPeriod halfBits[128];
+    size_t const halfBitsSize = makePacketPeriods(packets[i % 2], 3, halfBits);
+    for (size_t j = 0; j < halfBitsSize; j++) {
+      dcc_TimeMicroSec periods[3] = { halfBits[j] };
+      size_t periodsSize = 1;
+      if (nextRandom() % 10000 < spikesPer10000) {
+        dcc_TimeMicroSec const width = 1 + nextRandom() % NOISE_SPIKE_MAX_WIDTH;
+        dcc_TimeMicroSec const before = 1 + nextRandom() % (halfBits[j] - width - 1);
+        periods[0] = before;
+        periods[1] = width;
+        periods[2] = halfBits[j] - before - width;
+        periodsSize = 3;
+      }
+      for (size_t k = 0; k < periodsSize; k++) {
+        struct dcc_BytesView bytes;
+        if (decodeLegacy(&legacy, periods[k], &bytes)) {
+          if (isSentPacket(packets, &bytes)) {
+            legacyCount++;
+          } else {
+            legacyFalseCount++;
+          }
+        }
+        struct dcc_Packet packet;
+        if (dcc_StreamParserResult_Success == dcc_decodePeriodView(&decoder, periods[k], &packet, &bytes)) {
+          if (isSentPacket(packets, &bytes)) {
+            count++;
+          } else {
+            falseCount++;
+          }
+        }
+      }
+    }
+  }
+  char name[64];
+  snprintf(name, sizeof(name), "packet loss (%u spikes/10000 half bits)", spikesPer10000);
+  printf("%-40s %7.2f%% before, %7.2f%% after, false packets: %zu before, %zu after\n",
+         name,
+         100.0 * (double) (NOISE_PACKETS_SIZE - legacyCount) / NOISE_PACKETS_SIZE,
+         100.0 * (double) (NOISE_PACKETS_SIZE - count) / NOISE_PACKETS_SIZE,
+         legacyFalseCount,
+         falseCount);
+}
+
+// 雑音の割合ごとの失ったパケットの割合を、タイミングの失敗で同期し直す前と後で比べる
+static void benchNoise(void) {
+  unsigned const rates[] = { 0, 10, 30, 100, 300, 1000 };
+  for (size_t i = 0; i < sizeof rates / sizeof rates[0]; i++) simulateNoise(rates[i]);
+}
+
+static void runBenchmarks(void) {
+  benchDecodeSignal();
+  benchDecodePeriodBatch();
+  benchDecodeSignalsToBits();
+  benchFeedBits();
+  benchParsePacket();
+  benchWaveformCache();
+  benchScheduler();
+  benchNoise();
+}
+
+#if defined(ESP_PLATFORM)
+void app_main(void) { runBenchmarks(); }
+#else
+int main(void) {
+  runBenchmarks();
+  return 0;
+}
+#endif
@@ -0,0 +1,333 @@
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "logic_internal.h"
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#include <immintrin.h>
+#define DCC_BATCH_X86
+#endif
+
+// 一度に分類する半ビットの組の最大数
+// 組ごとの判定結果を64ビットのマスクに収める
+#define CHUNK_PAIRS_SIZE 64
+
+// SIMD で配列の末尾を超えて読み込む分の余白
+#define CHUNK_PADDING 8
+
+// 許容時間の定数を32ビットの範囲の判定に使う形にしたもの
+// `min ≦ x ≦ min + width` を `x - min ≦ width` の符号なし比較1回で判定する
+struct Thresholds {
+  uint32_t minOne;
+  uint32_t oneWidth;
+  uint32_t minZero;
+  uint32_t zeroWidth;
+  uint32_t oneDiff;
+  uint32_t maxStretchedZero;
+};
+
+static struct Thresholds makeThresholds(struct dcc_ReceiveTiming const *const timing) {
+  return (struct Thresholds){
+    .minOne = (uint32_t) timing->minOneHalfBitPeriod,
+    .oneWidth = (uint32_t) (timing->maxOneHalfBitPeriod - timing->minOneHalfBitPeriod),
+    .minZero = (uint32_t) timing->minZeroHalfBitPeriod,
+    .zeroWidth = (uint32_t) (timing->maxZeroHalfBitPeriod - timing->minZeroHalfBitPeriod),
+    .oneDiff = (uint32_t) timing->maxOneHalfBitPeriodDiff,
+    .maxStretchedZero = (uint32_t) timing->maxStretchedZeroBitPeriod,
+  };
+}
+
+// 継続時間の列 `periods[0]`〜`periods[pairsSize]` の隣り合う組 `(periods[k], periods[k + 1])` を判定し、
+// ビットになる組を `*valid` の第 k ビットに、そのうち `1` になる組を `*one` の第 k ビットに立てる
+// 判定は dcc_decodeSignal と同じで、継続時間は全て32ビットに収まっているので32ビットで計算しても結果は変わらない
+static void classifyScalar(struct Thresholds const *const thresholds, uint32_t const *const periods,
+                           size_t const pairsSize, uint64_t *const valid, uint64_t *const one) {
+  uint64_t validMask = 0;
+  uint64_t oneMask = 0;
+  for (size_t k = 0; k < pairsSize; k++) {
+    uint32_t const a = periods[k];
+    uint32_t const b = periods[k + 1];
+    bool const isOne =
+      a - thresholds->minOne <= thresholds->oneWidth && b - a + thresholds->oneDiff <= 2 * thresholds->oneDiff;
+    bool const isZero = a - thresholds->minZero <= thresholds->zeroWidth &&
+                        b - thresholds->minZero <= thresholds->zeroWidth && a + b <= thresholds->maxStretchedZero;
+    validMask |= (uint64_t) (isOne | isZero) << k;
+    oneMask |= (uint64_t) isOne << k;
+  }
+  *valid = validMask;
+  *one = oneMask;
+}
+
+#ifdef DCC_BATCH_X86
+
+// SSE2 と AVX2 には符号なし32ビット整数の比較がないので、符号ビットを反転させて符号付きの比較で代用する
+#define SIGN_BIT INT32_MIN
+
+// `x - min ≦ width` の各レーンを全ビット `1` または `0` で返す
+__attribute__((target("sse2"))) static __m128i inRange128(__m128i const x, uint32_t const min, uint32_t const width) {
+  __m128i const biased = _mm_xor_si128(_mm_sub_epi32(x, _mm_set1_epi32((int32_t) min)), _mm_set1_epi32(SIGN_BIT));
+  __m128i const greater = _mm_cmpgt_epi32(biased, _mm_set1_epi32((int32_t) (width ^ (uint32_t) SIGN_BIT)));
+  return _mm_andnot_si128(greater, _mm_set1_epi32(-1));
+}
+
+__attribute__((target("sse2"))) static void classifySse2(struct Thresholds const *const thresholds,
+                                                         uint32_t const *const periods, size_t const pairsSize,
+                                                         uint64_t *const valid, uint64_t *const one) {
+  uint64_t validMask = 0;
+  uint64_t oneMask = 0;
+  for (size_t k = 0; k < pairsSize; k += 4) {
+    __m128i const a = _mm_loadu_si128((__m128i const *) (periods + k));
+    __m128i const b = _mm_loadu_si128((__m128i const *) (periods + k + 1));
+    __m128i const isOne =
+      _mm_and_si128(inRange128(a, thresholds->minOne, thresholds->oneWidth),
+                    inRange128(_mm_sub_epi32(b, a), (uint32_t) -thresholds->oneDiff, 2 * thresholds->oneDiff));
+    __m128i const isZero =
+      _mm_and_si128(_mm_and_si128(inRange128(a, thresholds->minZero, thresholds->zeroWidth),
+                                  inRange128(b, thresholds->minZero, thresholds->zeroWidth)),
+                    inRange128(_mm_add_epi32(a, b), 0, thresholds->maxStretchedZero));
+    validMask |= (uint64_t) _mm_movemask_ps(_mm_castsi128_ps(_mm_or_si128(isOne, isZero))) << k;
+    oneMask |= (uint64_t) _mm_movemask_ps(_mm_castsi128_ps(isOne)) << k;
+  }
+  // 4つずつ判定したので pairsSize を超えた分を落とす
+  uint64_t const mask = pairsSize == 64 ? UINT64_MAX : (UINT64_C(1) << pairsSize) - 1;
+  *valid = validMask & mask;
+  *one = oneMask & mask;
+}
+
+__attribute__((target("avx2"))) static __m256i inRange256(__m256i const x, uint32_t const min, uint32_t const width) {
+  __m256i const biased =
+    _mm256_xor_si256(_mm256_sub_epi32(x, _mm256_set1_epi32((int32_t) min)), _mm256_set1_epi32(SIGN_BIT));
+  __m256i const greater = _mm256_cmpgt_epi32(biased, _mm256_set1_epi32((int32_t) (width ^ (uint32_t) SIGN_BIT)));
+  return _mm256_andnot_si256(greater, _mm256_set1_epi32(-1));
+}
+
+__attribute__((target("avx2"))) static void classifyAvx2(struct Thresholds const *const thresholds,
+                                                         uint32_t const *const periods, size_t const pairsSize,
+                                                         uint64_t *const valid, uint64_t *const one) {
+  uint64_t validMask = 0;
+  uint64_t oneMask = 0;
+  for (size_t k = 0; k < pairsSize; k += 8) {
+    __m256i const a = _mm256_loadu_si256((__m256i const *) (periods + k));
+    __m256i const b = _mm256_loadu_si256((__m256i const *) (periods + k + 1));
+    __m256i const isOne =
+      _mm256_and_si256(inRange256(a, thresholds->minOne, thresholds->oneWidth),
+                       inRange256(_mm256_sub_epi32(b, a), (uint32_t) -thresholds->oneDiff, 2 * thresholds->oneDiff));
+    __m256i const isZero =
+      _mm256_and_si256(_mm256_and_si256(inRange256(a, thresholds->minZero, thresholds->zeroWidth),
+                                        inRange256(b, thresholds->minZero, thresholds->zeroWidth)),
+                       inRange256(_mm256_add_epi32(a, b), 0, thresholds->maxStretchedZero));
+    validMask |= (uint64_t) (uint32_t) _mm256_movemask_ps(_mm256_castsi256_ps(_mm256_or_si256(isOne, isZero))) << k;
+    oneMask |= (uint64_t) (uint32_t) _mm256_movemask_ps(_mm256_castsi256_ps(isOne)) << k;
+  }
+  // 8つずつ判定したので pairsSize を超えた分を落とす
+  uint64_t const mask = pairsSize == 64 ? UINT64_MAX : (UINT64_C(1) << pairsSize) - 1;
+  *valid = validMask & mask;
+  *one = oneMask & mask;
+}
+
+#endif
+
+typedef void (*Classify)(struct Thresholds const *const thresholds, uint32_t const *const periods,
+                         size_t const pairsSize, uint64_t *const valid, uint64_t *const one);
+
+// 実行している CPU で使える最も速い実装を選ぶ
+static Classify selectClassify(void) {
+#ifdef DCC_BATCH_X86
+  if (__builtin_cpu_supports("avx2")) return classifyAvx2;
+  if (__builtin_cpu_supports("sse2")) return classifySse2;
+#endif
+  return classifyScalar;
+}
+
+// 書き込み中のワードを手元に保持し、32ビット溜まるごとに書き出す
+// メモリー上のワードをビットごとに読み書きすると、直前の書き込みを待つことになり遅い
+struct BitWriter {
+  uint32_t *bits;
+  size_t count;
+  uint32_t word;
+};
+
+static void writeBit(struct BitWriter *const writer, dcc_Bit const bit) {
+  writer->word = writer->word << 1 | bit;
+  writer->count++;
+  if (writer->count % 32 == 0) writer->bits[writer->count / 32 - 1] = writer->word;
+}
+
+// 書き出していない端数のビットを上位に詰めて書き出す
+static void flushBits(struct BitWriter *const writer) {
+  size_t const rest = writer->count % 32;
+  if (rest != 0) writer->bits[writer->count / 32] = writer->word << (32 - rest);
+}
+
+// 信号の列を CHUNK_PAIRS_SIZE 組ずつ継続時間にして判定し、判定結果のマスクを辿ってビットを取り出す
+//
+// 信号ごとの dcc_feedSignal と同じく、組がビットにならなければ1つずらし、ビットになれば2つ進める。
+// 判定の前半の継続時間がパーサーに残っている場合はそれを継続時間の列の先頭に置き、
+// 最後に組にならずに残った継続時間は次の塊の先頭に持ち越す。
+size_t dcc_decodeSignalsToBits(struct dcc_SignalStreamParser *const parser, dcc_TimeMicroSec const *const signals,
+                               size_t const signalsSize, uint32_t *const bits, size_t const bitsCapacity,
+                               size_t *const bitsSize) {
+  DCC_DEBUG_LOG("dcc_decodeSignalsToBits(parser: %p, signals: %p, signalsSize: %zu, bits: %p, bitsCapacity: %zu, "
+                "bitsSize: %p)",
+                parser,
+                signals,
+                signalsSize,
+                bits,
+                bitsCapacity,
+                bitsSize);
+  struct Thresholds const thresholds =
+    makeThresholds(parser->receiveTiming == NULL ? &dcc_defaultReceiveTiming : parser->receiveTiming);
+  Classify const classify = selectClassify();
+  size_t i = 0;
+  struct BitWriter writer = { .bits = bits, .count = 0, .word = 0 };
+  if (i < signalsSize && !parser->signalExists) {
+    dcc_Bit bit;
+    dcc_feedSignal(parser, signals[i++], &bit);  // 時刻を記録するのみ
+  }
+  // 1つの塊から得られるビットは最大で (CHUNK_PAIRS_SIZE + 1) / 2 個
+  // プロファイルやクロック再生は半ビットごとに記録し、極性が分かっていると失敗の後の組み方が変わるので、
+  // 下の1つずつ処理する方に任せる
+  while (parser->timingProfile == NULL && parser->clockRecovery == NULL &&
+         parser->polarity == dcc_SignalPolarity_Unknown && i < signalsSize &&
+         (CHUNK_PAIRS_SIZE + 1) / 2 <= bitsCapacity - writer.count) {
+    uint32_t periods[CHUNK_PAIRS_SIZE + 1 + CHUNK_PADDING];
+    size_t size = 0;
+    if (parser->periodExists) periods[size++] = (uint32_t) parser->period;
+    size_t const signalsCount =
+      CHUNK_PAIRS_SIZE + 1 - size < signalsSize - i ? CHUNK_PAIRS_SIZE + 1 - size : signalsSize - i;
+    // 32ビットに切り詰めた差は dcc_elapsedTime と同じ
+    periods[size++] = (uint32_t) (signals[i] - parser->signal);
+    // スパイクの断片は次の継続時間と合わせるので組み方が変わる
+    // 断片を含む塊は1つずつ処理するので、差を求めながら最小値も求めておく
+    uint32_t shortest = periods[size - 1];
+    for (size_t j = 1; j < signalsCount; j++) {
+      uint32_t const period = (uint32_t) (signals[i + j] - signals[i + j - 1]);
+      periods[size++] = period;
+      shortest = period < shortest ? period : shortest;
+    }
+    if (parser->fragmentExists || shortest < thresholds.minOne) {
+      for (size_t j = 0; j < signalsCount; j++) {
+        dcc_Bit bit;
+        if (dcc_StreamParserResult_Success == dcc_feedSignal(parser, signals[i + j], &bit)) writeBit(&writer, bit);
+      }
+      i += signalsCount;
+      continue;
+    }
+    for (size_t j = 0; j < CHUNK_PADDING; j++) periods[size + j] = 0;
+    uint64_t valid = 0;
+    uint64_t one = 0;
+    if (1 < size) classify(&thresholds, periods, size - 1, &valid, &one);
+    size_t position = 0;
+    while (position + 1 < size) {
+      uint64_t const rest = valid >> position;
+      if (rest == 0) {
+        // 残りの組はどれもビットにならないので、最後の継続時間のみが残る
+        position = size - 1;
+        break;
+      }
+      position += (size_t) __builtin_ctzll(rest);
+      writeBit(&writer, (dcc_Bit) ((one >> position) & 1));
+      position += 2;
+    }
+    parser->periodExists = position + 1 == size;
+    if (parser->periodExists) parser->period = periods[size - 1];
+    parser->signal = signals[i + signalsCount - 1];
+    if (signalsCount % 2 == 1) parser->oddPeriod = !parser->oddPeriod;
+    i += signalsCount;
+  }
+  // 出力の残りが少ない場合は1つずつ処理する
+  while (i < signalsSize && writer.count < bitsCapacity) {
+    dcc_Bit bit;
+    if (dcc_StreamParserResult_Success == dcc_feedSignal(parser, signals[i++], &bit)) writeBit(&writer, bit);
+  }
+  flushBits(&writer);
+  *bitsSize = writer.count;
+  return i;
+}
+
+// `position` ビット目から始まる64ビットを上位から詰めて読み込む
+// `bitsSize` を超えた部分は `0` になる
+static uint64_t loadBits(uint32_t const *const bits, size_t const bitsSize, size_t const position) {
+  size_t const wordsSize = (bitsSize + 31) / 32;
+  size_t const index = position / 32;
+  unsigned const offset = (unsigned) (position % 32);
+  uint64_t window = (uint64_t) bits[index] << 32;
+  if (index + 1 < wordsSize) window |= bits[index + 1];
+  window <<= offset;
+  if (offset != 0 && index + 2 < wordsSize) window |= bits[index + 2] >> (32 - offset);
+  // 最後のワードの有効でないビットを落とす
+  size_t const available = bitsSize - position;
+  if (available < 64) window &= ~(UINT64_MAX >> available);
+  return window;
+}
+
+// ワード単位で読み進め、プリアンブルとデータバイトを一度に処理する
+// 状態がバイトの途中の場合（dcc_feedBit と併用した場合やビットの列の境目）は、バイトの境目まで1ビットずつ処理する
+enum dcc_StreamParserResult dcc_feedBits(struct dcc_BitStreamParser *const parser, uint32_t const *const bits,
+                                         size_t *const position, size_t const bitsSize, dcc_Byte *const bytes,
+                                         size_t *const bytesSize) {
+  DCC_DEBUG_LOG("dcc_feedBits(parser: %p, bits: %p, position: %zu, bitsSize: %zu, bytes: %p, bytesSize: %p)",
+                parser,
+                bits,
+                *position,
+                bitsSize,
+                bytes,
+                bytesSize);
+  size_t current = *position;
+  while (current < bitsSize) {
+    size_t const available = bitsSize - current < 64 ? bitsSize - current : 64;
+    uint64_t const window = loadBits(bits, bitsSize, current);
+    if (parser->state == dcc_BitStreamParserState_InPreamble) {
+      // 先頭の `1` の数を数える
+      size_t const ones = ~window == 0 ? 64 : (size_t) __builtin_clzll(~window);
+      if (available <= ones) {
+        parser->inPreamble.oneBitsCount += available;
+        current += available;
+        continue;
+      }
+      parser->inPreamble.oneBitsCount += ones;
+      current += ones + 1;  // パケット開始ビットまで
+      if (parser->inPreamble.oneBitsCount <= 12) {
+        dcc_resetBitStreamParser(parser);
+        continue;
+      }
+      parser->state = dcc_BitStreamParserState_InByte;
+      parser->inByte.byte = 0;
+      parser->inByte.bitCount = 0;
+      continue;
+    }
+    // 壊れた状態は dcc_feedBit で回復させる
+    if (parser->state == dcc_BitStreamParserState_InByte && parser->inByte.bitCount == 0 && 9 <= available &&
+        parser->bytesSize <= DCC_BIT_STREAM_PARSER_BYTES_CAPACITY) {
+      // データバイトとそれに続くビットを取り出す
+      if (parser->bytesSize == DCC_BIT_STREAM_PARSER_BYTES_CAPACITY) {
+        dcc_resetBitStreamParser(parser);
+        current += 8;
+        continue;
+      }
+      parser->bytes[parser->bytesSize++] = (dcc_Byte) (window >> 56);
+      current += 9;
+      if ((window >> 55) & 1) {
+        // パケット終了ビット
+        memcpy(bytes, parser->bytes, parser->bytesSize);
+        *bytesSize = parser->bytesSize;
+        dcc_resetBitStreamParser(parser);
+        *position = current;
+        return dcc_StreamParserResult_Success;
+      }
+      // データバイト開始ビット
+      continue;
+    }
+    enum dcc_StreamParserResult const result =
+      dcc_feedBit(parser, (dcc_Bit) (window >> 63), bytes, bytesSize);
+    current++;
+    if (result == dcc_StreamParserResult_Success) {
+      *position = current;
+      return dcc_StreamParserResult_Success;
+    }
+  }
+  *position = current;
+  return dcc_StreamParserResult_Continue;
+}
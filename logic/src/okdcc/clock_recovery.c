@@ -0,0 +1,113 @@
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "logic_internal.h"
+
+// `base` の `1` の範囲の半分の幅
+// 学習した値の周りにも同じ幅の余裕を持たせる
+static dcc_TimeMicroSec marginOf(struct dcc_ReceiveTiming const *const base) {
+  return (base->maxOneHalfBitPeriod - base->minOneHalfBitPeriod) / 2;
+}
+
+// 学習に使う `1` の半ビットとみなす範囲
+static bool isLearnable(struct dcc_ReceiveTiming const *const base, dcc_TimeMicroSec const period) {
+  dcc_TimeMicroSec const margin = marginOf(base);
+  dcc_TimeMicroSec const max = base->maxOneHalfBitPeriod + margin < base->minZeroHalfBitPeriod
+                                 ? base->maxOneHalfBitPeriod + margin
+                                 : base->minZeroHalfBitPeriod - 1;
+  return base->minOneHalfBitPeriod - margin <= period && period <= max;
+}
+
+// `value` をクロックの速さ `one / center` に合わせて伸縮する
+// 32ビットの unsigned long でも桁あふれしないように64ビットで計算し、dcc_validateReceiveTiming の上限で飽和させる
+static dcc_TimeMicroSec scale(dcc_TimeMicroSec const value, dcc_TimeMicroSec const one, dcc_TimeMicroSec const center,
+                              dcc_TimeMicroSec const limit) {
+  uint_least64_t const scaled = (uint_least64_t) value * one / center;
+  return limit < scaled ? limit : (dcc_TimeMicroSec) scaled;
+}
+
+// 学習中の連続した `1` の半ビットから受信のタイミングを求め直す
+static void learn(struct dcc_ClockRecovery *const recovery) {
+  struct dcc_ReceiveTiming const *const base = &recovery->base;
+  dcc_TimeMicroSec const margin = marginOf(base);
+  size_t const count = recovery->runPeriodsCount;
+  dcc_TimeMicroSec const one = (recovery->runPeriodsSum + count / 2) / count;
+  // 偏りは隣り合う半ビットの差の平均で、入力の範囲の幅までに抑える
+  long const maxSkew = (long) (2 * margin);
+  long const averageSkew = recovery->runSkewsSum / (long) (count - 1);
+  long const skew = averageSkew < -maxSkew ? -maxSkew : maxSkew < averageSkew ? maxSkew : averageSkew;
+  dcc_TimeMicroSec const absoluteSkew = (dcc_TimeMicroSec) (skew < 0 ? -skew : skew);
+  // 長い半ビットと短い半ビットは公称の値から偏りの半分ずつずれる
+  dcc_TimeMicroSec const spread = (absoluteSkew + 1) / 2 + margin;
+  // 差の判定 `period2 - period1 - skew + d` が一周しないように、`1` の下限は偏りと差の最大値より大きくする
+  dcc_TimeMicroSec const minOneLimit = absoluteSkew + base->maxOneHalfBitPeriodDiff + 1;
+  dcc_TimeMicroSec const center = (base->minOneHalfBitPeriod + base->maxOneHalfBitPeriod) / 2;
+  dcc_TimeMicroSec const limit = DCC_TIME_MICRO_SEC_MASK / 2;
+  struct dcc_ReceiveTiming timing;
+  timing.minOneHalfBitPeriod = minOneLimit + spread < one ? one - spread : minOneLimit;
+  timing.maxOneHalfBitPeriod = one + spread;
+  dcc_TimeMicroSec const minZero = scale(base->minZeroHalfBitPeriod, one, center, limit);
+  timing.minZeroHalfBitPeriod = timing.maxOneHalfBitPeriod + (absoluteSkew + 1) / 2 < minZero
+                                  ? minZero - (absoluteSkew + 1) / 2
+                                  : timing.maxOneHalfBitPeriod + 1;
+  timing.maxZeroHalfBitPeriod = scale(base->maxZeroHalfBitPeriod, one, center, limit) + (absoluteSkew + 1) / 2;
+  timing.maxOneHalfBitPeriodDiff = base->maxOneHalfBitPeriodDiff;
+  timing.maxStretchedZeroBitPeriod =
+    scale(base->maxStretchedZeroBitPeriod, one, center, DCC_TIME_MICRO_SEC_MASK - absoluteSkew) + absoluteSkew;
+  if (timing.maxZeroHalfBitPeriod < timing.minZeroHalfBitPeriod) {
+    timing.maxZeroHalfBitPeriod = timing.minZeroHalfBitPeriod;
+  }
+  recovery->timing = timing;
+  recovery->oneHalfBitPeriod = one;
+  recovery->oneHalfBitPeriodSkew = skew;
+  recovery->learnedCount++;
+}
+
+struct dcc_ClockRecovery dcc_initializeClockRecovery(struct dcc_ReceiveTiming const *const base) {
+  DCC_DEBUG_LOG("dcc_initializeClockRecovery(base: %p)", base);
+  return (struct dcc_ClockRecovery){
+    .base = *base,
+    .timing = *base,
+    .oneHalfBitPeriod = 0,
+    .oneHalfBitPeriodSkew = 0,
+    .pairSkew = 0,
+    .oddPeriod = false,
+    .lastPeriod = 0,
+    .runPeriodsCount = 0,
+    .runPeriodsSum = 0,
+    .runSkewsSum = 0,
+    .learnedCount = 0,
+  };
+}
+
+void dcc_attachClockRecovery(struct dcc_SignalStreamParser *const parser, struct dcc_ClockRecovery *const recovery) {
+  DCC_DEBUG_LOG("dcc_attachClockRecovery(parser: %p, recovery: %p)", parser, recovery);
+  parser->clockRecovery = recovery;
+  parser->receiveTiming = recovery == NULL ? NULL : &recovery->timing;
+}
+
+// 電圧変化ごとに呼ばれるので、ここではデバッグログを出力しない
+// プリアンブルの間は足し合わせるだけにして、除算は連続が途切れたとき（普通はパケット開始ビット）に1回だけ行う
+void dcc_recoverClock(struct dcc_ClockRecovery *const recovery, dcc_TimeMicroSec const period) {
+  recovery->oddPeriod = !recovery->oddPeriod;
+  dcc_TimeMicroSec const margin = marginOf(&recovery->base);
+  long const difference = (long) period - (long) recovery->lastPeriod;
+  // 半ビットの間の差が大きすぎれば、そこで連続が途切れたとみなす
+  bool const learnable = isLearnable(&recovery->base, period);
+  bool const continued = recovery->runPeriodsCount != 0 && learnable &&
+                         (difference < 0 ? -difference : difference) <= (long) (4 * margin);
+  if (continued) {
+    recovery->runPeriodsCount++;
+    recovery->runPeriodsSum += period;
+    recovery->runSkewsSum += recovery->oddPeriod ? difference : -difference;
+  } else {
+    if (DCC_CLOCK_RECOVERY_LEARNING_HALF_BITS_COUNT <= recovery->runPeriodsCount) learn(recovery);
+    recovery->runPeriodsCount = learnable ? 1 : 0;
+    recovery->runPeriodsSum = learnable ? period : 0;
+    recovery->runSkewsSum = 0;
+  }
+  recovery->lastPeriod = period;
+  // この半ビットが奇数番目なら、前の偶数番目の半ビットとの組の後半である
+  recovery->pairSkew = recovery->oddPeriod ? recovery->oneHalfBitPeriodSkew : -recovery->oneHalfBitPeriodSkew;
+}
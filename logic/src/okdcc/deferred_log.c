@@ -0,0 +1,336 @@
+#include <limits.h>
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "logic_internal.h"
+
+// 整形し直すときに組み立てる変換指定の最大の長さ
+#define SPEC_CAPACITY 32
+
+struct dcc_DeferredLog *dcc_deferred_log = NULL;
+
+enum ArgKind {
+  ArgKind_None,
+  ArgKind_Signed,
+  ArgKind_Unsigned,
+  ArgKind_Char,
+  ArgKind_Double,
+  ArgKind_Pointer,
+  ArgKind_String,
+  ArgKind_Unsupported,
+};
+
+enum Length {
+  Length_None,
+  Length_hh,
+  Length_h,
+  Length_l,
+  Length_ll,
+  Length_j,
+  Length_z,
+  Length_t,
+  Length_L,
+};
+
+// 1つの変換指定
+struct Conversion {
+  // フラグ、幅と精度
+  char const *flags;
+  size_t flagsSize;
+  size_t starsCount;
+  enum Length length;
+  char specifier;
+  enum ArgKind kind;
+};
+
+static enum ArgKind kindOf(char const specifier, enum Length const length) {
+  switch (specifier) {
+    case 'd':
+    case 'i':
+      return length == Length_L ? ArgKind_Unsupported : ArgKind_Signed;
+    case 'u':
+    case 'o':
+    case 'x':
+    case 'X':
+      return length == Length_L ? ArgKind_Unsupported : ArgKind_Unsigned;
+    case 'c':
+      return length == Length_None ? ArgKind_Char : ArgKind_Unsupported;
+    case 'f':
+    case 'F':
+    case 'e':
+    case 'E':
+    case 'g':
+    case 'G':
+    case 'a':
+    case 'A':
+      return length == Length_None || length == Length_l || length == Length_L ? ArgKind_Double : ArgKind_Unsupported;
+    case 'p':
+      return length == Length_None ? ArgKind_Pointer : ArgKind_Unsupported;
+    case 's':
+      return length == Length_None ? ArgKind_String : ArgKind_Unsupported;
+    case '%':
+      return ArgKind_None;
+    default:
+      // `%n` と終端ヌル文字
+      return ArgKind_Unsupported;
+  }
+}
+
+// `format` は `%` を指す
+// 変換指定の次の文字へのポインターを返す
+static char const *parseConversion(char const *const format, struct Conversion *const conversion) {
+  char const *p = format + 1;
+  conversion->flags = p;
+  conversion->starsCount = 0;
+  while (*p != '\0' && strchr("-+ #0123456789.*", *p) != NULL) {
+    if (*p == '*') conversion->starsCount++;
+    p++;
+  }
+  conversion->flagsSize = (size_t) (p - conversion->flags);
+  conversion->length = Length_None;
+  if (p[0] == 'h' && p[1] == 'h') conversion->length = Length_hh;
+  else if (p[0] == 'h') conversion->length = Length_h;
+  else if (p[0] == 'l' && p[1] == 'l') conversion->length = Length_ll;
+  else if (p[0] == 'l') conversion->length = Length_l;
+  else if (p[0] == 'j') conversion->length = Length_j;
+  else if (p[0] == 'z') conversion->length = Length_z;
+  else if (p[0] == 't') conversion->length = Length_t;
+  else if (p[0] == 'L') conversion->length = Length_L;
+  if (conversion->length == Length_hh || conversion->length == Length_ll) p += 2;
+  else if (conversion->length != Length_None) p++;
+  conversion->specifier = *p;
+  conversion->kind = kindOf(*p, conversion->length);
+  return *p == '\0' ? p : p + 1;
+}
+
+static size_t argsCountOf(struct Conversion const *const conversion) {
+  return conversion->starsCount + (conversion->kind == ArgKind_None ? 0 : 1);
+}
+
+// 整数は最も広い型に広げて記録し、整形するときに `j` で読む
+static union dcc_DeferredLogArg readArg(struct Conversion const *const conversion, va_list *const args) {
+  union dcc_DeferredLogArg arg;
+  switch (conversion->kind) {
+    case ArgKind_Signed:
+      switch (conversion->length) {
+        case Length_hh:
+          arg.signedValue = (signed char) va_arg(*args, int);
+          break;
+        case Length_h:
+          arg.signedValue = (short) va_arg(*args, int);
+          break;
+        case Length_l:
+          arg.signedValue = va_arg(*args, long);
+          break;
+        case Length_ll:
+          arg.signedValue = va_arg(*args, long long);
+          break;
+        case Length_j:
+          arg.signedValue = va_arg(*args, intmax_t);
+          break;
+        case Length_z:
+        case Length_t:
+          arg.signedValue = va_arg(*args, ptrdiff_t);
+          break;
+        default:
+          arg.signedValue = va_arg(*args, int);
+          break;
+      }
+      break;
+    case ArgKind_Unsigned:
+      switch (conversion->length) {
+        case Length_hh:
+          arg.unsignedValue = (unsigned char) va_arg(*args, unsigned int);
+          break;
+        case Length_h:
+          arg.unsignedValue = (unsigned short) va_arg(*args, unsigned int);
+          break;
+        case Length_l:
+          arg.unsignedValue = va_arg(*args, unsigned long);
+          break;
+        case Length_ll:
+          arg.unsignedValue = va_arg(*args, unsigned long long);
+          break;
+        case Length_j:
+          arg.unsignedValue = va_arg(*args, uintmax_t);
+          break;
+        case Length_z:
+          arg.unsignedValue = va_arg(*args, size_t);
+          break;
+        case Length_t:
+          arg.unsignedValue = (uintmax_t) va_arg(*args, ptrdiff_t);
+          break;
+        default:
+          arg.unsignedValue = va_arg(*args, unsigned int);
+          break;
+      }
+      break;
+    case ArgKind_Char:
+      arg.signedValue = va_arg(*args, int);
+      break;
+    case ArgKind_Double:
+      arg.doubleValue = conversion->length == Length_L ? (double) va_arg(*args, long double) : va_arg(*args, double);
+      break;
+    case ArgKind_Pointer:
+    case ArgKind_String:
+      arg.pointer = va_arg(*args, void const *);
+      break;
+    default:
+      arg.unsignedValue = 0;
+      break;
+  }
+  return arg;
+}
+
+struct dcc_DeferredLog dcc_initializeDeferredLog(struct dcc_DeferredLogEntry *const entries, size_t const size) {
+  size_t const capacity = dcc_floorPowerOfTwo(size);
+  for (size_t i = 0; i < capacity; i++) entries[i].sequence = 0;
+  return (struct dcc_DeferredLog){
+    .entries = entries, .size = capacity, .claimCount = 0, .readCount = 0, .lostCount = 0
+  };
+}
+
+int dcc_deferLog(char const *const file, int const line, char const *func, char const *format, ...) {
+  struct dcc_DeferredLog *const log = dcc_deferred_log;
+  if (log == NULL || log->size == 0) return 0;
+  // 複数の書き込み側が競合するので、空きがある間だけ比較交換で要素を確保する
+  size_t claim = DCC_LOAD_RELAXED(&log->claimCount);
+  do {
+    if (log->size <= claim - DCC_LOAD_ACQUIRE(&log->readCount)) {
+      __atomic_fetch_add(&log->lostCount, 1, __ATOMIC_RELAXED);
+      return 0;
+    }
+  } while (!__atomic_compare_exchange_n(&log->claimCount, &claim, claim + 1, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+  struct dcc_DeferredLogEntry *const entry = &log->entries[claim & (log->size - 1)];
+  entry->file = file;
+  entry->line = line;
+  entry->func = func;
+  entry->format = format;
+  // 書式文字列から引数の型を読み取って、整形せずに記録する
+  size_t argsCount = 0;
+  va_list args;
+  va_start(args, format);
+  for (char const *p = format; *p != '\0';) {
+    if (*p != '%') {
+      p++;
+      continue;
+    }
+    struct Conversion conversion;
+    p = parseConversion(p, &conversion);
+    if (conversion.kind == ArgKind_Unsupported ||
+        DCC_DEFERRED_LOG_ARGS_CAPACITY < argsCount + argsCountOf(&conversion)) {
+      break;
+    }
+    for (size_t i = 0; i < conversion.starsCount; i++) entry->args[argsCount++].signedValue = va_arg(args, int);
+    if (conversion.kind != ArgKind_None) entry->args[argsCount++] = readArg(&conversion, &args);
+  }
+  va_end(args);
+  entry->argsCount = (uint_least8_t) argsCount;
+  DCC_STORE_RELEASE(&entry->sequence, claim + 1);
+  return 0;
+}
+
+enum dcc_Result dcc_popDeferredLog(struct dcc_DeferredLog *const log, struct dcc_DeferredLogEntry *const entry) {
+  size_t const readCount = DCC_LOAD_RELAXED(&log->readCount);
+  if (log->size == 0) return dcc_Failure;
+  struct dcc_DeferredLogEntry const *const source = &log->entries[readCount & (log->size - 1)];
+  // 確保した順に書き込みが終わるとは限らない
+  if (DCC_LOAD_ACQUIRE(&source->sequence) != readCount + 1) return dcc_Failure;
+  *entry = *source;
+  DCC_STORE_RELEASE(&log->readCount, readCount + 1);
+  return dcc_Success;
+}
+
+// `snprintf` と同じく、`bufferSize` を超える分は書き込まずに文字数だけ数える
+static void appendChars(char *const buffer, size_t const bufferSize, size_t *const written, char const *const chars,
+                        size_t const charsSize) {
+  if (*written + 1 < bufferSize) {
+    size_t const rest = bufferSize - 1 - *written;
+    memcpy(buffer + *written, chars, charsSize < rest ? charsSize : rest);
+  }
+  *written += charsSize;
+}
+
+// 幅と精度の `*` を記録した値に置き換えて、整数には `j` を付けた変換指定を組み立てる
+static enum dcc_Result buildSpec(struct Conversion const *const conversion, union dcc_DeferredLogArg const *const args,
+                                 char *const spec) {
+  size_t size = 0;
+  size_t star = 0;
+  spec[size++] = '%';
+  for (size_t i = 0; i < conversion->flagsSize; i++) {
+    char const c = conversion->flags[i];
+    if (c != '*') {
+      if (SPEC_CAPACITY - 4 <= size) return dcc_Failure;
+      spec[size++] = c;
+      continue;
+    }
+    char number[16];
+    int const numberSize = snprintf(number, sizeof number, "%d", (int) args[star++].signedValue);
+    if (numberSize < 0 || SPEC_CAPACITY - 4 <= size + (size_t) numberSize) return dcc_Failure;
+    memcpy(spec + size, number, (size_t) numberSize);
+    size += (size_t) numberSize;
+  }
+  if (conversion->kind == ArgKind_Signed || conversion->kind == ArgKind_Unsigned) spec[size++] = 'j';
+  spec[size++] = conversion->specifier;
+  spec[size] = '\0';
+  return dcc_Success;
+}
+
+int dcc_formatDeferredLog(char *buffer, size_t const bufferSize, struct dcc_DeferredLogEntry const *const entry) {
+  size_t written = 0;
+  size_t argsIndex = 0;
+  char const *p = entry->format;
+  while (*p != '\0') {
+    char const *const percent = strchr(p, '%');
+    if (percent == NULL) break;
+    appendChars(buffer, bufferSize, &written, p, (size_t) (percent - p));
+    p = percent;
+    struct Conversion conversion;
+    char const *const next = parseConversion(p, &conversion);
+    // 記録できなかった変換以降はそのまま出力する
+    if (conversion.kind == ArgKind_Unsupported || entry->argsCount < argsIndex + argsCountOf(&conversion)) break;
+    if (conversion.kind == ArgKind_None) {
+      appendChars(buffer, bufferSize, &written, "%", 1);
+      p = next;
+      continue;
+    }
+    union dcc_DeferredLogArg const *const args = &entry->args[argsIndex];
+    argsIndex += argsCountOf(&conversion);
+    char spec[SPEC_CAPACITY];
+    if (dcc_Failure == buildSpec(&conversion, args, spec)) break;
+    union dcc_DeferredLogArg const arg = args[conversion.starsCount];
+    char *const out = written < bufferSize ? buffer + written : NULL;
+    size_t const rest = written < bufferSize ? bufferSize - written : 0;
+    int result;
+    switch (conversion.kind) {
+      case ArgKind_Signed:
+        result = snprintf(out, rest, spec, arg.signedValue);
+        break;
+      case ArgKind_Unsigned:
+        result = snprintf(out, rest, spec, arg.unsignedValue);
+        break;
+      case ArgKind_Char:
+        result = snprintf(out, rest, spec, (int) arg.signedValue);
+        break;
+      case ArgKind_Double:
+        result = snprintf(out, rest, spec, arg.doubleValue);
+        break;
+      case ArgKind_String:
+        result = snprintf(out, rest, spec, (char const *) arg.pointer);
+        break;
+      default:
+        result = snprintf(out, rest, spec, arg.pointer);
+        break;
+    }
+    if (result < 0) return result;
+    written += (size_t) result;
+    p = next;
+  }
+  appendChars(buffer, bufferSize, &written, p, strlen(p));
+  if (0 < bufferSize) buffer[written < bufferSize ? written : bufferSize - 1] = '\0';
+  return written < INT_MAX ? (int) written : INT_MAX;
+}
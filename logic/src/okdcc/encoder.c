@@ -0,0 +1,403 @@
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "logic_internal.h"
+
+// パケットのバイト列の最大長（チェックサムを含む）
+// 長いアドレス 2 バイト、命令 1 バイト、データ 2 バイト、チェックサム 1 バイト
+#define PACKET_BYTES_MAX 6
+
+// 多機能デコーダー用パケットのアドレスを書き込む
+// 0～127 は 1 バイト、それより大きければ 2 バイトの長いアドレスにする
+static enum dcc_Result encodeAddressForExtendedPacket(dcc_AddressForExtendedPacket const address,
+                                                      dcc_Byte *const bytes, size_t *const size) {
+  if (address < 0x80) {
+    bytes[(*size)++] = (dcc_Byte) address;
+    return dcc_Success;
+  }
+  // 0xE8 以上の先頭バイトは予約されている
+  if (address > 0x27FF) return dcc_Failure;
+  bytes[(*size)++] = (dcc_Byte) (0xC0 | address >> 8);
+  bytes[(*size)++] = (dcc_Byte) (address & 0xFF);
+  return dcc_Success;
+}
+
+// parseSpeed4Bit の逆
+static enum dcc_Result encodeSpeed4Bit(dcc_Speed4Bit const speed, bool const emergencyStop, dcc_Byte *const bits) {
+  if (emergencyStop) {
+    *bits = 1;
+    return dcc_Success;
+  }
+  if (speed > 14) return dcc_Failure;
+  *bits = (dcc_Byte) (speed == 0 ? 0 : speed + 1);
+  return dcc_Success;
+}
+
+// parseSpeed5Bit の逆
+// 5 ビット目（C）が最下位ビットなので下位 4 ビットと入れ替えて返す
+static enum dcc_Result encodeSpeed5Bit(dcc_Speed5Bit const speed, bool const emergencyStop,
+                                       bool const directionMayBeIgnored, dcc_Byte *const bits) {
+  unsigned value;
+  if (emergencyStop) value = directionMayBeIgnored ? 3 : 2;
+  else if (speed == 0) value = directionMayBeIgnored ? 1 : 0;
+  else if (speed <= 28) value = speed + 3u;
+  else return dcc_Failure;
+  *bits = (dcc_Byte) ((value & 1) << 4 | value >> 1);
+  return dcc_Success;
+}
+
+// 速度方向命令 `01DCSSSS` を作る
+static enum dcc_Result encodeSpeedAndDirection(enum dcc_Direction const direction, bool const flControl,
+                                               dcc_Speed4Bit const speed4Bit, bool const fl,
+                                               dcc_Speed5Bit const speed5Bit, bool const emergencyStop,
+                                               bool const directionMayBeIgnored, dcc_Byte *const byte) {
+  dcc_Byte bits;
+  if (flControl) {
+    if (dcc_Failure == encodeSpeed4Bit(speed4Bit, emergencyStop, &bits)) return dcc_Failure;
+    bits |= (dcc_Byte) (fl << 4);
+  } else {
+    if (dcc_Failure == encodeSpeed5Bit(speed5Bit, emergencyStop, directionMayBeIgnored, &bits)) return dcc_Failure;
+  }
+  *byte = (dcc_Byte) (0x40 | (direction == dcc_Forward) << 5 | bits);
+  return dcc_Success;
+}
+
+// 各ビットを `bit0` から順に並べたバイトを作る
+static dcc_Byte packFlags(bool const bit0, bool const bit1, bool const bit2, bool const bit3, bool const bit4,
+                          bool const bit5, bool const bit6, bool const bit7) {
+  return (dcc_Byte) (bit0 | bit1 << 1 | bit2 << 2 | bit3 << 3 | bit4 << 4 | bit5 << 5 | bit6 << 6 | bit7 << 7);
+}
+
+// チェックサムを除くバイト列を作る
+static enum dcc_Result encodeBody(struct dcc_Packet const *const packet, dcc_Byte *const bytes, size_t *const size) {
+  // 多機能デコーダー用パケットはアドレスを書いてから命令を書く
+#define ENCODE_ADDRESS(member)                                                                      \
+  do {                                                                                              \
+    if (dcc_Failure == encodeAddressForExtendedPacket(packet->member.address, bytes, size)) {       \
+      return dcc_Failure;                                                                           \
+    }                                                                                               \
+  } while (0)
+  switch (packet->tag) {
+    case dcc_SpeedAndDirectionPacketForLocomotiveDecodersTag: {
+      struct dcc_SpeedAndDirectionPacketForLocomotiveDecoders const *const p =
+        &packet->speedAndDirectionPacketForLocomotiveDecoders;
+      if (p->address > 0x7F) return dcc_Failure;
+      bytes[(*size)++] = (dcc_Byte) p->address;
+      return encodeSpeedAndDirection(p->direction,
+                                     p->flControl,
+                                     p->speed4Bit,
+                                     p->fl,
+                                     p->speed5Bit,
+                                     p->emergencyStop,
+                                     !p->flControl && p->directionMayBeIgnored,
+                                     &bytes[(*size)++]);
+    }
+    case dcc_ResetPacketForAllDecodersTag:
+      bytes[(*size)++] = 0x00;
+      bytes[(*size)++] = 0x00;
+      return dcc_Success;
+    case dcc_IdlePacketForAllDecodersTag:
+      bytes[(*size)++] = 0xFF;
+      bytes[(*size)++] = 0x00;
+      return dcc_Success;
+    case dcc_BroadcastStopPacketForAllDecodersTag: {
+      struct dcc_BroadcastStopPacketForAllDecoders const *const p = &packet->broadcastStopPacketForAllDecoders;
+      bytes[(*size)++] = 0x00;
+      bytes[(*size)++] = (dcc_Byte) (0x40 | (p->direction == dcc_Forward) << 5 | p->directionMayBeIgnored << 4 |
+                                     (p->kind == dcc_BroadcastStopKind_Shutdown));
+      return dcc_Success;
+    }
+    case dcc_ResetPacketForMultiFunctionDecodersTag:
+      ENCODE_ADDRESS(resetPacketForMultiFunctionDecoders);
+      bytes[(*size)++] = 0x00;
+      return dcc_Success;
+    case dcc_HardResetPacketForMultiFunctionDecodersTag:
+      ENCODE_ADDRESS(hardResetPacketForMultiFunctionDecoders);
+      bytes[(*size)++] = 0x01;
+      return dcc_Success;
+    case dcc_FactoryTestInstructionPacketForMultiFunctionDecodersTag: {
+      struct dcc_FactoryTestInstructionPacketForMultiFunctionDecoders const *const p =
+        &packet->factoryTestInstructionPacketForMultiFunctionDecoders;
+      ENCODE_ADDRESS(factoryTestInstructionPacketForMultiFunctionDecoders);
+      bytes[(*size)++] = (dcc_Byte) (0x02 | p->set);
+      if (p->dataExists) bytes[(*size)++] = p->data;
+      return dcc_Success;
+    }
+    case dcc_SetDecoderFlagsPacketForMultiFunctionDecodersTag: {
+      struct dcc_SetDecoderFlagsPacketForMultiFunctionDecoders const *const p =
+        &packet->setDecoderFlagsPacketForMultiFunctionDecoders;
+      ENCODE_ADDRESS(setDecoderFlagsPacketForMultiFunctionDecoders);
+      bytes[(*size)++] = (dcc_Byte) (0x06 | p->set);
+      bytes[(*size)++] = (dcc_Byte) ((p->instruction & 0x0F) << 4 | (p->subaddress & 0x07));
+      return dcc_Success;
+    }
+    case dcc_SetExtendedAddressingPacketForMultiFunctionDecodersTag:
+      ENCODE_ADDRESS(setExtendedAddressingPacketForMultiFunctionDecoders);
+      bytes[(*size)++] = (dcc_Byte) (0x0A | packet->setExtendedAddressingPacketForMultiFunctionDecoders.set);
+      return dcc_Success;
+    case dcc_DecoderAcknowledgementRequestPacketForMultiFunctionDecodersTag:
+      ENCODE_ADDRESS(decoderAcknowledgementRequestPacketForMultiFunctionDecoders);
+      bytes[(*size)++] = (dcc_Byte) (0x0E | packet->decoderAcknowledgementRequestPacketForMultiFunctionDecoders.set);
+      return dcc_Success;
+    case dcc_ConsistControlPacketForMultiFunctionDecodersTag: {
+      struct dcc_ConsistControlPacketForMultiFunctionDecoders const *const p =
+        &packet->consistControlPacketForMultiFunctionDecoders;
+      if (p->consistAddress > 0x7F) return dcc_Failure;
+      ENCODE_ADDRESS(consistControlPacketForMultiFunctionDecoders);
+      bytes[(*size)++] = p->direction == dcc_Forward ? 0x12 : 0x13;
+      bytes[(*size)++] = (dcc_Byte) p->consistAddress;
+      return dcc_Success;
+    }
+    case dcc_SpeedStep128ControlPacketForMultiFunctionDecodersTag: {
+      struct dcc_SpeedStep128ControlPacketForMultiFunctionDecoders const *const p = &packet->speedStep128ControlPacket;
+      if (p->speed > 126) return dcc_Failure;
+      ENCODE_ADDRESS(speedStep128ControlPacket);
+      bytes[(*size)++] = 0x3F;
+      bytes[(*size)++] =
+        (dcc_Byte) ((p->direction == dcc_Forward) << 7 | (p->emergencyStop ? 1 : p->speed == 0 ? 0 : p->speed + 1));
+      return dcc_Success;
+    }
+    case dcc_RestrictedSpeedStepPacketForMultiFunctionDecodersTag: {
+      struct dcc_RestrictedSpeedStepPacketForMultiFunctionDecoders const *const p =
+        &packet->restrictedSpeedStepPacketForMultiFunctionDecoders;
+      dcc_Byte bits;
+      if (p->flControl) {
+        if (dcc_Failure == encodeSpeed4Bit(p->speed4Bit, p->emergencyStop, &bits)) return dcc_Failure;
+      } else {
+        if (dcc_Failure == encodeSpeed5Bit(p->speed5Bit, p->emergencyStop, p->directionMayBeIgnored, &bits)) {
+          return dcc_Failure;
+        }
+      }
+      ENCODE_ADDRESS(restrictedSpeedStepPacketForMultiFunctionDecoders);
+      bytes[(*size)++] = 0x3E;
+      bytes[(*size)++] = (dcc_Byte) (p->enabled << 7 | bits);
+      return dcc_Success;
+    }
+    case dcc_AnalogFunctionPacketForMultiFunctionDecodersTag: {
+      struct dcc_AnalogFunctionPacketForMultiFunctionDecoders const *const p =
+        &packet->analogFunctionPacketForMultiFunctionDecoders;
+      ENCODE_ADDRESS(analogFunctionPacketForMultiFunctionDecoders);
+      bytes[(*size)++] = 0x3D;
+      bytes[(*size)++] = p->output;
+      bytes[(*size)++] = p->data;
+      return dcc_Success;
+    }
+    case dcc_SpeedAndDirectionPacketForMultiFunctionDecodersTag: {
+      struct dcc_SpeedAndDirectionPacketForMultiFunctionDecoders const *const p =
+        &packet->speedAndDirectionPacketForMultiFunctionDecoders;
+      ENCODE_ADDRESS(speedAndDirectionPacketForMultiFunctionDecoders);
+      return encodeSpeedAndDirection(p->direction,
+                                     p->flControl,
+                                     p->speed4Bit,
+                                     p->fl,
+                                     p->speed5Bit,
+                                     p->emergencyStop,
+                                     !p->flControl && p->directionMayBeIgnored,
+                                     &bytes[(*size)++]);
+    }
+    case dcc_FunctionGroup1PacketForMultiFunctionDecodersTag: {
+      struct dcc_FunctionGroup1PacketForMultiFunctionDecoders const *const p =
+        &packet->functionGroup1PacketForMultiFunctionDecoders;
+      ENCODE_ADDRESS(functionGroup1PacketForMultiFunctionDecoders);
+      bytes[(*size)++] =
+        (dcc_Byte) (0x80 | packFlags(p->f1, p->f2, p->f3, p->f4, p->flControl && p->fl, false, false, false));
+      return dcc_Success;
+    }
+    case dcc_FunctionGroup2PacketForMultiFunctionDecodersTag: {
+      struct dcc_FunctionGroup2PacketForMultiFunctionDecoders const *const p =
+        &packet->functionGroup2PacketForMultiFunctionDecoders;
+      ENCODE_ADDRESS(functionGroup2PacketForMultiFunctionDecoders);
+      // F5～F8 と F9～F12 は同じ位置にある
+      bytes[(*size)++] = (dcc_Byte) (0xA0 | packFlags(p->functions.f5,
+                                                      p->functions.f6,
+                                                      p->functions.f7,
+                                                      p->functions.f8,
+                                                      p->group == dcc_FunctionGroup2Group_F5_F8,
+                                                      false,
+                                                      false,
+                                                      false));
+      return dcc_Success;
+    }
+    case dcc_BinaryStateControlLongFormPacketTag: {
+      struct dcc_BinaryStateControlLongFormPacket const *const p = &packet->binaryStateControlLongFormPacket;
+      if (p->stateAddress > 0x7FFF) return dcc_Failure;
+      ENCODE_ADDRESS(binaryStateControlLongFormPacket);
+      bytes[(*size)++] = 0xC0;
+      bytes[(*size)++] = (dcc_Byte) (p->state << 7 | (p->stateAddress & 0x7F));
+      bytes[(*size)++] = (dcc_Byte) (p->stateAddress >> 7);
+      return dcc_Success;
+    }
+    case dcc_BinaryStateControlShortFormPacketTag: {
+      struct dcc_BinaryStateControlShortFormPacket const *const p = &packet->binaryStateControlShortFormPacket;
+      if (p->stateAddress > 0x7F) return dcc_Failure;
+      ENCODE_ADDRESS(binaryStateControlShortFormPacket);
+      bytes[(*size)++] = 0xDD;
+      bytes[(*size)++] = (dcc_Byte) (p->state << 7 | p->stateAddress);
+      return dcc_Success;
+    }
+    case dcc_FunctionControlF13F20PacketTag: {
+      struct dcc_FunctionControlF13F20Packet const *const p = &packet->functionControlF13F20Packet;
+      ENCODE_ADDRESS(functionControlF13F20Packet);
+      bytes[(*size)++] = 0xDE;
+      bytes[(*size)++] = packFlags(p->f13, p->f14, p->f15, p->f16, p->f17, p->f18, p->f19, p->f20);
+      return dcc_Success;
+    }
+    case dcc_FunctionControlF21F28PacketTag: {
+      struct dcc_FunctionControlF21F28Packet const *const p = &packet->functionControlF21F28Packet;
+      ENCODE_ADDRESS(functionControlF21F28Packet);
+      bytes[(*size)++] = 0xDF;
+      bytes[(*size)++] = packFlags(p->f21, p->f22, p->f23, p->f24, p->f25, p->f26, p->f27, p->f28);
+      return dcc_Success;
+    }
+    default:
+      return dcc_Failure;
+  }
+#undef ENCODE_ADDRESS
+}
+
+enum dcc_Result dcc_encodePacket(struct dcc_Packet const packet, dcc_Byte *const bytes, size_t *const bytesSize) {
+  dcc_Byte encoded[PACKET_BYTES_MAX];
+  size_t size = 0;
+  if (dcc_Failure == encodeBody(&packet, encoded, &size)) return dcc_Failure;
+  dcc_Byte checksum = 0;
+  for (size_t i = 0; i < size; i++) checksum ^= encoded[i];
+  encoded[size++] = checksum;
+  memcpy(bytes, encoded, size);
+  *bytesSize = size;
+  return dcc_Success;
+}
+
+struct dcc_WaveformGenerator dcc_initializeWaveformGenerator(dcc_Byte const *const bytes, size_t const bytesSize,
+                                                             size_t const preambleBitsCount) {
+  struct dcc_WaveformGenerator generator = {
+    .bytesSize = bytesSize,
+    .bitsCount = preambleBitsCount + 9 * bytesSize + 1,
+    .preambleBitsCount = preambleBitsCount,
+    .bitIndex = 0,
+    .secondHalf = false,
+  };
+  memcpy(generator.bytes, bytes, bytesSize);
+  return generator;
+}
+
+// 送信するビット列の `index` 番目のビット
+// プリアンブルの `1` の後、各バイトはパケット開始ビットまたはデータバイト開始ビットの `0` と 8 ビットからなり、
+// 最後にパケット終了ビットの `1` が続く
+static dcc_Bit bitAt(struct dcc_WaveformGenerator const *const generator, size_t index) {
+  if (index < generator->preambleBitsCount) return 1;
+  index -= generator->preambleBitsCount;
+  size_t const byteIndex = index / 9;
+  if (byteIndex == generator->bytesSize) return 1;
+  size_t const offset = index % 9;
+  if (offset == 0) return 0;
+  return (generator->bytes[byteIndex] >> (8 - offset)) & 1;
+}
+
+size_t dcc_generateHalfBitPeriods(struct dcc_WaveformGenerator *const generator, dcc_HalfBitPeriod *const periods,
+                                  size_t const periodsCapacity) {
+  dcc_HalfBitPeriod const one = (dcc_HalfBitPeriod) dcc_nominalOneHalfBitSentPeriod;
+  dcc_HalfBitPeriod const zero = (dcc_HalfBitPeriod) dcc_nominalZeroHalfBitSentPeriod;
+  size_t count = 0;
+  while (count < periodsCapacity && generator->bitIndex < generator->bitsCount) {
+    periods[count++] = bitAt(generator, generator->bitIndex) ? one : zero;
+    // 1 ビットは同じ長さの 2 つの半ビットからなる
+    if (generator->secondHalf) generator->bitIndex++;
+    generator->secondHalf = !generator->secondHalf;
+  }
+  return count;
+}
+
+enum dcc_Result dcc_encodeBits(dcc_Byte const *const bytes, size_t const bytesSize, size_t const preambleBitsCount,
+                               uint32_t *const bits, size_t const bitsCapacity, size_t *const bitsSize) {
+  struct dcc_WaveformGenerator const generator = dcc_initializeWaveformGenerator(bytes, bytesSize, preambleBitsCount);
+  if (generator.bitsCount > bitsCapacity) return dcc_Failure;
+  for (size_t i = 0; i < generator.bitsCount; i++) {
+    uint32_t const mask = UINT32_C(1) << (31 - i % 32);
+    if (bitAt(&generator, i)) bits[i / 32] |= mask;
+    else bits[i / 32] &= ~mask;
+  }
+  *bitsSize = generator.bitsCount;
+  return dcc_Success;
+}
+
+dcc_AddressForExtendedPacket dcc_addressOfEncodedPacket(dcc_Byte const *const bytes) {
+  if (0xC0 <= bytes[0] && bytes[0] < 0xE8) return (dcc_AddressForExtendedPacket) ((bytes[0] & 0x3F) << 8 | bytes[1]);
+  return bytes[0];
+}
+
+struct dcc_WaveformCache dcc_initializeWaveformCache(struct dcc_WaveformCacheEntry *const entries, size_t const size,
+                                                     size_t const preambleBitsCount) {
+  for (size_t i = 0; i < size; i++) entries[i].used = false;
+  return (struct dcc_WaveformCache){ .entries = entries,
+                                     .size = size,
+                                     .preambleBitsCount = preambleBitsCount,
+                                     .hitsCount = 0,
+                                     .missesCount = 0 };
+}
+
+// 同じアドレスと種類でも別々に繰り返し送るパケットを区別する値
+static uint_least16_t waveformCacheChannel(struct dcc_Packet const *const packet) {
+  switch (packet->tag) {
+    case dcc_FunctionGroup2PacketForMultiFunctionDecodersTag:
+      return (uint_least16_t) packet->functionGroup2PacketForMultiFunctionDecoders.group;
+    case dcc_AnalogFunctionPacketForMultiFunctionDecodersTag:
+      return packet->analogFunctionPacketForMultiFunctionDecoders.output;
+    case dcc_BinaryStateControlLongFormPacketTag:
+      return packet->binaryStateControlLongFormPacket.stateAddress;
+    case dcc_BinaryStateControlShortFormPacketTag:
+      return packet->binaryStateControlShortFormPacket.stateAddress;
+    default:
+      return 0;
+  }
+}
+
+void dcc_invalidateWaveformCache(struct dcc_WaveformCache *const cache) {
+  for (size_t i = 0; i < cache->size; i++) cache->entries[i].used = false;
+}
+
+enum dcc_Result dcc_getWaveform(struct dcc_WaveformCache *const cache, struct dcc_Packet const packet,
+                                struct dcc_Waveform const **const waveform) {
+  if (cache->size == 0) return dcc_Failure;
+  dcc_Byte bytes[PACKET_BYTES_MAX];
+  size_t bytesSize;
+  if (dcc_Failure == dcc_encodePacket(packet, bytes, &bytesSize)) return dcc_Failure;
+  // アドレスはバイト列から取り出すとパケットの種類によらない
+  dcc_AddressForExtendedPacket const address = dcc_addressOfEncodedPacket(bytes);
+  uint_least16_t const channel = waveformCacheChannel(&packet);
+  // 開番地法で探し、見つからなければ最初の空きを使う
+  // 空きがなければ本来の位置の要素を追い出す
+  size_t const home = ((size_t) address * 31u + (size_t) packet.tag * 7u + channel) % cache->size;
+  struct dcc_WaveformCacheEntry *entry = NULL;
+  for (size_t i = 0; i < cache->size; i++) {
+    struct dcc_WaveformCacheEntry *const candidate = &cache->entries[(home + i) % cache->size];
+    if (!candidate->used) {
+      entry = candidate;
+      break;
+    }
+    if (candidate->address == address && candidate->tag == packet.tag && candidate->channel == channel) {
+      // 内容が変わっていなければそのまま使う
+      if (candidate->bytesSize == bytesSize && memcmp(candidate->bytes, bytes, bytesSize) == 0) {
+        cache->hitsCount++;
+        *waveform = &candidate->waveform;
+        return dcc_Success;
+      }
+      entry = candidate;
+      break;
+    }
+  }
+  struct dcc_WaveformGenerator generator = dcc_initializeWaveformGenerator(bytes, bytesSize, cache->preambleBitsCount);
+  if (DCC_WAVEFORM_PERIODS_CAPACITY < 2 * generator.bitsCount) return dcc_Failure;
+  if (entry == NULL) entry = &cache->entries[home];
+  cache->missesCount++;
+  entry->used = true;
+  entry->address = address;
+  entry->tag = packet.tag;
+  entry->channel = channel;
+  memcpy(entry->bytes, bytes, bytesSize);
+  entry->bytesSize = bytesSize;
+  entry->waveform.size = dcc_generateHalfBitPeriods(&generator, entry->waveform.periods, DCC_WAVEFORM_PERIODS_CAPACITY);
+  *waveform = &entry->waveform;
+  return dcc_Success;
+}
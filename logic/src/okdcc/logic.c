@@ -1,5 +1,3 @@
-// spell-checker:words uldiff
-
 #include <assert.h>
 #include <stdbool.h>
 #include <stddef.h>
@@ -9,26 +7,6 @@
 
 #include "logic_internal.h"
 
-#define DCC_ERROR_LOG(...)                                                               \
-  do {                                                                                   \
-    if (dcc_error_log != NULL) dcc_error_log(__FILE__, __LINE__, __func__, __VA_ARGS__); \
-    fprintf(stderr, "error: %s:%d:%s: ", __FILE__, __LINE__, __func__);                  \
-    fprintf(stderr, __VA_ARGS__);                                                        \
-    fprintf(stderr, "\n");                                                               \
-    exit(EXIT_FAILURE);                                                                  \
-  } while (0)
-
-#define DCC_DEBUG_LOG(...) (dcc_debug_log == NULL ? 0 : dcc_debug_log(__FILE__, __LINE__, __func__, __VA_ARGS__))
-
-#define DCC_UNREACHABLE(...) DCC_ERROR_LOG("unreachable: "__VA_ARGS__)
-
-#define DCC_UNIMPLEMENTED() DCC_ERROR_LOG("unimplemented")
-
-#ifdef DCC_ASSERT
-#undef DCC_ASSERT
-#define DCC_ASSERT(e) assert(e)
-#endif
-
 void (*dcc_error_log)(char const *const file, int const line, char const *func, char const *format, ...) = NULL;
 
 int (*dcc_debug_log)(char const *const file, int const line, char const *func, char const *format, ...) = NULL;
@@ -66,65 +44,313 @@ dcc_TimeMicroSec const dcc_maxOneHalfBitSentPeriodDiff = 3UL;
 // 受信した `1` の半ビットの時間の差の最大値
 dcc_TimeMicroSec const dcc_maxOneHalfBitReceivedPeriodDiff = 6UL;
 
+// 生成器が送る `1` の半ビットの継続時間
+dcc_TimeMicroSec const dcc_nominalOneHalfBitSentPeriod = 58UL;
+
+// 生成器が送る `0` の半ビットの継続時間
+dcc_TimeMicroSec const dcc_nominalZeroHalfBitSentPeriod = 100UL;
+
+struct dcc_ReceiveTiming const dcc_strictReceiveTiming = DCC_STRICT_RECEIVE_TIMING;
+
+struct dcc_ReceiveTiming const dcc_tolerantReceiveTiming = DCC_TOLERANT_RECEIVE_TIMING;
+
+struct dcc_ReceiveTiming const dcc_defaultReceiveTiming = DCC_DEFAULT_RECEIVE_TIMING;
+
+// 既定の経路で使う受信のタイミング
+// 初期化子が見える static const なので、読み出しはコンパイル時に即値に畳み込まれる
+static struct dcc_ReceiveTiming const defaultReceiveTiming = DCC_DEFAULT_RECEIVE_TIMING;
+
 #define LOG_BUFFER_SIZE 1024
 
-static unsigned long uldiff(unsigned long const a, unsigned long const b) { return a > b ? a - b : b - a; }
+size_t dcc_floorPowerOfTwo(size_t const n) {
+  if (n == 0) return 0;
+  size_t result = 1;
+  while (result <= n / 2) result <<= 1;
+  return result;
+}
+
+// 符号なし整数の減算は法 2^n で行われるので、下位32ビットを取り出せば一周をまたいでも正しい差になる
+dcc_TimeMicroSec dcc_elapsedTime(dcc_TimeMicroSec const since, dcc_TimeMicroSec const until) {
+  return (until - since) & DCC_TIME_MICRO_SEC_MASK;
+}
 
 struct dcc_SignalBuffer dcc_initializeSignalBuffer(dcc_TimeMicroSec *buffer, size_t const size) {
-  return (struct dcc_SignalBuffer){ .buffer = buffer, .size = size, .written = 0, .writeIndex = 0, .readIndex = 0 };
+  return (struct dcc_SignalBuffer){
+    .buffer = buffer, .size = dcc_floorPowerOfTwo(size), .writeIndex = 0, .readIndex = 0
+  };
 }
 
+// インデックスは単調増加しオーバーフローで一周するが、`size` は2の冪なので
+// `writeIndex - readIndex` は常に書き込まれている要素数になる
 enum dcc_Result dcc_writeSignalBuffer(struct dcc_SignalBuffer *const buffer, dcc_TimeMicroSec const signal) {
   DCC_DEBUG_LOG("dcc_writeSignalBuffer(buffer: %p, signal: %lu)", buffer, signal);
-  if (buffer->written == buffer->size) return dcc_Failure;
-  buffer->buffer[buffer->writeIndex] = signal;
-  buffer->written++;
-  buffer->writeIndex = (buffer->writeIndex + 1) % buffer->size;
+  size_t const writeIndex = DCC_LOAD_RELAXED(&buffer->writeIndex);
+  size_t const readIndex = DCC_LOAD_ACQUIRE(&buffer->readIndex);
+  if (writeIndex - readIndex == buffer->size) return dcc_Failure;
+  buffer->buffer[writeIndex & (buffer->size - 1)] = signal;
+  DCC_STORE_RELEASE(&buffer->writeIndex, writeIndex + 1);
   return dcc_Success;
 }
 
 enum dcc_Result dcc_readSignalBuffer(struct dcc_SignalBuffer *const buffer, dcc_TimeMicroSec *const signal) {
   DCC_DEBUG_LOG("dcc_readSignalBuffer(buffer: %p, signal: %p)", buffer, signal);
-  if (buffer->written == 0) return dcc_Failure;
-  *signal = buffer->buffer[buffer->readIndex];
-  buffer->written--;
-  buffer->readIndex = (buffer->readIndex + 1) % buffer->size;
+  size_t const readIndex = DCC_LOAD_RELAXED(&buffer->readIndex);
+  size_t const writeIndex = DCC_LOAD_ACQUIRE(&buffer->writeIndex);
+  if (writeIndex == readIndex) return dcc_Failure;
+  *signal = buffer->buffer[readIndex & (buffer->size - 1)];
+  DCC_STORE_RELEASE(&buffer->readIndex, readIndex + 1);
+  return dcc_Success;
+}
+
+size_t dcc_readSignalBufferSpans(struct dcc_SignalBuffer *const buffer, struct dcc_SignalSpan spans[2]) {
+  DCC_DEBUG_LOG("dcc_readSignalBufferSpans(buffer: %p, spans: %p)", buffer, spans);
+  size_t const readIndex = DCC_LOAD_RELAXED(&buffer->readIndex);
+  size_t const writeIndex = DCC_LOAD_ACQUIRE(&buffer->writeIndex);
+  size_t const size = writeIndex - readIndex;
+  if (size == 0) return 0;
+  size_t const head = readIndex & (buffer->size - 1);
+  size_t const firstSize = buffer->size - head < size ? buffer->size - head : size;
+  spans[0] = (struct dcc_SignalSpan){ .signals = buffer->buffer + head, .size = firstSize };
+  if (firstSize == size) return 1;
+  spans[1] = (struct dcc_SignalSpan){ .signals = buffer->buffer, .size = size - firstSize };
+  return 2;
+}
+
+void dcc_releaseSignalBuffer(struct dcc_SignalBuffer *const buffer, size_t const size) {
+  DCC_DEBUG_LOG("dcc_releaseSignalBuffer(buffer: %p, size: %zu)", buffer, size);
+  size_t const readIndex = DCC_LOAD_RELAXED(&buffer->readIndex);
+  DCC_STORE_RELEASE(&buffer->readIndex, readIndex + size);
+}
+
+struct dcc_PeriodBuffer dcc_initializePeriodBuffer(dcc_HalfBitPeriod *array, size_t const size) {
+  return (struct dcc_PeriodBuffer){ .buffer = array,
+                                    .size = dcc_floorPowerOfTwo(size),
+                                    .writeIndex = 0,
+                                    .readIndex = 0,
+                                    .lastSignal = 0,
+                                    .lastSignalExists = false,
+                                    .gapPending = false };
+}
+
+// インデックスの扱いは dcc_SignalBuffer と同じ
+enum dcc_Result dcc_writePeriodBuffer(struct dcc_PeriodBuffer *const buffer, dcc_TimeMicroSec const period) {
+  DCC_DEBUG_LOG("dcc_writePeriodBuffer(buffer: %p, period: %lu)", buffer, period);
+  size_t const writeIndex = DCC_LOAD_RELAXED(&buffer->writeIndex);
+  size_t const readIndex = DCC_LOAD_ACQUIRE(&buffer->readIndex);
+  if (writeIndex - readIndex == buffer->size) return dcc_Failure;
+  buffer->buffer[writeIndex & (buffer->size - 1)] =
+    period < DCC_HALF_BIT_PERIOD_MAX ? (dcc_HalfBitPeriod) period : DCC_HALF_BIT_PERIOD_MAX;
+  DCC_STORE_RELEASE(&buffer->writeIndex, writeIndex + 1);
+  return dcc_Success;
+}
+
+enum dcc_Result dcc_writeSignalToPeriodBuffer(struct dcc_PeriodBuffer *const buffer, dcc_TimeMicroSec const signal) {
+  DCC_DEBUG_LOG("dcc_writeSignalToPeriodBuffer(buffer: %p, signal: %lu)", buffer, signal);
+  if (!buffer->lastSignalExists) {
+    buffer->lastSignal = signal;
+    buffer->lastSignalExists = true;
+    return dcc_Success;
+  }
+  // 書き込めなくても lastSignal を進め、失われた変化を次の継続時間に畳み込まない
+  dcc_TimeMicroSec const period = dcc_elapsedTime(buffer->lastSignal, signal);
+  buffer->lastSignal = signal;
+  // 空きができたら、取得の実装と同じく `DCC_HALF_BIT_PERIOD_MAX` を途切れの印として先に書き込む
+  if (buffer->gapPending) {
+    if (dcc_Failure == dcc_writePeriodBuffer(buffer, DCC_HALF_BIT_PERIOD_MAX)) return dcc_Failure;
+    buffer->gapPending = false;
+  }
+  if (dcc_Failure == dcc_writePeriodBuffer(buffer, period)) {
+    buffer->gapPending = true;
+    return dcc_Failure;
+  }
+  return dcc_Success;
+}
+
+enum dcc_Result dcc_readPeriodBuffer(struct dcc_PeriodBuffer *const buffer, dcc_HalfBitPeriod *const period) {
+  DCC_DEBUG_LOG("dcc_readPeriodBuffer(buffer: %p, period: %p)", buffer, period);
+  size_t const readIndex = DCC_LOAD_RELAXED(&buffer->readIndex);
+  size_t const writeIndex = DCC_LOAD_ACQUIRE(&buffer->writeIndex);
+  if (writeIndex == readIndex) return dcc_Failure;
+  *period = buffer->buffer[readIndex & (buffer->size - 1)];
+  DCC_STORE_RELEASE(&buffer->readIndex, readIndex + 1);
   return dcc_Success;
 }
 
+size_t dcc_readPeriodBufferSpans(struct dcc_PeriodBuffer *const buffer, struct dcc_PeriodSpan spans[2]) {
+  DCC_DEBUG_LOG("dcc_readPeriodBufferSpans(buffer: %p, spans: %p)", buffer, spans);
+  size_t const readIndex = DCC_LOAD_RELAXED(&buffer->readIndex);
+  size_t const writeIndex = DCC_LOAD_ACQUIRE(&buffer->writeIndex);
+  size_t const size = writeIndex - readIndex;
+  if (size == 0) return 0;
+  size_t const head = readIndex & (buffer->size - 1);
+  size_t const firstSize = buffer->size - head < size ? buffer->size - head : size;
+  spans[0] = (struct dcc_PeriodSpan){ .periods = buffer->buffer + head, .size = firstSize };
+  if (firstSize == size) return 1;
+  spans[1] = (struct dcc_PeriodSpan){ .periods = buffer->buffer, .size = size - firstSize };
+  return 2;
+}
+
+void dcc_releasePeriodBuffer(struct dcc_PeriodBuffer *const buffer, size_t const size) {
+  DCC_DEBUG_LOG("dcc_releasePeriodBuffer(buffer: %p, size: %zu)", buffer, size);
+  size_t const readIndex = DCC_LOAD_RELAXED(&buffer->readIndex);
+  DCC_STORE_RELEASE(&buffer->readIndex, readIndex + size);
+}
+
 struct dcc_SignalStreamParser dcc_initializeSignalStreamParser(void) {
-  return (struct dcc_SignalStreamParser){ { 0 }, 0 };
+  return (struct dcc_SignalStreamParser){
+    .signal = 0,
+    .signalExists = false,
+    .period = 0,
+    .periodExists = false,
+    .fragment = 0,
+    .fragmentExists = false,
+    .errorsCount = 0,
+    .timingProfile = NULL,
+    .receiveTiming = NULL,
+    .clockRecovery = NULL,
+    .oddPeriod = false,
+    .polarity = dcc_SignalPolarity_Unknown,
+  };
 }
 
-enum dcc_StreamParserResult dcc_feedSignal(struct dcc_SignalStreamParser *const parser, dcc_TimeMicroSec const signal,
-                                           dcc_Bit *const bit) {
-  DCC_DEBUG_LOG("dcc_feedSignal(parser: %p, signal: %lu, bit: %p)", parser, signal, bit);
-  switch (parser->signalsSize) {
-    case 0:
-    case 1:
-      parser->signals[parser->signalsSize] = signal;
-      parser->signalsSize++;
-      return dcc_StreamParserResult_Continue;
-    case 2: {
-      // TODO signal がオーバーフローした場合の処理が必要
-      enum dcc_Result const result =
-        dcc_decodeSignal(parser->signals[1] - parser->signals[0], signal - parser->signals[1], bit);
-      switch (result) {
-        case dcc_Failure:
-          parser->signals[0] = parser->signals[1];
-          parser->signals[1] = signal;
-          return dcc_StreamParserResult_Failure;
-        case dcc_Success:
-          parser->signals[0] = signal;
-          parser->signalsSize = 1;
-          return dcc_StreamParserResult_Success;
-        default:
-          DCC_UNREACHABLE("result: %d", result);
+// 不正な状態から回復して、次の電圧変化から読み直す
+static void recoverSignalStreamParser(struct dcc_SignalStreamParser *const parser) {
+  size_t const errorsCount = parser->errorsCount;
+  struct dcc_TimingProfile *const timingProfile = parser->timingProfile;
+  struct dcc_ReceiveTiming const *const receiveTiming = parser->receiveTiming;
+  struct dcc_ClockRecovery *const clockRecovery = parser->clockRecovery;
+  *parser = dcc_initializeSignalStreamParser();
+  parser->errorsCount = errorsCount + 1;
+  parser->timingProfile = timingProfile;
+  parser->receiveTiming = receiveTiming;
+  parser->clockRecovery = clockRecovery;
+}
+
+// `min ≦ x ≦ max` を分岐なしで判定する
+// `x < min` のときは `x - min` が符号なし整数の一周で非常に大きな値になるので、比較1回で済む
+static unsigned inRange(dcc_TimeMicroSec const x, dcc_TimeMicroSec const min, dcc_TimeMicroSec const max) {
+  return (unsigned) (x - min <= max - min);
+}
+
+// 分岐予測の外れを避けるため、全ての条件を分岐なしで求めてから組み合わせる
+// 成否に関わらず `*bit` に書き込む
+// 呼び出し元に展開されるので、`timing` が既定のタイミングなら境界は即値になり、`skew` が 0 なら引き算も消える
+// `skew` は `1` の組の後半から前半を引いた値の期待値
+static inline enum dcc_Result decodeSignalWithSkew(struct dcc_ReceiveTiming const *const timing, long const skew,
+                                                   dcc_TimeMicroSec const period1, dcc_TimeMicroSec const period2,
+                                                   dcc_Bit *const bit) {
+  // 各半ビットが `1` と `0`（引き伸ばされたものを含む）のどちらの許容範囲内かに分類する
+  // 2つの範囲は重ならない
+  unsigned const isOne1 = inRange(period1, timing->minOneHalfBitPeriod, timing->maxOneHalfBitPeriod);
+  unsigned const isZero1 = inRange(period1, timing->minZeroHalfBitPeriod, timing->maxZeroHalfBitPeriod);
+  unsigned const isZero2 = inRange(period2, timing->minZeroHalfBitPeriod, timing->maxZeroHalfBitPeriod);
+  // |period2 - period1 - skew| ≦ d を period2 - period1 - skew + d ∈ [0, 2d] として判定する
+  unsigned const one = isOne1 & inRange(period2 - period1 - (dcc_TimeMicroSec) skew + timing->maxOneHalfBitPeriodDiff,
+                                        0,
+                                        2 * timing->maxOneHalfBitPeriodDiff);
+  // 両方が `0` の範囲内なら和はオーバーフローしない
+  unsigned const zero = isZero1 & isZero2 & inRange(period1 + period2, 0, timing->maxStretchedZeroBitPeriod);
+  *bit = (dcc_Bit) one;
+  return (one | zero) ? dcc_Success : dcc_Failure;
+}
+
+static inline enum dcc_Result decodeSignalWithTiming(struct dcc_ReceiveTiming const *const timing,
+                                                     dcc_TimeMicroSec const period1, dcc_TimeMicroSec const period2,
+                                                     dcc_Bit *const bit) {
+  return decodeSignalWithSkew(timing, 0, period1, period2, bit);
+}
+
+// dcc_feedPeriod の本体
+// dcc_decodeBatch からも呼ばれるのでここではデバッグログを出力しない
+static enum dcc_StreamParserResult feedPeriod(struct dcc_SignalStreamParser *const parser,
+                                              dcc_TimeMicroSec period, dcc_Bit *const bit) {
+  // プロファイルにはスパイクも含めて受け取ったままの継続時間を記録する
+  if (parser->timingProfile != NULL) {
+    dcc_profileHalfBitPeriod(parser->timingProfile, period);
+    if (parser->periodExists) dcc_profileHalfBitPair(parser->timingProfile, parser->period, period);
+  }
+  // `1` の半ビットの最小値より短い継続時間は半ビットになり得ないので、スパイクで分かれた断片とみなして次と合わせる
+  // スパイクは半ビットを3つに分けるが、元の半ビットに戻るのは最初の断片も短い場合だけである
+  // 最初の断片が半ビットとして読める長さなら、それはそのまま処理され、残りの2つを合わせたものは元の半ビットより短くなる
+  // その半ビットは失われるが、合わせなくても失われるのは同じで、パケットの途中ならデコーダーが次のプリアンブルから同期し直す
+  if (parser->fragmentExists) {
+    period += parser->fragment;
+    parser->fragmentExists = false;
+  }
+  dcc_TimeMicroSec const minOneHalfBitPeriod = parser->receiveTiming == NULL
+                                                 ? defaultReceiveTiming.minOneHalfBitPeriod
+                                                 : parser->receiveTiming->minOneHalfBitPeriod;
+  if (period < minOneHalfBitPeriod) {
+    parser->fragment = period;
+    parser->fragmentExists = true;
+    return dcc_StreamParserResult_Continue;
+  }
+  if (parser->clockRecovery != NULL) dcc_recoverClock(parser->clockRecovery, period);
+  parser->oddPeriod = !parser->oddPeriod;
+  if (!parser->periodExists) {
+    parser->period = period;
+    parser->periodExists = true;
+    return dcc_StreamParserResult_Continue;
+  }
+  dcc_Bit decoded;
+  // 既定のタイミングは別に展開して、境界を即値で比べる
+  // クロック再生は receiveTiming を学習したタイミングに向けるので、既定の経路には判定が増えない
+  enum dcc_Result const result =
+    parser->receiveTiming == NULL
+      ? decodeSignalWithTiming(&defaultReceiveTiming, parser->period, period, &decoded)
+      : decodeSignalWithSkew(parser->receiveTiming,
+                             parser->clockRecovery == NULL ? 0 : parser->clockRecovery->pairSkew,
+                             parser->period,
+                             period,
+                             &decoded);
+  switch (result) {
+    case dcc_Failure:
+      // 極性が分かっていて後半の半ビットがビットを始められなければ、次の半ビットから組み直す
+      // 極性が間違っていた場合に備えて、組み直すのは1回だけにする
+      if (parser->polarity != dcc_SignalPolarity_Unknown &&
+          (dcc_SignalPolarity_OddPeriodFirst == parser->polarity) != parser->oddPeriod) {
+        parser->periodExists = false;
+        parser->polarity = dcc_SignalPolarity_Unknown;
+        return dcc_StreamParserResult_Failure;
       }
-    }
+      // 後半の半ビットを次のビットの前半として扱う
+      parser->period = period;
+      return dcc_StreamParserResult_Failure;
+    case dcc_Success:
+      parser->periodExists = false;
+      *bit = decoded;
+      return dcc_StreamParserResult_Success;
     default:
-      DCC_UNREACHABLE("signalsSize: %zd", parser->signalsSize);
+      DCC_UNREACHABLE("result: %d", result);
+      recoverSignalStreamParser(parser);
+      return dcc_StreamParserResult_Failure;
+  }
+}
+
+// dcc_feedSignal の本体
+// dcc_decodeBatch からも呼ばれるのでここではデバッグログを出力しない
+static enum dcc_StreamParserResult feedSignal(struct dcc_SignalStreamParser *const parser,
+                                              dcc_TimeMicroSec const signal, dcc_Bit *const bit) {
+  if (!parser->signalExists) {
+    parser->signal = signal;
+    parser->signalExists = true;
+    return dcc_StreamParserResult_Continue;
   }
+  dcc_TimeMicroSec const period = dcc_elapsedTime(parser->signal, signal);
+  parser->signal = signal;
+  return feedPeriod(parser, period, bit);
+}
+
+enum dcc_StreamParserResult dcc_feedSignal(struct dcc_SignalStreamParser *const parser, dcc_TimeMicroSec const signal,
+                                           dcc_Bit *const bit) {
+  DCC_DEBUG_LOG("dcc_feedSignal(parser: %p, signal: %lu, bit: %p)", parser, signal, bit);
+  return feedSignal(parser, signal, bit);
+}
+
+enum dcc_StreamParserResult dcc_feedPeriod(struct dcc_SignalStreamParser *const parser, dcc_TimeMicroSec const period,
+                                           dcc_Bit *const bit) {
+  DCC_DEBUG_LOG("dcc_feedPeriod(parser: %p, period: %lu, bit: %p)", parser, period, bit);
+  return feedPeriod(parser, period, bit);
 }
 
 struct dcc_BitStreamParser dcc_initializeBitStreamParser(void) {
@@ -133,12 +359,22 @@ struct dcc_BitStreamParser dcc_initializeBitStreamParser(void) {
     .inPreamble = { .oneBitsCount = 0 },
     .bytes = { 0 },
     .bytesSize = 0,
+    .errorsCount = 0,
   };
 }
 
-enum dcc_StreamParserResult dcc_feedBit(struct dcc_BitStreamParser *const parser, dcc_Bit const bit,
-                                        dcc_Byte *const bytes, size_t *const bytesSize) {
-  DCC_DEBUG_LOG("dcc_feedBit(parser: %p, bit: %d, bytes: %p, bytesSize: %p)", parser, bit, bytes, bytesSize);
+void dcc_resetBitStreamParser(struct dcc_BitStreamParser *const parser) {
+  size_t const errorsCount = parser->errorsCount;
+  *parser = dcc_initializeBitStreamParser();
+  parser->errorsCount = errorsCount;
+}
+
+// dcc_feedBitView の本体
+// dcc_decodeBatch からも呼ばれるのでここではデバッグログを出力しない
+// パケットのバイト列は parser->bytes に残し、その参照を返す
+// parser->bytes は次のバイトが揃うまで書き換えられない
+static enum dcc_StreamParserResult feedBitView(struct dcc_BitStreamParser *const parser, dcc_Bit const bit,
+                                               struct dcc_BytesView *const bytes) {
   switch (parser->state) {
     case dcc_BitStreamParserState_InPreamble:
       if (bit) {
@@ -146,8 +382,8 @@ enum dcc_StreamParserResult dcc_feedBit(struct dcc_BitStreamParser *const parser
         return dcc_StreamParserResult_Continue;
       }
       if (parser->inPreamble.oneBitsCount <= 12) {
-        DCC_DEBUG_LOG("too short preamble: one bits count: %d", parser->inPreamble.oneBitsCount);
-        *parser = dcc_initializeBitStreamParser();
+        DCC_DEBUG_LOG("too short preamble: one bits count: %zu", parser->inPreamble.oneBitsCount);
+        dcc_resetBitStreamParser(parser);
         return dcc_StreamParserResult_Failure;
       }
       parser->state = dcc_BitStreamParserState_InByte;
@@ -155,17 +391,23 @@ enum dcc_StreamParserResult dcc_feedBit(struct dcc_BitStreamParser *const parser
       parser->inByte.bitCount = 0;
       return dcc_StreamParserResult_Continue;
     case dcc_BitStreamParserState_InByte:
+      if (7 < parser->inByte.bitCount || DCC_BIT_STREAM_PARSER_BYTES_CAPACITY < parser->bytesSize) break;
       parser->inByte.byte |= (bit << (7 - parser->inByte.bitCount));
       parser->inByte.bitCount++;
       if (parser->inByte.bitCount < 8) return dcc_StreamParserResult_Continue;
+      if (parser->bytesSize == DCC_BIT_STREAM_PARSER_BYTES_CAPACITY) {
+        DCC_DEBUG_LOG("too long packet");
+        dcc_resetBitStreamParser(parser);
+        return dcc_StreamParserResult_Failure;
+      }
       parser->bytes[parser->bytesSize] = parser->inByte.byte;
       parser->bytesSize++;
       parser->state = dcc_BitStreamParserState_AfterByte;
       return dcc_StreamParserResult_Continue;
     case dcc_BitStreamParserState_AfterByte:
+      if (parser->bytesSize == 0 || DCC_BIT_STREAM_PARSER_BYTES_CAPACITY < parser->bytesSize) break;
       if (bit) {
-        memcpy(bytes, parser->bytes, parser->bytesSize);
-        *bytesSize = parser->bytesSize;
+        *bytes = (struct dcc_BytesView){ .bytes = parser->bytes, .size = parser->bytesSize };
         parser->state = dcc_BitStreamParserState_InPreamble;
         parser->inPreamble.oneBitsCount = 0;
         parser->bytesSize = 0;
@@ -176,23 +418,56 @@ enum dcc_StreamParserResult dcc_feedBit(struct dcc_BitStreamParser *const parser
       parser->inByte.bitCount = 0;
       return dcc_StreamParserResult_Continue;
     default:
-      DCC_UNREACHABLE("state: %d", parser->state);
+      break;
   }
+  // 状態が壊れていれば、捨てて次のプリアンブルから同期し直す
+  DCC_ERROR_LOG("invalid state: %d, bitCount: %zu, bytesSize: %zu",
+                (int) parser->state,
+                parser->inByte.bitCount,
+                parser->bytesSize);
+  dcc_resetBitStreamParser(parser);
+  parser->errorsCount++;
+  return dcc_StreamParserResult_Failure;
 }
 
-enum dcc_Result dcc_decodeSignal(dcc_TimeMicroSec const period1, dcc_TimeMicroSec const period2, dcc_Bit *const bit) {
-  if (period1 >= dcc_minOneHalfBitReceivedPeriod && period1 <= dcc_maxOneHalfBitReceivedPeriod &&
-      uldiff(period1, period2) <= dcc_maxOneHalfBitReceivedPeriodDiff) {
-    *bit = 1;
-    return dcc_Success;
-  }
-  if (period1 >= dcc_minZeroHalfBitReceivedPeriod && period1 <= dcc_maxZeroHalfBitReceivedPeriod &&
-      period2 >= dcc_minZeroHalfBitReceivedPeriod && period2 <= dcc_maxZeroHalfBitReceivedPeriod &&
-      period1 + period2 <= dcc_maxStretchedZeroBitPeriod) {
-    *bit = 0;
-    return dcc_Success;
+enum dcc_StreamParserResult dcc_feedBit(struct dcc_BitStreamParser *const parser, dcc_Bit const bit,
+                                        dcc_Byte *const bytes, size_t *const bytesSize) {
+  DCC_DEBUG_LOG("dcc_feedBit(parser: %p, bit: %d, bytes: %p, bytesSize: %p)", parser, bit, bytes, bytesSize);
+  struct dcc_BytesView view;
+  enum dcc_StreamParserResult const result = feedBitView(parser, bit, &view);
+  if (result == dcc_StreamParserResult_Success) {
+    memcpy(bytes, view.bytes, view.size);
+    *bytesSize = view.size;
   }
-  return dcc_Failure;
+  return result;
+}
+
+enum dcc_StreamParserResult dcc_feedBitView(struct dcc_BitStreamParser *const parser, dcc_Bit const bit,
+                                            struct dcc_BytesView *const bytes) {
+  DCC_DEBUG_LOG("dcc_feedBitView(parser: %p, bit: %d, bytes: %p)", parser, bit, bytes);
+  return feedBitView(parser, bit, bytes);
+}
+
+enum dcc_Result dcc_decodeSignal(dcc_TimeMicroSec const period1, dcc_TimeMicroSec const period2, dcc_Bit *const bit) {
+  return decodeSignalWithTiming(&defaultReceiveTiming, period1, period2, bit);
+}
+
+enum dcc_Result dcc_decodeSignalWithTiming(struct dcc_ReceiveTiming const *const timing, dcc_TimeMicroSec const period1,
+                                           dcc_TimeMicroSec const period2, dcc_Bit *const bit) {
+  return decodeSignalWithTiming(timing, period1, period2, bit);
+}
+
+enum dcc_Result dcc_validateReceiveTiming(struct dcc_ReceiveTiming const *const timing) {
+  DCC_DEBUG_LOG("dcc_validateReceiveTiming(timing: %p)", timing);
+  // `1` と `0` の範囲が重なると、判定の結果が一意に決まらない
+  if (timing->maxOneHalfBitPeriod < timing->minOneHalfBitPeriod) return dcc_Failure;
+  if (timing->minZeroHalfBitPeriod <= timing->maxOneHalfBitPeriod) return dcc_Failure;
+  if (timing->maxZeroHalfBitPeriod < timing->minZeroHalfBitPeriod) return dcc_Failure;
+  // dcc_decodeSignalsToBits は32ビットで計算するので、`0` の半ビットの和と `1` の差の範囲の幅も収まらなければならない
+  if (DCC_TIME_MICRO_SEC_MASK / 2 < timing->maxZeroHalfBitPeriod) return dcc_Failure;
+  if ((timing->maxStretchedZeroBitPeriod & ~(dcc_TimeMicroSec) DCC_TIME_MICRO_SEC_MASK) != 0) return dcc_Failure;
+  if (DCC_TIME_MICRO_SEC_MASK / 2 < timing->maxOneHalfBitPeriodDiff) return dcc_Failure;
+  return dcc_Success;
 }
 
 enum dcc_Result dcc_validatePacket(dcc_Byte const *const bytes, size_t const bytesSize, dcc_Byte const checksum) {
@@ -202,64 +477,9 @@ enum dcc_Result dcc_validatePacket(dcc_Byte const *const bytes, size_t const byt
   return dcc_Failure;
 }
 
-enum dcc_Result dcc_parsePacket(dcc_Byte const *const bytes, size_t const bytesSize, struct dcc_Packet *const packet) {
-  if (dcc_Success ==
-      dcc_parseSpeedAndDirectionPacketForLocomotiveDecoders(bytes,
-                                                            bytesSize,
-                                                            false,  // TODO CV の実装ができたら書き換える
-                                                            &packet->speedAndDirectionPacketForLocomotiveDecoders)) {
-    packet->tag = dcc_SpeedAndDirectionPacketForLocomotiveDecodersTag;
-    return dcc_Success;
-  }
-  if (dcc_Success == dcc_parseResetPacketForAllDecoders(bytes, bytesSize)) {
-    packet->tag = dcc_ResetPacketForAllDecodersTag;
-    return dcc_Success;
-  }
-  if (dcc_Success == dcc_parseIdlePacketForAllDecoders(bytes, bytesSize)) {
-    packet->tag = dcc_IdlePacketForAllDecodersTag;
-    return dcc_Success;
-  }
-  if (dcc_Success ==
-      dcc_parseResetPacketForMultiFunctionDecoders(bytes, bytesSize, &packet->resetPacketForMultiFunctionDecoders)) {
-    packet->tag = dcc_ResetPacketForMultiFunctionDecodersTag;
-    return dcc_Success;
-  }
-  if (dcc_Success ==
-      dcc_parseHardResetPacketForMultiFunctionDecoders(bytes,
-                                                       bytesSize,
-                                                       &packet->hardResetPacketForMultiFunctionDecoders)) {
-    packet->tag = dcc_HardResetPacketForMultiFunctionDecodersTag;
-    return dcc_Success;
-  }
-  if (dcc_Success == dcc_parseDecoderAcknowledgementRequestPacket(
-                       bytes,
-                       bytesSize,
-                       &packet->decoderAcknowledgementRequestPacketForMultiFunctionDecoders)) {
-    packet->tag = dcc_DecoderAcknowledgementRequestPacketForMultiFunctionDecodersTag;
-    return dcc_Success;
-  }
-  if (dcc_Success == dcc_parseFactoryTestInstructionPacketForMultiFunctionDecoders(
-                       bytes,
-                       bytesSize,
-                       &packet->factoryTestInstructionPacketForMultiFunctionDecoders)) {
-    packet->tag = dcc_FactoryTestInstructionPacketForMultiFunctionDecodersTag;
-    return dcc_Success;
-  }
-  if (dcc_Success ==
-      dcc_parseConsistControlPacket(bytes, bytesSize, &packet->consistControlPacketForMultiFunctionDecoders)) {
-    packet->tag = dcc_ConsistControlPacketForMultiFunctionDecodersTag;
-    return dcc_Success;
-  }
-  if (dcc_Success == dcc_parseSpeedStep128ControlPacket(bytes, bytesSize, &packet->speedStep128ControlPacket)) {
-    packet->tag = dcc_SpeedStep128ControlPacketForMultiFunctionDecodersTag;
-    return dcc_Success;
-  }
-  return dcc_Failure;
-}
-
 void parseSpeed4Bit(dcc_Byte const byte, dcc_Speed4Bit *const speed, bool *const emergencyStop) {
   *emergencyStop = false;
-  dcc_Speed4Bit const speed_ = (dcc_Speed4Bit) (byte & 0x1F);
+  dcc_Speed4Bit const speed_ = (dcc_Speed4Bit) (byte & 0x0F);
   switch (speed_) {
     case 0:
       *speed = 0;
@@ -338,7 +558,7 @@ enum dcc_Result dcc_parseBroadcastStopPacketForAllDecoders(dcc_Byte const *const
   if (bytesSize < 3) return dcc_Failure;
   if (bytes[0] != 0 || (bytes[1] & 0xCE) != 0x40) return dcc_Failure;
   packet->direction = bytes[1] & 0x20 ? dcc_Forward : dcc_Backward;
-  packet->directionMayBeIgnored = (bool) bytes[1] & 0x10;
+  packet->directionMayBeIgnored = (bytes[1] & 0x10) != 0;
   packet->kind = (enum dcc_BroadcastStopKind)(bytes[1] & 1);
   return dcc_Success;
 }
@@ -358,58 +578,41 @@ static enum dcc_Result parseAddressForExtendedPacket(dcc_Byte const *const bytes
   return dcc_Success;
 }
 
-enum dcc_Result dcc_parseResetPacketForMultiFunctionDecoders(
-  dcc_Byte const *const bytes, size_t const bytesSize, struct dcc_ResetPacketForMultiFunctionDecoders *const packet) {
-  if (bytesSize < 3) return dcc_Failure;
-  size_t addressSize;
-  if (dcc_Failure == parseAddressForExtendedPacket(bytes, bytesSize, &packet->address, &addressSize)) {
-    return dcc_Failure;
-  }
-  if (bytesSize < addressSize + 1) return dcc_Failure;
+// 以下の parse…Instruction はアドレスの後の命令部分をパースする
+// アドレスはパース済みとして `bytes[addressSize]` 以降だけを見る
+// `bytesSize` が 3 以上であることは呼び出し元が確認している
+// `bytes` の最後はチェックサムなので、命令のバイトが N 個なら `addressSize + N + 1` バイトが必要である
+
+static enum dcc_Result parseResetInstruction(dcc_Byte const *const bytes, size_t const bytesSize,
+                                             size_t const addressSize) {
+  if (bytesSize < addressSize + 2) return dcc_Failure;
   if (bytes[addressSize] == 0) return dcc_Success;
   return dcc_Failure;
 }
 
-enum dcc_Result dcc_parseHardResetPacketForMultiFunctionDecoders(
-  dcc_Byte const *const bytes, size_t const bytesSize,
-  struct dcc_HardResetPacketForMultiFunctionDecoders *const packet) {
-  if (bytesSize < 3) return dcc_Failure;
-  size_t addressSize;
-  if (dcc_Failure == parseAddressForExtendedPacket(bytes, bytesSize, &packet->address, &addressSize)) {
-    return dcc_Failure;
-  }
-  if (bytesSize < addressSize + 1) return dcc_Failure;
+static enum dcc_Result parseHardResetInstruction(dcc_Byte const *const bytes, size_t const bytesSize,
+                                                 size_t const addressSize) {
+  if (bytesSize < addressSize + 2) return dcc_Failure;
   if (bytes[addressSize] == 1) return dcc_Success;
   return dcc_Failure;
 }
 
-enum dcc_Result dcc_parseFactoryTestInstructionPacketForMultiFunctionDecoders(
-  dcc_Byte const *const bytes, size_t const bytesSize,
+static enum dcc_Result parseFactoryTestInstruction(
+  dcc_Byte const *const bytes, size_t const bytesSize, size_t const addressSize,
   struct dcc_FactoryTestInstructionPacketForMultiFunctionDecoders *const packet) {
-  if (bytesSize < 3) return dcc_Failure;
-  size_t addressSize;
-  if (dcc_Failure == parseAddressForExtendedPacket(bytes, bytesSize, &packet->address, &addressSize)) {
-    return dcc_Failure;
-  }
+  // 最後のバイトはチェックサムで、データのバイトは省略できる
+  if (bytesSize < addressSize + 2 || addressSize + 3 < bytesSize) return dcc_Failure;
   if ((bytes[addressSize] & 0xFE) != 2) return dcc_Failure;
   packet->set = bytes[addressSize] & 1;
-  if (addressSize + 1 == bytesSize) {
-    packet->dataExists = false;
-    return dcc_Success;
-  }
-  packet->dataExists = true;
-  packet->data = bytes[addressSize + 1];
+  packet->dataExists = addressSize + 3 == bytesSize;
+  if (packet->dataExists) packet->data = bytes[addressSize + 1];
   return dcc_Success;
 }
 
-enum dcc_Result dcc_parseDecoderFlagsSetPacketForMultiFunctionDecoders(
-  dcc_Byte const *const bytes, size_t const bytesSize,
+static enum dcc_Result parseDecoderFlagsSetInstruction(
+  dcc_Byte const *const bytes, size_t const bytesSize, size_t const addressSize,
   struct dcc_SetDecoderFlagsPacketForMultiFunctionDecoders *const packet) {
-  if (bytesSize < 3) return dcc_Failure;
-  size_t addressSize;
-  if (dcc_Failure == parseAddressForExtendedPacket(bytes, bytesSize, &packet->address, &addressSize)) {
-    return dcc_Failure;
-  }
+  if (bytesSize < addressSize + 3) return dcc_Failure;
   if ((bytes[addressSize] & 0xFE) != 6) return dcc_Failure;
   packet->set = bytes[addressSize] & 1;
   packet->subaddress = bytes[addressSize + 1] & 7;
@@ -423,42 +626,28 @@ enum dcc_Result dcc_parseDecoderFlagsSetPacketForMultiFunctionDecoders(
   return dcc_Success;
 }
 
-enum dcc_Result dcc_parseSetAdvancedAddressingPacketForMultiFunctionDecoders(
-  dcc_Byte const *const bytes, size_t const bytesSize,
+static enum dcc_Result parseSetAdvancedAddressingInstruction(
+  dcc_Byte const *const bytes, size_t const bytesSize, size_t const addressSize,
   struct dcc_SetExtendedAddressingPacketForMultiFunctionDecoders *const packet) {
-  if (bytesSize < 2) return dcc_Failure;
-  size_t addressSize;
-  if (dcc_Failure == parseAddressForExtendedPacket(bytes, bytesSize, &packet->address, &addressSize)) {
-    return dcc_Failure;
-  }
-  if (bytesSize < addressSize + 1) return dcc_Failure;
+  if (bytesSize < addressSize + 2) return dcc_Failure;
   if ((bytes[addressSize] & 0xFE) != 0xA) return dcc_Failure;
   packet->set = bytes[addressSize] & 1;
   return dcc_Success;
 }
 
-enum dcc_Result dcc_parseDecoderAcknowledgementRequestPacket(
-  dcc_Byte const *const bytes, size_t const bytesSize,
+static enum dcc_Result parseDecoderAcknowledgementRequestInstruction(
+  dcc_Byte const *const bytes, size_t const bytesSize, size_t const addressSize,
   struct dcc_DecoderAcknowledgementRequestPacketForMultiFunctionDecoders *const packet) {
-  if (bytesSize < 3) return dcc_Failure;
-  size_t addressSize;
-  if (dcc_Failure == parseAddressForExtendedPacket(bytes, bytesSize, &packet->address, &addressSize)) {
-    return dcc_Failure;
-  }
-  if (bytesSize < addressSize + 1) return dcc_Failure;
+  if (bytesSize < addressSize + 2) return dcc_Failure;
   if ((bytes[addressSize] & 0xFE) != 0xE) return dcc_Failure;
   packet->set = bytes[addressSize] & 1;
   return dcc_Success;
 }
 
-enum dcc_Result dcc_parseConsistControlPacket(dcc_Byte const *const bytes, size_t const bytesSize,
-                                              struct dcc_ConsistControlPacketForMultiFunctionDecoders *const packet) {
-  if (bytesSize < 3) return dcc_Failure;
-  size_t addressSize;
-  if (dcc_Failure == parseAddressForExtendedPacket(bytes, bytesSize, &packet->address, &addressSize)) {
-    return dcc_Failure;
-  }
-  if (bytesSize < addressSize + 2) return dcc_Failure;
+static enum dcc_Result parseConsistControlInstruction(
+  dcc_Byte const *const bytes, size_t const bytesSize, size_t const addressSize,
+  struct dcc_ConsistControlPacketForMultiFunctionDecoders *const packet) {
+  if (bytesSize < addressSize + 3) return dcc_Failure;
   if ((bytes[addressSize] & 0xF0) != 0x10) return dcc_Failure;
   switch (bytes[addressSize] & 0x0F) {
     case 2:
@@ -474,15 +663,10 @@ enum dcc_Result dcc_parseConsistControlPacket(dcc_Byte const *const bytes, size_
   return dcc_Success;
 }
 
-enum dcc_Result dcc_parseSpeedStep128ControlPacket(
-  dcc_Byte const *const bytes, size_t const bytesSize,
+static enum dcc_Result parseSpeedStep128ControlInstruction(
+  dcc_Byte const *const bytes, size_t const bytesSize, size_t const addressSize,
   struct dcc_SpeedStep128ControlPacketForMultiFunctionDecoders *const packet) {
-  if (bytesSize < 3) return dcc_Failure;
-  size_t addressSize;
-  if (dcc_Failure == parseAddressForExtendedPacket(bytes, bytesSize, &packet->address, &addressSize)) {
-    return dcc_Failure;
-  }
-  if (bytesSize < addressSize + 2) return dcc_Failure;
+  if (bytesSize < addressSize + 3) return dcc_Failure;
   if ((bytes[addressSize] & 0xFF) != 0x3F) return dcc_Failure;
   if ((bytes[addressSize + 1] & 0x80) == 0) packet->direction = dcc_Backward;
   else packet->direction = dcc_Forward;
@@ -504,74 +688,792 @@ enum dcc_Result dcc_parseSpeedStep128ControlPacket(
   return dcc_Success;
 }
 
-struct dcc_Decoder dcc_initializeDecoder(dcc_TimeMicroSec *signalBufferValues, size_t const signalBufferSize) {
-  return (struct dcc_Decoder){ .signalBuffer = dcc_initializeSignalBuffer(signalBufferValues, signalBufferSize),
-                               .signalStreamParser = dcc_initializeSignalStreamParser(),
-                               .bitStreamParser = dcc_initializeBitStreamParser() };
+// 制限された速度命令 `00111110 E0DCSSSS` の `E` は制限の有効化で、速度は速度方向命令と同じ形式である
+static enum dcc_Result parseRestrictedSpeedStepInstruction(
+  dcc_Byte const *const bytes, size_t const bytesSize, size_t const addressSize, bool const flControl,
+  struct dcc_RestrictedSpeedStepPacketForMultiFunctionDecoders *const packet) {
+  if (bytesSize < addressSize + 3) return dcc_Failure;
+  if (bytes[addressSize] != 0x3E) return dcc_Failure;
+  dcc_Byte const data = bytes[addressSize + 1];
+  packet->enabled = (data & 0x80) != 0;
+  packet->flControl = flControl;
+  packet->directionMayBeIgnored = false;
+  if (flControl) {
+    parseSpeed4Bit(data, &packet->speed4Bit, &packet->emergencyStop);
+  } else {
+    parseSpeed5Bit(data, &packet->speed5Bit, &packet->emergencyStop, &packet->directionMayBeIgnored);
+  }
+  return dcc_Success;
 }
 
-enum dcc_StreamParserResult dcc_decode(struct dcc_Decoder *const decoder, dcc_TimeMicroSec const signal,
-                                       struct dcc_Packet *const packet) {
-  DCC_DEBUG_LOG("dcc_decode(decoder: %p, signal: %lu, packet: %p)", decoder, signal, packet);
-  dcc_Bit bit;
-  {
-    enum dcc_StreamParserResult const result = dcc_feedSignal(&decoder->signalStreamParser, signal, &bit);
-    switch (result) {
-      case dcc_StreamParserResult_Failure:
-        // 直近の3つの信号の組ではビットにならなかった
-        // そのまま次の信号を待つ
-        return dcc_StreamParserResult_Continue;
-      case dcc_StreamParserResult_Continue:
-        return dcc_StreamParserResult_Continue;
-      case dcc_StreamParserResult_Success:
-        break;
-      default:
-        DCC_UNREACHABLE("result: %d", result);
-    }
-  }
-  dcc_Byte bytes[DCC_BIT_STREAM_PARSER_BYTES_CAPACITY];
-  size_t bytesSize;
-  {
-    enum dcc_StreamParserResult const result = dcc_feedBit(&decoder->bitStreamParser, bit, bytes, &bytesSize);
-    switch (result) {
-      case dcc_StreamParserResult_Failure:
-        DCC_DEBUG_LOG("dcc_feedBit failed");
-        return dcc_StreamParserResult_Failure;
-      case dcc_StreamParserResult_Continue:
-        return dcc_StreamParserResult_Continue;
-      case dcc_StreamParserResult_Success:
-        break;
-      default:
-        DCC_UNREACHABLE("result: %d", result);
-    }
-  }
-  if (dcc_Failure == dcc_validatePacket(bytes, bytesSize - 1, bytes[bytesSize - 1])) {
-    DCC_DEBUG_LOG("dcc_validatePacket failed");
-    return dcc_StreamParserResult_Failure;
-  }
-  {
-    enum dcc_Result const result = dcc_parsePacket(bytes, bytesSize, packet);
-    switch (result) {
-      case dcc_Failure:
-        DCC_DEBUG_LOG("dcc_parsePacket failed");
-        return dcc_StreamParserResult_Failure;
-      case dcc_Success:
-        return dcc_StreamParserResult_Success;
-      default:
-        DCC_UNREACHABLE("result: %d", result);
-    }
+// アナログ機能群命令 `00111101 VVVVVVVV DDDDDDDD`
+static enum dcc_Result parseAnalogFunctionInstruction(
+  dcc_Byte const *const bytes, size_t const bytesSize, size_t const addressSize,
+  struct dcc_AnalogFunctionPacketForMultiFunctionDecoders *const packet) {
+  if (bytesSize < addressSize + 4) return dcc_Failure;
+  if (bytes[addressSize] != 0x3D) return dcc_Failure;
+  packet->output = bytes[addressSize + 1];
+  packet->data = bytes[addressSize + 2];
+  return dcc_Success;
+}
+
+// 速度方向命令 `01DCSSSS`
+static enum dcc_Result parseSpeedAndDirectionInstruction(
+  dcc_Byte const *const bytes, size_t const bytesSize, size_t const addressSize, bool const flControl,
+  struct dcc_SpeedAndDirectionPacketForMultiFunctionDecoders *const packet) {
+  if (bytesSize < addressSize + 2) return dcc_Failure;
+  dcc_Byte const instruction = bytes[addressSize];
+  if ((instruction & 0xC0) != 0x40) return dcc_Failure;
+  packet->direction = instruction & 0x20 ? dcc_Forward : dcc_Backward;
+  packet->flControl = flControl;
+  packet->directionMayBeIgnored = false;
+  if (flControl) {
+    parseSpeed4Bit(instruction, &packet->speed4Bit, &packet->emergencyStop);
+    packet->fl = (instruction & 0x10) >> 4;
+  } else {
+    parseSpeed5Bit(instruction, &packet->speed5Bit, &packet->emergencyStop, &packet->directionMayBeIgnored);
   }
+  return dcc_Success;
 }
 
-#define SHOW_BOOL(value) ((value) ? "true" : "false")
+// 第1機能群命令 `100DDDDD`
+// `flControl` はこの命令の `D` の最上位ビットが FL かどうかで、速度方向命令の `flControl` とは逆になる
+static enum dcc_Result parseFunctionGroup1Instruction(
+  dcc_Byte const *const bytes, size_t const bytesSize, size_t const addressSize, bool const flControl,
+  struct dcc_FunctionGroup1PacketForMultiFunctionDecoders *const packet) {
+  if (bytesSize < addressSize + 2) return dcc_Failure;
+  dcc_Byte const instruction = bytes[addressSize];
+  if ((instruction & 0xE0) != 0x80) return dcc_Failure;
+  packet->flControl = flControl;
+  packet->fl = flControl && (instruction & 0x10);
+  packet->f1 = instruction & 0x01;
+  packet->f2 = (instruction & 0x02) >> 1;
+  packet->f3 = (instruction & 0x04) >> 2;
+  packet->f4 = (instruction & 0x08) >> 3;
+  return dcc_Success;
+}
 
-int dcc_showSignalBuffer(char *buffer, size_t const bufferSize, struct dcc_SignalBuffer const signalBuffer) {
-  return snprintf(buffer,
-                  bufferSize,
-                  "{\"buffer\":%p,\"size\":%zu,\"written\":%zu,\"writeIndex\":%zu,\"readIndex\":%zu}",
+// 第2機能群命令 `101SDDDD`
+static enum dcc_Result parseFunctionGroup2Instruction(
+  dcc_Byte const *const bytes, size_t const bytesSize, size_t const addressSize,
+  struct dcc_FunctionGroup2PacketForMultiFunctionDecoders *const packet) {
+  if (bytesSize < addressSize + 2) return dcc_Failure;
+  dcc_Byte const instruction = bytes[addressSize];
+  if ((instruction & 0xE0) != 0xA0) return dcc_Failure;
+  packet->group = (enum dcc_FunctionGroup2Group) ((instruction & 0x10) >> 4);
+  // F5～F8 と F9～F12 は同じ位置にある
+  packet->functions.f5 = instruction & 0x01;
+  packet->functions.f6 = (instruction & 0x02) >> 1;
+  packet->functions.f7 = (instruction & 0x04) >> 2;
+  packet->functions.f8 = (instruction & 0x08) >> 3;
+  return dcc_Success;
+}
+
+// 2値状態制御命令（長形式） `11000000 DLLLLLLL HHHHHHHH`
+static enum dcc_Result parseBinaryStateControlLongFormInstruction(
+  dcc_Byte const *const bytes, size_t const bytesSize, size_t const addressSize,
+  struct dcc_BinaryStateControlLongFormPacket *const packet) {
+  if (bytesSize < addressSize + 4) return dcc_Failure;
+  if (bytes[addressSize] != 0xC0) return dcc_Failure;
+  packet->state = (bytes[addressSize + 1] & 0x80) != 0;
+  packet->stateAddress =
+    (dcc_BinaryStateAddressLongForm) (bytes[addressSize + 2] << 7 | (bytes[addressSize + 1] & 0x7F));
+  return dcc_Success;
+}
+
+// 2値状態制御命令（短形式） `11011101 DLLLLLLL`
+static enum dcc_Result parseBinaryStateControlShortFormInstruction(
+  dcc_Byte const *const bytes, size_t const bytesSize, size_t const addressSize,
+  struct dcc_BinaryStateControlShortFormPacket *const packet) {
+  if (bytesSize < addressSize + 3) return dcc_Failure;
+  if (bytes[addressSize] != 0xDD) return dcc_Failure;
+  packet->state = (bytes[addressSize + 1] & 0x80) != 0;
+  packet->stateAddress = (dcc_BinaryStateAddressShortForm) (bytes[addressSize + 1] & 0x7F);
+  return dcc_Success;
+}
+
+// F13～F20 機能制御 `11011110 DDDDDDDD`
+static enum dcc_Result parseFunctionControlF13F20Instruction(dcc_Byte const *const bytes, size_t const bytesSize,
+                                                             size_t const addressSize,
+                                                             struct dcc_FunctionControlF13F20Packet *const packet) {
+  if (bytesSize < addressSize + 3) return dcc_Failure;
+  if (bytes[addressSize] != 0xDE) return dcc_Failure;
+  dcc_Byte const data = bytes[addressSize + 1];
+  packet->f13 = data & 0x01;
+  packet->f14 = (data & 0x02) >> 1;
+  packet->f15 = (data & 0x04) >> 2;
+  packet->f16 = (data & 0x08) >> 3;
+  packet->f17 = (data & 0x10) >> 4;
+  packet->f18 = (data & 0x20) >> 5;
+  packet->f19 = (data & 0x40) >> 6;
+  packet->f20 = (data & 0x80) >> 7;
+  return dcc_Success;
+}
+
+// F21～F28 機能制御 `11011111 DDDDDDDD`
+static enum dcc_Result parseFunctionControlF21F28Instruction(dcc_Byte const *const bytes, size_t const bytesSize,
+                                                             size_t const addressSize,
+                                                             struct dcc_FunctionControlF21F28Packet *const packet) {
+  if (bytesSize < addressSize + 3) return dcc_Failure;
+  if (bytes[addressSize] != 0xDF) return dcc_Failure;
+  dcc_Byte const data = bytes[addressSize + 1];
+  packet->f21 = data & 0x01;
+  packet->f22 = (data & 0x02) >> 1;
+  packet->f23 = (data & 0x04) >> 2;
+  packet->f24 = (data & 0x08) >> 3;
+  packet->f25 = (data & 0x10) >> 4;
+  packet->f26 = (data & 0x20) >> 5;
+  packet->f27 = (data & 0x40) >> 6;
+  packet->f28 = (data & 0x80) >> 7;
+  return dcc_Success;
+}
+
+enum dcc_Result dcc_parseResetPacketForMultiFunctionDecoders(
+  dcc_Byte const *const bytes, size_t const bytesSize, struct dcc_ResetPacketForMultiFunctionDecoders *const packet) {
+  if (bytesSize < 3) return dcc_Failure;
+  size_t addressSize;
+  if (dcc_Failure == parseAddressForExtendedPacket(bytes, bytesSize, &packet->address, &addressSize)) {
+    return dcc_Failure;
+  }
+  return parseResetInstruction(bytes, bytesSize, addressSize);
+}
+
+enum dcc_Result dcc_parseHardResetPacketForMultiFunctionDecoders(
+  dcc_Byte const *const bytes, size_t const bytesSize,
+  struct dcc_HardResetPacketForMultiFunctionDecoders *const packet) {
+  if (bytesSize < 3) return dcc_Failure;
+  size_t addressSize;
+  if (dcc_Failure == parseAddressForExtendedPacket(bytes, bytesSize, &packet->address, &addressSize)) {
+    return dcc_Failure;
+  }
+  return parseHardResetInstruction(bytes, bytesSize, addressSize);
+}
+
+enum dcc_Result dcc_parseFactoryTestInstructionPacketForMultiFunctionDecoders(
+  dcc_Byte const *const bytes, size_t const bytesSize,
+  struct dcc_FactoryTestInstructionPacketForMultiFunctionDecoders *const packet) {
+  if (bytesSize < 3) return dcc_Failure;
+  size_t addressSize;
+  if (dcc_Failure == parseAddressForExtendedPacket(bytes, bytesSize, &packet->address, &addressSize)) {
+    return dcc_Failure;
+  }
+  return parseFactoryTestInstruction(bytes, bytesSize, addressSize, packet);
+}
+
+enum dcc_Result dcc_parseDecoderFlagsSetPacketForMultiFunctionDecoders(
+  dcc_Byte const *const bytes, size_t const bytesSize,
+  struct dcc_SetDecoderFlagsPacketForMultiFunctionDecoders *const packet) {
+  if (bytesSize < 3) return dcc_Failure;
+  size_t addressSize;
+  if (dcc_Failure == parseAddressForExtendedPacket(bytes, bytesSize, &packet->address, &addressSize)) {
+    return dcc_Failure;
+  }
+  return parseDecoderFlagsSetInstruction(bytes, bytesSize, addressSize, packet);
+}
+
+enum dcc_Result dcc_parseSetAdvancedAddressingPacketForMultiFunctionDecoders(
+  dcc_Byte const *const bytes, size_t const bytesSize,
+  struct dcc_SetExtendedAddressingPacketForMultiFunctionDecoders *const packet) {
+  if (bytesSize < 2) return dcc_Failure;
+  size_t addressSize;
+  if (dcc_Failure == parseAddressForExtendedPacket(bytes, bytesSize, &packet->address, &addressSize)) {
+    return dcc_Failure;
+  }
+  return parseSetAdvancedAddressingInstruction(bytes, bytesSize, addressSize, packet);
+}
+
+enum dcc_Result dcc_parseDecoderAcknowledgementRequestPacket(
+  dcc_Byte const *const bytes, size_t const bytesSize,
+  struct dcc_DecoderAcknowledgementRequestPacketForMultiFunctionDecoders *const packet) {
+  if (bytesSize < 3) return dcc_Failure;
+  size_t addressSize;
+  if (dcc_Failure == parseAddressForExtendedPacket(bytes, bytesSize, &packet->address, &addressSize)) {
+    return dcc_Failure;
+  }
+  return parseDecoderAcknowledgementRequestInstruction(bytes, bytesSize, addressSize, packet);
+}
+
+enum dcc_Result dcc_parseConsistControlPacket(dcc_Byte const *const bytes, size_t const bytesSize,
+                                              struct dcc_ConsistControlPacketForMultiFunctionDecoders *const packet) {
+  if (bytesSize < 3) return dcc_Failure;
+  size_t addressSize;
+  if (dcc_Failure == parseAddressForExtendedPacket(bytes, bytesSize, &packet->address, &addressSize)) {
+    return dcc_Failure;
+  }
+  return parseConsistControlInstruction(bytes, bytesSize, addressSize, packet);
+}
+
+enum dcc_Result dcc_parseSpeedStep128ControlPacket(
+  dcc_Byte const *const bytes, size_t const bytesSize,
+  struct dcc_SpeedStep128ControlPacketForMultiFunctionDecoders *const packet) {
+  if (bytesSize < 3) return dcc_Failure;
+  size_t addressSize;
+  if (dcc_Failure == parseAddressForExtendedPacket(bytes, bytesSize, &packet->address, &addressSize)) {
+    return dcc_Failure;
+  }
+  return parseSpeedStep128ControlInstruction(bytes, bytesSize, addressSize, packet);
+}
+
+enum dcc_Result dcc_parseRestrictedSpeedStepPacketForMultiFunctionDecoders(
+  dcc_Byte const *const bytes, size_t const bytesSize, bool flControl,
+  struct dcc_RestrictedSpeedStepPacketForMultiFunctionDecoders *const packet) {
+  if (bytesSize < 3) return dcc_Failure;
+  size_t addressSize;
+  if (dcc_Failure == parseAddressForExtendedPacket(bytes, bytesSize, &packet->address, &addressSize)) {
+    return dcc_Failure;
+  }
+  return parseRestrictedSpeedStepInstruction(bytes, bytesSize, addressSize, flControl, packet);
+}
+
+enum dcc_Result dcc_parseAnalogFunctionPacketForMultiFunctionDecoders(
+  dcc_Byte const *const bytes, size_t const bytesSize,
+  struct dcc_AnalogFunctionPacketForMultiFunctionDecoders *const packet) {
+  if (bytesSize < 3) return dcc_Failure;
+  size_t addressSize;
+  if (dcc_Failure == parseAddressForExtendedPacket(bytes, bytesSize, &packet->address, &addressSize)) {
+    return dcc_Failure;
+  }
+  return parseAnalogFunctionInstruction(bytes, bytesSize, addressSize, packet);
+}
+
+enum dcc_Result dcc_parseSpeedAndDirectionPacketForMultiFunctionDecoders(
+  dcc_Byte const *const bytes, size_t const bytesSize, bool flControl,
+  struct dcc_SpeedAndDirectionPacketForMultiFunctionDecoders *const packet) {
+  if (bytesSize < 3) return dcc_Failure;
+  size_t addressSize;
+  if (dcc_Failure == parseAddressForExtendedPacket(bytes, bytesSize, &packet->address, &addressSize)) {
+    return dcc_Failure;
+  }
+  return parseSpeedAndDirectionInstruction(bytes, bytesSize, addressSize, flControl, packet);
+}
+
+enum dcc_Result dcc_parseFunctionGroup1PacketForMultiFunctionDecoders(
+  dcc_Byte const *const bytes, size_t const bytesSize, bool flControl,
+  struct dcc_FunctionGroup1PacketForMultiFunctionDecoders *const packet) {
+  if (bytesSize < 3) return dcc_Failure;
+  size_t addressSize;
+  if (dcc_Failure == parseAddressForExtendedPacket(bytes, bytesSize, &packet->address, &addressSize)) {
+    return dcc_Failure;
+  }
+  return parseFunctionGroup1Instruction(bytes, bytesSize, addressSize, flControl, packet);
+}
+
+enum dcc_Result dcc_parseFunctionGroup2PacketForMultiFunctionDecoders(
+  dcc_Byte const *const bytes, size_t const bytesSize,
+  struct dcc_FunctionGroup2PacketForMultiFunctionDecoders *const packet) {
+  if (bytesSize < 3) return dcc_Failure;
+  size_t addressSize;
+  if (dcc_Failure == parseAddressForExtendedPacket(bytes, bytesSize, &packet->address, &addressSize)) {
+    return dcc_Failure;
+  }
+  return parseFunctionGroup2Instruction(bytes, bytesSize, addressSize, packet);
+}
+
+enum dcc_Result dcc_parseBinaryStateControlLongFormPacket(
+  dcc_Byte const *const bytes, size_t const bytesSize,
+  struct dcc_BinaryStateControlLongFormPacket *const packet) {
+  if (bytesSize < 3) return dcc_Failure;
+  size_t addressSize;
+  if (dcc_Failure == parseAddressForExtendedPacket(bytes, bytesSize, &packet->address, &addressSize)) {
+    return dcc_Failure;
+  }
+  return parseBinaryStateControlLongFormInstruction(bytes, bytesSize, addressSize, packet);
+}
+
+enum dcc_Result dcc_parseBinaryStateControlShortFormPacket(
+  dcc_Byte const *const bytes, size_t const bytesSize,
+  struct dcc_BinaryStateControlShortFormPacket *const packet) {
+  if (bytesSize < 3) return dcc_Failure;
+  size_t addressSize;
+  if (dcc_Failure == parseAddressForExtendedPacket(bytes, bytesSize, &packet->address, &addressSize)) {
+    return dcc_Failure;
+  }
+  return parseBinaryStateControlShortFormInstruction(bytes, bytesSize, addressSize, packet);
+}
+
+enum dcc_Result dcc_parseFunctionControlF13F20Packet(
+  dcc_Byte const *const bytes, size_t const bytesSize,
+  struct dcc_FunctionControlF13F20Packet *const packet) {
+  if (bytesSize < 3) return dcc_Failure;
+  size_t addressSize;
+  if (dcc_Failure == parseAddressForExtendedPacket(bytes, bytesSize, &packet->address, &addressSize)) {
+    return dcc_Failure;
+  }
+  return parseFunctionControlF13F20Instruction(bytes, bytesSize, addressSize, packet);
+}
+
+enum dcc_Result dcc_parseFunctionControlF21F28Packet(
+  dcc_Byte const *const bytes, size_t const bytesSize,
+  struct dcc_FunctionControlF21F28Packet *const packet) {
+  if (bytesSize < 3) return dcc_Failure;
+  size_t addressSize;
+  if (dcc_Failure == parseAddressForExtendedPacket(bytes, bytesSize, &packet->address, &addressSize)) {
+    return dcc_Failure;
+  }
+  return parseFunctionControlF21F28Instruction(bytes, bytesSize, addressSize, packet);
+}
+
+// 命令部分のパーサー `parse` を呼び、成功したら `packet->member` のアドレスとタグを設定して返す
+#define PARSE_INSTRUCTION(member, packetTag, parse) \
+  do {                                              \
+    if (dcc_Failure == (parse)) return dcc_Failure; \
+    packet->member.address = address;               \
+    packet->tag = (packetTag);                      \
+    return dcc_Success;                             \
+  } while (0)
+
+// 多機能デコーダー用パケットの命令部分を分類してパースする
+// 命令の種類は命令バイトの上位3ビットで決まるため、それで分岐してから個々の命令を見る
+// `flControl` は速度方向命令の `flControl` で、第1機能群命令にはその逆を渡す
+static enum dcc_Result parseMultiFunctionInstruction(dcc_Byte const *const bytes, size_t const bytesSize,
+                                                     dcc_AddressForExtendedPacket const address,
+                                                     size_t const addressSize, bool const flControl,
+                                                     struct dcc_Packet *const packet) {
+  dcc_Byte const instruction = bytes[addressSize];
+  switch (instruction >> 5) {
+    case 0:  // 000: デコーダー・コンシスト制御命令
+      switch (instruction) {
+        case 0x00:
+          PARSE_INSTRUCTION(resetPacketForMultiFunctionDecoders,
+                            dcc_ResetPacketForMultiFunctionDecodersTag,
+                            parseResetInstruction(bytes, bytesSize, addressSize));
+        case 0x01:
+          PARSE_INSTRUCTION(hardResetPacketForMultiFunctionDecoders,
+                            dcc_HardResetPacketForMultiFunctionDecodersTag,
+                            parseHardResetInstruction(bytes, bytesSize, addressSize));
+        case 0x02:
+        case 0x03:
+          PARSE_INSTRUCTION(
+            factoryTestInstructionPacketForMultiFunctionDecoders,
+            dcc_FactoryTestInstructionPacketForMultiFunctionDecodersTag,
+            parseFactoryTestInstruction(bytes,
+                                        bytesSize,
+                                        addressSize,
+                                        &packet->factoryTestInstructionPacketForMultiFunctionDecoders));
+        case 0x06:
+        case 0x07:
+          PARSE_INSTRUCTION(setDecoderFlagsPacketForMultiFunctionDecoders,
+                            dcc_SetDecoderFlagsPacketForMultiFunctionDecodersTag,
+                            parseDecoderFlagsSetInstruction(bytes,
+                                                            bytesSize,
+                                                            addressSize,
+                                                            &packet->setDecoderFlagsPacketForMultiFunctionDecoders));
+        case 0x0A:
+        case 0x0B:
+          PARSE_INSTRUCTION(
+            setExtendedAddressingPacketForMultiFunctionDecoders,
+            dcc_SetExtendedAddressingPacketForMultiFunctionDecodersTag,
+            parseSetAdvancedAddressingInstruction(bytes,
+                                                  bytesSize,
+                                                  addressSize,
+                                                  &packet->setExtendedAddressingPacketForMultiFunctionDecoders));
+        case 0x0E:
+        case 0x0F:
+          PARSE_INSTRUCTION(decoderAcknowledgementRequestPacketForMultiFunctionDecoders,
+                            dcc_DecoderAcknowledgementRequestPacketForMultiFunctionDecodersTag,
+                            parseDecoderAcknowledgementRequestInstruction(
+                              bytes,
+                              bytesSize,
+                              addressSize,
+                              &packet->decoderAcknowledgementRequestPacketForMultiFunctionDecoders));
+        case 0x12:
+        case 0x13:
+          PARSE_INSTRUCTION(consistControlPacketForMultiFunctionDecoders,
+                            dcc_ConsistControlPacketForMultiFunctionDecodersTag,
+                            parseConsistControlInstruction(bytes,
+                                                           bytesSize,
+                                                           addressSize,
+                                                           &packet->consistControlPacketForMultiFunctionDecoders));
+        default:
+          return dcc_Failure;
+      }
+    case 1:  // 001: 拡張操作命令
+      switch (instruction) {
+        case 0x3D:
+          PARSE_INSTRUCTION(analogFunctionPacketForMultiFunctionDecoders,
+                            dcc_AnalogFunctionPacketForMultiFunctionDecodersTag,
+                            parseAnalogFunctionInstruction(bytes,
+                                                           bytesSize,
+                                                           addressSize,
+                                                           &packet->analogFunctionPacketForMultiFunctionDecoders));
+        case 0x3E:
+          PARSE_INSTRUCTION(
+            restrictedSpeedStepPacketForMultiFunctionDecoders,
+            dcc_RestrictedSpeedStepPacketForMultiFunctionDecodersTag,
+            parseRestrictedSpeedStepInstruction(bytes,
+                                                bytesSize,
+                                                addressSize,
+                                                flControl,
+                                                &packet->restrictedSpeedStepPacketForMultiFunctionDecoders));
+        case 0x3F:
+          PARSE_INSTRUCTION(
+            speedStep128ControlPacket,
+            dcc_SpeedStep128ControlPacketForMultiFunctionDecodersTag,
+            parseSpeedStep128ControlInstruction(bytes, bytesSize, addressSize, &packet->speedStep128ControlPacket));
+        default:
+          return dcc_Failure;
+      }
+    case 2:  // 010: 逆方向の速度方向命令
+    case 3:  // 011: 正方向の速度方向命令
+      PARSE_INSTRUCTION(speedAndDirectionPacketForMultiFunctionDecoders,
+                        dcc_SpeedAndDirectionPacketForMultiFunctionDecodersTag,
+                        parseSpeedAndDirectionInstruction(bytes,
+                                                          bytesSize,
+                                                          addressSize,
+                                                          flControl,
+                                                          &packet->speedAndDirectionPacketForMultiFunctionDecoders));
+    case 4:  // 100: 第1機能群命令
+      PARSE_INSTRUCTION(functionGroup1PacketForMultiFunctionDecoders,
+                        dcc_FunctionGroup1PacketForMultiFunctionDecodersTag,
+                        parseFunctionGroup1Instruction(bytes,
+                                                       bytesSize,
+                                                       addressSize,
+                                                       !flControl,
+                                                       &packet->functionGroup1PacketForMultiFunctionDecoders));
+    case 5:  // 101: 第2機能群命令
+      PARSE_INSTRUCTION(functionGroup2PacketForMultiFunctionDecoders,
+                        dcc_FunctionGroup2PacketForMultiFunctionDecodersTag,
+                        parseFunctionGroup2Instruction(bytes,
+                                                       bytesSize,
+                                                       addressSize,
+                                                       &packet->functionGroup2PacketForMultiFunctionDecoders));
+    case 6:  // 110: 将来の拡張
+      switch (instruction) {
+        case 0xC0:
+          PARSE_INSTRUCTION(binaryStateControlLongFormPacket,
+                            dcc_BinaryStateControlLongFormPacketTag,
+                            parseBinaryStateControlLongFormInstruction(bytes,
+                                                                       bytesSize,
+                                                                       addressSize,
+                                                                       &packet->binaryStateControlLongFormPacket));
+        case 0xDD:
+          PARSE_INSTRUCTION(binaryStateControlShortFormPacket,
+                            dcc_BinaryStateControlShortFormPacketTag,
+                            parseBinaryStateControlShortFormInstruction(bytes,
+                                                                        bytesSize,
+                                                                        addressSize,
+                                                                        &packet->binaryStateControlShortFormPacket));
+        case 0xDE:
+          PARSE_INSTRUCTION(
+            functionControlF13F20Packet,
+            dcc_FunctionControlF13F20PacketTag,
+            parseFunctionControlF13F20Instruction(bytes, bytesSize, addressSize, &packet->functionControlF13F20Packet));
+        case 0xDF:
+          PARSE_INSTRUCTION(
+            functionControlF21F28Packet,
+            dcc_FunctionControlF21F28PacketTag,
+            parseFunctionControlF21F28Instruction(bytes, bytesSize, addressSize, &packet->functionControlF21F28Packet));
+        default:
+          return dcc_Failure;
+      }
+    default:  // 111: CV アクセス命令には対応する種類がない
+      return dcc_Failure;
+  }
+}
+
+#undef PARSE_INSTRUCTION
+
+enum dcc_Result dcc_parsePacket(dcc_Byte const *const bytes, size_t const bytesSize, struct dcc_Packet *const packet) {
+  // 個々のパーサーを順に試すのではなく、先頭バイトでアドレスの区分を一度だけ判定し、
+  // 続く命令バイトで該当するパーサーに直接分岐する
+  // どのパケットも 3 バイト以上（チェックサムを含む）
+  if (bytesSize < 3) return dcc_Failure;
+  bool const flControl = false;  // TODO CV の実装ができたら書き換える
+  dcc_Byte const first = bytes[0];
+  // 0x00：ブロードキャスト
+  if (first == 0) {
+    if (dcc_Success ==
+        dcc_parseBroadcastStopPacketForAllDecoders(bytes, bytesSize, &packet->broadcastStopPacketForAllDecoders)) {
+      packet->tag = dcc_BroadcastStopPacketForAllDecodersTag;
+      return dcc_Success;
+    }
+    if (dcc_Success == dcc_parseResetPacketForAllDecoders(bytes, bytesSize)) {
+      packet->tag = dcc_ResetPacketForAllDecodersTag;
+      return dcc_Success;
+    }
+  }
+  // 0x00–0x7F：ブロードキャストまたは短いアドレス
+  // `01DCSSSS` の命令は基本パケットの速度・方向パケットとして扱う
+  if (first < 0x80 && (bytes[1] & 0xC0) == 0x40) {
+    dcc_parseSpeedAndDirectionPacketForLocomotiveDecoders(bytes,
+                                                          bytesSize,
+                                                          flControl,
+                                                          &packet->speedAndDirectionPacketForLocomotiveDecoders);
+    packet->tag = dcc_SpeedAndDirectionPacketForLocomotiveDecodersTag;
+    return dcc_Success;
+  }
+  // 0x80–0xBF：アクセサリーデコーダー用で、対応する種類がない
+  if ((first & 0xC0) == 0x80) return dcc_Failure;
+  // 0xFF：アイドル
+  if (first == 0xFF) {
+    if (dcc_Success == dcc_parseIdlePacketForAllDecoders(bytes, bytesSize)) {
+      packet->tag = dcc_IdlePacketForAllDecodersTag;
+      return dcc_Success;
+    }
+    return dcc_Failure;
+  }
+  // 0xC0–0xFE：長いアドレス
+  // それ以外は 1 バイトのアドレスとして命令を見る
+  dcc_AddressForExtendedPacket address;
+  size_t addressSize;
+  if (dcc_Failure == parseAddressForExtendedPacket(bytes, bytesSize, &address, &addressSize)) return dcc_Failure;
+  return parseMultiFunctionInstruction(bytes, bytesSize, address, addressSize, flControl, packet);
+}
+
+struct dcc_Decoder dcc_initializeDecoder(dcc_TimeMicroSec *signalBufferValues, size_t const signalBufferSize) {
+  return (struct dcc_Decoder){ .signalBuffer = dcc_initializeSignalBuffer(signalBufferValues, signalBufferSize),
+                               .signalStreamParser = dcc_initializeSignalStreamParser(),
+                               .bitStreamParser = dcc_initializeBitStreamParser(),
+                               .stats = { 0 } };
+}
+
+enum dcc_AddressClass dcc_classifyAddress(dcc_Byte const first) {
+  if (first == 0) return dcc_AddressClass_Broadcast;
+  if (first < 0x80) return dcc_AddressClass_ShortAddress;
+  if (first < 0xC0) return dcc_AddressClass_Accessory;
+  if (first < 0xE8) return dcc_AddressClass_LongAddress;
+  if (first < 0xFF) return dcc_AddressClass_Reserved;
+  return dcc_AddressClass_Idle;
+}
+
+struct dcc_DecoderStats dcc_getDecoderStats(struct dcc_Decoder const *const decoder) {
+  DCC_DEBUG_LOG("dcc_getDecoderStats(decoder: %p)", decoder);
+  struct dcc_DecoderStats const *const stats = &decoder->stats;
+  struct dcc_DecoderStats snapshot = {
+    .edgesCount = DCC_LOAD_RELAXED(&stats->edgesCount),
+    .bitsCount = DCC_LOAD_RELAXED(&stats->bitsCount),
+    .timingRejectsCount = DCC_LOAD_RELAXED(&stats->timingRejectsCount),
+    .preambleResyncsCount = DCC_LOAD_RELAXED(&stats->preambleResyncsCount),
+    .timingResyncsCount = DCC_LOAD_RELAXED(&stats->timingResyncsCount),
+    .framingErrorsCount = DCC_LOAD_RELAXED(&stats->framingErrorsCount),
+    .checksumFailuresCount = DCC_LOAD_RELAXED(&stats->checksumFailuresCount),
+  };
+  for (size_t i = 0; i < DCC_ADDRESS_CLASSES_COUNT; i++) {
+    snapshot.unparsedPacketsCounts[i] = DCC_LOAD_RELAXED(&stats->unparsedPacketsCounts[i]);
+  }
+  for (size_t i = 0; i < DCC_PACKET_TAGS_COUNT; i++) {
+    snapshot.packetsCounts[i] = DCC_LOAD_RELAXED(&stats->packetsCounts[i]);
+  }
+  return snapshot;
+}
+
+void dcc_resetDecoderStats(struct dcc_Decoder *const decoder) {
+  DCC_DEBUG_LOG("dcc_resetDecoderStats(decoder: %p)", decoder);
+  decoder->stats = (struct dcc_DecoderStats){ 0 };
+}
+
+struct dcc_DecoderStats dcc_subtractDecoderStats(struct dcc_DecoderStats const *const until,
+                                                 struct dcc_DecoderStats const *const since) {
+  DCC_DEBUG_LOG("dcc_subtractDecoderStats(until: %p, since: %p)", until, since);
+  struct dcc_DecoderStats difference = {
+    .edgesCount = until->edgesCount - since->edgesCount,
+    .bitsCount = until->bitsCount - since->bitsCount,
+    .timingRejectsCount = until->timingRejectsCount - since->timingRejectsCount,
+    .preambleResyncsCount = until->preambleResyncsCount - since->preambleResyncsCount,
+    .timingResyncsCount = until->timingResyncsCount - since->timingResyncsCount,
+    .framingErrorsCount = until->framingErrorsCount - since->framingErrorsCount,
+    .checksumFailuresCount = until->checksumFailuresCount - since->checksumFailuresCount,
+  };
+  for (size_t i = 0; i < DCC_ADDRESS_CLASSES_COUNT; i++) {
+    difference.unparsedPacketsCounts[i] = until->unparsedPacketsCounts[i] - since->unparsedPacketsCounts[i];
+  }
+  for (size_t i = 0; i < DCC_PACKET_TAGS_COUNT; i++) {
+    difference.packetsCounts[i] = until->packetsCounts[i] - since->packetsCounts[i];
+  }
+  return difference;
+}
+
+// dcc_decode と dcc_decodePeriod のビット以降の処理
+// signalResult と bit は信号のパースの結果
+// パケットのバイト列はコピーせずにパーサー内の参照のまま検証、パースし、その参照を `*bytes` に設定する
+static enum dcc_StreamParserResult decodeBit(struct dcc_Decoder *const decoder,
+                                             enum dcc_StreamParserResult const signalResult, dcc_Bit const bit,
+                                             struct dcc_Packet *const packet, struct dcc_BytesView *const bytes) {
+  struct dcc_DecoderStats *const stats = &decoder->stats;
+  DCC_COUNT_UP(&stats->edgesCount);
+  switch (signalResult) {
+    case dcc_StreamParserResult_Failure:
+      // 直近の3つの信号の組ではビットにならなかった
+      DCC_COUNT_UP(&stats->timingRejectsCount);
+      // プリアンブルの `1` は位相がずれてもビットになり、パケット開始ビットで位相が合うので、そのまま次の信号を待つ
+      if (dcc_BitStreamParserState_InPreamble == decoder->bitStreamParser.state) return dcc_StreamParserResult_Continue;
+      // パケットの途中ならビットが欠けているので、ずれたビットを読み続けずに次のプリアンブルから同期し直す
+      // 読み続けると次のプリアンブルの `1` まで読み込んで、次のパケットも失う
+      DCC_DEBUG_LOG("timing failure in packet");
+      dcc_resetBitStreamParser(&decoder->bitStreamParser);
+      DCC_COUNT_UP(&stats->timingResyncsCount);
+      return dcc_StreamParserResult_Failure;
+    case dcc_StreamParserResult_Continue:
+      return dcc_StreamParserResult_Continue;
+    case dcc_StreamParserResult_Success:
+      break;
+    default:
+      DCC_UNREACHABLE("signalResult: %d", signalResult);
+      return dcc_StreamParserResult_Failure;
+  }
+  DCC_COUNT_UP(&stats->bitsCount);
+  {
+    // 失敗したときにどの段階だったかを数えるために、送る前の状態を覚えておく
+    enum dcc_BitStreamParserState const state = decoder->bitStreamParser.state;
+    enum dcc_StreamParserResult const result = feedBitView(&decoder->bitStreamParser, bit, bytes);
+    switch (result) {
+      case dcc_StreamParserResult_Failure:
+        DCC_DEBUG_LOG("dcc_feedBit failed");
+        if (dcc_BitStreamParserState_InPreamble == state) {
+          DCC_COUNT_UP(&stats->preambleResyncsCount);
+        } else {
+          DCC_COUNT_UP(&stats->framingErrorsCount);
+        }
+        return dcc_StreamParserResult_Failure;
+      case dcc_StreamParserResult_Continue:
+        // パケット開始ビットの組で位相が合っているので、次の半ビットがビットの始まりである
+        if (dcc_BitStreamParserState_InPreamble == state &&
+            dcc_BitStreamParserState_InByte == decoder->bitStreamParser.state) {
+          struct dcc_SignalStreamParser *const parser = &decoder->signalStreamParser;
+          parser->polarity =
+            parser->oddPeriod ? dcc_SignalPolarity_EvenPeriodFirst : dcc_SignalPolarity_OddPeriodFirst;
+        }
+        return dcc_StreamParserResult_Continue;
+      case dcc_StreamParserResult_Success:
+        break;
+      default:
+        DCC_UNREACHABLE("result: %d", result);
+        return dcc_StreamParserResult_Failure;
+    }
+  }
+  if (dcc_Failure == dcc_validatePacket(bytes->bytes, bytes->size - 1, bytes->bytes[bytes->size - 1])) {
+    DCC_DEBUG_LOG("dcc_validatePacket failed");
+    DCC_COUNT_UP(&stats->checksumFailuresCount);
+    return dcc_StreamParserResult_Failure;
+  }
+  {
+    enum dcc_Result const result = dcc_parsePacket(bytes->bytes, bytes->size, packet);
+    switch (result) {
+      case dcc_Failure:
+        DCC_DEBUG_LOG("dcc_parsePacket failed");
+        DCC_COUNT_UP(&stats->unparsedPacketsCounts[dcc_classifyAddress(bytes->bytes[0])]);
+        return dcc_StreamParserResult_Failure;
+      case dcc_Success:
+        DCC_COUNT_UP(&stats->packetsCounts[packet->tag]);
+        return dcc_StreamParserResult_Success;
+      default:
+        DCC_UNREACHABLE("result: %d", result);
+        return dcc_StreamParserResult_Failure;
+    }
+  }
+}
+
+// dcc_decode の本体
+// dcc_decodeBatch からも呼ばれるのでここではデバッグログを出力しない
+static enum dcc_StreamParserResult decode(struct dcc_Decoder *const decoder, dcc_TimeMicroSec const signal,
+                                          struct dcc_Packet *const packet, struct dcc_BytesView *const bytes) {
+  dcc_Bit bit = 0;
+  enum dcc_StreamParserResult const result = feedSignal(&decoder->signalStreamParser, signal, &bit);
+  return decodeBit(decoder, result, bit, packet, bytes);
+}
+
+// dcc_decodePeriod の本体
+// dcc_decodePeriodBatch からも呼ばれるのでここではデバッグログを出力しない
+static enum dcc_StreamParserResult decodePeriod(struct dcc_Decoder *const decoder, dcc_TimeMicroSec const period,
+                                                struct dcc_Packet *const packet, struct dcc_BytesView *const bytes) {
+  dcc_Bit bit = 0;
+  enum dcc_StreamParserResult const result = feedPeriod(&decoder->signalStreamParser, period, &bit);
+  return decodeBit(decoder, result, bit, packet, bytes);
+}
+
+enum dcc_StreamParserResult dcc_decode(struct dcc_Decoder *const decoder, dcc_TimeMicroSec const signal,
+                                       struct dcc_Packet *const packet) {
+  DCC_DEBUG_LOG("dcc_decode(decoder: %p, signal: %lu, packet: %p)", decoder, signal, packet);
+  struct dcc_BytesView bytes;
+  return decode(decoder, signal, packet, &bytes);
+}
+
+enum dcc_StreamParserResult dcc_decodeView(struct dcc_Decoder *const decoder, dcc_TimeMicroSec const signal,
+                                           struct dcc_Packet *const packet, struct dcc_BytesView *const bytes) {
+  DCC_DEBUG_LOG("dcc_decodeView(decoder: %p, signal: %lu, packet: %p, bytes: %p)", decoder, signal, packet, bytes);
+  return decode(decoder, signal, packet, bytes);
+}
+
+size_t dcc_decodeBatch(struct dcc_Decoder *const decoder, dcc_TimeMicroSec const *const signals,
+                       size_t const signalsSize, struct dcc_Packet *const packets, size_t const packetsSize,
+                       size_t *const packetsCount) {
+  DCC_DEBUG_LOG("dcc_decodeBatch(decoder: %p, signals: %p, signalsSize: %zu, packets: %p, packetsSize: %zu, "
+                "packetsCount: %p)",
+                decoder,
+                signals,
+                signalsSize,
+                packets,
+                packetsSize,
+                packetsCount);
+  // `packets` が空でも入力を消費してパケットを捨て、0 を返し続けて呼び出し側の繰り返しが終わらなくなるのを防ぐ
+  if (packetsSize == 0) {
+    struct dcc_Packet packet;
+    struct dcc_BytesView bytes;
+    for (size_t i = 0; i < signalsSize; i++) decode(decoder, signals[i], &packet, &bytes);
+    *packetsCount = 0;
+    return signalsSize;
+  }
+  size_t count = 0;
+  size_t i = 0;
+  while (i < signalsSize && count < packetsSize) {
+    struct dcc_BytesView bytes;
+    if (dcc_StreamParserResult_Success == decode(decoder, signals[i++], &packets[count], &bytes)) count++;
+  }
+  *packetsCount = count;
+  return i;
+}
+
+enum dcc_StreamParserResult dcc_decodePeriod(struct dcc_Decoder *const decoder, dcc_TimeMicroSec const period,
+                                             struct dcc_Packet *const packet) {
+  DCC_DEBUG_LOG("dcc_decodePeriod(decoder: %p, period: %lu, packet: %p)", decoder, period, packet);
+  struct dcc_BytesView bytes;
+  return decodePeriod(decoder, period, packet, &bytes);
+}
+
+enum dcc_StreamParserResult dcc_decodePeriodView(struct dcc_Decoder *const decoder, dcc_TimeMicroSec const period,
+                                                 struct dcc_Packet *const packet, struct dcc_BytesView *const bytes) {
+  DCC_DEBUG_LOG(
+    "dcc_decodePeriodView(decoder: %p, period: %lu, packet: %p, bytes: %p)", decoder, period, packet, bytes);
+  return decodePeriod(decoder, period, packet, bytes);
+}
+
+size_t dcc_decodePeriodBatch(struct dcc_Decoder *const decoder, dcc_HalfBitPeriod const *const periods,
+                             size_t const periodsSize, struct dcc_Packet *const packets, size_t const packetsSize,
+                             size_t *const packetsCount) {
+  DCC_DEBUG_LOG("dcc_decodePeriodBatch(decoder: %p, periods: %p, periodsSize: %zu, packets: %p, packetsSize: %zu, "
+                "packetsCount: %p)",
+                decoder,
+                periods,
+                periodsSize,
+                packets,
+                packetsSize,
+                packetsCount);
+  // `packets` が空でも入力を消費してパケットを捨て、0 を返し続けて呼び出し側の繰り返しが終わらなくなるのを防ぐ
+  if (packetsSize == 0) {
+    struct dcc_Packet packet;
+    struct dcc_BytesView bytes;
+    for (size_t i = 0; i < periodsSize; i++) decodePeriod(decoder, periods[i], &packet, &bytes);
+    *packetsCount = 0;
+    return periodsSize;
+  }
+  size_t count = 0;
+  size_t i = 0;
+  while (i < periodsSize && count < packetsSize) {
+    struct dcc_BytesView bytes;
+    if (dcc_StreamParserResult_Success == decodePeriod(decoder, periods[i++], &packets[count], &bytes)) count++;
+  }
+  *packetsCount = count;
+  return i;
+}
+
+#define SHOW_BOOL(value) ((value) ? "true" : "false")
+
+int dcc_showSignalBuffer(char *buffer, size_t const bufferSize, struct dcc_SignalBuffer const signalBuffer) {
+  return snprintf(buffer,
+                  bufferSize,
+                  "{\"buffer\":%p,\"size\":%zu,\"writeIndex\":%zu,\"readIndex\":%zu}",
                   signalBuffer.buffer,
                   signalBuffer.size,
-                  signalBuffer.written,
                   signalBuffer.writeIndex,
                   signalBuffer.readIndex);
 }
@@ -678,6 +1580,12 @@ int dcc_showSetDecoderFlagsPacketForMultiFunctionDecoders(
                   SHOW_DECODER_FLAGS_INSTRUCTION(packet.instruction));
 }
 
+int dcc_showSetExtendedAddressingPacketForMultiFunctionDecoders(
+  char *buffer, size_t const bufferSize,
+  struct dcc_SetExtendedAddressingPacketForMultiFunctionDecoders const packet) {
+  return snprintf(buffer, bufferSize, "{\"address\":%d,\"set\":%s}", packet.address, SHOW_BOOL(packet.set));
+}
+
 int dcc_showDecoderAcknowledgementRequestPacket(
   char *buffer, size_t const bufferSize,
   struct dcc_DecoderAcknowledgementRequestPacketForMultiFunctionDecoders const packet) {
@@ -705,6 +1613,162 @@ int dcc_showSpeedStep128ControlPacket(char *buffer, size_t const bufferSize,
                   packet.speed);
 }
 
+int dcc_showRestrictedSpeedStepPacketForMultiFunctionDecoders(
+  char *buffer, size_t const bufferSize, struct dcc_RestrictedSpeedStepPacketForMultiFunctionDecoders const packet) {
+  if (packet.flControl) {
+    return snprintf(buffer,
+                    bufferSize,
+                    "{\"address\":%d,\"enabled\":%s,\"flControl\":true,\"speed4Bit\":%d,\"emergencyStop\":%s}",
+                    packet.address,
+                    SHOW_BOOL(packet.enabled),
+                    packet.speed4Bit,
+                    SHOW_BOOL(packet.emergencyStop));
+  }
+  return snprintf(buffer,
+                  bufferSize,
+                  "{\"address\":%d,\"enabled\":%s,\"flControl\":false,\"speed5Bit\":%d,"
+                  "\"directionMayBeIgnored\":%s,\"emergencyStop\":%s}",
+                  packet.address,
+                  SHOW_BOOL(packet.enabled),
+                  packet.speed5Bit,
+                  SHOW_BOOL(packet.directionMayBeIgnored),
+                  SHOW_BOOL(packet.emergencyStop));
+}
+
+int dcc_showAnalogFunctionPacketForMultiFunctionDecoders(
+  char *buffer, size_t const bufferSize, struct dcc_AnalogFunctionPacketForMultiFunctionDecoders const packet) {
+  return snprintf(buffer,
+                  bufferSize,
+                  "{\"address\":%d,\"output\":%d,\"data\":%d}",
+                  packet.address,
+                  packet.output,
+                  packet.data);
+}
+
+int dcc_showSpeedAndDirectionPacketForMultiFunctionDecoders(
+  char *buffer, size_t const bufferSize, struct dcc_SpeedAndDirectionPacketForMultiFunctionDecoders const packet) {
+  int writtenSize = 0;
+  writtenSize += snprintf(buffer + writtenSize,
+                          bufferSize - (size_t) writtenSize,
+                          "{\"address\":%d,\"direction\":%s,\"flControl\":%s",
+                          packet.address,
+                          SHOW_DIRECTION(packet.direction),
+                          SHOW_BOOL(packet.flControl));
+  if (packet.flControl) {
+    writtenSize +=
+      snprintf(buffer + writtenSize, bufferSize - (size_t) writtenSize, ",\"speed4Bit\":%d", packet.speed4Bit);
+    writtenSize +=
+      snprintf(buffer + writtenSize, bufferSize - (size_t) writtenSize, ",\"fl\":%s", SHOW_BOOL(packet.fl));
+  } else {
+    writtenSize +=
+      snprintf(buffer + writtenSize, bufferSize - (size_t) writtenSize, ",\"speed5Bit\":%d", packet.speed5Bit);
+  }
+  writtenSize += snprintf(buffer + writtenSize,
+                          bufferSize - (size_t) writtenSize,
+                          ",\"directionMayBeIgnored\":%s,\"emergencyStop\":%s}",
+                          SHOW_BOOL(packet.directionMayBeIgnored),
+                          SHOW_BOOL(packet.emergencyStop));
+  return writtenSize;
+}
+
+int dcc_showFunctionGroup1PacketForMultiFunctionDecoders(
+  char *buffer, size_t const bufferSize, struct dcc_FunctionGroup1PacketForMultiFunctionDecoders const packet) {
+  int writtenSize = 0;
+  writtenSize += snprintf(buffer + writtenSize,
+                          bufferSize - (size_t) writtenSize,
+                          "{\"address\":%d,\"flControl\":%s",
+                          packet.address,
+                          SHOW_BOOL(packet.flControl));
+  if (packet.flControl) {
+    writtenSize +=
+      snprintf(buffer + writtenSize, bufferSize - (size_t) writtenSize, ",\"fl\":%s", SHOW_BOOL(packet.fl));
+  }
+  writtenSize += snprintf(buffer + writtenSize,
+                          bufferSize - (size_t) writtenSize,
+                          ",\"f1\":%s,\"f2\":%s,\"f3\":%s,\"f4\":%s}",
+                          SHOW_BOOL(packet.f1),
+                          SHOW_BOOL(packet.f2),
+                          SHOW_BOOL(packet.f3),
+                          SHOW_BOOL(packet.f4));
+  return writtenSize;
+}
+
+int dcc_showFunctionGroup2PacketForMultiFunctionDecoders(
+  char *buffer, size_t const bufferSize, struct dcc_FunctionGroup2PacketForMultiFunctionDecoders const packet) {
+  if (packet.group == dcc_FunctionGroup2Group_F5_F8) {
+    return snprintf(buffer,
+                    bufferSize,
+                    "{\"address\":%d,\"group\":\"F5_F8\",\"f5\":%s,\"f6\":%s,\"f7\":%s,\"f8\":%s}",
+                    packet.address,
+                    SHOW_BOOL(packet.functions.f5),
+                    SHOW_BOOL(packet.functions.f6),
+                    SHOW_BOOL(packet.functions.f7),
+                    SHOW_BOOL(packet.functions.f8));
+  }
+  return snprintf(buffer,
+                  bufferSize,
+                  "{\"address\":%d,\"group\":\"F9_F12\",\"f9\":%s,\"f10\":%s,\"f11\":%s,\"f12\":%s}",
+                  packet.address,
+                  SHOW_BOOL(packet.functions.f9),
+                  SHOW_BOOL(packet.functions.f10),
+                  SHOW_BOOL(packet.functions.f11),
+                  SHOW_BOOL(packet.functions.f12));
+}
+
+int dcc_showBinaryStateControlLongFormPacket(char *buffer, size_t const bufferSize,
+                                             struct dcc_BinaryStateControlLongFormPacket const packet) {
+  return snprintf(buffer,
+                  bufferSize,
+                  "{\"address\":%d,\"stateAddress\":%d,\"state\":%s}",
+                  packet.address,
+                  packet.stateAddress,
+                  SHOW_BOOL(packet.state));
+}
+
+int dcc_showBinaryStateControlShortFormPacket(char *buffer, size_t const bufferSize,
+                                              struct dcc_BinaryStateControlShortFormPacket const packet) {
+  return snprintf(buffer,
+                  bufferSize,
+                  "{\"address\":%d,\"stateAddress\":%d,\"state\":%s}",
+                  packet.address,
+                  packet.stateAddress,
+                  SHOW_BOOL(packet.state));
+}
+
+int dcc_showFunctionControlF13F20Packet(char *buffer, size_t const bufferSize,
+                                       struct dcc_FunctionControlF13F20Packet const packet) {
+  return snprintf(buffer,
+                  bufferSize,
+                  "{\"address\":%d,\"f13\":%s,\"f14\":%s,\"f15\":%s,\"f16\":%s,\"f17\":%s,\"f18\":%s,\"f19\":%s,"
+                  "\"f20\":%s}",
+                  packet.address,
+                  SHOW_BOOL(packet.f13),
+                  SHOW_BOOL(packet.f14),
+                  SHOW_BOOL(packet.f15),
+                  SHOW_BOOL(packet.f16),
+                  SHOW_BOOL(packet.f17),
+                  SHOW_BOOL(packet.f18),
+                  SHOW_BOOL(packet.f19),
+                  SHOW_BOOL(packet.f20));
+}
+
+int dcc_showFunctionControlF21F28Packet(char *buffer, size_t const bufferSize,
+                                       struct dcc_FunctionControlF21F28Packet const packet) {
+  return snprintf(buffer,
+                  bufferSize,
+                  "{\"address\":%d,\"f21\":%s,\"f22\":%s,\"f23\":%s,\"f24\":%s,\"f25\":%s,\"f26\":%s,\"f27\":%s,"
+                  "\"f28\":%s}",
+                  packet.address,
+                  SHOW_BOOL(packet.f21),
+                  SHOW_BOOL(packet.f22),
+                  SHOW_BOOL(packet.f23),
+                  SHOW_BOOL(packet.f24),
+                  SHOW_BOOL(packet.f25),
+                  SHOW_BOOL(packet.f26),
+                  SHOW_BOOL(packet.f27),
+                  SHOW_BOOL(packet.f28));
+}
+
 int dcc_showPacket(char *buffer, size_t const bufferSize, struct dcc_Packet const packet) {
   int writtenSize = 0;
   switch (packet.tag) {
@@ -770,8 +1834,15 @@ int dcc_showPacket(char *buffer, size_t const bufferSize, struct dcc_Packet cons
       writtenSize += snprintf(buffer + writtenSize, bufferSize - (size_t) writtenSize, "}");
       return writtenSize;
     case dcc_SetExtendedAddressingPacketForMultiFunctionDecodersTag:
-      DCC_UNIMPLEMENTED();
-      return snprintf(buffer, bufferSize, "{\"tag\":\"dcc_SetExtendedAddressingPacketForMultiFunctionDecodersTag\"}");
+      writtenSize += snprintf(buffer + writtenSize,
+                              bufferSize - (size_t) writtenSize,
+                              "{\"tag\":\"dcc_SetExtendedAddressingPacketForMultiFunctionDecodersTag\",\"packet\":");
+      writtenSize += dcc_showSetExtendedAddressingPacketForMultiFunctionDecoders(
+        buffer + writtenSize,
+        bufferSize - (size_t) writtenSize,
+        packet.setExtendedAddressingPacketForMultiFunctionDecoders);
+      writtenSize += snprintf(buffer + writtenSize, bufferSize - (size_t) writtenSize, "}");
+      return writtenSize;
     case dcc_DecoderAcknowledgementRequestPacketForMultiFunctionDecodersTag:
       writtenSize +=
         snprintf(buffer + writtenSize,
@@ -801,6 +1872,92 @@ int dcc_showPacket(char *buffer, size_t const bufferSize, struct dcc_Packet cons
                                                        packet.speedStep128ControlPacket);
       writtenSize += snprintf(buffer + writtenSize, bufferSize - (size_t) writtenSize, "}");
       return writtenSize;
+    case dcc_RestrictedSpeedStepPacketForMultiFunctionDecodersTag:
+      writtenSize += snprintf(buffer + writtenSize,
+                              bufferSize - (size_t) writtenSize,
+                              "{\"tag\":\"dcc_RestrictedSpeedStepPacketForMultiFunctionDecodersTag\",\"packet\":");
+      writtenSize += dcc_showRestrictedSpeedStepPacketForMultiFunctionDecoders(
+        buffer + writtenSize,
+        bufferSize - (size_t) writtenSize,
+        packet.restrictedSpeedStepPacketForMultiFunctionDecoders);
+      writtenSize += snprintf(buffer + writtenSize, bufferSize - (size_t) writtenSize, "}");
+      return writtenSize;
+    case dcc_AnalogFunctionPacketForMultiFunctionDecodersTag:
+      writtenSize += snprintf(buffer + writtenSize,
+                              bufferSize - (size_t) writtenSize,
+                              "{\"tag\":\"dcc_AnalogFunctionPacketForMultiFunctionDecodersTag\",\"packet\":");
+      writtenSize += dcc_showAnalogFunctionPacketForMultiFunctionDecoders(
+        buffer + writtenSize,
+        bufferSize - (size_t) writtenSize,
+        packet.analogFunctionPacketForMultiFunctionDecoders);
+      writtenSize += snprintf(buffer + writtenSize, bufferSize - (size_t) writtenSize, "}");
+      return writtenSize;
+    case dcc_SpeedAndDirectionPacketForMultiFunctionDecodersTag:
+      writtenSize += snprintf(buffer + writtenSize,
+                              bufferSize - (size_t) writtenSize,
+                              "{\"tag\":\"dcc_SpeedAndDirectionPacketForMultiFunctionDecodersTag\",\"packet\":");
+      writtenSize += dcc_showSpeedAndDirectionPacketForMultiFunctionDecoders(
+        buffer + writtenSize,
+        bufferSize - (size_t) writtenSize,
+        packet.speedAndDirectionPacketForMultiFunctionDecoders);
+      writtenSize += snprintf(buffer + writtenSize, bufferSize - (size_t) writtenSize, "}");
+      return writtenSize;
+    case dcc_FunctionGroup1PacketForMultiFunctionDecodersTag:
+      writtenSize += snprintf(buffer + writtenSize,
+                              bufferSize - (size_t) writtenSize,
+                              "{\"tag\":\"dcc_FunctionGroup1PacketForMultiFunctionDecodersTag\",\"packet\":");
+      writtenSize += dcc_showFunctionGroup1PacketForMultiFunctionDecoders(
+        buffer + writtenSize,
+        bufferSize - (size_t) writtenSize,
+        packet.functionGroup1PacketForMultiFunctionDecoders);
+      writtenSize += snprintf(buffer + writtenSize, bufferSize - (size_t) writtenSize, "}");
+      return writtenSize;
+    case dcc_FunctionGroup2PacketForMultiFunctionDecodersTag:
+      writtenSize += snprintf(buffer + writtenSize,
+                              bufferSize - (size_t) writtenSize,
+                              "{\"tag\":\"dcc_FunctionGroup2PacketForMultiFunctionDecodersTag\",\"packet\":");
+      writtenSize += dcc_showFunctionGroup2PacketForMultiFunctionDecoders(
+        buffer + writtenSize,
+        bufferSize - (size_t) writtenSize,
+        packet.functionGroup2PacketForMultiFunctionDecoders);
+      writtenSize += snprintf(buffer + writtenSize, bufferSize - (size_t) writtenSize, "}");
+      return writtenSize;
+    case dcc_BinaryStateControlLongFormPacketTag:
+      writtenSize += snprintf(buffer + writtenSize,
+                              bufferSize - (size_t) writtenSize,
+                              "{\"tag\":\"dcc_BinaryStateControlLongFormPacketTag\",\"packet\":");
+      writtenSize += dcc_showBinaryStateControlLongFormPacket(buffer + writtenSize,
+                                                              bufferSize - (size_t) writtenSize,
+                                                              packet.binaryStateControlLongFormPacket);
+      writtenSize += snprintf(buffer + writtenSize, bufferSize - (size_t) writtenSize, "}");
+      return writtenSize;
+    case dcc_BinaryStateControlShortFormPacketTag:
+      writtenSize += snprintf(buffer + writtenSize,
+                              bufferSize - (size_t) writtenSize,
+                              "{\"tag\":\"dcc_BinaryStateControlShortFormPacketTag\",\"packet\":");
+      writtenSize += dcc_showBinaryStateControlShortFormPacket(buffer + writtenSize,
+                                                               bufferSize - (size_t) writtenSize,
+                                                               packet.binaryStateControlShortFormPacket);
+      writtenSize += snprintf(buffer + writtenSize, bufferSize - (size_t) writtenSize, "}");
+      return writtenSize;
+    case dcc_FunctionControlF13F20PacketTag:
+      writtenSize += snprintf(buffer + writtenSize,
+                              bufferSize - (size_t) writtenSize,
+                              "{\"tag\":\"dcc_FunctionControlF13F20PacketTag\",\"packet\":");
+      writtenSize += dcc_showFunctionControlF13F20Packet(buffer + writtenSize,
+                                                         bufferSize - (size_t) writtenSize,
+                                                         packet.functionControlF13F20Packet);
+      writtenSize += snprintf(buffer + writtenSize, bufferSize - (size_t) writtenSize, "}");
+      return writtenSize;
+    case dcc_FunctionControlF21F28PacketTag:
+      writtenSize += snprintf(buffer + writtenSize,
+                              bufferSize - (size_t) writtenSize,
+                              "{\"tag\":\"dcc_FunctionControlF21F28PacketTag\",\"packet\":");
+      writtenSize += dcc_showFunctionControlF21F28Packet(buffer + writtenSize,
+                                                         bufferSize - (size_t) writtenSize,
+                                                         packet.functionControlF21F28Packet);
+      writtenSize += snprintf(buffer + writtenSize, bufferSize - (size_t) writtenSize, "}");
+      return writtenSize;
     default:
       return snprintf(buffer, bufferSize, "{\"tag\":\"Not implemented or unknown\"}");
   }
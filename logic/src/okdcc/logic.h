@@ -8,13 +8,120 @@
 
 #define DCC_BIT_STREAM_PARSER_BYTES_CAPACITY 8
 
+#define DCC_PREAMBLE_SENT_BITS_COUNT 14
+
+#define DCC_WAVEFORM_PERIODS_CAPACITY \
+  (2 * (DCC_PREAMBLE_SENT_BITS_COUNT + 9 * DCC_BIT_STREAM_PARSER_BYTES_CAPACITY + 1))
+
+#define DCC_PACKET_LOG_FRAME_CAPACITY (2 + 1 + 1 + 5 + DCC_BIT_STREAM_PARSER_BYTES_CAPACITY)
+
+#define DCC_PACKET_LOG_FRAME_MARKER 0x00
+
+#define DCC_PACKET_LOG_ABSOLUTE_TIME_INTERVAL 64
+
+#define DCC_TIMING_PROFILE_BUCKETS_COUNT 32
+
+/// \~english
+/// \brief The lower bound and the width in microseconds of the buckets of `dcc_TimingProfile`.
+///
+/// The first and the last buckets also include the values below and above the range.
+/// \~japanese
+/// \brief `dcc_TimingProfile` の区間の下限と幅（マイクロ秒）。
+///
+/// 最初と最後の区間は範囲より小さい値と大きい値も含む。
+#define DCC_TIMING_PROFILE_ONE_HALF_BIT_MIN 40
+#define DCC_TIMING_PROFILE_ONE_HALF_BIT_WIDTH 1
+#define DCC_TIMING_PROFILE_ZERO_HALF_BIT_MIN 80
+#define DCC_TIMING_PROFILE_ZERO_HALF_BIT_WIDTH 4
+#define DCC_TIMING_PROFILE_ASYMMETRY_MIN (-16)
+#define DCC_TIMING_PROFILE_ASYMMETRY_WIDTH 1
+
+/// \~english
+/// \brief The number of consecutive half bits of `1` from which `dcc_ClockRecovery` learns.
+///
+/// It is longer than the 8 ones of the byte 0xFF and the packet end bit, so only preambles are learned.
+/// \~japanese
+/// \brief `dcc_ClockRecovery` が学習する連続した `1` の半ビットの数。
+///
+/// 0xFF のバイトの8個の `1` とパケット終了ビットより長いので、プリアンブルだけを学習する。
+#define DCC_CLOCK_RECOVERY_LEARNING_HALF_BITS_COUNT 20
+
+#define DCC_LOG_LEVEL_NONE 0
+#define DCC_LOG_LEVEL_ERROR 1
+#define DCC_LOG_LEVEL_DEBUG 2
+
+/// \~english
+/// \brief The level of logs compiled into the library.
+///
+/// Define it as `DCC_LOG_LEVEL_ERROR` or lower when building the library to remove the calls of `dcc_debug_log`
+/// entirely, including the check of the pointer. `dcc_error_log` is not called below `DCC_LOG_LEVEL_ERROR`.
+/// \~japanese
+/// \brief ライブラリーに組み込むログの水準。
+///
+/// ライブラリーをビルドするときに `DCC_LOG_LEVEL_ERROR` 以下に定義すると、ポインターの確認も含めて `dcc_debug_log`
+/// の呼び出しを取り除く。`DCC_LOG_LEVEL_ERROR` 未満では `dcc_error_log` も呼び出さない。
+#ifndef DCC_LOG_LEVEL
+#define DCC_LOG_LEVEL DCC_LOG_LEVEL_DEBUG
+#endif
+
+/// \~english
+/// \brief The initializers of `dcc_ReceiveTiming` for the strict NMRA ranges and for the wider ranges that tolerate
+/// noisy boosters.
+///
+/// The values are in the order of the fields of `dcc_ReceiveTiming`.
+/// \~japanese
+/// \brief NMRA どおりの厳密な範囲と、ノイズの多いブースターを許容する広い範囲の `dcc_ReceiveTiming` の初期化子。
+///
+/// 値は `dcc_ReceiveTiming` のフィールドの順である。
+#define DCC_STRICT_RECEIVE_TIMING { 52UL, 64UL, 90UL, 10000UL, 6UL, 12000UL }
+#define DCC_TOLERANT_RECEIVE_TIMING { 46UL, 70UL, 80UL, 10000UL, 10UL, 12000UL }
+
+/// \~english
+/// \brief The receive timing used by decoders that do not select one.
+///
+/// Define it as `DCC_TOLERANT_RECEIVE_TIMING` or a custom initializer when building the library.
+/// Because it is known at compile time, the comparisons of the default path are compiled with immediate values.
+/// \~japanese
+/// \brief 受信のタイミングを選んでいないデコーダーが使う受信のタイミング。
+///
+/// ライブラリーをビルドするときに `DCC_TOLERANT_RECEIVE_TIMING` か独自の初期化子に定義する。
+/// コンパイル時に決まるので、既定の経路の比較は即値でコンパイルされる。
+#ifndef DCC_DEFAULT_RECEIVE_TIMING
+#define DCC_DEFAULT_RECEIVE_TIMING DCC_STRICT_RECEIVE_TIMING
+#endif
+
+#define DCC_DEFERRED_LOG_ARGS_CAPACITY 8
+
 /// \~english
 /// \brief A type that represents the time in microseconds.
 ///
+/// Times of voltage changes are treated as a free-running counter that wraps around at `DCC_TIME_MICRO_SEC_MASK`,
+/// e.g. `esp_timer_get_time()` truncated to 32 bits, which wraps about every 71 minutes. Use `dcc_elapsedTime` to get
+/// the duration between two times.
+///
 /// \~japanese
 /// \brief マイクロ秒単位の時間を表す型。
+///
+/// 電圧変化の時刻は `DCC_TIME_MICRO_SEC_MASK` で一周するフリーランニングカウンターとして扱う。例えば32ビットに切り詰めた `esp_timer_get_time()`
+/// は約71分ごとに一周する。2つの時刻の間の継続時間は `dcc_elapsedTime` で求める。
 typedef unsigned long dcc_TimeMicroSec;
 
+#define DCC_TIME_MICRO_SEC_MASK UINT32_C(0xFFFFFFFF)
+
+/// \~english
+/// \brief A type that represents the duration of a half bit in microseconds in 16 bits.
+///
+/// Durations longer than `DCC_HALF_BIT_PERIOD_MAX` are saturated to it. It is enough to keep every duration that can
+/// be decoded, because a half bit of a stretched `0` is at most 10 ms.
+///
+/// \~japanese
+/// \brief 半ビットの継続時間をマイクロ秒単位で16ビットで表す型。
+///
+/// `DCC_HALF_BIT_PERIOD_MAX` より長い継続時間はその値に飽和させる。引き伸ばされた `0` の半ビットは最長でも 10 ms なので、デコード可能な継続時間は全て保持できる。
+typedef uint_least16_t dcc_HalfBitPeriod;
+
+#define DCC_HALF_BIT_PERIOD_MAX UINT16_C(0xFFFF)
+
 /// \~english
 /// \brief A type that represents a bit.
 ///
@@ -29,6 +136,16 @@ typedef bool dcc_Bit;
 /// \brief バイトを表す型。
 typedef uint_least8_t dcc_Byte;
 
+/// \~english
+/// \brief A read-only view of bytes owned by someone else.
+///
+/// \~japanese
+/// \brief 他が所有するバイト列の読み取り専用の参照。
+struct dcc_BytesView {
+  dcc_Byte const *bytes;
+  size_t size;
+};
+
 /// \~english
 /// \brief A type that represents success or failure.
 ///
@@ -58,14 +175,96 @@ enum dcc_StreamParserResult {
 /// \~english
 /// \brief A structure that records the time of voltage changes.
 ///
+/// It is a lock-free ring buffer for a single producer (e.g. an interrupt handler) and a single consumer (e.g. the
+/// main loop). Neither side needs to disable interrupts. `writeIndex` is written only by the producer and `readIndex`
+/// only by the consumer. Both are free-running counters and are masked by `size - 1` when accessing `buffer`.
+///
 /// \~japanese
 /// \brief 電圧変化の時刻を記録する構造体。
+///
+/// 単一の書き込み側（割り込みハンドラーなど）と単一の読み出し側（メインループなど）のためのロックフリーなリングバッファーである。
+/// どちらの側も割り込みを禁止する必要はない。`writeIndex` は書き込み側のみが、`readIndex` は読み出し側のみが書き換える。
+/// どちらも単調に増加するカウンターであり、`buffer` にアクセスするときに `size - 1` でマスクされる。
 struct dcc_SignalBuffer {
   dcc_TimeMicroSec *const buffer;
+  /// \~english
+  /// \brief The capacity of `buffer`. It is a power of two.
+  ///
+  /// \~japanese
+  /// \brief `buffer` の容量。2の冪である。
+  size_t const size;
+  size_t writeIndex;
+  size_t readIndex;
+};
+
+/// \~english
+/// \brief A contiguous view of the times of voltage changes stored in a `dcc_SignalBuffer`.
+///
+/// \~japanese
+/// \brief `dcc_SignalBuffer` に記録された電圧変化の時刻の連続した範囲を表す構造体。
+struct dcc_SignalSpan {
+  dcc_TimeMicroSec const *signals;
+  size_t size;
+};
+
+/// \~english
+/// \brief To get the duration from `since` to `until` taking the wrap-around of the time into account.
+///
+/// Only the lower 32 bits of the times are used, so the result is correct whether the times are truncated to 32 bits
+/// or not, as long as the actual duration is shorter than about 71 minutes.
+/// \param since The earlier time.
+/// \param until The later time.
+/// \return The duration.
+/// \~japanese
+/// \brief 時刻の一周を考慮して `since` から `until` までの継続時間を求める。
+///
+/// 時刻の下位32ビットのみを使うので、実際の継続時間が約71分より短ければ、時刻が32ビットに切り詰められているかどうかに関わらず正しい結果になる。
+/// \param since 前の時刻。
+/// \param until 後の時刻。
+/// \return 継続時間。
+dcc_TimeMicroSec dcc_elapsedTime(dcc_TimeMicroSec const since, dcc_TimeMicroSec const until);
+
+/// \~english
+/// \brief A structure that records the durations between voltage changes.
+///
+/// It is the 16-bit capture mode of `dcc_SignalBuffer`. Instead of absolute times, it stores the durations of half
+/// bits, so each element needs a half (or a quarter where `dcc_TimeMicroSec` is 64 bits) of the memory. The
+/// concurrency is the same as `dcc_SignalBuffer`. `lastSignal`, `lastSignalExists` and `gapPending` are used only by the
+/// producer.
+///
+/// \~japanese
+/// \brief 電圧変化の間の継続時間を記録する構造体。
+///
+/// `dcc_SignalBuffer` の16ビット記録モードである。絶対時刻の代わりに半ビットの継続時間を記録するので、要素ごとに半分（`dcc_TimeMicroSec` が64ビットの環境では4分の1）のメモリーで済む。
+/// 並行性は `dcc_SignalBuffer` と同じである。`lastSignal`、`lastSignalExists` と `gapPending` は書き込み側のみが使う。
+struct dcc_PeriodBuffer {
+  dcc_HalfBitPeriod *const buffer;
+  /// \~english
+  /// \brief The capacity of `buffer`. It is a power of two.
+  ///
+  /// \~japanese
+  /// \brief `buffer` の容量。2の冪である。
   size_t const size;
-  size_t written;
   size_t writeIndex;
   size_t readIndex;
+  dcc_TimeMicroSec lastSignal;
+  bool lastSignalExists;
+  /// \~english
+  /// \brief Whether a change was lost because the buffer was full and the gap marker is not written yet.
+  ///
+  /// \~japanese
+  /// \brief バッファに空きがなく変化が失われ、途切れの印をまだ書き込んでいないか。
+  bool gapPending;
+};
+
+/// \~english
+/// \brief A contiguous view of the durations stored in a `dcc_PeriodBuffer`.
+///
+/// \~japanese
+/// \brief `dcc_PeriodBuffer` に記録された継続時間の連続した範囲を表す構造体。
+struct dcc_PeriodSpan {
+  dcc_HalfBitPeriod const *periods;
+  size_t size;
 };
 
 /// \~english
@@ -333,6 +532,15 @@ struct dcc_RestrictedSpeedStepPacketForMultiFunctionDecoders {
     dcc_Speed4Bit speed4Bit;
     dcc_Speed5Bit speed5Bit;
   };
+  /// \~english
+  /// \brief `emergencyStop` and `directionMayBeIgnored` are encoded with the speed, as in
+  /// `dcc_SpeedAndDirectionPacketForMultiFunctionDecoders`. `directionMayBeIgnored` is always `false` when `flControl`
+  /// is `true`.
+  /// \~japanese
+  /// \brief `emergencyStop` と `directionMayBeIgnored` は速度と合わせて表され、`dcc_SpeedAndDirectionPacketForMultiFunctionDecoders` と同様である。
+  /// `flControl` が `true` のとき `directionMayBeIgnored` は常に `false` である。
+  bool emergencyStop;
+  bool directionMayBeIgnored;
 };
 
 /// \~english
@@ -342,6 +550,12 @@ struct dcc_RestrictedSpeedStepPacketForMultiFunctionDecoders {
 /// `dcc_AnalogFunctionPacketForMultiFunctionDecodersTag` を参照。
 struct dcc_AnalogFunctionPacketForMultiFunctionDecoders {
   dcc_AddressForExtendedPacket address;
+  /// \~english
+  /// \brief The analog function output.
+  ///
+  /// \~japanese
+  /// \brief アナログ機能の出力。
+  dcc_Byte output;
   dcc_Byte data;
 };
 
@@ -376,6 +590,7 @@ struct dcc_SpeedAndDirectionPacketForMultiFunctionDecoders {
 /// \~japanese
 /// `dcc_FunctionGroup1PacketForMultiFunctionDecodersTag` を参照。
 struct dcc_FunctionGroup1PacketForMultiFunctionDecoders {
+  dcc_AddressForExtendedPacket address;
   /// \~english
   /// \brief Which FL control is active within Function Group One Instruction Packet or not.
   ///
@@ -404,6 +619,7 @@ enum dcc_FunctionGroup2Group {
 /// \~japanese
 /// `dcc_FunctionGroup2PacketForMultiFunctionDecodersTag` を参照。
 struct dcc_FunctionGroup2PacketForMultiFunctionDecoders {
+  dcc_AddressForExtendedPacket address;
   enum dcc_FunctionGroup2Group group;
   union {
     struct {
@@ -820,6 +1036,12 @@ enum dcc_PacketTag {
 
 };
 
+/// \~english
+/// \brief The number of the kinds of `dcc_PacketTag`.
+/// \~japanese
+/// \brief `dcc_PacketTag` の種類の数。
+#define DCC_PACKET_TAGS_COUNT (dcc_FunctionControlF21F28PacketTag + 1)
+
 struct dcc_Packet {
   enum dcc_PacketTag tag;
   union {
@@ -835,16 +1057,239 @@ struct dcc_Packet {
       decoderAcknowledgementRequestPacketForMultiFunctionDecoders;
     struct dcc_ConsistControlPacketForMultiFunctionDecoders consistControlPacketForMultiFunctionDecoders;
     struct dcc_SpeedStep128ControlPacketForMultiFunctionDecoders speedStep128ControlPacket;
+    struct dcc_RestrictedSpeedStepPacketForMultiFunctionDecoders restrictedSpeedStepPacketForMultiFunctionDecoders;
+    struct dcc_AnalogFunctionPacketForMultiFunctionDecoders analogFunctionPacketForMultiFunctionDecoders;
+    struct dcc_SpeedAndDirectionPacketForMultiFunctionDecoders speedAndDirectionPacketForMultiFunctionDecoders;
+    struct dcc_FunctionGroup1PacketForMultiFunctionDecoders functionGroup1PacketForMultiFunctionDecoders;
+    struct dcc_FunctionGroup2PacketForMultiFunctionDecoders functionGroup2PacketForMultiFunctionDecoders;
+    struct dcc_BinaryStateControlLongFormPacket binaryStateControlLongFormPacket;
+    struct dcc_BinaryStateControlShortFormPacket binaryStateControlShortFormPacket;
+    struct dcc_FunctionControlF13F20Packet functionControlF13F20Packet;
+    struct dcc_FunctionControlF21F28Packet functionControlF21F28Packet;
   };
 };
 
+/// \~english
+/// \brief A structure that holds the histograms of the durations of half bits.
+///
+/// It shows how close the received timing is to the edges of the acceptable ranges before packets start to fail.
+/// A half bit shorter than `DCC_TIMING_PROFILE_ZERO_HALF_BIT_MIN` is counted as a half bit of `1` and the others as
+/// a half bit of `0`. Updating it is O(1) per half bit and does not allocate.
+/// Only one thread updates the counts and other threads can read them with `dcc_getTimingProfile`.
+/// \~japanese
+/// \brief 半ビットの継続時間のヒストグラムを保持する構造体。
+///
+/// パケットが失敗し始める前に、受信したタイミングが許容範囲の端にどれだけ近いかを示す。
+/// `DCC_TIMING_PROFILE_ZERO_HALF_BIT_MIN` より短い半ビットを `1` の半ビットとして、それ以外を `0` の半ビットとして数える。
+/// 更新は半ビットごとに O(1) で、メモリーを確保しない。
+/// 回数を更新するのは1つのスレッドだけで、他のスレッドからは `dcc_getTimingProfile` で読み出せる。
+struct dcc_TimingProfile {
+  /// \~english
+  /// \brief The counts of the durations of half bits of `1`.
+  /// \~japanese
+  /// \brief `1` の半ビットの継続時間の回数。
+  size_t oneHalfBitCounts[DCC_TIMING_PROFILE_BUCKETS_COUNT];
+
+  /// \~english
+  /// \brief The counts of the durations of half bits of `0`.
+  /// \~japanese
+  /// \brief `0` の半ビットの継続時間の回数。
+  size_t zeroHalfBitCounts[DCC_TIMING_PROFILE_BUCKETS_COUNT];
+
+  /// \~english
+  /// \brief The counts of the second half minus the first half of pairs of half bits of `1`.
+  ///
+  /// The pair is rejected when the absolute value exceeds `dcc_maxOneHalfBitReceivedPeriodDiff`.
+  /// \~japanese
+  /// \brief `1` の半ビットの組の後半から前半を引いた値の回数。
+  ///
+  /// 絶対値が `dcc_maxOneHalfBitReceivedPeriodDiff` を超えると組は棄却される。
+  size_t oneBitAsymmetryCounts[DCC_TIMING_PROFILE_BUCKETS_COUNT];
+};
+
+/// \~english
+/// \brief A structure that holds the acceptable durations of received half bits.
+///
+/// The range of `1` must be below the range of `0`. See `dcc_validateReceiveTiming`.
+/// \~japanese
+/// \brief 受信した半ビットの許容時間を保持する構造体。
+///
+/// `1` の範囲は `0` の範囲より下でなければならない。`dcc_validateReceiveTiming` を参照。
+struct dcc_ReceiveTiming {
+  dcc_TimeMicroSec minOneHalfBitPeriod;
+  dcc_TimeMicroSec maxOneHalfBitPeriod;
+  dcc_TimeMicroSec minZeroHalfBitPeriod;
+  dcc_TimeMicroSec maxZeroHalfBitPeriod;
+  /// \~english
+  /// \brief The maximum difference of the durations of the two half bits of `1`.
+  /// \~japanese
+  /// \brief `1` の2つの半ビットの継続時間の差の最大値。
+  dcc_TimeMicroSec maxOneHalfBitPeriodDiff;
+  /// \~english
+  /// \brief The maximum total duration of a stretched `0` bit.
+  /// \~japanese
+  /// \brief 引き伸ばされた `0` ビットの総和継続時間の最大値。
+  dcc_TimeMicroSec maxStretchedZeroBitPeriod;
+};
+
+/// \~english
+/// \brief A structure that holds the state of the adaptive clock recovery of a signal stream parser.
+///
+/// It learns the nominal duration of half bits of `1` and the skew between the two half bits from the preamble, e.g.
+/// a booster or an opto-isolated input that always makes the high half bit longer. The following half bits are judged
+/// with `timing`, whose ranges are centred on the learned values, and pairs of `1` are judged relative to the skew.
+/// The ranges of `0` are scaled by the learned clock rate. The values are learned when the run of half bits of `1`
+/// ends, usually at the packet start bit. Until a preamble is learned, `timing` is `base`.
+///
+/// Attach it with `dcc_attachClockRecovery`. It is updated for every half bit by the thread that owns the parser.
+/// \~japanese
+/// \brief 信号列パーサーの適応的なクロック再生の状態を保持する構造体。
+///
+/// プリアンブルから `1` の半ビットの公称の継続時間と2つの半ビットの偏りを学習する。例えば常に High の半ビットを長くするブースターやフォトカプラーの入力である。
+/// 続く半ビットは学習した値を中心とする範囲の `timing` で判定し、`1` の組は偏りを差し引いて判定する。`0` の範囲は学習したクロックの速さに合わせて伸縮する。
+/// 値は `1` の半ビットの連続が途切れたとき、普通はパケット開始ビットで学習する。プリアンブルを学習するまで `timing` は `base` である。
+///
+/// `dcc_attachClockRecovery` で取り付ける。パーサーを所有するスレッドが半ビットごとに更新する。
+struct dcc_ClockRecovery {
+  /// \~english
+  /// \brief The receive timing around which it learns.
+  /// \~japanese
+  /// \brief 学習の基準にする受信のタイミング。
+  struct dcc_ReceiveTiming base;
+  /// \~english
+  /// \brief The receive timing from the learned values.
+  /// \~japanese
+  /// \brief 学習した値から求めた受信のタイミング。
+  struct dcc_ReceiveTiming timing;
+  /// \~english
+  /// \brief The learned nominal duration of a half bit of `1`, or `0` before learning.
+  /// \~japanese
+  /// \brief 学習した `1` の半ビットの公称の継続時間。学習前は `0`。
+  dcc_TimeMicroSec oneHalfBitPeriod;
+  /// \~english
+  /// \brief The learned duration of the half bits at odd positions minus that at even positions.
+  ///
+  /// The positions are counted from the attachment, so that the sign follows the polarity of the input.
+  /// \~japanese
+  /// \brief 学習した奇数番目の半ビットの継続時間から偶数番目の半ビットの継続時間を引いた値。
+  ///
+  /// 番目は取り付けてから数えるので、符号は入力の極性に従う。
+  long oneHalfBitPeriodSkew;
+  /// \~english
+  /// \brief The expected second half minus the first half of the pair that ends with the last half bit.
+  /// \~japanese
+  /// \brief 最後の半ビットで終わる組の、後半から前半を引いた値の期待値。
+  long pairSkew;
+  bool oddPeriod;
+  dcc_TimeMicroSec lastPeriod;
+  size_t runPeriodsCount;
+  dcc_TimeMicroSec runPeriodsSum;
+  long runSkewsSum;
+  /// \~english
+  /// \brief The number of preambles learned.
+  /// \~japanese
+  /// \brief 学習したプリアンブルの数。
+  size_t learnedCount;
+};
+
+/// \~english
+/// \brief Which half bits start bits, which is the polarity of the input.
+///
+/// The positions of half bits are counted by `dcc_SignalStreamParser::oddPeriod`.
+/// \~japanese
+/// \brief どの半ビットがビットの始まりかで、入力の極性である。
+///
+/// 半ビットの番目は `dcc_SignalStreamParser::oddPeriod` で数える。
+enum dcc_SignalPolarity {
+  dcc_SignalPolarity_Unknown,
+  dcc_SignalPolarity_OddPeriodFirst,
+  dcc_SignalPolarity_EvenPeriodFirst,
+};
+
 /// \~english
 /// \brief A structure that holds the state of the parser that parses the time of voltage changes and gets the bit.
 /// \~japanese
 /// \brief 電圧変化の時刻の列をパースしビットを取得するパーサーの状態を保持する構造体。
 struct dcc_SignalStreamParser {
-  dcc_TimeMicroSec signals[2];
-  size_t signalsSize;
+  /// \~english
+  /// \brief The time of the last voltage change. Valid only when `signalExists` is `true`.
+  ///
+  /// \~japanese
+  /// \brief 最後の電圧変化の時刻。`signalExists` が `true` のときのみ有効。
+  dcc_TimeMicroSec signal;
+  bool signalExists;
+  /// \~english
+  /// \brief The duration of the first half bit of the bit being parsed. Valid only when `periodExists` is `true`.
+  ///
+  /// \~japanese
+  /// \brief パース中のビットの前半の半ビットの継続時間。`periodExists` が `true` のときのみ有効。
+  dcc_TimeMicroSec period;
+  bool periodExists;
+  /// \~english
+  /// \brief The sum of the durations shorter than the minimum half bit of `1` since the last half bit. Valid only when
+  /// `fragmentExists` is `true`.
+  ///
+  /// Such a duration cannot be a half bit, so it is taken as a piece of a half bit split by a spike and added to the
+  /// next duration. A spike splits a half bit into three pieces. Their sum is the original half bit only when the first
+  /// piece is also short. When the first piece is long enough to be read as a half bit, it is processed on its own and
+  /// the sum of the other two is shorter than the original, so the half bit is lost as it would be without merging.
+  /// \~japanese
+  /// \brief 最後の半ビットからの、`1` の半ビットの最小値より短い継続時間の和。`fragmentExists` が `true` のときのみ有効。
+  ///
+  /// そのような継続時間は半ビットになり得ないので、スパイクで分かれた半ビットの断片とみなして次の継続時間に足す。スパイクは半ビットを3つに分け、
+  /// その和が元の半ビットになるのは最初の断片も短い場合だけである。最初の断片が半ビットとして読める長さならそれだけで処理され、残りの2つの和は元より短くなるので、
+  /// 合わせない場合と同じくその半ビットは失われる。
+  dcc_TimeMicroSec fragment;
+  bool fragmentExists;
+  /// \~english
+  /// \brief The number of times the parser recovered from an invalid state.
+  /// \~japanese
+  /// \brief パーサーが不正な状態から回復した回数。
+  size_t errorsCount;
+  /// \~english
+  /// \brief The profile to which the durations of half bits are added, or `NULL` not to profile.
+  ///
+  /// `dcc_decodeSignalsToBits` processes the signals one by one while it is set.
+  /// \~japanese
+  /// \brief 半ビットの継続時間を追加するプロファイル。`NULL` ならプロファイルしない。
+  ///
+  /// 設定されている間は `dcc_decodeSignalsToBits` も信号を1つずつ処理する。
+  struct dcc_TimingProfile *timingProfile;
+  /// \~english
+  /// \brief The receive timing to judge half bits with, or `NULL` to use `DCC_DEFAULT_RECEIVE_TIMING`.
+  ///
+  /// It can be switched between bits. `NULL` is the fastest because the default is compiled in.
+  /// \~japanese
+  /// \brief 半ビットの判定に使う受信のタイミング。`NULL` なら `DCC_DEFAULT_RECEIVE_TIMING` を使う。
+  ///
+  /// ビットの間で切り替えられる。既定値はコンパイル時に組み込まれるので `NULL` が最も速い。
+  struct dcc_ReceiveTiming const *receiveTiming;
+  /// \~english
+  /// \brief The adaptive clock recovery, or `NULL` to judge with fixed ranges.
+  ///
+  /// Set it with `dcc_attachClockRecovery`. `dcc_decodeSignalsToBits` processes the signals one by one while it is set.
+  /// \~japanese
+  /// \brief 適応的なクロック再生。`NULL` なら固定の範囲で判定する。
+  ///
+  /// `dcc_attachClockRecovery` で設定する。設定されている間は `dcc_decodeSignalsToBits` も信号を1つずつ処理する。
+  struct dcc_ClockRecovery *clockRecovery;
+  /// \~english
+  /// \brief Whether the last half bit is at an odd position since the initialization.
+  /// \~japanese
+  /// \brief 最後の半ビットが初期化してから奇数番目かどうか。
+  bool oddPeriod;
+  /// \~english
+  /// \brief Which half bits start bits. `dcc_Decoder` sets it at every packet start bit.
+  ///
+  /// When a pair of half bits is not a bit, the second half is kept as the first half of the next bit only if it can
+  /// start a bit. Otherwise the next half bit starts the next bit and the polarity is forgotten, so that a wrong
+  /// polarity costs only one half bit. While it is unknown, the window slides by one half bit.
+  /// \~japanese
+  /// \brief どの半ビットがビットの始まりか。`dcc_Decoder` がパケット開始ビットごとに設定する。
+  ///
+  /// 半ビットの組がビットにならなかったとき、後半の半ビットはビットを始められる場合だけ次のビットの前半として残す。そうでなければ次の半ビットから次のビットを始め、極性は忘れるので、
+  /// 極性が間違っていても失うのは半ビット1つだけである。分からない間は1つずつずらす。
+  enum dcc_SignalPolarity polarity;
 };
 
 enum dcc_BitStreamParserState {
@@ -870,6 +1315,129 @@ struct dcc_BitStreamParser {
   };
   dcc_Byte bytes[DCC_BIT_STREAM_PARSER_BYTES_CAPACITY];
   size_t bytesSize;
+  /// \~english
+  /// \brief The number of times the parser recovered from an invalid state by waiting for the next preamble.
+  /// \~japanese
+  /// \brief パーサーが次のプリアンブルを待つことで不正な状態から回復した回数。
+  size_t errorsCount;
+};
+
+/// \~english
+/// \brief The classes of the first byte of a packet, which is the kind of the address.
+/// \~japanese
+/// \brief パケットの先頭バイトの区分で、アドレスの種類。
+enum dcc_AddressClass {
+  /// \~english
+  /// \brief 0x00: the broadcast address.
+  /// \~japanese
+  /// \brief 0x00：ブロードキャストアドレス。
+  dcc_AddressClass_Broadcast,
+
+  /// \~english
+  /// \brief 0x01–0x7F: the short address of multi function decoders.
+  /// \~japanese
+  /// \brief 0x01–0x7F：多機能デコーダーの短いアドレス。
+  dcc_AddressClass_ShortAddress,
+
+  /// \~english
+  /// \brief 0x80–0xBF: the address of accessory decoders.
+  /// \~japanese
+  /// \brief 0x80–0xBF：アクセサリーデコーダーのアドレス。
+  dcc_AddressClass_Accessory,
+
+  /// \~english
+  /// \brief 0xC0–0xE7: the long address of multi function decoders.
+  /// \~japanese
+  /// \brief 0xC0–0xE7：多機能デコーダーの長いアドレス。
+  dcc_AddressClass_LongAddress,
+
+  /// \~english
+  /// \brief 0xE8–0xFE: reserved for future use.
+  /// \~japanese
+  /// \brief 0xE8–0xFE：将来のために予約されている。
+  dcc_AddressClass_Reserved,
+
+  /// \~english
+  /// \brief 0xFF: the idle packet.
+  /// \~japanese
+  /// \brief 0xFF：アイドルパケット。
+  dcc_AddressClass_Idle,
+};
+
+/// \~english
+/// \brief The number of the kinds of `dcc_AddressClass`.
+/// \~japanese
+/// \brief `dcc_AddressClass` の種類の数。
+#define DCC_ADDRESS_CLASSES_COUNT (dcc_AddressClass_Idle + 1)
+
+/// \~english
+/// \brief A structure that holds the counts of the results of each stage of a `dcc_Decoder`.
+///
+/// Only the thread that runs the decoder updates the counts.
+/// Other threads can read them with `dcc_getDecoderStats`.
+/// \~japanese
+/// \brief `dcc_Decoder` の段階ごとの結果の回数を保持する構造体。
+///
+/// 回数を更新するのはデコーダーを動かすスレッドだけである。
+/// 他のスレッドからは `dcc_getDecoderStats` で読み出せる。
+struct dcc_DecoderStats {
+  /// \~english
+  /// \brief The number of the voltage changes or the half bit periods given to the decoder.
+  /// \~japanese
+  /// \brief デコーダーに与えられた電圧変化または半ビットの継続時間の数。
+  size_t edgesCount;
+
+  /// \~english
+  /// \brief The number of the decoded bits.
+  /// \~japanese
+  /// \brief デコードされたビットの数。
+  size_t bitsCount;
+
+  /// \~english
+  /// \brief The number of the pairs of half bits whose timing is neither one nor zero.
+  /// \~japanese
+  /// \brief タイミングが 1 と 0 のどちらでもなかった半ビットの組の数。
+  size_t timingRejectsCount;
+
+  /// \~english
+  /// \brief The number of the times the preamble was too short and the decoder waited for the next one.
+  /// \~japanese
+  /// \brief プリアンブルが短すぎて次のプリアンブルを待った回数。
+  size_t preambleResyncsCount;
+
+  /// \~english
+  /// \brief The number of the packets abandoned because a pair of half bits inside was not a bit.
+  ///
+  /// The decoder waits for the next preamble instead of taking the misaligned bits as data.
+  /// \~japanese
+  /// \brief 途中の半ビットの組がビットにならなかったために捨てたパケットの数。
+  ///
+  /// デコーダーはずれたビットをデータとして読まずに、次のプリアンブルを待つ。
+  size_t timingResyncsCount;
+
+  /// \~english
+  /// \brief The number of the packets that were too long or broke the state of the parser.
+  /// \~japanese
+  /// \brief 長すぎたかパーサーの状態を壊したパケットの数。
+  size_t framingErrorsCount;
+
+  /// \~english
+  /// \brief The number of the packets whose error detection byte did not match.
+  /// \~japanese
+  /// \brief 誤り検出バイトが一致しなかったパケットの数。
+  size_t checksumFailuresCount;
+
+  /// \~english
+  /// \brief The number of the valid packets that could not be parsed, for each `dcc_AddressClass`.
+  /// \~japanese
+  /// \brief 正しいがパースできなかったパケットの `dcc_AddressClass` ごとの数。
+  size_t unparsedPacketsCounts[DCC_ADDRESS_CLASSES_COUNT];
+
+  /// \~english
+  /// \brief The number of the decoded packets for each `dcc_PacketTag`.
+  /// \~japanese
+  /// \brief デコードされたパケットの `dcc_PacketTag` ごとの数。
+  size_t packetsCounts[DCC_PACKET_TAGS_COUNT];
 };
 
 /// \~english
@@ -880,30 +1448,414 @@ struct dcc_Decoder {
   struct dcc_SignalBuffer signalBuffer;
   struct dcc_SignalStreamParser signalStreamParser;
   struct dcc_BitStreamParser bitStreamParser;
+  struct dcc_DecoderStats stats;
 };
 
 /// \~english
-/// \brief The minimum value of the duration of a half bit of `1` sent.
+/// \brief A structure that holds the state of generating the waveform of a packet.
+///
+/// The bytes are copied so that the generator does not refer to the caller's buffer.
 /// \~japanese
-/// \brief `1` の半ビットの転送継続時間の最小値。
-extern dcc_TimeMicroSec const dcc_minOneHalfBitSentPeriod;
+/// \brief パケットの波形の生成状態を保持する構造体。
+///
+/// 呼び出し元のバッファーを参照しないようにバイト列はコピーして持つ。
+struct dcc_WaveformGenerator {
+  dcc_Byte bytes[DCC_BIT_STREAM_PARSER_BYTES_CAPACITY];
+  size_t bytesSize;
+  size_t preambleBitsCount;
+  /// \~english
+  /// \brief The number of bits including the preamble and the packet end bit.
+  /// \~japanese
+  /// \brief プリアンブルとパケット終了ビットを含むビット数。
+  size_t bitsCount;
+  size_t bitIndex;
+  bool secondHalf;
+};
 
 /// \~english
-/// \brief The maximum value of the duration of a half bit of `1` sent.
+/// \brief The durations of half bits of a whole packet.
 /// \~japanese
-/// \brief `1` の半ビットの転送継続時間の最大値。
-extern dcc_TimeMicroSec const dcc_maxOneHalfBitSentPeriod;
+/// \brief パケット全体の半ビットの継続時間。
+struct dcc_Waveform {
+  dcc_HalfBitPeriod periods[DCC_WAVEFORM_PERIODS_CAPACITY];
+  size_t size;
+};
 
 /// \~english
-/// \brief The minimum value of the acceptable duration of a half bit of `1` received.
+/// \brief An element of `dcc_WaveformCache`.
+///
+/// An entry is identified by the address, the tag and the channel. The channel distinguishes packets of the same
+/// address and tag that are refreshed separately: the group of function group two, the output of analog function and
+/// the state address of binary state control.
+/// \~japanese
+/// \brief `dcc_WaveformCache` の要素。
+///
+/// 要素はアドレスとタグとチャンネルで識別する。チャンネルは同じアドレスとタグで別々に繰り返し送るパケットを区別するもので、機能グループ2のグループ、アナログ機能の出力、
+/// 二値状態制御の状態アドレスである。
+struct dcc_WaveformCacheEntry {
+  bool used;
+  dcc_AddressForExtendedPacket address;
+  enum dcc_PacketTag tag;
+  uint_least16_t channel;
+  dcc_Byte bytes[DCC_BIT_STREAM_PARSER_BYTES_CAPACITY];
+  size_t bytesSize;
+  struct dcc_Waveform waveform;
+};
+
+/// \~english
+/// \brief A cache of the waveforms of packets sent repeatedly.
+/// \~japanese
+/// \brief 繰り返し送るパケットの波形のキャッシュ。
+struct dcc_WaveformCache {
+  struct dcc_WaveformCacheEntry *const entries;
+  size_t const size;
+  size_t preambleBitsCount;
+  size_t hitsCount;
+  size_t missesCount;
+};
+
+/// \~english
+/// \brief The kinds of packets that `dcc_Scheduler` holds for each decoder.
+///
+/// The packets except `dcc_SchedulerSlot_OneShot` are refreshed. The latest packet of each kind replaces the older one,
+/// so only the last binary state control of a decoder is refreshed. The other packets such as reset or consist control
+/// are only sent the number of repeats.
+/// \~japanese
+/// \brief `dcc_Scheduler` がデコーダーごとに保持するパケットの種類。
+///
+/// `dcc_SchedulerSlot_OneShot` 以外のパケットは巡回して送る。各種類の最新のパケットが古いものを置き換えるので、二値状態制御はデコーダーごとに最後のもののみを巡回する。
+/// リセットや編成制御などその他のパケットは繰り返し回数だけ送る。
+enum dcc_SchedulerSlot {
+  dcc_SchedulerSlot_Speed,
+  dcc_SchedulerSlot_FunctionGroup1,
+  dcc_SchedulerSlot_FunctionGroup2F5F8,
+  dcc_SchedulerSlot_FunctionGroup2F9F12,
+  dcc_SchedulerSlot_FunctionControlF13F20,
+  dcc_SchedulerSlot_FunctionControlF21F28,
+  dcc_SchedulerSlot_BinaryState,
+  dcc_SchedulerSlot_OneShot,
+  dcc_SchedulerSlotsCount,
+};
+
+/// \~english
+/// \brief A packet held by `dcc_Scheduler`.
+/// \~japanese
+/// \brief `dcc_Scheduler` が保持するパケット。
+struct dcc_SchedulerEntry {
+  struct dcc_Packet packet;
+  dcc_Byte bytes[DCC_BIT_STREAM_PARSER_BYTES_CAPACITY];
+  size_t bytesSize;
+  bool exists;
+  /// \~english
+  /// \brief Whether it is in the refresh ring.
+  /// \~japanese
+  /// \brief 巡回の輪に入っているかどうか。
+  bool refreshed;
+  /// \~english
+  /// \brief Whether it is in the queue of changed packets.
+  /// \~japanese
+  /// \brief 変更されたパケットの待ち行列に入っているかどうか。
+  bool queued;
+  /// \~english
+  /// \brief The remaining number of times to send it with priority.
+  /// \~japanese
+  /// \brief 優先して送る残りの回数。
+  uint_least8_t repeatsCount;
+  size_t queueNext;
+  size_t refreshNext;
+  size_t refreshPrev;
+};
+
+/// \~english
+/// \brief The packets of a decoder held by `dcc_Scheduler`.
+/// \~japanese
+/// \brief `dcc_Scheduler` が保持するデコーダーのパケット。
+struct dcc_SchedulerDecoder {
+  bool used;
+  /// \~english
+  /// \brief Whether it was released, so the lookup of an address continues past it.
+  /// \~japanese
+  /// \brief 解放されたかどうか。アドレスの検索はこの先も続ける。
+  bool deleted;
+  dcc_AddressForExtendedPacket address;
+  struct dcc_SchedulerEntry entries[dcc_SchedulerSlotsCount];
+};
+
+/// \~english
+/// \brief A structure that decides the order of packets sent by a command station.
+///
+/// Changed packets are kept in a queue and the refreshed packets are kept in a ring, both linked through the entries,
+/// so every operation takes constant time except finding a decoder by its address, which is a hash table lookup.
+/// \~japanese
+/// \brief コマンドステーションが送るパケットの順序を決める構造体。
+///
+/// 変更されたパケットは待ち行列に、巡回するパケットは輪に、いずれも要素をつないで保持するので、アドレスからデコーダーを探すハッシュ表の検索を除いてすべての操作は定数時間である。
+struct dcc_Scheduler {
+  struct dcc_SchedulerDecoder *const decoders;
+  size_t const decodersSize;
+  uint_least8_t repeatsCount;
+  uint_least8_t maxBackToBackCount;
+  size_t queueHead;
+  size_t queueTail;
+  size_t refreshCursor;
+  dcc_AddressForExtendedPacket lastAddress;
+  bool lastAddressExists;
+  uint_least8_t backToBackCount;
+};
+
+/// \~english
+/// \brief Flags of errors of a `dcc_PacketRecord`.
+/// \~japanese
+/// \brief `dcc_PacketRecord` のエラーのフラグ。
+enum dcc_PacketRecordError {
+  /// \~english
+  /// \brief The checksum does not match. `packet` is not valid.
+  /// \~japanese
+  /// \brief チェックサムが一致しない。`packet` は無効である。
+  dcc_PacketRecordError_Checksum = 1 << 0,
+  /// \~english
+  /// \brief The bytes are not a known kind of packet. `packet` is not valid.
+  /// \~japanese
+  /// \brief バイト列が既知の種類のパケットでない。`packet` は無効である。
+  dcc_PacketRecordError_Unparsed = 1 << 1,
+};
+
+/// \~english
+/// \brief A decoded packet with its raw bytes, the time it was captured and errors.
+/// \~japanese
+/// \brief 生のバイト列、取得した時刻とエラーを伴うデコードしたパケット。
+struct dcc_PacketRecord {
+  /// \~english
+  /// \brief The packet. Valid only when `errors` is `0`.
+  /// \~japanese
+  /// \brief パケット。`errors` が `0` のときのみ有効。
+  struct dcc_Packet packet;
+  /// \~english
+  /// \brief The raw bytes including the checksum.
+  /// \~japanese
+  /// \brief チェックサムを含む生のバイト列。
+  dcc_Byte bytes[DCC_BIT_STREAM_PARSER_BYTES_CAPACITY];
+  uint_least8_t bytesSize;
+  /// \~english
+  /// \brief The bitwise or of `dcc_PacketRecordError`.
+  /// \~japanese
+  /// \brief `dcc_PacketRecordError` のビットごとの論理和。
+  uint_least8_t errors;
+  /// \~english
+  /// \brief The time of the end of the packet.
+  /// \~japanese
+  /// \brief パケットの終わりの時刻。
+  dcc_TimeMicroSec time;
+};
+
+/// \~english
+/// \brief A queue that hands `dcc_PacketRecord` from a decoder to any number of consumers.
+///
+/// It is a lock-free ring buffer for a single producer and readers of `dcc_PacketQueueReader`. Each reader consumes
+/// the whole stream at its own pace. The producer never waits for readers: when a reader falls behind by more than
+/// `size` records, the oldest records are overwritten and the reader counts them as lost. `writeCount` is the number
+/// of records published and `claimCount` the number of records the producer has started to write, so a reader can
+/// detect a record overwritten while it copies it.
+/// \~japanese
+/// \brief デコーダーから任意の数の消費側に `dcc_PacketRecord` を渡すキュー。
+///
+/// 単一の書き込み側と `dcc_PacketQueueReader` の読み出し側のためのロックフリーなリングバッファーである。それぞれの読み出し側は自分の速さで流れ全体を消費する。
+/// 書き込み側は読み出し側を待たない。読み出し側が `size` 個より多く遅れると古い記録は上書きされ、読み出し側はそれを失ったものとして数える。`writeCount`
+/// は公開した記録の数、`claimCount` は書き込み側が書き込みを始めた記録の数なので、読み出し側はコピー中に上書きされた記録を検出できる。
+struct dcc_PacketQueue {
+  struct dcc_PacketRecord *const records;
+  /// \~english
+  /// \brief The capacity of `records`. It is a power of two.
+  /// \~japanese
+  /// \brief `records` の容量。2の冪である。
+  size_t const size;
+  size_t claimCount;
+  size_t writeCount;
+};
+
+/// \~english
+/// \brief A structure that holds the position of a consumer of a `dcc_PacketQueue`.
+///
+/// Each consumer has its own reader, which is used only by that consumer.
+/// \~japanese
+/// \brief `dcc_PacketQueue` の消費側の位置を保持する構造体。
+///
+/// 消費側ごとに読み出し側を持ち、その消費側だけが使う。
+struct dcc_PacketQueueReader {
+  struct dcc_PacketQueue const *queue;
+  size_t readCount;
+  /// \~english
+  /// \brief The number of records overwritten before they were read.
+  /// \~japanese
+  /// \brief 読む前に上書きされた記録の数。
+  size_t lostCount;
+};
+
+/// \~english
+/// \brief A structure that holds the state of a binary packet log, which encodes `dcc_PacketRecord` compactly.
+///
+/// A frame of the log is a record encoded with COBS between two `DCC_PACKET_LOG_FRAME_MARKER`s, so the marker never
+/// appears inside a frame and a reader can resynchronize at the next marker after a broken frame. A record consists of
+/// a header, the time in unsigned LEB128 and the raw bytes. The header is the `dcc_PacketTag` of the packet when it has
+/// no errors, otherwise the bitwise or of `0x80` and the errors. The time is the absolute time when the header has
+/// `0x40`, otherwise the time elapsed since the previous record. The writer writes the absolute time in the first record
+/// and every `DCC_PACKET_LOG_ABSOLUTE_TIME_INTERVAL` records, and the times after a broken frame are correct again from
+/// there. The checksum is omitted from the raw bytes of a packet without errors. Text that contains no null characters
+/// can be interleaved between frames. The writer and the reader each keep a `dcc_PacketLog` to track the time.
+/// \~japanese
+/// \brief `dcc_PacketRecord` を小さく符号化するバイナリーのパケットログの状態を保持する構造体。
+///
+/// ログのフレームは COBS で符号化した記録を2つの `DCC_PACKET_LOG_FRAME_MARKER` で挟んだもので、フレームの中に区切りは現れないので、読み出し側は壊れたフレームの後も次の区切りから読み直せる。
+/// 記録は見出し、時刻の符号なし LEB128 と生のバイト列からなる。見出しはエラーのないパケットならその `dcc_PacketTag`、そうでなければ `0x80` とエラーの論理和である。
+/// 見出しに `0x40` があれば時刻は絶対時刻、なければ直前の記録からの経過時間である。書き込み側は最初と `DCC_PACKET_LOG_ABSOLUTE_TIME_INTERVAL` 個ごとの記録に絶対時刻を書き込み、壊れたフレームの後の時刻はそこから正しくなる。
+/// エラーのないパケットの生のバイト列からはチェックサムを省く。
+/// フレームの間にはヌル文字を含まないテキストを挟んでもよい。書き込み側と読み出し側はそれぞれ `dcc_PacketLog` を持って時刻を追う。
+struct dcc_PacketLog {
+  /// \~english
+  /// \brief The time of the previous record.
+  /// \~japanese
+  /// \brief 直前の記録の時刻。
+  dcc_TimeMicroSec time;
+  /// \~english
+  /// \brief The number of records the writer has written since the previous absolute time.
+  /// \~japanese
+  /// \brief 書き込み側が直前の絶対時刻から書き込んだ記録の数。
+  unsigned int relativeRecordsCount;
+};
+
+/// \~english
+/// \brief An argument of a log recorded without formatting.
+/// \~japanese
+/// \brief 整形せずに記録したログの引数。
+union dcc_DeferredLogArg {
+  intmax_t signedValue;
+  uintmax_t unsignedValue;
+  double doubleValue;
+  void const *pointer;
+};
+
+/// \~english
+/// \brief A log recorded without formatting.
+/// \~japanese
+/// \brief 整形せずに記録したログ。
+struct dcc_DeferredLogEntry {
+  /// \~english
+  /// \brief One more than the number of the claim that wrote this entry, which tells the reader it is complete.
+  /// \~japanese
+  /// \brief この要素を書き込んだ確保の番号に1を足した値で、読み出し側に書き込みが終わったことを伝える。
+  size_t sequence;
+  char const *file;
+  int line;
+  char const *func;
+  /// \~english
+  /// \brief The format string. It is kept as a pointer, so it must be a string literal.
+  /// \~japanese
+  /// \brief 書式文字列。ポインターのまま保持するので文字列リテラルでなければならない。
+  char const *format;
+  uint_least8_t argsCount;
+  union dcc_DeferredLogArg args[DCC_DEFERRED_LOG_ARGS_CAPACITY];
+};
+
+/// \~english
+/// \brief A ring buffer of logs whose formatting is deferred to a reader.
+///
+/// Writers are `dcc_deferLog` called from any tasks or interrupts, and record the format string pointer and the raw
+/// arguments without waiting. When the ring is full, new logs are dropped and counted in `lostCount`. The single
+/// reader takes logs with `dcc_popDeferredLog` and formats them with `dcc_formatDeferredLog`, e.g. on a task with a
+/// low priority.
+/// \~japanese
+/// \brief 整形を読み出し側に遅らせるログのリングバッファー。
+///
+/// 書き込み側は任意のタスクや割り込みから呼び出される `dcc_deferLog` で、待つことなく書式文字列へのポインターと生の引数を記録する。リングがいっぱいなら新しいログは捨てて
+/// `lostCount` に数える。単一の読み出し側が `dcc_popDeferredLog` でログを取り出し、例えば優先度の低いタスクで `dcc_formatDeferredLog` で整形する。
+struct dcc_DeferredLog {
+  struct dcc_DeferredLogEntry *const entries;
+  /// \~english
+  /// \brief The capacity of `entries`. It is a power of two.
+  /// \~japanese
+  /// \brief `entries` の容量。2の冪である。
+  size_t const size;
+  size_t claimCount;
+  size_t readCount;
+  size_t lostCount;
+};
+
+/// \~english
+/// \brief The receive timing of `DCC_STRICT_RECEIVE_TIMING`, which is the same as the NMRA standard.
+/// \~japanese
+/// \brief `DCC_STRICT_RECEIVE_TIMING` の受信のタイミングで、NMRA の規格と同じである。
+extern struct dcc_ReceiveTiming const dcc_strictReceiveTiming;
+
+/// \~english
+/// \brief The receive timing of `DCC_TOLERANT_RECEIVE_TIMING`.
+/// \~japanese
+/// \brief `DCC_TOLERANT_RECEIVE_TIMING` の受信のタイミング。
+extern struct dcc_ReceiveTiming const dcc_tolerantReceiveTiming;
+
+/// \~english
+/// \brief The receive timing of `DCC_DEFAULT_RECEIVE_TIMING` the library was built with.
+/// \~japanese
+/// \brief ライブラリーのビルドに使った `DCC_DEFAULT_RECEIVE_TIMING` の受信のタイミング。
+extern struct dcc_ReceiveTiming const dcc_defaultReceiveTiming;
+
+/// \~english
+/// \brief To check that a custom receive timing can be used.
+/// \return Failure if a range is empty, the range of `1` is not below the range of `0` or a value is too large for
+/// 32-bit arithmetic.
+/// \~japanese
+/// \brief 独自の受信のタイミングが使えることを確かめる。
+/// \return 範囲が空であるか、`1` の範囲が `0` の範囲より下にないか、値が 32 ビットの計算に大きすぎれば失敗。
+enum dcc_Result dcc_validateReceiveTiming(struct dcc_ReceiveTiming const *const timing);
+
+/// \~english
+/// \brief To initialize the adaptive clock recovery that learns around a receive timing.
+/// \param base A receive timing that passes `dcc_validateReceiveTiming`.
+/// \~japanese
+/// \brief 受信のタイミングを基準に学習する適応的なクロック再生を初期化する。
+/// \param base `dcc_validateReceiveTiming` を満たす受信のタイミング。
+struct dcc_ClockRecovery dcc_initializeClockRecovery(struct dcc_ReceiveTiming const *const base);
+
+/// \~english
+/// \brief To make a parser judge half bits with the adaptive clock recovery.
+///
+/// It sets `clockRecovery` and points `receiveTiming` at the learned timing. `NULL` detaches it and restores the
+/// default timing. It can be called between bits.
+/// \~japanese
+/// \brief パーサーに適応的なクロック再生で半ビットを判定させる。
+///
+/// `clockRecovery` を設定し、`receiveTiming` を学習したタイミングに向ける。`NULL` なら取り外し、既定のタイミングに戻す。ビットの間で呼び出せる。
+void dcc_attachClockRecovery(struct dcc_SignalStreamParser *const parser, struct dcc_ClockRecovery *const recovery);
+
+/// \~english
+/// \brief The minimum value of the duration of a half bit of `1` sent.
+/// \~japanese
+/// \brief `1` の半ビットの転送継続時間の最小値。
+extern dcc_TimeMicroSec const dcc_minOneHalfBitSentPeriod;
+
+/// \~english
+/// \brief The maximum value of the duration of a half bit of `1` sent.
+/// \~japanese
+/// \brief `1` の半ビットの転送継続時間の最大値。
+extern dcc_TimeMicroSec const dcc_maxOneHalfBitSentPeriod;
+
+/// \~english
+/// \brief The minimum value of the acceptable duration of a half bit of `1` received.
+///
+/// The strict NMRA value. Decoders judge with `dcc_ReceiveTiming` instead.
 /// \~japanese
 /// \brief 受信した `1` の半ビットの許容時間の最小値。
+///
+/// NMRA の厳密な値。デコーダーは代わりに `dcc_ReceiveTiming` で判定する。
 extern dcc_TimeMicroSec const dcc_minOneHalfBitReceivedPeriod;
 
 /// \~english
 /// \brief The maximum value of the acceptable duration of a half bit of `1` received.
+///
+/// The strict NMRA value. Decoders judge with `dcc_ReceiveTiming` instead.
 /// \~japanese
 /// \brief 受信した `1` の半ビットの許容時間の最大値。
+///
+/// NMRA の厳密な値。デコーダーは代わりに `dcc_ReceiveTiming` で判定する。
 extern dcc_TimeMicroSec const dcc_maxOneHalfBitReceivedPeriod;
 
 /// \~english
@@ -920,20 +1872,32 @@ extern dcc_TimeMicroSec const dcc_maxZeroHalfBitSentPeriod;
 
 /// \~english
 /// \brief The maximum value of the total duration of stretched `0` bits.
+///
+/// The strict NMRA value. Decoders judge with `dcc_ReceiveTiming` instead.
 /// \~japanese
 /// \brief 引き伸ばされた `0` ビットの総和継続時間の最大値。
+///
+/// NMRA の厳密な値。デコーダーは代わりに `dcc_ReceiveTiming` で判定する。
 extern dcc_TimeMicroSec const dcc_maxStretchedZeroBitPeriod;
 
 /// \~english
 /// \brief The minimum value of the acceptable duration of a half bit of `0` received.
+///
+/// The strict NMRA value. Decoders judge with `dcc_ReceiveTiming` instead.
 /// \~japanese
 /// \brief 受信した `0` の半ビットの許容時間の最小値。
+///
+/// NMRA の厳密な値。デコーダーは代わりに `dcc_ReceiveTiming` で判定する。
 extern dcc_TimeMicroSec const dcc_minZeroHalfBitReceivedPeriod;
 
 /// \~english
 /// \brief The maximum value of the acceptable duration of a half bit of `0` received.
+///
+/// The strict NMRA value. Decoders judge with `dcc_ReceiveTiming` instead.
 /// \~japanese
 /// \brief 受信した `0` の半ビットの許容時間の最大値。
+///
+/// NMRA の厳密な値。デコーダーは代わりに `dcc_ReceiveTiming` で判定する。
 extern dcc_TimeMicroSec const dcc_maxZeroHalfBitReceivedPeriod;
 
 /// \~english
@@ -944,17 +1908,37 @@ extern dcc_TimeMicroSec const dcc_maxOneHalfBitSentPeriodDiff;
 
 /// \~english
 /// \brief The maximum value of the difference in the durations of half bits of `1` received.
+///
+/// The strict NMRA value. Decoders judge with `dcc_ReceiveTiming` instead.
 /// \~japanese
 /// \brief 受信した `1` の半ビットの時間の差の最大値。
+///
+/// NMRA の厳密な値。デコーダーは代わりに `dcc_ReceiveTiming` で判定する。
 extern dcc_TimeMicroSec const dcc_maxOneHalfBitReceivedPeriodDiff;
 
+/// \~english
+/// \brief The duration of a half bit of `1` that the generator sends.
+/// \~japanese
+/// \brief 生成器が送る `1` の半ビットの継続時間。
+extern dcc_TimeMicroSec const dcc_nominalOneHalfBitSentPeriod;
+
+/// \~english
+/// \brief The duration of a half bit of `0` that the generator sends.
+/// \~japanese
+/// \brief 生成器が送る `0` の半ビットの継続時間。
+extern dcc_TimeMicroSec const dcc_nominalZeroHalfBitSentPeriod;
+
 /// \~english
 /// \brief To initialize a `SignalBuffer`.
+///
+/// When `size` is not a power of two, only the largest power of two elements not exceeding `size` are used.
 /// \param array A pointer to the array used by the `SignalBuffer`.
 /// \param size The number of elements in `array`.
 /// \return The initialized `SignalBuffer`.
 /// \~japanese
 /// \brief `dcc_SignalBuffer` を初期化する。
+///
+/// `size` が2の冪でない場合は `size` を超えない最大の2の冪の数の要素のみを使う。
 /// \param array `dcc_SignalBuffer` が使う配列へのポインター。
 /// \param size `array` の要素数。
 /// \return 初期化された `dcc_SignalBuffer`
@@ -963,7 +1947,7 @@ struct dcc_SignalBuffer dcc_initializeSignalBuffer(dcc_TimeMicroSec *array, size
 /// \~english
 /// \brief To write the time of a voltage change to a `dcc_SignalBuffer`.
 ///
-/// It is expected to be called within an interrupt handler.
+/// It is expected to be called within an interrupt handler. Only one context may write to the same buffer.
 ///
 /// \param buffer The `dcc_SignalBuffer` to write to.
 /// \param signal The time of the voltage change.
@@ -971,7 +1955,7 @@ struct dcc_SignalBuffer dcc_initializeSignalBuffer(dcc_TimeMicroSec *array, size
 /// \~japanese
 /// \brief 電圧変化の時刻を `dcc_SignalBuffer` に書き込む。
 ///
-/// 割り込みハンドラー内で呼び出すことが想定される。
+/// 割り込みハンドラー内で呼び出すことが想定される。同じバッファーに書き込むのは1つのコンテキストのみでなければならない。
 ///
 /// \param buffer 書き込み先の `dcc_SignalBuffer`。
 /// \param signal 電圧変化の時刻。
@@ -980,16 +1964,123 @@ enum dcc_Result dcc_writeSignalBuffer(struct dcc_SignalBuffer *const buffer, dcc
 
 /// \~english
 /// \brief To read the time of a voltage change written to a `dcc_SignalBuffer`.
+///
+/// It may run concurrently with `dcc_writeSignalBuffer`. Only one context may read from the same buffer.
 /// \param buffer The `dcc_SignalBuffer` to read from.
 /// \param signal The time of the voltage change read (output). If it fails, the value will not change.
 /// \return Failure if the buffer is empty, otherwise success.
 /// \~japanese
 /// \brief 書き込まれた電圧変化の時刻を読み出す。
+///
+/// `dcc_writeSignalBuffer` と並行に実行してよい。同じバッファーから読み出すのは1つのコンテキストのみでなければならない。
 /// \param buffer 読み出し先の `dcc_SignalBuffer`。
 /// \param signal 読み出された電圧変化の時刻（出力）。失敗した場合は値が変更されない。
 /// \return バッファが空の場合は失敗、それ以外は成功。
 enum dcc_Result dcc_readSignalBuffer(struct dcc_SignalBuffer *const buffer, dcc_TimeMicroSec *const signal);
 
+/// \~english
+/// \brief To get all the times of voltage changes written to a `dcc_SignalBuffer` without copying.
+///
+/// Because the buffer is a ring, they are returned as at most two spans in order. They are not removed from the
+/// buffer until `dcc_releaseSignalBuffer` is called, and they stay valid until then.
+/// \param buffer The `dcc_SignalBuffer` to read from.
+/// \param spans The spans (output). Only the first elements as many as the return value are set.
+/// \return The number of spans, `0`, `1` or `2`.
+/// \~japanese
+/// \brief `dcc_SignalBuffer` に書き込まれた全ての電圧変化の時刻をコピーせずに取得する。
+///
+/// バッファーはリング状なので、最大2つの範囲に分けて順に返される。`dcc_releaseSignalBuffer` が呼ばれるまでバッファーから取り除かれず、それまで有効である。
+/// \param buffer 読み出し先の `dcc_SignalBuffer`。
+/// \param spans 範囲（出力）。戻り値の数だけ先頭から設定される。
+/// \return 範囲の数、`0` か `1` か `2`。
+size_t dcc_readSignalBufferSpans(struct dcc_SignalBuffer *const buffer, struct dcc_SignalSpan spans[2]);
+
+/// \~english
+/// \brief To remove the times of voltage changes obtained by `dcc_readSignalBufferSpans` from a `dcc_SignalBuffer`.
+/// \param buffer The `dcc_SignalBuffer`.
+/// \param size The number of times to remove. It must not exceed the total size of the spans obtained.
+/// \~japanese
+/// \brief `dcc_readSignalBufferSpans` で取得した電圧変化の時刻を `dcc_SignalBuffer` から取り除く。
+/// \param buffer 対象の `dcc_SignalBuffer`。
+/// \param size 取り除く時刻の数。取得した範囲の大きさの合計を超えてはならない。
+void dcc_releaseSignalBuffer(struct dcc_SignalBuffer *const buffer, size_t const size);
+
+/// \~english
+/// \brief To initialize a `dcc_PeriodBuffer`.
+///
+/// When `size` is not a power of two, only the largest power of two elements not exceeding `size` are used.
+/// \param array A pointer to the array used by the `dcc_PeriodBuffer`.
+/// \param size The number of elements in `array`.
+/// \return The initialized `dcc_PeriodBuffer`.
+/// \~japanese
+/// \brief `dcc_PeriodBuffer` を初期化する。
+///
+/// `size` が2の冪でない場合は `size` を超えない最大の2の冪の数の要素のみを使う。
+/// \param array `dcc_PeriodBuffer` が使う配列へのポインター。
+/// \param size `array` の要素数。
+/// \return 初期化された `dcc_PeriodBuffer`。
+struct dcc_PeriodBuffer dcc_initializePeriodBuffer(dcc_HalfBitPeriod *array, size_t const size);
+
+/// \~english
+/// \brief To write the duration of a half bit to a `dcc_PeriodBuffer`.
+///
+/// It is expected to be called within an interrupt handler. The duration is saturated to `DCC_HALF_BIT_PERIOD_MAX`.
+/// \param buffer The `dcc_PeriodBuffer` to write to.
+/// \param period The duration.
+/// \return Failure if there is no space left in the buffer, otherwise success.
+/// \~japanese
+/// \brief 半ビットの継続時間を `dcc_PeriodBuffer` に書き込む。
+///
+/// 割り込みハンドラー内で呼び出すことが想定される。継続時間は `DCC_HALF_BIT_PERIOD_MAX` に飽和させる。
+/// \param buffer 書き込み先の `dcc_PeriodBuffer`。
+/// \param period 継続時間。
+/// \return バッファに空きがない場合は失敗、それ以外は成功。
+enum dcc_Result dcc_writePeriodBuffer(struct dcc_PeriodBuffer *const buffer, dcc_TimeMicroSec const period);
+
+/// \~english
+/// \brief To write the time of a voltage change to a `dcc_PeriodBuffer` as the duration from the previous one.
+///
+/// It is expected to be called within an interrupt handler in place of `dcc_writeSignalBuffer`. The first call only
+/// records the time. When it fails, the time is still recorded, and `DCC_HALF_BIT_PERIOD_MAX` is written before the
+/// next duration as a gap marker once the buffer has space, so the lost change is never folded into a duration.
+/// \param buffer The `dcc_PeriodBuffer` to write to.
+/// \param signal The time of the voltage change.
+/// \return Failure if there is no space left in the buffer, otherwise success.
+/// \~japanese
+/// \brief 電圧変化の時刻を直前の変化からの継続時間として `dcc_PeriodBuffer` に書き込む。
+///
+/// `dcc_writeSignalBuffer` の代わりに割り込みハンドラー内で呼び出すことが想定される。最初の呼び出しでは時刻を記録するのみである。失敗した場合も時刻は記録し、空きができたら次の継続時間の前に途切れの印として `DCC_HALF_BIT_PERIOD_MAX` を書き込むので、失われた変化が継続時間に畳み込まれることはない。
+/// \param buffer 書き込み先の `dcc_PeriodBuffer`。
+/// \param signal 電圧変化の時刻。
+/// \return バッファに空きがない場合は失敗、それ以外は成功。
+enum dcc_Result dcc_writeSignalToPeriodBuffer(struct dcc_PeriodBuffer *const buffer, dcc_TimeMicroSec const signal);
+
+/// \~english
+/// \brief To read the duration of a half bit written to a `dcc_PeriodBuffer`.
+/// \param buffer The `dcc_PeriodBuffer` to read from.
+/// \param period The duration read (output). If it fails, the value will not change.
+/// \return Failure if the buffer is empty, otherwise success.
+/// \~japanese
+/// \brief 書き込まれた半ビットの継続時間を読み出す。
+/// \param buffer 読み出し先の `dcc_PeriodBuffer`。
+/// \param period 読み出された継続時間（出力）。失敗した場合は値が変更されない。
+/// \return バッファが空の場合は失敗、それ以外は成功。
+enum dcc_Result dcc_readPeriodBuffer(struct dcc_PeriodBuffer *const buffer, dcc_HalfBitPeriod *const period);
+
+/// \~english
+/// \brief The same as `dcc_readSignalBufferSpans` but for a `dcc_PeriodBuffer`.
+///
+/// \~japanese
+/// \brief `dcc_PeriodBuffer` 用の `dcc_readSignalBufferSpans`。
+size_t dcc_readPeriodBufferSpans(struct dcc_PeriodBuffer *const buffer, struct dcc_PeriodSpan spans[2]);
+
+/// \~english
+/// \brief The same as `dcc_releaseSignalBuffer` but for a `dcc_PeriodBuffer`.
+///
+/// \~japanese
+/// \brief `dcc_PeriodBuffer` 用の `dcc_releaseSignalBuffer`。
+void dcc_releasePeriodBuffer(struct dcc_PeriodBuffer *const buffer, size_t const size);
+
 /// \~english
 /// \brief To initialize a `dcc_SignalStreamParser`.
 /// \return The initialized `dcc_SignalStreamParser`.
@@ -1013,6 +2104,25 @@ struct dcc_SignalStreamParser dcc_initializeSignalStreamParser(void);
 enum dcc_StreamParserResult dcc_feedSignal(struct dcc_SignalStreamParser *const parser, dcc_TimeMicroSec const signal,
                                            dcc_Bit *const bit);
 
+/// \~english
+/// \brief To input the duration of a half bit to a `dcc_SignalStreamParser` and get a bit.
+///
+/// It is the counterpart of `dcc_feedSignal` for durations. Do not mix them on the same parser.
+/// \param parser The place to store the state.
+/// \param period The duration between voltage changes.
+/// \param bit The bit (output). If it is not successful, the value will not change.
+/// \return Success or failure of the parsing.
+/// \~japanese
+/// \brief `dcc_SignalStreamParser` に半ビットの継続時間を入力し、ビットを取得する。
+///
+/// 継続時間を入力する版の `dcc_feedSignal` である。同じパーサーに対して両者を混ぜて使ってはならない。
+/// \param parser 状態を保持する場所。
+/// \param period 電圧変化の間の継続時間。
+/// \param bit ビット（出力）。成功でない場合は値が変更されない。
+/// \return パースの成否。
+enum dcc_StreamParserResult dcc_feedPeriod(struct dcc_SignalStreamParser *const parser, dcc_TimeMicroSec const period,
+                                           dcc_Bit *const bit);
+
 /// \~english
 /// \brief To initialize a `dcc_BitStreamParser`.
 /// \return The initialized `dcc_BitStreamParser`.
@@ -1042,6 +2152,25 @@ struct dcc_BitStreamParser dcc_initializeBitStreamParser(void);
 enum dcc_StreamParserResult dcc_feedBit(struct dcc_BitStreamParser *const parser, dcc_Bit const bit,
                                         dcc_Byte *const bytes, size_t *const bytesSize);
 
+/// \~english
+/// \brief The same as `dcc_feedBit` but gives a view into the parser's storage instead of copying the bytes.
+///
+/// The view is valid until the next call that feeds `parser`.
+/// \param parser The place to store the state.
+/// \param bit The bit.
+/// \param bytes The view of the bytes (output). If it is not successful, the value will not change.
+/// \return Success or failure of the parsing.
+/// \~japanese
+/// \brief バイトをコピーする代わりにパーサーの記憶域への参照を返す `dcc_feedBit`。
+///
+/// 参照は次に `parser` に入力するまで有効である。
+/// \param parser 状態を保持する場所。
+/// \param bit ビット。
+/// \param bytes バイト列への参照（出力）。成功でない場合は値が変更されない。
+/// \return パースの成否。
+enum dcc_StreamParserResult dcc_feedBitView(struct dcc_BitStreamParser *const parser, dcc_Bit const bit,
+                                            struct dcc_BytesView *const bytes);
+
 enum dcc_Result dcc_parseSpeedAndDirectionPacketForLocomotiveDecoders(
   dcc_Byte const *const bytes, size_t const bytesSize, bool flControl,
   struct dcc_SpeedAndDirectionPacketForLocomotiveDecoders *const packet);
@@ -1060,6 +2189,14 @@ enum dcc_Result dcc_parseHardResetPacketForMultiFunctionDecoders(
   dcc_Byte const *const bytes, size_t const bytesSize,
   struct dcc_HardResetPacketForMultiFunctionDecoders *const packet);
 
+enum dcc_Result dcc_parseDecoderFlagsSetPacketForMultiFunctionDecoders(
+  dcc_Byte const *const bytes, size_t const bytesSize,
+  struct dcc_SetDecoderFlagsPacketForMultiFunctionDecoders *const packet);
+
+enum dcc_Result dcc_parseSetAdvancedAddressingPacketForMultiFunctionDecoders(
+  dcc_Byte const *const bytes, size_t const bytesSize,
+  struct dcc_SetExtendedAddressingPacketForMultiFunctionDecoders *const packet);
+
 enum dcc_Result dcc_parseDecoderAcknowledgementRequestPacket(
   dcc_Byte const *const bytes, size_t const bytesSize,
   struct dcc_DecoderAcknowledgementRequestPacketForMultiFunctionDecoders *const packet);
@@ -1075,6 +2212,38 @@ enum dcc_Result dcc_parseSpeedStep128ControlPacket(
   dcc_Byte const *const bytes, size_t const bytesSize,
   struct dcc_SpeedStep128ControlPacketForMultiFunctionDecoders *const packet);
 
+enum dcc_Result dcc_parseRestrictedSpeedStepPacketForMultiFunctionDecoders(
+  dcc_Byte const *const bytes, size_t const bytesSize, bool flControl,
+  struct dcc_RestrictedSpeedStepPacketForMultiFunctionDecoders *const packet);
+
+enum dcc_Result dcc_parseAnalogFunctionPacketForMultiFunctionDecoders(
+  dcc_Byte const *const bytes, size_t const bytesSize,
+  struct dcc_AnalogFunctionPacketForMultiFunctionDecoders *const packet);
+
+enum dcc_Result dcc_parseSpeedAndDirectionPacketForMultiFunctionDecoders(
+  dcc_Byte const *const bytes, size_t const bytesSize, bool flControl,
+  struct dcc_SpeedAndDirectionPacketForMultiFunctionDecoders *const packet);
+
+enum dcc_Result dcc_parseFunctionGroup1PacketForMultiFunctionDecoders(
+  dcc_Byte const *const bytes, size_t const bytesSize, bool flControl,
+  struct dcc_FunctionGroup1PacketForMultiFunctionDecoders *const packet);
+
+enum dcc_Result dcc_parseFunctionGroup2PacketForMultiFunctionDecoders(
+  dcc_Byte const *const bytes, size_t const bytesSize,
+  struct dcc_FunctionGroup2PacketForMultiFunctionDecoders *const packet);
+
+enum dcc_Result dcc_parseBinaryStateControlLongFormPacket(dcc_Byte const *const bytes, size_t const bytesSize,
+                                                          struct dcc_BinaryStateControlLongFormPacket *const packet);
+
+enum dcc_Result dcc_parseBinaryStateControlShortFormPacket(dcc_Byte const *const bytes, size_t const bytesSize,
+                                                           struct dcc_BinaryStateControlShortFormPacket *const packet);
+
+enum dcc_Result dcc_parseFunctionControlF13F20Packet(dcc_Byte const *const bytes, size_t const bytesSize,
+                                                     struct dcc_FunctionControlF13F20Packet *const packet);
+
+enum dcc_Result dcc_parseFunctionControlF21F28Packet(dcc_Byte const *const bytes, size_t const bytesSize,
+                                                     struct dcc_FunctionControlF21F28Packet *const packet);
+
 enum dcc_Result dcc_parsePacket(dcc_Byte const *const bytes, size_t const bytesSize, struct dcc_Packet *const packet);
 
 /// \~english
@@ -1089,6 +2258,63 @@ enum dcc_Result dcc_parsePacket(dcc_Byte const *const bytes, size_t const bytesS
 /// \return 初期化された `dcc_Decoder`。
 struct dcc_Decoder dcc_initializeDecoder(dcc_TimeMicroSec *signalBufferValues, size_t const signalBufferSize);
 
+/// \~english
+/// \brief To classify the first byte of a packet.
+/// \param first The first byte of a packet.
+/// \return The class of the address.
+/// \~japanese
+/// \brief パケットの先頭バイトを区分する。
+/// \param first パケットの先頭バイト。
+/// \return アドレスの区分。
+enum dcc_AddressClass dcc_classifyAddress(dcc_Byte const first);
+
+/// \~english
+/// \brief To get a snapshot of the statistics of a decoder.
+///
+/// It can be called from a thread other than the one that runs the decoder.
+/// Each count is read without tearing, but the counts may be from slightly different moments.
+/// \param decoder The decoder.
+/// \return The copy of the statistics.
+/// \~japanese
+/// \brief デコーダーの統計のスナップショットを取得する。
+///
+/// デコーダーを動かすスレッド以外からも呼び出せる。
+/// 各回数は壊れずに読み出されるが、回数どうしはわずかに異なる時点のものであることがある。
+/// \param decoder デコーダー。
+/// \return 統計のコピー。
+struct dcc_DecoderStats dcc_getDecoderStats(struct dcc_Decoder const *const decoder);
+
+/// \~english
+/// \brief To reset the statistics of a decoder to zero.
+///
+/// It must be called from the thread that runs the decoder.
+/// Other threads should take the difference of snapshots with `dcc_subtractDecoderStats` instead.
+/// \param decoder The decoder.
+/// \~japanese
+/// \brief デコーダーの統計を 0 に戻す。
+///
+/// デコーダーを動かすスレッドから呼び出さなければならない。
+/// 他のスレッドは代わりに `dcc_subtractDecoderStats` でスナップショットの差を取る。
+/// \param decoder デコーダー。
+void dcc_resetDecoderStats(struct dcc_Decoder *const decoder);
+
+/// \~english
+/// \brief To get the counts between two snapshots of the statistics.
+///
+/// The counts wrap around like `size_t`, so the difference is correct even if a count overflows once.
+/// \param until The later snapshot.
+/// \param since The earlier snapshot.
+/// \return `until` minus `since` for each count.
+/// \~japanese
+/// \brief 統計の2つのスナップショットの間の回数を取得する。
+///
+/// 回数は `size_t` として一周するので、回数が一度桁あふれしても差は正しい。
+/// \param until 後のスナップショット。
+/// \param since 前のスナップショット。
+/// \return 回数ごとの `until` から `since` を引いた値。
+struct dcc_DecoderStats dcc_subtractDecoderStats(struct dcc_DecoderStats const *const until,
+                                                 struct dcc_DecoderStats const *const since);
+
 /// \~english
 /// \brief A function that serves as the main interface when used as a decoder.
 /// \param decoder A place to store the state.
@@ -1104,10 +2330,466 @@ struct dcc_Decoder dcc_initializeDecoder(dcc_TimeMicroSec *signalBufferValues, s
 enum dcc_StreamParserResult dcc_decode(struct dcc_Decoder *const decoder, dcc_TimeMicroSec const signal,
                                        struct dcc_Packet *const packet);
 
+/// \~english
+/// \brief The same as `dcc_decode` but also gives the raw bytes of the packet including the checksum.
+///
+/// The bytes are not copied. The view points into `decoder` and is valid until the next call that feeds `decoder`.
+/// \param decoder A place to store the state.
+/// \param signal The time at which the line voltage changes.
+/// \param packet The decoded packet (output).
+/// \param bytes The view of the raw bytes (output). It is set when the bytes are framed even if the packet cannot be
+/// parsed, so that a failed packet can be logged.
+/// \return Success or failure of the decoding.
+/// \~japanese
+/// \brief チェックサムを含むパケットの生のバイト列も返す `dcc_decode`。
+///
+/// バイト列はコピーしない。参照は `decoder` 内を指し、次に `decoder` に入力するまで有効である。
+/// \param decoder 状態を保持する場所。
+/// \param signal 線路電圧の変化した時刻。
+/// \param packet デコードされたパケット（出力）。
+/// \param bytes 生のバイト列への参照（出力）。パケットをパースできなかった場合も記録できるように、バイト列が揃った時点で設定される。
+/// \return デコードの成否。
+enum dcc_StreamParserResult dcc_decodeView(struct dcc_Decoder *const decoder, dcc_TimeMicroSec const signal,
+                                           struct dcc_Packet *const packet, struct dcc_BytesView *const bytes);
+
+/// \~english
+/// \brief To decode a sequence of times of voltage changes at once.
+///
+/// It is equivalent to calling `dcc_decode` for each signal and collecting the successful packets, but avoids the
+/// per-signal overhead. It stops when `packets` becomes full. When `packetsSize` is `0`, it consumes all the signals and
+/// discards the packets, so a caller that loops until the input is consumed always terminates.
+/// \param decoder A place to store the state.
+/// \param signals The times at which the line voltage changes.
+/// \param signalsSize The number of elements in `signals`.
+/// \param packets The decoded packets (output).
+/// \param packetsSize The number of elements in `packets`.
+/// \param packetsCount The number of decoded packets (output).
+/// \return The number of signals consumed.
+/// \~japanese
+/// \brief 電圧変化の時刻の列をまとめてデコードする。
+///
+/// 各信号について `dcc_decode` を呼び出し成功したパケットを集めるのと同等だが、信号ごとのオーバーヘッドがない。`packets` がいっぱいになると停止する。
+/// `packetsSize` が `0` なら信号をすべて消費してパケットを捨てるので、入力を消費し終えるまで繰り返す呼び出し側も必ず終わる。
+/// \param decoder 状態を保持する場所。
+/// \param signals 線路電圧の変化した時刻の列。
+/// \param signalsSize `signals` の要素数。
+/// \param packets デコードされたパケット（出力）。
+/// \param packetsSize `packets` の要素数。
+/// \param packetsCount デコードされたパケットの数（出力）。
+/// \return 消費した信号の数。
+size_t dcc_decodeBatch(struct dcc_Decoder *const decoder, dcc_TimeMicroSec const *const signals,
+                       size_t const signalsSize, struct dcc_Packet *const packets, size_t const packetsSize,
+                       size_t *const packetsCount);
+
+/// \~english
+/// \brief The same as `dcc_decode` but takes the duration of a half bit instead of the time of a voltage change.
+///
+/// \~japanese
+/// \brief 電圧変化の時刻の代わりに半ビットの継続時間を受け取る `dcc_decode`。
+enum dcc_StreamParserResult dcc_decodePeriod(struct dcc_Decoder *const decoder, dcc_TimeMicroSec const period,
+                                             struct dcc_Packet *const packet);
+
+/// \~english
+/// \brief The same as `dcc_decodeView` but takes the duration of a half bit instead of the time of a voltage change.
+///
+/// \~japanese
+/// \brief 電圧変化の時刻の代わりに半ビットの継続時間を受け取る `dcc_decodeView`。
+enum dcc_StreamParserResult dcc_decodePeriodView(struct dcc_Decoder *const decoder, dcc_TimeMicroSec const period,
+                                                 struct dcc_Packet *const packet, struct dcc_BytesView *const bytes);
+
+/// \~english
+/// \brief The same as `dcc_decodeBatch` but takes the durations of half bits instead of the times of voltage changes.
+///
+/// \~japanese
+/// \brief 電圧変化の時刻の代わりに半ビットの継続時間を受け取る `dcc_decodeBatch`。
+size_t dcc_decodePeriodBatch(struct dcc_Decoder *const decoder, dcc_HalfBitPeriod const *const periods,
+                             size_t const periodsSize, struct dcc_Packet *const packets, size_t const packetsSize,
+                             size_t *const packetsCount);
+
+/// \~english
+/// \brief To decode the times of voltage changes into bits in bulk.
+///
+/// It is for offline analysis of long captures. The result is the same as calling `dcc_feedSignal` for each signal
+/// and collecting the bits, but the durations are computed and classified per block with SIMD instructions where
+/// available (SSE2 or AVX2 on x86, chosen at run time).
+///
+/// The bits are packed from the most significant bit: the `i`-th bit is `bits[i / 32] >> (31 - i % 32) & 1`.
+/// It stops when `bitsCapacity` bits are written.
+/// \param parser The place to store the state. It can be used with `dcc_feedSignal` before and after.
+/// \param signals The times of voltage changes.
+/// \param signalsSize The number of elements in `signals`.
+/// \param bits The bits (output). It needs `(bitsCapacity + 31) / 32` elements.
+/// \param bitsCapacity The maximum number of bits to write.
+/// \param bitsSize The number of bits written (output).
+/// \return The number of signals consumed.
+/// \~japanese
+/// \brief 電圧変化の時刻の列をまとめてビットの列にデコードする。
+///
+/// 長時間の記録をあとから解析するためのものである。結果は信号ごとに `dcc_feedSignal` を呼んでビットを集めたものと同じだが、継続時間の計算と分類を塊ごとに、使える場合は SIMD
+/// 命令（x86 では SSE2 または AVX2 を実行時に選択する）で行う。
+///
+/// ビットは最上位ビットから詰める。`i` 番目のビットは `bits[i / 32] >> (31 - i % 32) & 1` である。`bitsCapacity` 個のビットを書き込むと止まる。
+/// \param parser 状態を保持する場所。前後で `dcc_feedSignal` と併用できる。
+/// \param signals 電圧変化の時刻の列。
+/// \param signalsSize `signals` の要素数。
+/// \param bits ビットの列（出力）。`(bitsCapacity + 31) / 32` 個の要素が必要。
+/// \param bitsCapacity 書き込むビットの最大数。
+/// \param bitsSize 書き込んだビットの数（出力）。
+/// \return 消費した信号の数。
+size_t dcc_decodeSignalsToBits(struct dcc_SignalStreamParser *const parser, dcc_TimeMicroSec const *const signals,
+                               size_t const signalsSize, uint32_t *const bits, size_t const bitsCapacity,
+                               size_t *const bitsSize);
+
+/// \~english
+/// \brief To input packed bits to a `dcc_BitStreamParser` and get the bytes of a packet.
+///
+/// It is the bulk counterpart of `dcc_feedBit` for the output of `dcc_decodeSignalsToBits`. The preamble is skipped by
+/// counting leading ones of a 64-bit window, and each data byte is taken together with its following bit by shifts.
+/// The result is the same as feeding the bits one by one to `dcc_feedBit`, except that failures are not reported: the
+/// parser is initialized and the parsing continues. It stops right after the end bit of a packet.
+/// \param parser The place to store the state. It can be used with `dcc_feedBit` before and after.
+/// \param bits The bits packed from the most significant bit.
+/// \param position The index of the first bit to read (input) and the index of the next bit to read (output).
+/// \param bitsSize The number of bits in `bits`.
+/// \param bytes The bytes of the packet (output). It needs `DCC_BIT_STREAM_PARSER_BYTES_CAPACITY` elements. If it is
+/// not successful, the value will not change.
+/// \param bytesSize The number of bytes of the packet (output). If it is not successful, the value will not change.
+/// \return `dcc_StreamParserResult_Success` if a packet is found, otherwise `dcc_StreamParserResult_Continue`.
+/// \~japanese
+/// \brief `dcc_BitStreamParser` に詰められたビットの列を入力し、パケットのバイトを取得する。
+///
+/// `dcc_decodeSignalsToBits` の出力に対する `dcc_feedBit` のまとめて処理する版である。プリアンブルは64ビットの窓の先頭の `1` の数を数えて読み飛ばし、
+/// データバイトは後続のビットとともにシフトで取り出す。結果はビットを1つずつ `dcc_feedBit` に入力したものと同じだが、失敗は報告せず、パーサーを初期化してパースを続ける。
+/// パケットの終了ビットの直後で止まる。
+/// \param parser 状態を保持する場所。前後で `dcc_feedBit` と併用できる。
+/// \param bits 最上位ビットから詰められたビットの列。
+/// \param position 最初に読むビットの位置（入力）と次に読むビットの位置（出力）。
+/// \param bitsSize `bits` のビット数。
+/// \param bytes パケットのバイト（出力）。`DCC_BIT_STREAM_PARSER_BYTES_CAPACITY` 個の要素が必要。成功でない場合は値が変更されない。
+/// \param bytesSize パケットのバイト数（出力）。成功でない場合は値が変更されない。
+/// \return パケットが見つかった場合は `dcc_StreamParserResult_Success`、それ以外は `dcc_StreamParserResult_Continue`。
+enum dcc_StreamParserResult dcc_feedBits(struct dcc_BitStreamParser *const parser, uint32_t const *const bits,
+                                         size_t *const position, size_t const bitsSize, dcc_Byte *const bytes,
+                                         size_t *const bytesSize);
+
+/// \~english
+/// \brief To serialize a packet into bytes.
+///
+/// It is the inverse of `dcc_parsePacket`. A multi-function decoder address less than 128 is written in one byte and
+/// otherwise in two bytes.
+/// \param packet The packet.
+/// \param bytes The bytes of the packet including the checksum (output). It needs
+/// `DCC_BIT_STREAM_PARSER_BYTES_CAPACITY` elements. If it is not successful, the value will not change.
+/// \param bytesSize The number of bytes (output). If it is not successful, the value will not change.
+/// \return Failure if a field is out of the range that the packet can represent.
+/// \~japanese
+/// \brief パケットをバイト列にする。
+///
+/// `dcc_parsePacket` の逆である。多機能デコーダーのアドレスは 128 未満なら 1 バイト、それ以外は 2 バイトで書く。
+/// \param packet パケット。
+/// \param bytes チェックサムを含むパケットのバイト列（出力）。`DCC_BIT_STREAM_PARSER_BYTES_CAPACITY` 個の要素が必要。成功でない場合は値が変更されない。
+/// \param bytesSize バイト数（出力）。成功でない場合は値が変更されない。
+/// \return フィールドがパケットで表せる範囲外のとき失敗。
+enum dcc_Result dcc_encodePacket(struct dcc_Packet const packet, dcc_Byte *const bytes, size_t *const bytesSize);
+
+/// \~english
+/// \brief To initialize a `dcc_WaveformGenerator`.
+/// \param bytes The bytes of the packet including the checksum.
+/// \param bytesSize The number of bytes. It must be at most `DCC_BIT_STREAM_PARSER_BYTES_CAPACITY`.
+/// \param preambleBitsCount The number of `1` bits of the preamble, usually `DCC_PREAMBLE_SENT_BITS_COUNT`.
+/// \return The initialized `dcc_WaveformGenerator`.
+/// \~japanese
+/// \brief `dcc_WaveformGenerator` を初期化する。
+/// \param bytes チェックサムを含むパケットのバイト列。
+/// \param bytesSize バイト数。`DCC_BIT_STREAM_PARSER_BYTES_CAPACITY` 以下でなければならない。
+/// \param preambleBitsCount プリアンブルの `1` のビット数。通常は `DCC_PREAMBLE_SENT_BITS_COUNT`。
+/// \return 初期化された `dcc_WaveformGenerator`。
+struct dcc_WaveformGenerator dcc_initializeWaveformGenerator(dcc_Byte const *const bytes, size_t const bytesSize,
+                                                             size_t const preambleBitsCount);
+
+/// \~english
+/// \brief To generate the durations of half bits of a packet.
+///
+/// The waveform is the preamble, the packet start bit, the data bytes separated by data byte start bits and the packet
+/// end bit. The durations are `dcc_nominalOneHalfBitSentPeriod` and `dcc_nominalZeroHalfBitSentPeriod`. It can be
+/// called repeatedly with a small buffer.
+/// \param generator The place to store the state.
+/// \param periods The durations of half bits (output).
+/// \param periodsCapacity The number of elements in `periods`.
+/// \return The number of durations written. `0` means that the packet has been generated.
+/// \~japanese
+/// \brief パケットの半ビットの継続時間を生成する。
+///
+/// 波形はプリアンブル、パケット開始ビット、データバイト開始ビットで区切られたデータバイト、パケット終了ビットからなる。継続時間は
+/// `dcc_nominalOneHalfBitSentPeriod` と `dcc_nominalZeroHalfBitSentPeriod` である。小さいバッファーで繰り返し呼び出してよい。
+/// \param generator 状態を保持する場所。
+/// \param periods 半ビットの継続時間（出力）。
+/// \param periodsCapacity `periods` の要素数。
+/// \return 書き込んだ継続時間の数。`0` はパケットを生成し終えたことを表す。
+size_t dcc_generateHalfBitPeriods(struct dcc_WaveformGenerator *const generator, dcc_HalfBitPeriod *const periods,
+                                  size_t const periodsCapacity);
+
+/// \~english
+/// \brief To frame the bytes of a packet into bits.
+///
+/// The bits are packed in the same way as `dcc_decodeSignalsToBits` and can be input to `dcc_feedBits`.
+/// \param bytes The bytes of the packet including the checksum.
+/// \param bytesSize The number of bytes.
+/// \param preambleBitsCount The number of `1` bits of the preamble.
+/// \param bits The bits (output). It needs `(bitsCapacity + 31) / 32` elements.
+/// \param bitsCapacity The maximum number of bits to write.
+/// \param bitsSize The number of bits written (output).
+/// \return Failure if the bits do not fit in `bitsCapacity`.
+/// \~japanese
+/// \brief パケットのバイト列をビット列に組み立てる。
+///
+/// ビットは `dcc_decodeSignalsToBits` と同じように詰めるので `dcc_feedBits` に入力できる。
+/// \param bytes チェックサムを含むパケットのバイト列。
+/// \param bytesSize バイト数。
+/// \param preambleBitsCount プリアンブルの `1` のビット数。
+/// \param bits ビットの列（出力）。`(bitsCapacity + 31) / 32` 個の要素が必要。
+/// \param bitsCapacity 書き込むビットの最大数。
+/// \param bitsSize 書き込んだビットの数（出力）。
+/// \return ビットが `bitsCapacity` に収まらないとき失敗。
+enum dcc_Result dcc_encodeBits(dcc_Byte const *const bytes, size_t const bytesSize, size_t const preambleBitsCount,
+                               uint32_t *const bits, size_t const bitsCapacity, size_t *const bitsSize);
+
+/// \~english
+/// \brief To initialize a `dcc_WaveformCache`.
+/// \param entries A pointer to the array used by the `dcc_WaveformCache`.
+/// \param size The number of elements in `entries`. It should be larger than the number of packets refreshed so that
+/// entries are not evicted.
+/// \param preambleBitsCount The number of `1` bits of the preamble. It must be at most
+/// `DCC_PREAMBLE_SENT_BITS_COUNT`.
+/// \return The initialized `dcc_WaveformCache`.
+/// \~japanese
+/// \brief `dcc_WaveformCache` を初期化する。
+/// \param entries `dcc_WaveformCache` が使う配列へのポインター。
+/// \param size `entries` の要素数。要素が追い出されないように、繰り返し送るパケットの数より大きくするべきである。
+/// \param preambleBitsCount プリアンブルの `1` のビット数。`DCC_PREAMBLE_SENT_BITS_COUNT` 以下でなければならない。
+/// \return 初期化された `dcc_WaveformCache`。
+struct dcc_WaveformCache dcc_initializeWaveformCache(struct dcc_WaveformCacheEntry *const entries, size_t const size,
+                                                     size_t const preambleBitsCount);
+
+/// \~english
+/// \brief To get the waveform of a packet.
+///
+/// When the entry of the same address and kind has the same bytes, its waveform is returned without being generated
+/// again. Otherwise the entry is regenerated, so a changed packet invalidates only its own entry. When the cache is
+/// full, an entry of another packet is evicted.
+/// \param cache The cache.
+/// \param packet The packet.
+/// \param waveform The waveform (output). It is valid until its entry is regenerated or evicted.
+/// \return Failure if the packet cannot be encoded.
+/// \~japanese
+/// \brief パケットの波形を取得する。
+///
+/// 同じアドレスと種類の要素が同じバイト列を持っていれば、その波形を生成し直さずに返す。そうでなければその要素を生成し直すので、変更されたパケットは自身の要素のみを無効にする。
+/// キャッシュがいっぱいのときは他のパケットの要素を追い出す。
+/// \param cache キャッシュ。
+/// \param packet パケット。
+/// \param waveform 波形（出力）。その要素が生成し直されるか追い出されるまで有効である。
+/// \return パケットをエンコードできないとき失敗。
+enum dcc_Result dcc_getWaveform(struct dcc_WaveformCache *const cache, struct dcc_Packet const packet,
+                                struct dcc_Waveform const **const waveform);
+
+/// \~english
+/// \brief To remove all entries of a `dcc_WaveformCache`.
+/// \~japanese
+/// \brief `dcc_WaveformCache` のすべての要素を削除する。
+void dcc_invalidateWaveformCache(struct dcc_WaveformCache *const cache);
+
+/// \~english
+/// \brief To initialize a `dcc_Scheduler`.
+/// \param decoders A pointer to the array used by the `dcc_Scheduler`.
+/// \param decodersSize The number of elements in `decoders`, that is the maximum number of addresses.
+/// \param repeatsCount The number of times a changed packet is sent with priority. `0` is treated as `1`.
+/// \param maxBackToBackCount The maximum number of packets sent to the same address in a row. `0` is treated as `1`.
+/// \return The initialized `dcc_Scheduler`.
+/// \~japanese
+/// \brief `dcc_Scheduler` を初期化する。
+/// \param decoders `dcc_Scheduler` が使う配列へのポインター。
+/// \param decodersSize `decoders` の要素数。すなわちアドレスの最大数。
+/// \param repeatsCount 変更されたパケットを優先して送る回数。`0` は `1` として扱う。
+/// \param maxBackToBackCount 同じアドレスに続けて送るパケットの最大数。`0` は `1` として扱う。
+/// \return 初期化された `dcc_Scheduler`。
+struct dcc_Scheduler dcc_initializeScheduler(struct dcc_SchedulerDecoder *const decoders, size_t const decodersSize,
+                                             uint_least8_t const repeatsCount,
+                                             uint_least8_t const maxBackToBackCount);
+
+/// \~english
+/// \brief To give a packet to send.
+///
+/// The packet replaces the packet of the same address and `dcc_SchedulerSlot`, and is sent `repeatsCount` times
+/// before refreshed packets, interleaved with other changed packets. A packet that is the same as the one refreshed
+/// does not get priority.
+/// \param scheduler The scheduler.
+/// \param packet The packet.
+/// \return Failure if the packet cannot be encoded or `decoders` is full.
+/// \~japanese
+/// \brief 送るパケットを与える。
+///
+/// パケットは同じアドレスと `dcc_SchedulerSlot` のパケットを置き換え、他の変更されたパケットと交互に、巡回するパケットより先に `repeatsCount` 回送られる。
+/// 巡回しているものと同じパケットは優先されない。
+/// \param scheduler スケジューラー。
+/// \param packet パケット。
+/// \return パケットをエンコードできないか `decoders` がいっぱいのとき失敗。
+enum dcc_Result dcc_schedulePacket(struct dcc_Scheduler *const scheduler, struct dcc_Packet const packet);
+
+/// \~english
+/// \brief To stop refreshing the packets of an address.
+///
+/// The packets already queued are still sent. The decoder is released for another address once none of its packets are
+/// queued.
+/// \~japanese
+/// \brief アドレスのパケットの巡回を止める。
+///
+/// 待ち行列に入っているパケットは送られる。待ち行列にデコーダーのパケットがなくなれば、デコーダーは他のアドレスのために解放される。
+void dcc_stopRefreshing(struct dcc_Scheduler *const scheduler, dcc_AddressForExtendedPacket const address);
+
+/// \~english
+/// \brief To get the next packet to send.
+///
+/// It is a changed packet if any, otherwise the next refreshed packet. When neither is allowed by
+/// `maxBackToBackCount` or no packet exists, it is an idle packet.
+/// \~japanese
+/// \brief 次に送るパケットを取得する。
+///
+/// 変更されたパケットがあればそれを、なければ次の巡回するパケットを返す。どちらも `maxBackToBackCount` により送れないか、パケットがなければアイドルパケットを返す。
+struct dcc_Packet dcc_nextScheduledPacket(struct dcc_Scheduler *const scheduler);
+
+/// \~english
+/// \brief To make a `dcc_PacketRecord` from the result of `dcc_decodeView` or `dcc_decodePeriodView`.
+/// \param result The result of the decoding.
+/// \param packet The decoded packet.
+/// \param bytes The view of the raw bytes given by the decoding. Its `size` must be `0` if the decoding did not set it.
+/// \param time The time of the end of the packet.
+/// \param record The record (output).
+/// \return Success if a packet is framed, even when it has errors.
+/// \~japanese
+/// \brief `dcc_decodeView` か `dcc_decodePeriodView` の結果から `dcc_PacketRecord` を作る。
+/// \param result デコードの結果。
+/// \param packet デコードされたパケット。
+/// \param bytes デコードが与えた生のバイト列への参照。デコードが設定しなかった場合は `size` が `0` でなければならない。
+/// \param time パケットの終わりの時刻。
+/// \param record 記録（出力）。
+/// \return エラーがあってもパケットが区切られたなら成功。
+enum dcc_Result dcc_makePacketRecord(enum dcc_StreamParserResult const result, struct dcc_Packet const *const packet,
+                                     struct dcc_BytesView const bytes, dcc_TimeMicroSec const time,
+                                     struct dcc_PacketRecord *const record);
+
+/// \~english
+/// \brief To initialize a `dcc_PacketQueue`.
+/// \param records A pointer to the array used by the `dcc_PacketQueue`.
+/// \param size The number of elements in `records`. Only the largest power of two not exceeding it is used.
+/// \return The initialized `dcc_PacketQueue`.
+/// \~japanese
+/// \brief `dcc_PacketQueue` を初期化する。
+/// \param records `dcc_PacketQueue` が使う配列へのポインター。
+/// \param size `records` の要素数。これを超えない最大の2の冪だけが使われる。
+/// \return 初期化された `dcc_PacketQueue`。
+struct dcc_PacketQueue dcc_initializePacketQueue(struct dcc_PacketRecord *const records, size_t const size);
+
+/// \~english
+/// \brief To add a record to the queue.
+///
+/// It never blocks and can be called in an interrupt context. It overwrites the oldest record when a reader is `size`
+/// records behind.
+/// \~japanese
+/// \brief キューに記録を追加する。
+///
+/// 待つことはなく、割り込みコンテキストで呼び出してもよい。読み出し側が `size` 個遅れていると最も古い記録を上書きする。
+void dcc_pushPacketQueue(struct dcc_PacketQueue *const queue, struct dcc_PacketRecord const *const record);
+
+/// \~english
+/// \brief To make a reader that reads the records pushed after this call.
+/// \~japanese
+/// \brief この呼び出しの後に追加された記録を読む読み出し側を作る。
+struct dcc_PacketQueueReader dcc_initializePacketQueueReader(struct dcc_PacketQueue const *const queue);
+
+/// \~english
+/// \brief To take records from the queue at once.
+/// \param reader The reader.
+/// \param records The records (output).
+/// \param recordsSize The number of elements in `records`.
+/// \return The number of records written.
+/// \~japanese
+/// \brief キューから記録をまとめて取り出す。
+/// \param reader 読み出し側。
+/// \param records 記録（出力）。
+/// \param recordsSize `records` の要素数。
+/// \return 書き込んだ記録の数。
+size_t dcc_popPacketQueue(struct dcc_PacketQueueReader *const reader, struct dcc_PacketRecord *const records,
+                          size_t const recordsSize);
+
+/// \~english
+/// \brief To get the number of records that the reader has not read yet, including those that will be lost.
+/// \~japanese
+/// \brief 失われるものを含めて、読み出し側がまだ読んでいない記録の数を得る。
+size_t dcc_getPacketQueueDepth(struct dcc_PacketQueueReader const *const reader);
+
+/// \~english
+/// \brief To initialize a `dcc_PacketLog` for either a writer or a reader.
+/// \~japanese
+/// \brief 書き込み側か読み出し側の `dcc_PacketLog` を初期化する。
+struct dcc_PacketLog dcc_initializePacketLog(void);
+
+/// \~english
+/// \brief To encode a record into a frame of the binary packet log.
+/// \param log The log of the writer.
+/// \param record The record.
+/// \param buffer The frame (output).
+/// \param bufferSize The size of `buffer`. `DCC_PACKET_LOG_FRAME_CAPACITY` is always enough.
+/// \param size The number of bytes written (output).
+/// \return Failure if `buffer` is too small.
+/// \~japanese
+/// \brief 記録をバイナリーのパケットログのフレームに符号化する。
+/// \param log 書き込み側のログ。
+/// \param record 記録。
+/// \param buffer フレーム（出力）。
+/// \param bufferSize `buffer` の大きさ。`DCC_PACKET_LOG_FRAME_CAPACITY` あれば常に足りる。
+/// \param size 書き込んだバイト数（出力）。
+/// \return `buffer` が小さすぎれば失敗。
+enum dcc_Result dcc_writePacketLog(struct dcc_PacketLog *const log, struct dcc_PacketRecord const *const record,
+                                   dcc_Byte *const buffer, size_t const bufferSize, size_t *const size);
+
+/// \~english
+/// \brief To decode a frame of the binary packet log into a record.
+/// \param log The log of the reader.
+/// \param buffer The bytes starting with `DCC_PACKET_LOG_FRAME_MARKER`.
+/// \param bufferSize The size of `buffer`.
+/// \param record The record (output).
+/// \param size The number of bytes to consume (output). Not set when `dcc_StreamParserResult_Continue` is returned. The
+/// closing marker of a malformed frame is not consumed because it may open the next frame.
+/// \return Continue if `buffer` does not contain the whole frame, or Failure if the frame is malformed.
+/// \~japanese
+/// \brief バイナリーのパケットログのフレームを記録に復号する。
+/// \param log 読み出し側のログ。
+/// \param buffer `DCC_PACKET_LOG_FRAME_MARKER` から始まるバイト列。
+/// \param bufferSize `buffer` の大きさ。
+/// \param record 記録（出力）。
+/// \param size 消費するバイト数（出力）。`dcc_StreamParserResult_Continue` を返すときは設定しない。不正なフレームの終わりの区切りは次のフレームの始まりかもしれないので消費しない。
+/// \return `buffer` がフレーム全体を含まなければ継続、フレームが不正なら失敗。
+enum dcc_StreamParserResult dcc_readPacketLog(struct dcc_PacketLog *const log, dcc_Byte const *const buffer,
+                                              size_t const bufferSize, struct dcc_PacketRecord *const record,
+                                              size_t *const size);
+
 int dcc_showSignalBuffer(char *buffer, size_t const bufferSize, struct dcc_SignalBuffer const signalBuffer);
 
 int dcc_showBytes(char *buffer, size_t const bufferSize, dcc_Byte const *const bytes, size_t const bytesSize);
 
+/// \~english
+/// \brief To show a timing profile as JSON so that the host can plot it.
+///
+/// Each histogram is an object that has `min`, `width` and `counts`.
+/// \return The number of characters that would have been written if `bufferSize` had been large enough.
+/// \~japanese
+/// \brief ホストでプロットできるように、タイミングのプロファイルを JSON で表示する。
+///
+/// それぞれのヒストグラムは `min`、`width`、`counts` を持つオブジェクトである。
+/// \return `bufferSize` が十分に大きければ書き込んだはずの文字数。
+int dcc_showTimingProfile(char *buffer, size_t const bufferSize, struct dcc_TimingProfile const *const profile);
+
 int dcc_showDirection(char *buffer, size_t const bufferSize, enum dcc_Direction const direction);
 
 int dcc_showBroadcastStopKind(char *buffer, size_t const bufferSize,
@@ -1128,16 +2810,49 @@ int dcc_showHardResetPacketForMultiFunctionDecoders(char *buffer, size_t const b
 int dcc_showFactoryTestInstructionPacketForMultiFunctionDecoders(
   char *buffer, size_t const bufferSize, struct dcc_FactoryTestInstructionPacketForMultiFunctionDecoders const packet);
 
+int dcc_showSetExtendedAddressingPacketForMultiFunctionDecoders(
+  char *buffer, size_t const bufferSize,
+  struct dcc_SetExtendedAddressingPacketForMultiFunctionDecoders const packet);
+
+int dcc_showRestrictedSpeedStepPacketForMultiFunctionDecoders(
+  char *buffer, size_t const bufferSize, struct dcc_RestrictedSpeedStepPacketForMultiFunctionDecoders const packet);
+
+int dcc_showAnalogFunctionPacketForMultiFunctionDecoders(
+  char *buffer, size_t const bufferSize, struct dcc_AnalogFunctionPacketForMultiFunctionDecoders const packet);
+
+int dcc_showSpeedAndDirectionPacketForMultiFunctionDecoders(
+  char *buffer, size_t const bufferSize, struct dcc_SpeedAndDirectionPacketForMultiFunctionDecoders const packet);
+
+int dcc_showFunctionGroup1PacketForMultiFunctionDecoders(
+  char *buffer, size_t const bufferSize, struct dcc_FunctionGroup1PacketForMultiFunctionDecoders const packet);
+
+int dcc_showFunctionGroup2PacketForMultiFunctionDecoders(
+  char *buffer, size_t const bufferSize, struct dcc_FunctionGroup2PacketForMultiFunctionDecoders const packet);
+
+int dcc_showBinaryStateControlLongFormPacket(char *buffer, size_t const bufferSize,
+                                             struct dcc_BinaryStateControlLongFormPacket const packet);
+
+int dcc_showBinaryStateControlShortFormPacket(char *buffer, size_t const bufferSize,
+                                              struct dcc_BinaryStateControlShortFormPacket const packet);
+
+int dcc_showFunctionControlF13F20Packet(char *buffer, size_t const bufferSize,
+                                       struct dcc_FunctionControlF13F20Packet const packet);
+
+int dcc_showFunctionControlF21F28Packet(char *buffer, size_t const bufferSize,
+                                       struct dcc_FunctionControlF21F28Packet const packet);
+
 int dcc_showPacket(char *buffer, size_t const bufferSize, struct dcc_Packet const packet);
 
 /// \~english
 /// \brief A pointer to a function called when an error occurs.
 ///
-/// The function should output logs and exit or restart. `NULL` means that no function is called.
+/// The library recovers from the error after calling it, so the function should only output logs. It may be called in
+/// an interrupt context. `NULL` means that the error is written to `stderr` instead.
 /// \~japanese
 /// \brief エラー時に呼び出される関数へのポインター。
 ///
-/// ログを出力し、終了や再起動もすべし。`NULL` にすると関数は呼び出されない。
+/// ライブラリーは呼び出した後にエラーから回復するので、関数はログを出力するだけにすべし。割り込みコンテキストで呼び出されることもある。`NULL`
+/// にすると代わりに `stderr` に出力する。
 extern void (*dcc_error_log)(char const *const file, int const line, char const *func, char const *format, ...);
 
 /// \~english
@@ -1150,4 +2865,92 @@ extern void (*dcc_error_log)(char const *const file, int const line, char const
 /// `NULL` にすると関数は呼び出されない。
 extern int (*dcc_debug_log)(char const *const file, int const line, char const *func, char const *format, ...);
 
+/// \~english
+/// \brief A pointer to the ring where `dcc_deferLog` records logs.
+///
+/// `NULL` means that logs are discarded.
+/// \~japanese
+/// \brief `dcc_deferLog` がログを記録するリングへのポインター。
+///
+/// `NULL` にするとログは捨てられる。
+extern struct dcc_DeferredLog *dcc_deferred_log;
+
+/// \~english
+/// \brief To initialize a `dcc_DeferredLog`.
+/// \param entries A pointer to the array used by the `dcc_DeferredLog`.
+/// \param size The number of elements in `entries`. Only the largest power of two not exceeding it is used.
+/// \return The initialized `dcc_DeferredLog`.
+/// \~japanese
+/// \brief `dcc_DeferredLog` を初期化する。
+/// \param entries `dcc_DeferredLog` が使う配列へのポインター。
+/// \param size `entries` の要素数。これを超えない最大の2の冪だけが使われる。
+/// \return 初期化された `dcc_DeferredLog`。
+struct dcc_DeferredLog dcc_initializeDeferredLog(struct dcc_DeferredLogEntry *const entries, size_t const size);
+
+/// \~english
+/// \brief To record a log into `dcc_deferred_log` without formatting it.
+///
+/// It can be assigned to `dcc_debug_log`. It never blocks and can be called in an interrupt context. Arguments of
+/// `%s` are kept as pointers, and conversions after `%n` or `%ls` are not recorded.
+/// \~japanese
+/// \brief ログを整形せずに `dcc_deferred_log` に記録する。
+///
+/// `dcc_debug_log` に代入できる。待つことはなく、割り込みコンテキストで呼び出してもよい。`%s` の引数はポインターのまま保持し、`%n` や `%ls`
+/// 以降の変換は記録しない。
+int dcc_deferLog(char const *const file, int const line, char const *func, char const *format, ...);
+
+/// \~english
+/// \brief To take the oldest log from the ring.
+/// \return Failure if no log is complete.
+/// \~japanese
+/// \brief リングから最も古いログを取り出す。
+/// \return 書き込みが終わったログがなければ失敗。
+enum dcc_Result dcc_popDeferredLog(struct dcc_DeferredLog *const log, struct dcc_DeferredLogEntry *const entry);
+
+/// \~english
+/// \brief To format the message of a log in the same way as `snprintf`.
+/// \return The number of characters that would have been written if `bufferSize` had been large enough.
+/// \~japanese
+/// \brief `snprintf` と同じようにログのメッセージを整形する。
+/// \return `bufferSize` が十分に大きければ書き込んだはずの文字数。
+int dcc_formatDeferredLog(char *buffer, size_t const bufferSize, struct dcc_DeferredLogEntry const *const entry);
+
+/// \~english
+/// \brief To initialize a `dcc_TimingProfile` with all counts zero.
+/// \~japanese
+/// \brief すべての回数が 0 の `dcc_TimingProfile` を初期化する。
+struct dcc_TimingProfile dcc_initializeTimingProfile(void);
+
+/// \~english
+/// \brief To add the duration of a half bit to the profile.
+/// \~japanese
+/// \brief 半ビットの継続時間をプロファイルに追加する。
+void dcc_profileHalfBitPeriod(struct dcc_TimingProfile *const profile, dcc_TimeMicroSec const period);
+
+/// \~english
+/// \brief To add a pair of half bits that is judged as a bit to the profile.
+///
+/// It is ignored unless both are half bits of `1`.
+/// \~japanese
+/// \brief ビットとして判定される半ビットの組をプロファイルに追加する。
+///
+/// 両方が `1` の半ビットでなければ無視する。
+void dcc_profileHalfBitPair(struct dcc_TimingProfile *const profile, dcc_TimeMicroSec const first,
+                            dcc_TimeMicroSec const second);
+
+/// \~english
+/// \brief To get a snapshot of a profile from any thread.
+/// \~japanese
+/// \brief 任意のスレッドからプロファイルのスナップショットを取得する。
+struct dcc_TimingProfile dcc_getTimingProfile(struct dcc_TimingProfile const *const profile);
+
+/// \~english
+/// \brief To get the counts between two snapshots of a profile.
+/// \return `until` minus `since` for each count.
+/// \~japanese
+/// \brief プロファイルの2つのスナップショットの間の回数を取得する。
+/// \return 回数ごとの `until` から `since` を引いた値。
+struct dcc_TimingProfile dcc_subtractTimingProfile(struct dcc_TimingProfile const *const until,
+                                                   struct dcc_TimingProfile const *const since);
+
 #endif
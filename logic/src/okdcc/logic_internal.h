@@ -1,10 +1,75 @@
 #ifndef DCC_LOGIC_INTERNAL_H
 #define DCC_LOGIC_INTERNAL_H
 
+#include <assert.h>
+#include <stdio.h>
+
 #include "logic.h"
 
+// 出力するだけで終了はしないので、呼び出し側で状態を戻して処理を続ける
+#if DCC_LOG_LEVEL_ERROR <= DCC_LOG_LEVEL
+#define DCC_ERROR_LOG(...)                                                \
+  do {                                                                    \
+    if (dcc_error_log != NULL) {                                          \
+      dcc_error_log(__FILE__, __LINE__, __func__, __VA_ARGS__);           \
+    } else {                                                              \
+      fprintf(stderr, "error: %s:%d:%s: ", __FILE__, __LINE__, __func__); \
+      fprintf(stderr, __VA_ARGS__);                                       \
+      fprintf(stderr, "\n");                                              \
+    }                                                                     \
+  } while (0)
+#else
+#define DCC_ERROR_LOG(...) ((void) 0)
+#endif
+
+#if DCC_LOG_LEVEL_DEBUG <= DCC_LOG_LEVEL
+#define DCC_DEBUG_LOG(...) (dcc_debug_log == NULL ? 0 : dcc_debug_log(__FILE__, __LINE__, __func__, __VA_ARGS__))
+#else
+// 呼び出しごと取り除くので、引数も評価しない
+#define DCC_DEBUG_LOG(...) ((void) 0)
+#endif
+
+#define DCC_UNREACHABLE(...) DCC_ERROR_LOG("unreachable: "__VA_ARGS__)
+
+#define DCC_UNIMPLEMENTED() DCC_ERROR_LOG("unimplemented")
+
+// 割り込みハンドラーとタスクの間で共有されるインデックスの読み書き
+#define DCC_LOAD_RELAXED(p) __atomic_load_n((p), __ATOMIC_RELAXED)
+#define DCC_LOAD_ACQUIRE(p) __atomic_load_n((p), __ATOMIC_ACQUIRE)
+#define DCC_STORE_RELAXED(p, v) __atomic_store_n((p), (v), __ATOMIC_RELAXED)
+#define DCC_STORE_RELEASE(p, v) __atomic_store_n((p), (v), __ATOMIC_RELEASE)
+
+// 1つのスレッドだけが増やし、他のスレッドからも読まれる回数を 1 増やす
+// 書き込むのは1つのスレッドだけなので、読み書きを分けた安価な加算でよい
+#define DCC_COUNT_UP(p) DCC_STORE_RELAXED((p), DCC_LOAD_RELAXED(p) + 1)
+
+#ifdef DCC_ASSERT
+#undef DCC_ASSERT
+#define DCC_ASSERT(e) assert(e)
+#endif
+
+// 2つの半ビットの継続時間からビットを求める
+// 失敗した場合も `*bit` に書き込む
 enum dcc_Result dcc_decodeSignal(dcc_TimeMicroSec const period1, dcc_TimeMicroSec const period2, dcc_Bit *const bit);
 
+// 指定した受信のタイミングで dcc_decodeSignal と同じ判定をする
+enum dcc_Result dcc_decodeSignalWithTiming(struct dcc_ReceiveTiming const *const timing, dcc_TimeMicroSec const period1,
+                                           dcc_TimeMicroSec const period2, dcc_Bit *const bit);
+
+// 半ビットの継続時間から適応的なクロック再生を学習し、次の組の偏りを求める
+void dcc_recoverClock(struct dcc_ClockRecovery *const recovery, dcc_TimeMicroSec const period);
+
 enum dcc_Result dcc_validatePacket(uint8_t const *const bytes, size_t bytesSize, uint8_t const checksum);
 
+// ビット列のパーサーをプリアンブルを待つ状態に戻す
+// 壊れた状態から回復した回数は残す
+void dcc_resetBitStreamParser(struct dcc_BitStreamParser *const parser);
+
+// `n` を超えない最大の2の冪、ただし `n` が `0` のときは `0`
+size_t dcc_floorPowerOfTwo(size_t const n);
+
+// エンコードしたパケットのバイト列からアドレスを求める
+// 全デコーダー向けのパケットは `0`、アイドルパケットは `255` になる
+dcc_AddressForExtendedPacket dcc_addressOfEncodedPacket(dcc_Byte const *const bytes);
+
 #endif
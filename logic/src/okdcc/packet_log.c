@@ -0,0 +1,155 @@
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "logic_internal.h"
+
+// エラーのある記録の見出しはこのビットとエラーの論理和で、パケットの種類と区別できる
+#define ERROR_HEADER 0x80
+// 時刻が直前の記録からの時間差でなく絶対時刻であることを示す見出しのビット
+#define ABSOLUTE_TIME_HEADER 0x40
+// 区切りを除いた記録の最大の大きさ
+#define RECORD_CAPACITY (DCC_PACKET_LOG_FRAME_CAPACITY - 3)
+
+struct dcc_PacketLog dcc_initializePacketLog(void) {
+  return (struct dcc_PacketLog){ .time = 0, .relativeRecordsCount = 0 };
+}
+
+enum dcc_Result dcc_writePacketLog(struct dcc_PacketLog *const log, struct dcc_PacketRecord const *const record,
+                                   dcc_Byte *const buffer, size_t const bufferSize, size_t *const size) {
+  bool const valid = record->errors == 0;
+  if (record->bytesSize == 0 || DCC_BIT_STREAM_PARSER_BYTES_CAPACITY < record->bytesSize) return dcc_Failure;
+  // エラーのないパケットのチェックサムは読み出し側で計算し直せるので省く
+  size_t const bytesSize = valid ? record->bytesSize - 1u : record->bytesSize;
+  // 読み出し側がフレームを失っても時刻を取り戻せるように、最初と一定の記録ごとに絶対時刻を書き込む
+  bool const absolute = log->relativeRecordsCount == 0;
+  dcc_Byte recordBytes[RECORD_CAPACITY];
+  size_t recordSize = 0;
+  dcc_Byte const header = valid ? (dcc_Byte) record->packet.tag : (dcc_Byte) (ERROR_HEADER | record->errors);
+  recordBytes[recordSize++] = absolute ? (dcc_Byte) (header | ABSOLUTE_TIME_HEADER) : header;
+  // 時刻は符号なし LEB128 で書き込むので、パケットが続いていれば時間差は1、2バイトで済む
+  dcc_TimeMicroSec time = absolute ? record->time : dcc_elapsedTime(log->time, record->time);
+  do {
+    dcc_Byte const low = (dcc_Byte) (time & 0x7F);
+    time >>= 7;
+    recordBytes[recordSize++] = time == 0 ? low : (dcc_Byte) (low | 0x80);
+  } while (time != 0);
+  memcpy(recordBytes + recordSize, record->bytes, bytesSize);
+  recordSize += bytesSize;
+  // 記録を COBS で符号化して区切りを含まないようにし、区切りで挟む
+  // 記録は 254 バイトより短いので、符号のバイトは 0xFF にならない
+  dcc_Byte frame[DCC_PACKET_LOG_FRAME_CAPACITY];
+  size_t frameSize = 0;
+  frame[frameSize++] = DCC_PACKET_LOG_FRAME_MARKER;
+  size_t codeIndex = frameSize++;
+  for (size_t i = 0; i < recordSize; i++) {
+    if (recordBytes[i] == DCC_PACKET_LOG_FRAME_MARKER) {
+      frame[codeIndex] = (dcc_Byte) (frameSize - codeIndex);
+      codeIndex = frameSize++;
+    } else {
+      frame[frameSize++] = recordBytes[i];
+    }
+  }
+  frame[codeIndex] = (dcc_Byte) (frameSize - codeIndex);
+  frame[frameSize++] = DCC_PACKET_LOG_FRAME_MARKER;
+  if (bufferSize < frameSize) return dcc_Failure;
+  memcpy(buffer, frame, frameSize);
+  *size = frameSize;
+  log->time = record->time;
+  log->relativeRecordsCount = (log->relativeRecordsCount + 1) % DCC_PACKET_LOG_ABSOLUTE_TIME_INTERVAL;
+  return dcc_Success;
+}
+
+// 区切りの間の COBS を復号する
+static enum dcc_Result decodeFrame(dcc_Byte const *const encoded, size_t const encodedSize, dcc_Byte *const decoded,
+                                   size_t *const decodedSize) {
+  size_t size = 0;
+  for (size_t i = 0; i < encodedSize;) {
+    size_t const code = encoded[i++];
+    if (code == 0 || encodedSize < i + code - 1 || RECORD_CAPACITY < size + code - 1) return dcc_Failure;
+    memcpy(decoded + size, encoded + i, code - 1);
+    size += code - 1;
+    i += code - 1;
+    if (code != 0xFF && i < encodedSize) {
+      if (RECORD_CAPACITY <= size) return dcc_Failure;
+      decoded[size++] = DCC_PACKET_LOG_FRAME_MARKER;
+    }
+  }
+  *decodedSize = size;
+  return dcc_Success;
+}
+
+enum dcc_StreamParserResult dcc_readPacketLog(struct dcc_PacketLog *const log, dcc_Byte const *const buffer,
+                                              size_t const bufferSize, struct dcc_PacketRecord *const record,
+                                              size_t *const size) {
+  if (bufferSize == 0) return dcc_StreamParserResult_Continue;
+  if (buffer[0] != DCC_PACKET_LOG_FRAME_MARKER) {
+    *size = 1;
+    return dcc_StreamParserResult_Failure;
+  }
+  // 区切りが続いていれば最後のものをフレームの始まりとする
+  size_t start = 0;
+  while (start + 1 < bufferSize && buffer[start + 1] == DCC_PACKET_LOG_FRAME_MARKER) start++;
+  size_t end = start + 1;
+  while (end < bufferSize && buffer[end] != DCC_PACKET_LOG_FRAME_MARKER) end++;
+  if (bufferSize <= end) {
+    // 終わりの区切りが失われていれば、次の区切りを探せるように始まりの区切りまでを読み飛ばす
+    if (DCC_PACKET_LOG_FRAME_CAPACITY - 1 < end - start) {
+      *size = start + 1;
+      return dcc_StreamParserResult_Failure;
+    }
+    // 区切りだけが長く続くときも読み出し側の buffer を埋めないように読み飛ばす
+    if (DCC_PACKET_LOG_FRAME_CAPACITY <= start) {
+      *size = start;
+      return dcc_StreamParserResult_Failure;
+    }
+    return dcc_StreamParserResult_Continue;
+  }
+  // 壊れたフレームの終わりの区切りは次のフレームの始まりかもしれないので残す
+  *size = end;
+  dcc_Byte bytes[RECORD_CAPACITY];
+  size_t bytesSize;
+  if (dcc_Failure == decodeFrame(buffer + start + 1, end - start - 1, bytes, &bytesSize) || bytesSize == 0) {
+    return dcc_StreamParserResult_Failure;
+  }
+  size_t i = 0;
+  dcc_Byte const header = bytes[i++];
+  dcc_TimeMicroSec time = 0;
+  for (unsigned int shift = 0;; shift += 7) {
+    // 時刻は32ビットなので5バイトまで
+    if (bytesSize <= i || 28 < shift) return dcc_StreamParserResult_Failure;
+    dcc_Byte const byte = bytes[i++];
+    time |= (dcc_TimeMicroSec) (byte & 0x7F) << shift;
+    if ((byte & 0x80) == 0) break;
+  }
+  size_t const packetSize = bytesSize - i;
+  dcc_Byte const kind = (dcc_Byte) (header & ~ABSOLUTE_TIME_HEADER);
+  if (kind & ERROR_HEADER) {
+    if (packetSize == 0 || DCC_BIT_STREAM_PARSER_BYTES_CAPACITY < packetSize || (kind & ~ERROR_HEADER) == 0) {
+      return dcc_StreamParserResult_Failure;
+    }
+    memcpy(record->bytes, bytes + i, packetSize);
+    record->bytesSize = (uint_least8_t) packetSize;
+    record->errors = (uint_least8_t) (kind & ~ERROR_HEADER);
+  } else {
+    if (packetSize == 0 || DCC_BIT_STREAM_PARSER_BYTES_CAPACITY <= packetSize) return dcc_StreamParserResult_Failure;
+    dcc_Byte checksum = 0;
+    for (size_t j = 0; j < packetSize; j++) {
+      record->bytes[j] = bytes[i + j];
+      checksum ^= bytes[i + j];
+    }
+    record->bytes[packetSize] = checksum;
+    record->bytesSize = (uint_least8_t) (packetSize + 1);
+    record->errors = 0;
+    if (dcc_Failure == dcc_parsePacket(record->bytes, record->bytesSize, &record->packet) ||
+        record->packet.tag != kind) {
+      return dcc_StreamParserResult_Failure;
+    }
+  }
+  *size = end + 1;
+  if (header & ABSOLUTE_TIME_HEADER) log->time = 0;
+  log->time = (log->time + time) & DCC_TIME_MICRO_SEC_MASK;
+  record->time = log->time;
+  return dcc_StreamParserResult_Success;
+}
@@ -0,0 +1,75 @@
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "logic_internal.h"
+
+enum dcc_Result dcc_makePacketRecord(enum dcc_StreamParserResult const result, struct dcc_Packet const *const packet,
+                                     struct dcc_BytesView const bytes, dcc_TimeMicroSec const time,
+                                     struct dcc_PacketRecord *const record) {
+  // バイト列が揃わなかった
+  if (bytes.size == 0 || DCC_BIT_STREAM_PARSER_BYTES_CAPACITY < bytes.size) return dcc_Failure;
+  memcpy(record->bytes, bytes.bytes, bytes.size);
+  record->bytesSize = (uint_least8_t) bytes.size;
+  record->time = time;
+  record->errors = 0;
+  if (result == dcc_StreamParserResult_Success) {
+    record->packet = *packet;
+    return dcc_Success;
+  }
+  // デコーダーはチェックサムを検証してからパースするので、チェックサムが一致すればパースに失敗している
+  dcc_Byte checksum = 0;
+  for (size_t i = 0; i < bytes.size; i++) checksum ^= bytes.bytes[i];
+  record->errors = checksum == 0 ? dcc_PacketRecordError_Unparsed : dcc_PacketRecordError_Checksum;
+  return dcc_Success;
+}
+
+struct dcc_PacketQueue dcc_initializePacketQueue(struct dcc_PacketRecord *const records, size_t const size) {
+  return (struct dcc_PacketQueue){
+    .records = records, .size = dcc_floorPowerOfTwo(size), .claimCount = 0, .writeCount = 0
+  };
+}
+
+// シーケンスロックと同じく、書き込みを始める前に `claimCount` を進めて、読み出し側がコピーの後に確かめられるようにする
+void dcc_pushPacketQueue(struct dcc_PacketQueue *const queue, struct dcc_PacketRecord const *const record) {
+  size_t const writeCount = DCC_LOAD_RELAXED(&queue->writeCount);
+  DCC_STORE_RELAXED(&queue->claimCount, writeCount + 1);
+  __atomic_thread_fence(__ATOMIC_RELEASE);
+  queue->records[writeCount & (queue->size - 1)] = *record;
+  DCC_STORE_RELEASE(&queue->writeCount, writeCount + 1);
+}
+
+struct dcc_PacketQueueReader dcc_initializePacketQueueReader(struct dcc_PacketQueue const *const queue) {
+  return (struct dcc_PacketQueueReader){
+    .queue = queue, .readCount = DCC_LOAD_ACQUIRE(&queue->writeCount), .lostCount = 0
+  };
+}
+
+size_t dcc_popPacketQueue(struct dcc_PacketQueueReader *const reader, struct dcc_PacketRecord *const records,
+                          size_t const recordsSize) {
+  struct dcc_PacketQueue const *const queue = reader->queue;
+  size_t const writeCount = DCC_LOAD_ACQUIRE(&queue->writeCount);
+  // 追い越された分は失われている
+  if (queue->size < writeCount - reader->readCount) {
+    reader->lostCount += writeCount - reader->readCount - queue->size;
+    reader->readCount = writeCount - queue->size;
+  }
+  size_t const available = writeCount - reader->readCount;
+  size_t const size = available < recordsSize ? available : recordsSize;
+  for (size_t i = 0; i < size; i++) records[i] = queue->records[(reader->readCount + i) & (queue->size - 1)];
+  __atomic_thread_fence(__ATOMIC_ACQUIRE);
+  // コピーしている間に書き込みが始まった記録は壊れているかもしれないので捨てる
+  // `claimCount - 1` 番目の記録は `claimCount - 1 - size` 番目の記録と同じ場所に書き込まれる
+  size_t const claimedSize = DCC_LOAD_RELAXED(&queue->claimCount) - reader->readCount;
+  size_t overwrittenSize = queue->size < claimedSize ? claimedSize - queue->size : 0;
+  if (size < overwrittenSize) overwrittenSize = size;
+  if (overwrittenSize != 0) memmove(records, records + overwrittenSize, (size - overwrittenSize) * sizeof *records);
+  reader->lostCount += overwrittenSize;
+  reader->readCount += size;
+  return size - overwrittenSize;
+}
+
+size_t dcc_getPacketQueueDepth(struct dcc_PacketQueueReader const *const reader) {
+  return DCC_LOAD_ACQUIRE(&reader->queue->writeCount) - reader->readCount;
+}
@@ -0,0 +1,241 @@
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "logic_internal.h"
+
+// 要素を指さないことを表す番号
+#define NONE SIZE_MAX
+
+// 要素の番号はデコーダーの添字とスロットから決まる
+static struct dcc_SchedulerEntry *entryAt(struct dcc_Scheduler const *const scheduler, size_t const id) {
+  return &scheduler->decoders[id / dcc_SchedulerSlotsCount].entries[id % dcc_SchedulerSlotsCount];
+}
+
+static dcc_AddressForExtendedPacket addressAt(struct dcc_Scheduler const *const scheduler, size_t const id) {
+  return scheduler->decoders[id / dcc_SchedulerSlotsCount].address;
+}
+
+struct dcc_Scheduler dcc_initializeScheduler(struct dcc_SchedulerDecoder *const decoders, size_t const decodersSize,
+                                             uint_least8_t const repeatsCount,
+                                             uint_least8_t const maxBackToBackCount) {
+  for (size_t i = 0; i < decodersSize; i++) {
+    decoders[i].used = false;
+    decoders[i].deleted = false;
+  }
+  return (struct dcc_Scheduler){ .decoders = decoders,
+                                 .decodersSize = decodersSize,
+                                 .repeatsCount = repeatsCount == 0 ? 1 : repeatsCount,
+                                 .maxBackToBackCount = maxBackToBackCount == 0 ? 1 : maxBackToBackCount,
+                                 .queueHead = NONE,
+                                 .queueTail = NONE,
+                                 .refreshCursor = NONE,
+                                 .lastAddress = 0,
+                                 .lastAddressExists = false,
+                                 .backToBackCount = 0 };
+}
+
+static enum dcc_SchedulerSlot slotOf(struct dcc_Packet const *const packet) {
+  switch (packet->tag) {
+    case dcc_SpeedAndDirectionPacketForLocomotiveDecodersTag:
+    case dcc_SpeedStep128ControlPacketForMultiFunctionDecodersTag:
+    case dcc_SpeedAndDirectionPacketForMultiFunctionDecodersTag:
+      return dcc_SchedulerSlot_Speed;
+    case dcc_FunctionGroup1PacketForMultiFunctionDecodersTag:
+      return dcc_SchedulerSlot_FunctionGroup1;
+    case dcc_FunctionGroup2PacketForMultiFunctionDecodersTag:
+      return packet->functionGroup2PacketForMultiFunctionDecoders.group == dcc_FunctionGroup2Group_F5_F8
+               ? dcc_SchedulerSlot_FunctionGroup2F5F8
+               : dcc_SchedulerSlot_FunctionGroup2F9F12;
+    case dcc_FunctionControlF13F20PacketTag:
+      return dcc_SchedulerSlot_FunctionControlF13F20;
+    case dcc_FunctionControlF21F28PacketTag:
+      return dcc_SchedulerSlot_FunctionControlF21F28;
+    case dcc_BinaryStateControlLongFormPacketTag:
+    case dcc_BinaryStateControlShortFormPacketTag:
+      return dcc_SchedulerSlot_BinaryState;
+    default:
+      return dcc_SchedulerSlot_OneShot;
+  }
+}
+
+// 開番地法でデコーダーを探す
+// 解放した要素は墓標として残し、その先にあるアドレスも探せるようにする
+// `insert` が真なら見つからないときに最初の墓標か空きを使う
+static struct dcc_SchedulerDecoder *findDecoder(struct dcc_Scheduler *const scheduler,
+                                                dcc_AddressForExtendedPacket const address, bool const insert,
+                                                size_t *const index) {
+  if (scheduler->decodersSize == 0) return NULL;
+  size_t const home = (size_t) address % scheduler->decodersSize;
+  size_t vacant = NONE;
+  for (size_t i = 0; i < scheduler->decodersSize; i++) {
+    size_t const j = (home + i) % scheduler->decodersSize;
+    struct dcc_SchedulerDecoder *const decoder = &scheduler->decoders[j];
+    if (decoder->used) {
+      if (decoder->address != address) continue;
+      *index = j;
+      return decoder;
+    }
+    if (vacant == NONE) vacant = j;
+    if (!decoder->deleted) break;
+  }
+  if (!insert || vacant == NONE) return NULL;
+  struct dcc_SchedulerDecoder *const decoder = &scheduler->decoders[vacant];
+  decoder->used = true;
+  decoder->deleted = false;
+  decoder->address = address;
+  for (size_t slot = 0; slot < dcc_SchedulerSlotsCount; slot++) {
+    decoder->entries[slot].exists = false;
+    decoder->entries[slot].refreshed = false;
+    decoder->entries[slot].queued = false;
+  }
+  *index = vacant;
+  return decoder;
+}
+
+// 待ち行列にも巡回の輪にもパケットがなければ、デコーダーの要素を墓標にして空ける
+static void releaseDecoderIfIdle(struct dcc_Scheduler *const scheduler, size_t const index) {
+  struct dcc_SchedulerDecoder *const decoder = &scheduler->decoders[index];
+  for (size_t slot = 0; slot < dcc_SchedulerSlotsCount; slot++) {
+    if (decoder->entries[slot].queued || decoder->entries[slot].refreshed) return;
+  }
+  decoder->used = false;
+  decoder->deleted = true;
+}
+
+static void pushQueue(struct dcc_Scheduler *const scheduler, size_t const id) {
+  struct dcc_SchedulerEntry *const entry = entryAt(scheduler, id);
+  entry->queueNext = NONE;
+  entry->queued = true;
+  if (scheduler->queueTail == NONE) scheduler->queueHead = id;
+  else entryAt(scheduler, scheduler->queueTail)->queueNext = id;
+  scheduler->queueTail = id;
+}
+
+// `prev` の次の要素を取り出す、`prev` が `NONE` なら先頭を取り出す
+static size_t popQueue(struct dcc_Scheduler *const scheduler, size_t const prev) {
+  size_t const id = prev == NONE ? scheduler->queueHead : entryAt(scheduler, prev)->queueNext;
+  struct dcc_SchedulerEntry *const entry = entryAt(scheduler, id);
+  if (prev == NONE) scheduler->queueHead = entry->queueNext;
+  else entryAt(scheduler, prev)->queueNext = entry->queueNext;
+  if (scheduler->queueTail == id) scheduler->queueTail = prev;
+  entry->queued = false;
+  return id;
+}
+
+// 巡回の輪に加える
+// カーソルの直前に入れるので、一巡の最後に送られる
+static void linkRefresh(struct dcc_Scheduler *const scheduler, size_t const id) {
+  struct dcc_SchedulerEntry *const entry = entryAt(scheduler, id);
+  entry->refreshed = true;
+  size_t const cursor = scheduler->refreshCursor;
+  if (cursor == NONE) {
+    entry->refreshNext = entry->refreshPrev = id;
+    scheduler->refreshCursor = id;
+    return;
+  }
+  struct dcc_SchedulerEntry *const next = entryAt(scheduler, cursor);
+  size_t const prev = next->refreshPrev;
+  entry->refreshNext = cursor;
+  entry->refreshPrev = prev;
+  entryAt(scheduler, prev)->refreshNext = id;
+  next->refreshPrev = id;
+}
+
+static void unlinkRefresh(struct dcc_Scheduler *const scheduler, size_t const id) {
+  struct dcc_SchedulerEntry *const entry = entryAt(scheduler, id);
+  entry->refreshed = false;
+  if (entry->refreshNext == id) {
+    scheduler->refreshCursor = NONE;
+    return;
+  }
+  entryAt(scheduler, entry->refreshPrev)->refreshNext = entry->refreshNext;
+  entryAt(scheduler, entry->refreshNext)->refreshPrev = entry->refreshPrev;
+  if (scheduler->refreshCursor == id) scheduler->refreshCursor = entry->refreshNext;
+}
+
+enum dcc_Result dcc_schedulePacket(struct dcc_Scheduler *const scheduler, struct dcc_Packet const packet) {
+  dcc_Byte bytes[DCC_BIT_STREAM_PARSER_BYTES_CAPACITY];
+  size_t bytesSize;
+  if (dcc_Failure == dcc_encodePacket(packet, bytes, &bytesSize)) return dcc_Failure;
+  size_t index;
+  struct dcc_SchedulerDecoder *const decoder =
+    findDecoder(scheduler, dcc_addressOfEncodedPacket(bytes), true, &index);
+  if (decoder == NULL) return dcc_Failure;
+  enum dcc_SchedulerSlot const slot = slotOf(&packet);
+  struct dcc_SchedulerEntry *const entry = &decoder->entries[slot];
+  // 巡回するパケットが変わっていなければ優先して送り直す必要はない
+  if (slot != dcc_SchedulerSlot_OneShot && entry->exists && entry->bytesSize == bytesSize &&
+      memcmp(entry->bytes, bytes, bytesSize) == 0) {
+    return dcc_Success;
+  }
+  entry->packet = packet;
+  memcpy(entry->bytes, bytes, bytesSize);
+  entry->bytesSize = bytesSize;
+  entry->exists = true;
+  size_t const id = index * dcc_SchedulerSlotsCount + slot;
+  if (slot != dcc_SchedulerSlot_OneShot && !entry->refreshed) linkRefresh(scheduler, id);
+  entry->repeatsCount = scheduler->repeatsCount;
+  if (!entry->queued) pushQueue(scheduler, id);
+  return dcc_Success;
+}
+
+void dcc_stopRefreshing(struct dcc_Scheduler *const scheduler, dcc_AddressForExtendedPacket const address) {
+  size_t index;
+  struct dcc_SchedulerDecoder *const decoder = findDecoder(scheduler, address, false, &index);
+  if (decoder == NULL) return;
+  for (size_t slot = 0; slot < dcc_SchedulerSlotsCount; slot++) {
+    if (decoder->entries[slot].refreshed) unlinkRefresh(scheduler, index * dcc_SchedulerSlotsCount + slot);
+    decoder->entries[slot].exists = false;
+  }
+  releaseDecoderIfIdle(scheduler, index);
+}
+
+// 同じアドレスに続けて送る回数の上限を超えないか
+static bool canSend(struct dcc_Scheduler const *const scheduler, dcc_AddressForExtendedPacket const address) {
+  return !scheduler->lastAddressExists || scheduler->lastAddress != address ||
+         scheduler->backToBackCount < scheduler->maxBackToBackCount;
+}
+
+struct dcc_Packet dcc_nextScheduledPacket(struct dcc_Scheduler *const scheduler) {
+  size_t id = NONE;
+  // 変更されたパケットを巡回より優先する
+  // 先頭の要素を送れなければ2番目の要素を送る
+  size_t const head = scheduler->queueHead;
+  size_t const second = head == NONE ? NONE : entryAt(scheduler, head)->queueNext;
+  if (head != NONE && canSend(scheduler, addressAt(scheduler, head))) id = popQueue(scheduler, NONE);
+  else if (second != NONE && canSend(scheduler, addressAt(scheduler, second))) id = popQueue(scheduler, head);
+  if (id != NONE) {
+    struct dcc_SchedulerEntry *const entry = entryAt(scheduler, id);
+    if (0 < --entry->repeatsCount) pushQueue(scheduler, id);
+  } else if (scheduler->refreshCursor != NONE) {
+    // カーソルの要素を送れなければ次の要素と順序を入れ替えて送る
+    size_t const cursor = scheduler->refreshCursor;
+    size_t const next = entryAt(scheduler, cursor)->refreshNext;
+    if (canSend(scheduler, addressAt(scheduler, cursor))) {
+      id = cursor;
+      scheduler->refreshCursor = next;
+    } else if (canSend(scheduler, addressAt(scheduler, next))) {
+      id = next;
+      unlinkRefresh(scheduler, next);
+      linkRefresh(scheduler, next);
+    }
+  }
+  if (id == NONE) {
+    scheduler->lastAddressExists = false;
+    return (struct dcc_Packet){ .tag = dcc_IdlePacketForAllDecodersTag };
+  }
+  dcc_AddressForExtendedPacket const address = addressAt(scheduler, id);
+  if (scheduler->lastAddressExists && scheduler->lastAddress == address) {
+    scheduler->backToBackCount++;
+  } else {
+    scheduler->lastAddress = address;
+    scheduler->lastAddressExists = true;
+    scheduler->backToBackCount = 1;
+  }
+  struct dcc_Packet const packet = entryAt(scheduler, id)->packet;
+  // 巡回しないアドレスの最後のパケットを送ったらデコーダーを空ける
+  releaseDecoderIfIdle(scheduler, id / dcc_SchedulerSlotsCount);
+  return packet;
+}
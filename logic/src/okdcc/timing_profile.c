@@ -0,0 +1,122 @@
+#include <limits.h>
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "logic_internal.h"
+
+// 値が入る区間の添字
+// 範囲の外の値は最初か最後の区間に入れる
+static size_t bucketOf(long const value, long const min, long const width) {
+  if (value < min) return 0;
+  long const index = (value - min) / width;
+  return DCC_TIMING_PROFILE_BUCKETS_COUNT <= index ? DCC_TIMING_PROFILE_BUCKETS_COUNT - 1 : (size_t) index;
+}
+
+static bool isOneHalfBit(dcc_TimeMicroSec const period) {
+  return period < DCC_TIMING_PROFILE_ZERO_HALF_BIT_MIN;
+}
+
+struct dcc_TimingProfile dcc_initializeTimingProfile(void) {
+  return (struct dcc_TimingProfile){ .oneHalfBitCounts = { 0 },
+                                     .zeroHalfBitCounts = { 0 },
+                                     .oneBitAsymmetryCounts = { 0 } };
+}
+
+// 電圧変化ごとに呼ばれるので、ここではデバッグログを出力しない
+void dcc_profileHalfBitPeriod(struct dcc_TimingProfile *const profile, dcc_TimeMicroSec const period) {
+  // long に収まらない継続時間も最後の区間に入るので、飽和させてよい
+  long const value = period < LONG_MAX ? (long) period : LONG_MAX;
+  if (isOneHalfBit(period)) {
+    DCC_COUNT_UP(&profile->oneHalfBitCounts[bucketOf(
+      value, DCC_TIMING_PROFILE_ONE_HALF_BIT_MIN, DCC_TIMING_PROFILE_ONE_HALF_BIT_WIDTH)]);
+  } else {
+    DCC_COUNT_UP(&profile->zeroHalfBitCounts[bucketOf(
+      value, DCC_TIMING_PROFILE_ZERO_HALF_BIT_MIN, DCC_TIMING_PROFILE_ZERO_HALF_BIT_WIDTH)]);
+  }
+}
+
+// 電圧変化ごとに呼ばれるので、ここではデバッグログを出力しない
+void dcc_profileHalfBitPair(struct dcc_TimingProfile *const profile, dcc_TimeMicroSec const first,
+                            dcc_TimeMicroSec const second) {
+  if (!isOneHalfBit(first) || !isOneHalfBit(second)) return;
+  long const asymmetry = (long) second - (long) first;
+  DCC_COUNT_UP(&profile->oneBitAsymmetryCounts[bucketOf(
+    asymmetry, DCC_TIMING_PROFILE_ASYMMETRY_MIN, DCC_TIMING_PROFILE_ASYMMETRY_WIDTH)]);
+}
+
+struct dcc_TimingProfile dcc_getTimingProfile(struct dcc_TimingProfile const *const profile) {
+  DCC_DEBUG_LOG("dcc_getTimingProfile(profile: %p)", profile);
+  struct dcc_TimingProfile snapshot;
+  for (size_t i = 0; i < DCC_TIMING_PROFILE_BUCKETS_COUNT; i++) {
+    snapshot.oneHalfBitCounts[i] = DCC_LOAD_RELAXED(&profile->oneHalfBitCounts[i]);
+    snapshot.zeroHalfBitCounts[i] = DCC_LOAD_RELAXED(&profile->zeroHalfBitCounts[i]);
+    snapshot.oneBitAsymmetryCounts[i] = DCC_LOAD_RELAXED(&profile->oneBitAsymmetryCounts[i]);
+  }
+  return snapshot;
+}
+
+struct dcc_TimingProfile dcc_subtractTimingProfile(struct dcc_TimingProfile const *const until,
+                                                   struct dcc_TimingProfile const *const since) {
+  DCC_DEBUG_LOG("dcc_subtractTimingProfile(until: %p, since: %p)", until, since);
+  struct dcc_TimingProfile difference;
+  for (size_t i = 0; i < DCC_TIMING_PROFILE_BUCKETS_COUNT; i++) {
+    difference.oneHalfBitCounts[i] = until->oneHalfBitCounts[i] - since->oneHalfBitCounts[i];
+    difference.zeroHalfBitCounts[i] = until->zeroHalfBitCounts[i] - since->zeroHalfBitCounts[i];
+    difference.oneBitAsymmetryCounts[i] = until->oneBitAsymmetryCounts[i] - since->oneBitAsymmetryCounts[i];
+  }
+  return difference;
+}
+
+// バッファーが足りなくなっても書き込んだはずの文字数を数え続ける
+static void append(char *const buffer, size_t const bufferSize, int *const writtenSize, char const *const format,
+                   ...) {
+  size_t const offset = (size_t) *writtenSize;
+  va_list args;
+  va_start(args, format);
+  bool const fits = offset < bufferSize;
+  int const result = vsnprintf(fits ? buffer + offset : NULL, fits ? bufferSize - offset : 0, format, args);
+  va_end(args);
+  if (0 < result) *writtenSize += result;
+}
+
+static void showHistogram(char *const buffer, size_t const bufferSize, int *const writtenSize,
+                          char const *const name, long const min, long const width, size_t const *const counts) {
+  append(buffer, bufferSize, writtenSize, "\"%s\":{\"min\":%ld,\"width\":%ld,\"counts\":[", name, min, width);
+  for (size_t i = 0; i < DCC_TIMING_PROFILE_BUCKETS_COUNT; i++) {
+    append(buffer, bufferSize, writtenSize, i == 0 ? "%zu" : ",%zu", counts[i]);
+  }
+  append(buffer, bufferSize, writtenSize, "]}");
+}
+
+int dcc_showTimingProfile(char *buffer, size_t const bufferSize, struct dcc_TimingProfile const *const profile) {
+  int writtenSize = 0;
+  append(buffer, bufferSize, &writtenSize, "{");
+  showHistogram(buffer,
+                bufferSize,
+                &writtenSize,
+                "oneHalfBit",
+                DCC_TIMING_PROFILE_ONE_HALF_BIT_MIN,
+                DCC_TIMING_PROFILE_ONE_HALF_BIT_WIDTH,
+                profile->oneHalfBitCounts);
+  append(buffer, bufferSize, &writtenSize, ",");
+  showHistogram(buffer,
+                bufferSize,
+                &writtenSize,
+                "zeroHalfBit",
+                DCC_TIMING_PROFILE_ZERO_HALF_BIT_MIN,
+                DCC_TIMING_PROFILE_ZERO_HALF_BIT_WIDTH,
+                profile->zeroHalfBitCounts);
+  append(buffer, bufferSize, &writtenSize, ",");
+  showHistogram(buffer,
+                bufferSize,
+                &writtenSize,
+                "oneBitAsymmetry",
+                DCC_TIMING_PROFILE_ASYMMETRY_MIN,
+                DCC_TIMING_PROFILE_ASYMMETRY_WIDTH,
+                profile->oneBitAsymmetryCounts);
+  append(buffer, bufferSize, &writtenSize, "}");
+  return writtenSize;
+}
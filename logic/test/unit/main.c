@@ -1,5 +1,8 @@
+#include <limits.h>
 #include <munit.h>
 #include <okdcc/logic_internal.h>
+#include <pthread.h>
+#include <sched.h>
 #include <stdbool.h>
 
 static MunitResult test_writeSignalBuffer_1_is_success(MunitParameter const params[], void *fixture) {
@@ -50,6 +53,478 @@ static MunitResult test_SignalBuffer_1_write_write_read_is_failure_once_and_succ
   return MUNIT_OK;
 }
 
+static MunitResult test_SignalBuffer_3_has_2_elements(MunitParameter const params[], void *fixture) {
+  dcc_TimeMicroSec array[3] = { 0 };
+  struct dcc_SignalBuffer buffer = dcc_initializeSignalBuffer(array, 3);
+  munit_assert_size(2, ==, buffer.size);
+  munit_assert_int(dcc_Success, ==, dcc_writeSignalBuffer(&buffer, 1));
+  munit_assert_int(dcc_Success, ==, dcc_writeSignalBuffer(&buffer, 2));
+  munit_assert_int(dcc_Failure, ==, dcc_writeSignalBuffer(&buffer, 3));
+  return MUNIT_OK;
+}
+
+static MunitResult test_SignalBuffer_4_wraps_around(MunitParameter const params[], void *fixture) {
+  dcc_TimeMicroSec array[4] = { 0 };
+  struct dcc_SignalBuffer buffer = dcc_initializeSignalBuffer(array, 4);
+  dcc_TimeMicroSec expected = 0;
+  for (dcc_TimeMicroSec i = 0; i < 10; i++) {
+    munit_assert_int(dcc_Success, ==, dcc_writeSignalBuffer(&buffer, i));
+    if (i % 3 == 2) {
+      dcc_TimeMicroSec signal;
+      while (dcc_Success == dcc_readSignalBuffer(&buffer, &signal)) munit_assert_ulong(expected++, ==, signal);
+    }
+  }
+  return MUNIT_OK;
+}
+
+struct signalBufferStress {
+  struct dcc_SignalBuffer *buffer;
+  dcc_TimeMicroSec count;
+};
+
+static void *writeSignalBufferStress(void *arg) {
+  struct signalBufferStress *const stress = arg;
+  for (dcc_TimeMicroSec signal = 0; signal < stress->count; signal++) {
+    while (dcc_Failure == dcc_writeSignalBuffer(stress->buffer, signal)) sched_yield();
+  }
+  return NULL;
+}
+
+// 書き込み側と読み出し側を別スレッドで実行し、全ての時刻が欠落も重複もなく順番通りに読み出されることを確かめる
+static MunitResult signalBufferStress(size_t const size, dcc_TimeMicroSec const count) {
+  dcc_TimeMicroSec *const array = calloc(size, sizeof(dcc_TimeMicroSec));
+  munit_assert_not_null(array);
+  struct dcc_SignalBuffer buffer = dcc_initializeSignalBuffer(array, size);
+  struct signalBufferStress stress = { .buffer = &buffer, .count = count };
+  pthread_t writer;
+  munit_assert_int(0, ==, pthread_create(&writer, NULL, writeSignalBufferStress, &stress));
+  dcc_TimeMicroSec expected = 0;
+  while (expected < stress.count) {
+    dcc_TimeMicroSec signal;
+    if (dcc_Failure == dcc_readSignalBuffer(&buffer, &signal)) {
+      sched_yield();
+      continue;
+    }
+    if (signal != expected) munit_errorf("expected %lu but read %lu", expected, signal);
+    expected++;
+  }
+  munit_assert_int(0, ==, pthread_join(writer, NULL));
+  dcc_TimeMicroSec signal;
+  munit_assert_int(dcc_Failure, ==, dcc_readSignalBuffer(&buffer, &signal));
+  free(array);
+  return MUNIT_OK;
+}
+
+static MunitResult test_SignalBuffer_1_concurrent_write_read_loses_nothing(MunitParameter const params[],
+                                                                           void *fixture) {
+  return signalBufferStress(1, UINT32_C(1) << 16);
+}
+
+static MunitResult test_SignalBuffer_1024_concurrent_write_read_loses_nothing(MunitParameter const params[],
+                                                                              void *fixture) {
+  return signalBufferStress(1024, UINT32_C(1) << 22);
+}
+
+static MunitResult test_readSignalBufferSpans_4_wrapped_is_2_spans(MunitParameter const params[], void *fixture) {
+  dcc_TimeMicroSec array[4] = { 0 };
+  struct dcc_SignalBuffer buffer = dcc_initializeSignalBuffer(array, 4);
+  for (dcc_TimeMicroSec i = 0; i < 3; i++) munit_assert_int(dcc_Success, ==, dcc_writeSignalBuffer(&buffer, i));
+  struct dcc_SignalSpan spans[2];
+  munit_assert_size(1, ==, dcc_readSignalBufferSpans(&buffer, spans));
+  munit_assert_size(3, ==, spans[0].size);
+  dcc_releaseSignalBuffer(&buffer, 2);
+  for (dcc_TimeMicroSec i = 3; i < 6; i++) munit_assert_int(dcc_Success, ==, dcc_writeSignalBuffer(&buffer, i));
+  munit_assert_size(2, ==, dcc_readSignalBufferSpans(&buffer, spans));
+  munit_assert_size(2, ==, spans[0].size);
+  munit_assert_ulong(2, ==, spans[0].signals[0]);
+  munit_assert_ulong(3, ==, spans[0].signals[1]);
+  munit_assert_size(2, ==, spans[1].size);
+  munit_assert_ulong(4, ==, spans[1].signals[0]);
+  munit_assert_ulong(5, ==, spans[1].signals[1]);
+  dcc_releaseSignalBuffer(&buffer, 4);
+  munit_assert_size(0, ==, dcc_readSignalBufferSpans(&buffer, spans));
+  return MUNIT_OK;
+}
+
+// プリアンブル、パケット開始ビット、データバイト、パケット終了ビットからなるパケットを送信したときの電圧変化の時刻の列を作る
+// 最初の半ビットの開始時刻 `*time` は含まず、最後の半ビットの終了時刻を `*time` に設定する
+static size_t makeSignals(dcc_Byte const *const bytes, size_t const bytesSize, dcc_TimeMicroSec *const time,
+                          dcc_TimeMicroSec *const signals) {
+  size_t size = 0;
+#define PUSH_BIT(bit)                                      \
+  do {                                                     \
+    dcc_TimeMicroSec const halfBit = (bit) ? 58UL : 100UL; \
+    signals[size++] = *time += halfBit;                    \
+    signals[size++] = *time += halfBit;                    \
+  } while (0)
+  for (int i = 0; i < 14; i++) PUSH_BIT(1);
+  for (size_t i = 0; i < bytesSize; i++) {
+    PUSH_BIT(0);
+    for (int j = 7; 0 <= j; j--) PUSH_BIT((bytes[i] >> j) & 1);
+  }
+  PUSH_BIT(1);
+#undef PUSH_BIT
+  return size;
+}
+
+static MunitResult test_decodeBatch_3_idle_packets_is_3_packets(MunitParameter const params[], void *fixture) {
+  dcc_Byte const bytes[3] = { UINT8_C(0xFF), UINT8_C(0x00), UINT8_C(0xFF) };
+  dcc_TimeMicroSec signals[1 + 3 * 128];
+  dcc_TimeMicroSec time = 0;
+  size_t signalsSize = 0;
+  signals[signalsSize++] = time;
+  for (int i = 0; i < 3; i++) signalsSize += makeSignals(bytes, 3, &time, signals + signalsSize);
+  dcc_TimeMicroSec array[1] = { 0 };
+  struct dcc_Decoder decoder = dcc_initializeDecoder(array, 1);
+  struct dcc_Packet packets[4];
+  size_t packetsCount;
+  size_t const consumed = dcc_decodeBatch(&decoder, signals, signalsSize, packets, 4, &packetsCount);
+  munit_assert_size(signalsSize, ==, consumed);
+  munit_assert_size(3, ==, packetsCount);
+  for (size_t i = 0; i < packetsCount; i++) munit_assert_int(dcc_IdlePacketForAllDecodersTag, ==, packets[i].tag);
+  return MUNIT_OK;
+}
+
+static MunitResult test_decodeView_speed_packet_is_raw_bytes_in_decoder(MunitParameter const params[],
+                                                                         void *fixture) {
+  dcc_Byte const bytes[3] = { UINT8_C(0x01), UINT8_C(0x6A), UINT8_C(0x6B) };
+  dcc_TimeMicroSec signals[1 + 128];
+  dcc_TimeMicroSec time = 0;
+  size_t signalsSize = 0;
+  signals[signalsSize++] = time;
+  signalsSize += makeSignals(bytes, 3, &time, signals + signalsSize);
+  struct dcc_Decoder decoder = dcc_initializeDecoder(NULL, 0);
+  struct dcc_Packet packet;
+  struct dcc_BytesView view = { .bytes = NULL, .size = 0 };
+  for (size_t i = 0; i + 1 < signalsSize; i++) {
+    munit_assert_int(dcc_StreamParserResult_Success, !=, dcc_decodeView(&decoder, signals[i], &packet, &view));
+  }
+  munit_assert_int(dcc_StreamParserResult_Success,
+                   ==,
+                   dcc_decodeView(&decoder, signals[signalsSize - 1], &packet, &view));
+  munit_assert_int(dcc_SpeedAndDirectionPacketForLocomotiveDecodersTag, ==, packet.tag);
+  munit_assert_ptr_equal(decoder.bitStreamParser.bytes, view.bytes);
+  munit_assert_size(3, ==, view.size);
+  munit_assert_memory_equal(3, bytes, view.bytes);
+  return MUNIT_OK;
+}
+
+static MunitResult test_decodeBatch_stops_when_packets_is_full(MunitParameter const params[], void *fixture) {
+  dcc_Byte const bytes[3] = { UINT8_C(0xFF), UINT8_C(0x00), UINT8_C(0xFF) };
+  dcc_TimeMicroSec signals[1 + 3 * 128];
+  dcc_TimeMicroSec time = 0;
+  size_t signalsSize = 0;
+  signals[signalsSize++] = time;
+  for (int i = 0; i < 3; i++) signalsSize += makeSignals(bytes, 3, &time, signals + signalsSize);
+  dcc_TimeMicroSec array[1] = { 0 };
+  struct dcc_Decoder decoder = dcc_initializeDecoder(array, 1);
+  struct dcc_Packet packets[1];
+  size_t packetsCount;
+  size_t consumed = 0;
+  for (int i = 0; i < 3; i++) {
+    consumed += dcc_decodeBatch(&decoder, signals + consumed, signalsSize - consumed, packets, 1, &packetsCount);
+    munit_assert_size(1, ==, packetsCount);
+    munit_assert_int(dcc_IdlePacketForAllDecodersTag, ==, packets[0].tag);
+  }
+  munit_assert_size(signalsSize, ==, consumed);
+  return MUNIT_OK;
+}
+
+static MunitResult test_decodeBatch_empty_packets_discards_packets(MunitParameter const params[], void *fixture) {
+  dcc_Byte const bytes[3] = { UINT8_C(0xFF), UINT8_C(0x00), UINT8_C(0xFF) };
+  dcc_TimeMicroSec signals[1 + 3 * 128];
+  dcc_TimeMicroSec time = 0;
+  size_t signalsSize = 0;
+  signals[signalsSize++] = time;
+  for (int i = 0; i < 2; i++) signalsSize += makeSignals(bytes, 3, &time, signals + signalsSize);
+  size_t const firstSize = signalsSize;
+  signalsSize += makeSignals(bytes, 3, &time, signals + signalsSize);
+  dcc_TimeMicroSec array[1] = { 0 };
+  struct dcc_Decoder decoder = dcc_initializeDecoder(array, 1);
+  struct dcc_Packet packets[1];
+  size_t packetsCount = 1;
+  munit_assert_size(firstSize, ==, dcc_decodeBatch(&decoder, signals, firstSize, packets, 0, &packetsCount));
+  munit_assert_size(0, ==, packetsCount);
+  // 捨てた後も続きをデコードできる
+  munit_assert_size(signalsSize - firstSize,
+                    ==,
+                    dcc_decodeBatch(&decoder, signals + firstSize, signalsSize - firstSize, packets, 1, &packetsCount));
+  munit_assert_size(1, ==, packetsCount);
+  munit_assert_int(dcc_IdlePacketForAllDecodersTag, ==, packets[0].tag);
+  return MUNIT_OK;
+}
+
+static MunitResult test_PeriodBuffer_saturates_long_period(MunitParameter const params[], void *fixture) {
+  dcc_HalfBitPeriod array[2] = { 0 };
+  struct dcc_PeriodBuffer buffer = dcc_initializePeriodBuffer(array, 2);
+  munit_assert_int(dcc_Success, ==, dcc_writePeriodBuffer(&buffer, 12000UL));
+  munit_assert_int(dcc_Success, ==, dcc_writePeriodBuffer(&buffer, 100000UL));
+  munit_assert_int(dcc_Failure, ==, dcc_writePeriodBuffer(&buffer, 58UL));
+  dcc_HalfBitPeriod period;
+  munit_assert_int(dcc_Success, ==, dcc_readPeriodBuffer(&buffer, &period));
+  munit_assert_uint16(12000, ==, period);
+  munit_assert_int(dcc_Success, ==, dcc_readPeriodBuffer(&buffer, &period));
+  munit_assert_uint16(DCC_HALF_BIT_PERIOD_MAX, ==, period);
+  munit_assert_int(dcc_Failure, ==, dcc_readPeriodBuffer(&buffer, &period));
+  return MUNIT_OK;
+}
+
+static MunitResult test_PeriodBuffer_lost_signal_is_marked_as_gap(MunitParameter const params[], void *fixture) {
+  dcc_HalfBitPeriod array[2] = { 0 };
+  struct dcc_PeriodBuffer buffer = dcc_initializePeriodBuffer(array, 2);
+  munit_assert_int(dcc_Success, ==, dcc_writeSignalToPeriodBuffer(&buffer, 1000UL));
+  munit_assert_int(dcc_Success, ==, dcc_writeSignalToPeriodBuffer(&buffer, 1058UL));
+  munit_assert_int(dcc_Success, ==, dcc_writeSignalToPeriodBuffer(&buffer, 1116UL));
+  munit_assert_int(dcc_Failure, ==, dcc_writeSignalToPeriodBuffer(&buffer, 1174UL));
+  dcc_HalfBitPeriod period;
+  munit_assert_int(dcc_Success, ==, dcc_readPeriodBuffer(&buffer, &period));
+  munit_assert_uint16(58, ==, period);
+  munit_assert_int(dcc_Success, ==, dcc_readPeriodBuffer(&buffer, &period));
+  munit_assert_uint16(58, ==, period);
+  // 失われた変化は途切れの印になり、次の継続時間には含まれない
+  munit_assert_int(dcc_Success, ==, dcc_writeSignalToPeriodBuffer(&buffer, 1232UL));
+  munit_assert_int(dcc_Success, ==, dcc_readPeriodBuffer(&buffer, &period));
+  munit_assert_uint16(DCC_HALF_BIT_PERIOD_MAX, ==, period);
+  munit_assert_int(dcc_Success, ==, dcc_readPeriodBuffer(&buffer, &period));
+  munit_assert_uint16(58, ==, period);
+  munit_assert_int(dcc_Failure, ==, dcc_readPeriodBuffer(&buffer, &period));
+  return MUNIT_OK;
+}
+
+static MunitResult test_decodePeriodBatch_3_idle_packets_is_3_packets(MunitParameter const params[], void *fixture) {
+  dcc_Byte const bytes[3] = { UINT8_C(0xFF), UINT8_C(0x00), UINT8_C(0xFF) };
+  dcc_TimeMicroSec signals[1 + 3 * 128];
+  dcc_TimeMicroSec time = 0;
+  size_t signalsSize = 0;
+  signals[signalsSize++] = time;
+  for (int i = 0; i < 3; i++) signalsSize += makeSignals(bytes, 3, &time, signals + signalsSize);
+  dcc_HalfBitPeriod array[512] = { 0 };
+  struct dcc_PeriodBuffer buffer = dcc_initializePeriodBuffer(array, 512);
+  for (size_t i = 0; i < signalsSize; i++) {
+    munit_assert_int(dcc_Success, ==, dcc_writeSignalToPeriodBuffer(&buffer, signals[i]));
+  }
+  struct dcc_PeriodSpan spans[2];
+  munit_assert_size(1, ==, dcc_readPeriodBufferSpans(&buffer, spans));
+  munit_assert_size(signalsSize - 1, ==, spans[0].size);
+  struct dcc_Decoder decoder = dcc_initializeDecoder(NULL, 0);
+  struct dcc_Packet packets[4];
+  size_t packetsCount;
+  size_t const consumed = dcc_decodePeriodBatch(&decoder, spans[0].periods, spans[0].size, packets, 4, &packetsCount);
+  munit_assert_size(spans[0].size, ==, consumed);
+  dcc_releasePeriodBuffer(&buffer, consumed);
+  munit_assert_size(3, ==, packetsCount);
+  for (size_t i = 0; i < packetsCount; i++) munit_assert_int(dcc_IdlePacketForAllDecodersTag, ==, packets[i].tag);
+  munit_assert_size(0, ==, dcc_readPeriodBufferSpans(&buffer, spans));
+  return MUNIT_OK;
+}
+
+static MunitResult test_elapsedTime_0xFFFFFFF0_0x10_is_0x20(MunitParameter const params[], void *fixture) {
+  munit_assert_ulong(58, ==, dcc_elapsedTime(1000UL, 1058UL));
+  munit_assert_ulong(0x20, ==, dcc_elapsedTime(0xFFFFFFF0UL, 0x10UL));
+  munit_assert_ulong(0x20, ==, dcc_elapsedTime(0xFFFFFFF0UL, (dcc_TimeMicroSec) UINT64_C(0x100000010)));
+  return MUNIT_OK;
+}
+
+// 時刻の一周をいくつもまたいでパケットを送り続けても1つも失わないことを確かめる
+// 送信側の時刻は64ビットで数え、デコーダーには32ビットに切り詰めた時刻を渡す
+static MunitResult test_decode_across_wrap_points_loses_nothing(MunitParameter const params[], void *fixture) {
+  dcc_Byte const idle[3] = { UINT8_C(0xFF), UINT8_C(0x00), UINT8_C(0xFF) };
+  dcc_Byte const speed[3] = { UINT8_C(0x01), UINT8_C(0x6A), UINT8_C(0x6B) };
+  struct dcc_Decoder signalDecoder = dcc_initializeDecoder(NULL, 0);
+  struct dcc_Decoder periodDecoder = dcc_initializeDecoder(NULL, 0);
+  dcc_HalfBitPeriod array[128] = { 0 };
+  struct dcc_PeriodBuffer buffer = dcc_initializePeriodBuffer(array, 128);
+  size_t sent = 0;
+  size_t signalDecoded = 0;
+  size_t periodDecoded = 0;
+  for (uint64_t wrap = 1; wrap <= 4; wrap++) {
+    // 一周の手前から一周の後までパケットを送り続ける
+    uint64_t time = (wrap << 32) - 2000000;
+    while (time < (wrap << 32) + 2000000) {
+      bool const isIdle = sent % 3 == 0;
+      dcc_TimeMicroSec signals[128];
+      dcc_TimeMicroSec signalTime = 0;
+      size_t const signalsSize = makeSignals(isIdle ? idle : speed, 3, &signalTime, signals);
+      for (size_t i = 0; i < signalsSize; i++) {
+        dcc_TimeMicroSec const signal = (dcc_TimeMicroSec) ((time + signals[i]) & DCC_TIME_MICRO_SEC_MASK);
+        struct dcc_Packet packet;
+        if (dcc_StreamParserResult_Success == dcc_decode(&signalDecoder, signal, &packet)) {
+          enum dcc_PacketTag const expected =
+            isIdle ? dcc_IdlePacketForAllDecodersTag : dcc_SpeedAndDirectionPacketForLocomotiveDecodersTag;
+          munit_assert_int(expected, ==, packet.tag);
+          signalDecoded++;
+        }
+        munit_assert_int(dcc_Success, ==, dcc_writeSignalToPeriodBuffer(&buffer, signal));
+        dcc_HalfBitPeriod period;
+        if (dcc_Failure == dcc_readPeriodBuffer(&buffer, &period)) continue;  // 最初の電圧変化は時刻の記録のみ
+        if (dcc_StreamParserResult_Success == dcc_decodePeriod(&periodDecoder, period, &packet)) periodDecoded++;
+      }
+      time += signalTime;
+      sent++;
+      munit_assert_size(sent, ==, signalDecoded);
+    }
+  }
+  munit_assert_size(sent, ==, periodDecoded);
+  return MUNIT_OK;
+}
+
+// 雑音の入ったパケットの信号の列を作る
+// 一部の半ビットの途中に余分な電圧変化を挟み、一部の半ビットの長さを揺らす
+static size_t makeNoisySignals(dcc_TimeMicroSec *const signals, size_t const capacity) {
+  dcc_Byte const packets[3][3] = { { 0xFF, 0x00, 0xFF }, { 0x01, 0x6A, 0x6B }, { 0x03, 0x3F, 0x3C } };
+  dcc_TimeMicroSec clean[128];
+  dcc_TimeMicroSec time = 0;
+  dcc_TimeMicroSec previous = 0;
+  size_t size = 0;
+  for (int n = 0; size + 256 <= capacity; n++) {
+    dcc_TimeMicroSec start = time;
+    size_t const cleanSize = makeSignals(packets[n % 3], 3, &time, clean);
+    for (size_t i = 0; i < cleanSize; i++) {
+      dcc_TimeMicroSec const jitter = (dcc_TimeMicroSec) munit_rand_int_range(0, 8);
+      if (munit_rand_int_range(0, 40) == 0) signals[size++] = previous + (clean[i] - start) / 2;
+      previous = clean[i] + jitter;
+      signals[size++] = previous;
+      start = clean[i];
+    }
+  }
+  return size;
+}
+
+// dcc_feedSignal で1つずつデコードしたビットの列
+static size_t decodeSignalsToBitsReference(struct dcc_SignalStreamParser *const parser,
+                                           dcc_TimeMicroSec const *const signals, size_t const signalsSize,
+                                           dcc_Bit *const bits) {
+  size_t count = 0;
+  for (size_t i = 0; i < signalsSize; i++) {
+    if (dcc_StreamParserResult_Success == dcc_feedSignal(parser, signals[i], &bits[count])) count++;
+  }
+  return count;
+}
+
+static dcc_Bit packedBit(uint32_t const *const bits, size_t const index) {
+  return (bits[index / 32] >> (31 - index % 32)) & 1;
+}
+
+// 信号の列を様々な大きさに分けて与え、出力の容量を `bitsCapacity` に制限してデコードしたものが、1つずつデコードしたものと同じであることを確かめる
+static MunitResult decodeSignalsToBitsIsReference(struct dcc_ReceiveTiming const *const timing,
+                                                  size_t const bitsCapacity) {
+  static dcc_TimeMicroSec signals[1 << 14];
+  static dcc_Bit expected[1 << 14];
+  static uint32_t bits[(1 << 14) / 32];
+  size_t const signalsSize = makeNoisySignals(signals, sizeof signals / sizeof signals[0]);
+  struct dcc_SignalStreamParser expectedParser = dcc_initializeSignalStreamParser();
+  expectedParser.receiveTiming = timing;
+  size_t const expectedSize = decodeSignalsToBitsReference(&expectedParser, signals, signalsSize, expected);
+  struct dcc_SignalStreamParser parser = dcc_initializeSignalStreamParser();
+  parser.receiveTiming = timing;
+  size_t consumed = 0;
+  size_t actualSize = 0;
+  while (consumed < signalsSize) {
+    size_t const size = (size_t) munit_rand_int_range(1, 300);
+    size_t bitsSize;
+    consumed += dcc_decodeSignalsToBits(&parser,
+                                        signals + consumed,
+                                        size < signalsSize - consumed ? size : signalsSize - consumed,
+                                        bits,
+                                        bitsCapacity,
+                                        &bitsSize);
+    for (size_t i = 0; i < bitsSize; i++) {
+      if (expected[actualSize + i] != packedBit(bits, i)) munit_errorf("bit %zu differs", actualSize + i);
+    }
+    actualSize += bitsSize;
+  }
+  munit_assert_size(expectedSize, ==, actualSize);
+  munit_assert_ulong(expectedParser.signal, ==, parser.signal);
+  munit_assert_int(expectedParser.periodExists, ==, parser.periodExists);
+  if (parser.periodExists) munit_assert_ulong(expectedParser.period, ==, parser.period);
+  munit_assert_int(expectedParser.fragmentExists, ==, parser.fragmentExists);
+  if (parser.fragmentExists) munit_assert_ulong(expectedParser.fragment, ==, parser.fragment);
+  munit_assert_int(expectedParser.oddPeriod, ==, parser.oddPeriod);
+  return MUNIT_OK;
+}
+
+static MunitResult test_decodeSignalsToBits_is_the_same_as_feedSignal(MunitParameter const params[], void *fixture) {
+  return decodeSignalsToBitsIsReference(NULL, 1 << 14);
+}
+
+static MunitResult test_decodeSignalsToBits_with_small_capacity_is_the_same_as_feedSignal(MunitParameter const params[],
+                                                                                         void *fixture) {
+  return decodeSignalsToBitsIsReference(NULL, 5);
+}
+
+static MunitResult test_decodeSignalsToBits_tolerant_is_the_same_as_feedSignal(MunitParameter const params[],
+                                                                              void *fixture) {
+  return decodeSignalsToBitsIsReference(&dcc_tolerantReceiveTiming, 1 << 14);
+}
+
+static void pushPackedBit(uint32_t *const bits, size_t *const size, dcc_Bit const bit) {
+  if (*size % 32 == 0) bits[*size / 32] = 0;
+  bits[*size / 32] |= (uint32_t) bit << (31 - *size % 32);
+  (*size)++;
+}
+
+// 長さの異なるプリアンブル、長さの異なるパケット、ランダムなビットを混ぜたビットの列を作る
+static size_t makeRandomPackets(uint32_t *const bits, size_t const capacity) {
+  size_t size = 0;
+  while (size + 256 <= capacity) {
+    int const preamble = munit_rand_int_range(8, 20);
+    for (int i = 0; i < preamble; i++) pushPackedBit(bits, &size, 1);
+    int const bytesSize = munit_rand_int_range(1, DCC_BIT_STREAM_PARSER_BYTES_CAPACITY + 2);
+    for (int i = 0; i < bytesSize; i++) {
+      pushPackedBit(bits, &size, 0);
+      dcc_Byte const byte = (dcc_Byte) munit_rand_uint32();
+      for (int j = 7; 0 <= j; j--) pushPackedBit(bits, &size, (byte >> j) & 1);
+    }
+    pushPackedBit(bits, &size, 1);
+    int const noise = munit_rand_int_range(0, 3) == 0 ? munit_rand_int_range(1, 40) : 0;
+    for (int i = 0; i < noise; i++) pushPackedBit(bits, &size, munit_rand_int_range(0, 1) == 1);
+  }
+  return size;
+}
+
+static MunitResult test_feedBits_is_the_same_as_feedBit(MunitParameter const params[], void *fixture) {
+  static uint32_t bits[(1 << 16) / 32];
+  size_t const bitsSize = makeRandomPackets(bits, 1 << 16);
+  struct dcc_BitStreamParser expectedParser = dcc_initializeBitStreamParser();
+  struct dcc_BitStreamParser parser = dcc_initializeBitStreamParser();
+  size_t expectedIndex = 0;
+  size_t position = 0;
+  size_t packetsCount = 0;
+  // 区切りをまたぐ場合を確かめるため、ビットの列をランダムな長さに区切って与える
+  size_t end = 0;
+  while (position < bitsSize) {
+    if (position == end) {
+      end += (size_t) munit_rand_int_range(1, 200);
+      if (bitsSize < end) end = bitsSize;
+    }
+    dcc_Byte bytes[DCC_BIT_STREAM_PARSER_BYTES_CAPACITY];
+    size_t bytesSize;
+    if (dcc_StreamParserResult_Continue == dcc_feedBits(&parser, bits, &position, end, bytes, &bytesSize)) continue;
+    dcc_Byte expectedBytes[DCC_BIT_STREAM_PARSER_BYTES_CAPACITY];
+    size_t expectedBytesSize;
+    while (dcc_StreamParserResult_Success != dcc_feedBit(&expectedParser,
+                                                         packedBit(bits, expectedIndex++),
+                                                         expectedBytes,
+                                                         &expectedBytesSize)) {
+    }
+    munit_assert_size(expectedIndex, ==, position);
+    munit_assert_size(expectedBytesSize, ==, bytesSize);
+    munit_assert_memory_equal(bytesSize, expectedBytes, bytes);
+    packetsCount++;
+  }
+  dcc_Byte bytes[DCC_BIT_STREAM_PARSER_BYTES_CAPACITY];
+  size_t bytesSize;
+  while (expectedIndex < bitsSize) {
+    munit_assert_int(dcc_StreamParserResult_Success,
+                     !=,
+                     dcc_feedBit(&expectedParser, packedBit(bits, expectedIndex++), bytes, &bytesSize));
+  }
+  munit_assert_size(0, <, packetsCount);
+  munit_assert_int(expectedParser.state, ==, parser.state);
+  munit_assert_size(expectedParser.bytesSize, ==, parser.bytesSize);
+  return MUNIT_OK;
+}
+
 static MunitResult test_decodeSignal_58_58_is_1(MunitParameter const params[], void *fixture) {
   dcc_Bit bit;
   munit_assert_int(dcc_Success, ==, dcc_decodeSignal(58UL, 58UL, &bit));
@@ -70,6 +545,57 @@ static MunitResult test_decodeSignal_100_9000_is_0(MunitParameter const params[]
   return MUNIT_OK;
 }
 
+// 許容時間の定数をそのまま条件にした dcc_decodeSignal の参照実装
+static enum dcc_Result decodeSignalReference(dcc_TimeMicroSec const period1, dcc_TimeMicroSec const period2,
+                                             dcc_Bit *const bit) {
+  dcc_TimeMicroSec const diff = period1 > period2 ? period1 - period2 : period2 - period1;
+  if (period1 >= dcc_minOneHalfBitReceivedPeriod && period1 <= dcc_maxOneHalfBitReceivedPeriod &&
+      diff <= dcc_maxOneHalfBitReceivedPeriodDiff) {
+    *bit = 1;
+    return dcc_Success;
+  }
+  if (period1 >= dcc_minZeroHalfBitReceivedPeriod && period1 <= dcc_maxZeroHalfBitReceivedPeriod &&
+      period2 >= dcc_minZeroHalfBitReceivedPeriod && period2 <= dcc_maxZeroHalfBitReceivedPeriod &&
+      period1 + period2 <= dcc_maxStretchedZeroBitPeriod) {
+    *bit = 0;
+    return dcc_Success;
+  }
+  return dcc_Failure;
+}
+
+static MunitResult test_decodeSignal_is_the_same_as_reference_around_every_threshold(MunitParameter const params[],
+                                                                                     void *fixture) {
+  // 全ての閾値の前後を含む継続時間の集合
+  dcc_TimeMicroSec periods[1024];
+  size_t periodsSize = 0;
+  for (dcc_TimeMicroSec period = 0; period <= 200; period++) periods[periodsSize++] = period;
+  for (dcc_TimeMicroSec period = 1980; period <= 2020; period++) periods[periodsSize++] = period;
+  for (dcc_TimeMicroSec period = 5990; period <= 6010; period++) periods[periodsSize++] = period;
+  for (dcc_TimeMicroSec period = 9890; period <= 10010; period++) periods[periodsSize++] = period;
+  for (dcc_TimeMicroSec period = 11990; period <= 12010; period++) periods[periodsSize++] = period;
+  periods[periodsSize++] = DCC_HALF_BIT_PERIOD_MAX;
+  periods[periodsSize++] = DCC_TIME_MICRO_SEC_MASK;
+  periods[periodsSize++] = ULONG_MAX;
+  for (size_t i = 0; i < periodsSize; i++) {
+    for (size_t j = 0; j < periodsSize; j++) {
+      dcc_Bit expectedBit = 0;
+      dcc_Bit actualBit = 0;
+      enum dcc_Result const expected = decodeSignalReference(periods[i], periods[j], &expectedBit);
+      enum dcc_Result const actual = dcc_decodeSignal(periods[i], periods[j], &actualBit);
+      if (expected != actual || expectedBit != actualBit) {
+        munit_errorf("(%lu, %lu): expected %d (%d) but %d (%d)",
+                     periods[i],
+                     periods[j],
+                     expected,
+                     expectedBit,
+                     actual,
+                     actualBit);
+      }
+    }
+  }
+  return MUNIT_OK;
+}
+
 static MunitResult test_feedSignal_0_is_continue(MunitParameter const params[], void *fixture) {
   struct dcc_SignalStreamParser parser = dcc_initializeSignalStreamParser();
   dcc_Bit bit;
@@ -88,7 +614,8 @@ static MunitResult test_feedSignal_0_1_is_continue(MunitParameter const params[]
   return MUNIT_OK;
 }
 
-static MunitResult test_feedSignal_0_1_2_is_failure(MunitParameter const params[], void *fixture) {
+// 半ビットになり得ない短い継続時間は、スパイクの断片として次の継続時間に足される
+static MunitResult test_feedSignal_0_1_2_is_fragment(MunitParameter const params[], void *fixture) {
   struct dcc_SignalStreamParser parser = dcc_initializeSignalStreamParser();
   dcc_Bit bit;
   enum dcc_StreamParserResult const result1 = dcc_feedSignal(&parser, 0, &bit);
@@ -96,6 +623,21 @@ static MunitResult test_feedSignal_0_1_2_is_failure(MunitParameter const params[
   enum dcc_StreamParserResult const result2 = dcc_feedSignal(&parser, 1, &bit);
   munit_assert_int(dcc_StreamParserResult_Continue, ==, result2);
   enum dcc_StreamParserResult const result3 = dcc_feedSignal(&parser, 2, &bit);
+  munit_assert_int(dcc_StreamParserResult_Continue, ==, result3);
+  munit_assert_true(parser.fragmentExists);
+  munit_assert_ulong(2, ==, parser.fragment);
+  munit_assert_false(parser.periodExists);
+  return MUNIT_OK;
+}
+
+static MunitResult test_feedSignal_0_58_158_is_failure(MunitParameter const params[], void *fixture) {
+  struct dcc_SignalStreamParser parser = dcc_initializeSignalStreamParser();
+  dcc_Bit bit;
+  enum dcc_StreamParserResult const result1 = dcc_feedSignal(&parser, 0, &bit);
+  munit_assert_int(dcc_StreamParserResult_Continue, ==, result1);
+  enum dcc_StreamParserResult const result2 = dcc_feedSignal(&parser, 58, &bit);
+  munit_assert_int(dcc_StreamParserResult_Continue, ==, result2);
+  enum dcc_StreamParserResult const result3 = dcc_feedSignal(&parser, 158, &bit);
   munit_assert_int(dcc_StreamParserResult_Failure, ==, result3);
   return MUNIT_OK;
 }
@@ -202,131 +744,2217 @@ static MunitResult test_parseResetPacketForMultiFunctionDecoders_0b11000011_0b00
   return MUNIT_OK;
 }
 
-static MunitSuite const suite = {
-  "/okdcc",
-  NULL,
-  (MunitSuite[]){
-    { // name, tests, suites, iterations, options
-      "/SignalBuffer",
-      (MunitTest[]){
-        { "(1)/write is success", test_writeSignalBuffer_1_is_success, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL },
-        { "(1)/read is failure", test_SignalBuffer_1_read_is_failure, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL },
-        { "(1)/write write is failure",
-          test_writeSignalBuffer_1_2_is_failure,
-          NULL,
-          NULL,
-          MUNIT_TEST_OPTION_NONE,
-          NULL },
-        { "(1)/write read write read is success",
-          test_SignalBuffer_1_write_read_write_read_is_success,
-          NULL,
-          NULL,
-          MUNIT_TEST_OPTION_NONE,
-          NULL },
-        { "(1)/write write read is failure once and success",
-          test_SignalBuffer_1_write_write_read_is_failure_once_and_success,
-          NULL,
-          NULL,
-          MUNIT_TEST_OPTION_NONE,
-          NULL },
-        { NULL, NULL, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL } },
-      NULL,
-      1,
-      MUNIT_SUITE_OPTION_NONE },
-    { "/dcc_decodeSignal",
-      (MunitTest[]){
-        // name, test, setup, tear down, options, parameters
-        { "(58, 58) is 1", test_decodeSignal_58_58_is_1, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL },
-        { "(100, 9000) is 0", test_decodeSignal_100_9000_is_0, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL },
-        { "(51, 58) is failure", test_decodeSignal_51_58_is_failure, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL },
-        { NULL, NULL, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL } },
-      NULL,
-      1,
-      MUNIT_SUITE_OPTION_NONE },
-    { "/dcc_feedSignal",
-      (MunitTest[]){
-        { "([0]) is continue", test_feedSignal_0_is_continue, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL },
-        { "([0, 1]) is continue", test_feedSignal_0_1_is_continue, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL },
-        { "([0, 1, 2]) is failure", test_feedSignal_0_1_2_is_failure, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL },
-        { "([0, 57, 114]) is success", test_feedSignal_0_57_114_is_1, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL },
-        { NULL, NULL, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL } },
-      NULL,
-      1,
-      MUNIT_SUITE_OPTION_NONE },
-    { "/dcc_validatePacket",
-      (MunitTest[]){ { "([0x00], 0x00) is success",
-                       test_validatePacket_0x00_0x00_is_success,
-                       NULL,
-                       NULL,
-                       MUNIT_TEST_OPTION_NONE,
-                       NULL },
-                     { "([0x00], 0x01) is failure",
-                       test_validatePacket_0x00_0x01_is_failure,
-                       NULL,
-                       NULL,
-                       MUNIT_TEST_OPTION_NONE,
-                       NULL },
-                     { "([0x00, 0x01], 0x01) is success",
-                       test_validatePacket_0x00_0x01_0x01_is_success,
-                       NULL,
-                       NULL,
-                       MUNIT_TEST_OPTION_NONE,
-                       NULL },
-                     { NULL, NULL, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL } },
-      NULL,
-      1,
-      MUNIT_SUITE_OPTION_NONE },
-    { "/dcc_parseSpeedAndDirectionPacketForLocomotiveDecoders",
-      (MunitTest[]){
-        { "([0b00000001, 0b01101010], 0b01101011) is { address = 1, direction = forward, emergencyStop = false, "
-          "flControl = false, speed5Step = 17, directionMayBeIgnored = false }",
-          test_parseSpeedAndDirectionPacketForLocomotiveDecoders_0b00000001_0b01101010_0b01101011_is_1_forward_20,
-          NULL,
-          NULL,
-          MUNIT_TEST_OPTION_NONE,
-          NULL },
-        { "([0b00000001, 0b01101010], 0b01101011) is { address = 1, direction = forward, emergencyStop = false, "
-          "flControl = true, speed4Step = 9, fl = false }",
-          test_parseSpeedAndDirectionPacketForLocomotiveDecoders_0b00000001_0b01101010_0b01101011_is_1_forward_9_off,
-          NULL,
-          NULL,
-          MUNIT_TEST_OPTION_NONE,
-          NULL },
-        { NULL, NULL, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL } },
-      NULL,
-      1,
-      MUNIT_SUITE_OPTION_NONE },
-    { "/dcc_parseResetPacketForAllDecoders",
-      (MunitTest[]){ { "([0b00000000, 0b00000000, 0b00000000]) is success",
-                       test_parseResetPacketForAllDecoders_0b00000000_0b00000000_0b00000000_is_success,
-                       NULL,
-                       NULL,
-                       MUNIT_TEST_OPTION_NONE,
-                       NULL },
-                     { NULL, NULL, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL } },
-      NULL,
-      1,
-      MUNIT_SUITE_OPTION_NONE },
-    { "/dcc_parseIdlePacketForAllDecoders",
-      (MunitTest[]){ { "([0b11111111, 0b00000000, 0b11111111]) is success",
-                       test_parseIdlePacketForAllDecoders_0b11111111_0b00000000_0b11111111_is_success,
-                       NULL,
-                       NULL,
-                       MUNIT_TEST_OPTION_NONE,
-                       NULL },
-                     { NULL, NULL, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL } },
-      NULL,
-      1,
-      MUNIT_SUITE_OPTION_NONE },
-    { "/dcc_parseResetPacketForMultiFunctionDecoders",
-      (MunitTest[]){ { "([0b00000110, 0b0000000, 0b00000110]) is { address = 3 }",
-                       test_parseResetPacketForMultiFunctionDecoders_0b00000011_0b0000000_0b00000011_is_3,
-                       NULL,
-                       NULL,
-                       MUNIT_TEST_OPTION_NONE,
-                       NULL },
-                     { "([0b11000011, 0b0000000, 0b0000000, 0b11000011]) is { address = 768 }",
-                       test_parseResetPacketForMultiFunctionDecoders_0b11000011_0b0000000_0b0000000_0b11000011_is_768,
+static MunitResult test_parseFactoryTestInstructionPacketForMultiFunctionDecoders_without_data(
+  MunitParameter const params[], void *fixture) {
+  uint8_t const bytes[3] = { UINT8_C(0x05), UINT8_C(0x03), UINT8_C(0x06) };
+  struct dcc_FactoryTestInstructionPacketForMultiFunctionDecoders packet;
+  munit_assert_int(dcc_Success, ==, dcc_parseFactoryTestInstructionPacketForMultiFunctionDecoders(bytes, 3, &packet));
+  munit_assert_true(packet.set);
+  munit_assert_false(packet.dataExists);
+  return MUNIT_OK;
+}
+
+static MunitResult test_parseFactoryTestInstructionPacketForMultiFunctionDecoders_with_data(
+  MunitParameter const params[], void *fixture) {
+  uint8_t const bytes[4] = { UINT8_C(0x05), UINT8_C(0x03), UINT8_C(0x7F), UINT8_C(0x79) };
+  struct dcc_FactoryTestInstructionPacketForMultiFunctionDecoders packet;
+  munit_assert_int(dcc_Success, ==, dcc_parseFactoryTestInstructionPacketForMultiFunctionDecoders(bytes, 4, &packet));
+  munit_assert_true(packet.dataExists);
+  munit_assert_uint8(0x7F, ==, packet.data);
+  return MUNIT_OK;
+}
+
+// 長いアドレスの後に命令のバイトがなければ、チェックサムを命令として読まない
+static MunitResult test_parseFactoryTestInstructionPacketForMultiFunctionDecoders_too_short_is_failure(
+  MunitParameter const params[], void *fixture) {
+  uint8_t const bytes[3] = { UINT8_C(0xC0), UINT8_C(0xC2), UINT8_C(0x02) };
+  struct dcc_FactoryTestInstructionPacketForMultiFunctionDecoders packet;
+  munit_assert_int(dcc_Failure, ==, dcc_parseFactoryTestInstructionPacketForMultiFunctionDecoders(bytes, 3, &packet));
+  return MUNIT_OK;
+}
+
+static MunitResult test_parseFactoryTestInstructionPacketForMultiFunctionDecoders_too_long_is_failure(
+  MunitParameter const params[], void *fixture) {
+  uint8_t const bytes[5] = { UINT8_C(0x05), UINT8_C(0x03), UINT8_C(0x7F), UINT8_C(0x00), UINT8_C(0x79) };
+  struct dcc_FactoryTestInstructionPacketForMultiFunctionDecoders packet;
+  munit_assert_int(dcc_Failure, ==, dcc_parseFactoryTestInstructionPacketForMultiFunctionDecoders(bytes, 5, &packet));
+  return MUNIT_OK;
+}
+
+// dcc_parsePacket の分岐を使わずに、アドレスの区分を除外したあとパーサーを決まった順に試す
+static enum dcc_Result parsePacketReference(dcc_Byte const *const bytes, size_t const bytesSize,
+                                            struct dcc_Packet *const packet) {
+  if (dcc_Success ==
+      dcc_parseBroadcastStopPacketForAllDecoders(bytes, bytesSize, &packet->broadcastStopPacketForAllDecoders)) {
+    packet->tag = dcc_BroadcastStopPacketForAllDecodersTag;
+    return dcc_Success;
+  }
+  if (dcc_Success == dcc_parseSpeedAndDirectionPacketForLocomotiveDecoders(
+                       bytes, bytesSize, false, &packet->speedAndDirectionPacketForLocomotiveDecoders)) {
+    packet->tag = dcc_SpeedAndDirectionPacketForLocomotiveDecodersTag;
+    return dcc_Success;
+  }
+  if (dcc_Success == dcc_parseResetPacketForAllDecoders(bytes, bytesSize)) {
+    packet->tag = dcc_ResetPacketForAllDecodersTag;
+    return dcc_Success;
+  }
+  if (dcc_Success == dcc_parseIdlePacketForAllDecoders(bytes, bytesSize)) {
+    packet->tag = dcc_IdlePacketForAllDecodersTag;
+    return dcc_Success;
+  }
+  // アクセサリーデコーダー用とアイドル以外の 0xFF は多機能デコーダー用ではない
+  if ((bytes[0] & 0xC0) == 0x80 || bytes[0] == 0xFF) return dcc_Failure;
+#define TRY(packetTag, parse)   \
+  if (dcc_Success == (parse)) { \
+    packet->tag = (packetTag);  \
+    return dcc_Success;         \
+  }
+  TRY(dcc_ResetPacketForMultiFunctionDecodersTag,
+      dcc_parseResetPacketForMultiFunctionDecoders(bytes, bytesSize, &packet->resetPacketForMultiFunctionDecoders))
+  TRY(dcc_HardResetPacketForMultiFunctionDecodersTag,
+      dcc_parseHardResetPacketForMultiFunctionDecoders(bytes,
+                                                       bytesSize,
+                                                       &packet->hardResetPacketForMultiFunctionDecoders))
+  TRY(dcc_FactoryTestInstructionPacketForMultiFunctionDecodersTag,
+      dcc_parseFactoryTestInstructionPacketForMultiFunctionDecoders(
+        bytes,
+        bytesSize,
+        &packet->factoryTestInstructionPacketForMultiFunctionDecoders))
+  TRY(dcc_SetDecoderFlagsPacketForMultiFunctionDecodersTag,
+      dcc_parseDecoderFlagsSetPacketForMultiFunctionDecoders(bytes,
+                                                             bytesSize,
+                                                             &packet->setDecoderFlagsPacketForMultiFunctionDecoders))
+  TRY(dcc_SetExtendedAddressingPacketForMultiFunctionDecodersTag,
+      dcc_parseSetAdvancedAddressingPacketForMultiFunctionDecoders(
+        bytes,
+        bytesSize,
+        &packet->setExtendedAddressingPacketForMultiFunctionDecoders))
+  TRY(dcc_DecoderAcknowledgementRequestPacketForMultiFunctionDecodersTag,
+      dcc_parseDecoderAcknowledgementRequestPacket(
+        bytes,
+        bytesSize,
+        &packet->decoderAcknowledgementRequestPacketForMultiFunctionDecoders))
+  TRY(dcc_ConsistControlPacketForMultiFunctionDecodersTag,
+      dcc_parseConsistControlPacket(bytes, bytesSize, &packet->consistControlPacketForMultiFunctionDecoders))
+  TRY(dcc_SpeedStep128ControlPacketForMultiFunctionDecodersTag,
+      dcc_parseSpeedStep128ControlPacket(bytes, bytesSize, &packet->speedStep128ControlPacket))
+  TRY(dcc_RestrictedSpeedStepPacketForMultiFunctionDecodersTag,
+      dcc_parseRestrictedSpeedStepPacketForMultiFunctionDecoders(
+        bytes,
+        bytesSize,
+        false,
+        &packet->restrictedSpeedStepPacketForMultiFunctionDecoders))
+  TRY(dcc_AnalogFunctionPacketForMultiFunctionDecodersTag,
+      dcc_parseAnalogFunctionPacketForMultiFunctionDecoders(bytes,
+                                                            bytesSize,
+                                                            &packet->analogFunctionPacketForMultiFunctionDecoders))
+  TRY(dcc_SpeedAndDirectionPacketForMultiFunctionDecodersTag,
+      dcc_parseSpeedAndDirectionPacketForMultiFunctionDecoders(
+        bytes,
+        bytesSize,
+        false,
+        &packet->speedAndDirectionPacketForMultiFunctionDecoders))
+  TRY(dcc_FunctionGroup1PacketForMultiFunctionDecodersTag,
+      dcc_parseFunctionGroup1PacketForMultiFunctionDecoders(bytes,
+                                                            bytesSize,
+                                                            true,
+                                                            &packet->functionGroup1PacketForMultiFunctionDecoders))
+  TRY(dcc_FunctionGroup2PacketForMultiFunctionDecodersTag,
+      dcc_parseFunctionGroup2PacketForMultiFunctionDecoders(bytes,
+                                                            bytesSize,
+                                                            &packet->functionGroup2PacketForMultiFunctionDecoders))
+  TRY(dcc_BinaryStateControlLongFormPacketTag,
+      dcc_parseBinaryStateControlLongFormPacket(bytes, bytesSize, &packet->binaryStateControlLongFormPacket))
+  TRY(dcc_BinaryStateControlShortFormPacketTag,
+      dcc_parseBinaryStateControlShortFormPacket(bytes, bytesSize, &packet->binaryStateControlShortFormPacket))
+  TRY(dcc_FunctionControlF13F20PacketTag,
+      dcc_parseFunctionControlF13F20Packet(bytes, bytesSize, &packet->functionControlF13F20Packet))
+  TRY(dcc_FunctionControlF21F28PacketTag,
+      dcc_parseFunctionControlF21F28Packet(bytes, bytesSize, &packet->functionControlF21F28Packet))
+#undef TRY
+  return dcc_Failure;
+}
+
+static MunitResult parsePacketIsReference(dcc_Byte const *const bytes, size_t const bytesSize) {
+  struct dcc_Packet actual;
+  struct dcc_Packet expected;
+  memset(&actual, 0, sizeof(actual));
+  memset(&expected, 0, sizeof(expected));
+  enum dcc_Result const actualResult = dcc_parsePacket(bytes, bytesSize, &actual);
+  enum dcc_Result const expectedResult = parsePacketReference(bytes, bytesSize, &expected);
+  if (actualResult != expectedResult) {
+    munit_errorf("bytes[0..2] = %02X %02X %02X, size = %zu: result %d != %d",
+                 bytes[0],
+                 bytes[1],
+                 bytes[2],
+                 bytesSize,
+                 actualResult,
+                 expectedResult);
+  }
+  if (actualResult == dcc_Success && memcmp(&actual, &expected, sizeof(actual)) != 0) {
+    munit_errorf("bytes[0..2] = %02X %02X %02X, size = %zu: packet differs", bytes[0], bytes[1], bytes[2], bytesSize);
+  }
+  return MUNIT_OK;
+}
+
+static MunitResult test_parsePacket_is_the_same_as_sequential_parsers(MunitParameter const params[], void *fixture) {
+  dcc_Byte bytes[6];
+  // 3 バイトは全通り
+  for (uint_fast32_t i = 0; i < UINT32_C(1) << 24; i++) {
+    bytes[0] = (dcc_Byte) (i >> 16);
+    bytes[1] = (dcc_Byte) (i >> 8);
+    bytes[2] = (dcc_Byte) i;
+    parsePacketIsReference(bytes, 3);
+  }
+  // 4 バイト以上は乱数
+  for (size_t i = 0; i < 1 << 20; i++) {
+    for (size_t j = 0; j < sizeof(bytes); j++) bytes[j] = (dcc_Byte) munit_rand_uint32();
+    size_t const bytesSize = (size_t) munit_rand_int_range(4, (int) sizeof(bytes));
+    parsePacketIsReference(bytes, bytesSize);
+  }
+  return MUNIT_OK;
+}
+
+struct ParsePacketCase {
+  dcc_Byte bytes[5];
+  size_t bytesSize;  // チェックサムを含まない
+  char const *json;
+};
+
+static struct ParsePacketCase const parsePacketCases[] = {
+  { { 0x03, 0x76 },
+    2,
+    "{\"tag\":\"dcc_SpeedAndDirectionPacketForLocomotiveDecodersTag\",\"packet\":{\"address\":3,\"direction\":"
+    "\"Forward\",\"flControl\":false,\"speed5Bit\":10,\"directionMayBeIgnored\":false,\"emergencyStop\":false}}" },
+  { { 0x00, 0x00 }, 2, "{\"tag\":\"dcc_ResetPacketForAllDecodersTag\"}" },
+  { { 0xFF, 0x00 }, 2, "{\"tag\":\"dcc_IdlePacketForAllDecodersTag\"}" },
+  { { 0x00, 0x71 },
+    2,
+    "{\"tag\":\"dcc_BroadcastStopPacketForAllDecodersTag\",\"packet\":{\"kind\":\"Shutdown\","
+    "\"directionMayBeIgnored\":true,\"direction\":\"Forward\"}}" },
+  { { 0xC3, 0xE8, 0x00 },
+    3,
+    "{\"tag\":\"dcc_ResetPacketForMultiFunctionDecodersTag\",\"packet\":{\"address\":1000}}" },
+  { { 0x05, 0x01 }, 2, "{\"tag\":\"dcc_HardResetPacketForMultiFunctionDecodersTag\",\"packet\":{\"address\":5}}" },
+  { { 0x05, 0x03, 0x7F },
+    3,
+    "{\"tag\":\"dcc_FactoryTestInstructionPacketForMultiFunctionDecodersTag\",\"packet\":{\"address\":5,\"set\":true,"
+    "\"dataExists\":true,\"data\":\"0x7f\"}}" },
+  { { 0x05, 0x07, 0x93 },
+    3,
+    "{\"tag\":\"dcc_SetDecoderFlagsPacketForMultiFunctionDecodersTag\",\"packet\":{\"address\":5,\"set\":true,"
+    "\"subaddress\":3,\"instruction\":\"Set111Instruction\"}}" },
+  { { 0x05, 0x0B },
+    2,
+    "{\"tag\":\"dcc_SetExtendedAddressingPacketForMultiFunctionDecodersTag\",\"packet\":{\"address\":5,"
+    "\"set\":true}}" },
+  { { 0x05, 0x0F },
+    2,
+    "{\"tag\":\"dcc_DecoderAcknowledgementRequestPacketForMultiFunctionDecodersTag\",\"packet\":{\"address\":5}}" },
+  { { 0x05, 0x12, 0x17 },
+    3,
+    "{\"tag\":\"dcc_ConsistControlPacketForMultiFunctionDecodersTag\",\"packet\":{\"address\":5,\"direction\":"
+    "\"Forward\",\"consistAddress\":23}}" },
+  { { 0xC3, 0xE8, 0x3F, 0xC0 },
+    4,
+    "{\"tag\":\"dcc_SpeedStep128ControlPacketForMultiFunctionDecodersTag\",\"packet\":{\"address\":1000,"
+    "\"direction\":\"Forward\",\"emergencyStop\":false,\"speed\":63}}" },
+  { { 0x05, 0x3E, 0x86 },
+    3,
+    "{\"tag\":\"dcc_RestrictedSpeedStepPacketForMultiFunctionDecodersTag\",\"packet\":{\"address\":5,"
+    "\"enabled\":true,\"flControl\":false,\"speed5Bit\":9,\"directionMayBeIgnored\":false,\"emergencyStop\":false}}" },
+  { { 0x05, 0x3E, 0x81 },
+    3,
+    "{\"tag\":\"dcc_RestrictedSpeedStepPacketForMultiFunctionDecodersTag\",\"packet\":{\"address\":5,"
+    "\"enabled\":true,\"flControl\":false,\"speed5Bit\":0,\"directionMayBeIgnored\":false,\"emergencyStop\":true}}" },
+  { { 0x05, 0x3D, 0x01, 0x80 },
+    4,
+    "{\"tag\":\"dcc_AnalogFunctionPacketForMultiFunctionDecodersTag\",\"packet\":{\"address\":5,\"output\":1,"
+    "\"data\":128}}" },
+  { { 0xC3, 0xE8, 0x56 },
+    3,
+    "{\"tag\":\"dcc_SpeedAndDirectionPacketForMultiFunctionDecodersTag\",\"packet\":{\"address\":1000,\"direction\":"
+    "\"Backward\",\"flControl\":false,\"speed5Bit\":10,\"directionMayBeIgnored\":false,\"emergencyStop\":false}}" },
+  { { 0x05, 0x95 },
+    2,
+    "{\"tag\":\"dcc_FunctionGroup1PacketForMultiFunctionDecodersTag\",\"packet\":{\"address\":5,\"flControl\":true,"
+    "\"fl\":true,\"f1\":true,\"f2\":false,\"f3\":true,\"f4\":false}}" },
+  { { 0x05, 0xB9 },
+    2,
+    "{\"tag\":\"dcc_FunctionGroup2PacketForMultiFunctionDecodersTag\",\"packet\":{\"address\":5,\"group\":\"F5_F8\","
+    "\"f5\":true,\"f6\":false,\"f7\":false,\"f8\":true}}" },
+  { { 0x05, 0xA6 },
+    2,
+    "{\"tag\":\"dcc_FunctionGroup2PacketForMultiFunctionDecodersTag\",\"packet\":{\"address\":5,\"group\":\"F9_F12\","
+    "\"f9\":false,\"f10\":true,\"f11\":true,\"f12\":false}}" },
+  { { 0x05, 0xC0, 0x85, 0x02 },
+    4,
+    "{\"tag\":\"dcc_BinaryStateControlLongFormPacketTag\",\"packet\":{\"address\":5,\"stateAddress\":261,"
+    "\"state\":true}}" },
+  { { 0x05, 0xDD, 0x0A },
+    3,
+    "{\"tag\":\"dcc_BinaryStateControlShortFormPacketTag\",\"packet\":{\"address\":5,\"stateAddress\":10,"
+    "\"state\":false}}" },
+  { { 0x05, 0xDE, 0xA5 },
+    3,
+    "{\"tag\":\"dcc_FunctionControlF13F20PacketTag\",\"packet\":{\"address\":5,\"f13\":true,\"f14\":false,"
+    "\"f15\":true,\"f16\":false,\"f17\":false,\"f18\":true,\"f19\":false,\"f20\":true}}" },
+  { { 0x05, 0xDF, 0x0F },
+    3,
+    "{\"tag\":\"dcc_FunctionControlF21F28PacketTag\",\"packet\":{\"address\":5,\"f21\":true,\"f22\":true,"
+    "\"f23\":true,\"f24\":true,\"f25\":false,\"f26\":false,\"f27\":false,\"f28\":false}}" },
+};
+
+#define PARSE_PACKET_CASES_SIZE (sizeof(parsePacketCases) / sizeof(parsePacketCases[0]))
+
+// チェックサムを付けたバイト列を作り、そのバイト数を返す
+static size_t makeParsePacketCaseBytes(struct ParsePacketCase const *const c, dcc_Byte *const bytes) {
+  dcc_Byte checksum = 0;
+  for (size_t j = 0; j < c->bytesSize; j++) checksum ^= bytes[j] = c->bytes[j];
+  bytes[c->bytesSize] = checksum;
+  return c->bytesSize + 1;
+}
+
+static MunitResult test_parsePacket_parses_every_tag(MunitParameter const params[], void *fixture) {
+  for (size_t i = 0; i < PARSE_PACKET_CASES_SIZE; i++) {
+    dcc_Byte bytes[6];
+    size_t const bytesSize = makeParsePacketCaseBytes(&parsePacketCases[i], bytes);
+    struct dcc_Packet packet;
+    munit_assert_int(dcc_Success, ==, dcc_parsePacket(bytes, bytesSize, &packet));
+    char json[512];
+    dcc_showPacket(json, sizeof(json), packet);
+    munit_assert_string_equal(parsePacketCases[i].json, json);
+  }
+  return MUNIT_OK;
+}
+
+// 最後のバイトが欠けた命令は、チェックサムが正しくてもチェックサムを命令やデータとして読まない
+// データを省略できる工場試験命令は、データが欠けると省略した形として正しくパースされるので、命令のバイトだけの形で確かめる
+static MunitResult test_parsePacket_truncated_packets_are_failure(MunitParameter const params[], void *fixture) {
+  static struct {
+    dcc_Byte bytes[3];
+    size_t bytesSize;
+    char const *name;
+  } const instructions[] = {
+    { { 0x00 }, 1, "reset" },
+    { { 0x01 }, 1, "hard reset" },
+    { { 0x03 }, 1, "factory test" },
+    { { 0x07, 0x93 }, 2, "decoder flags set" },
+    { { 0x0B }, 1, "set extended addressing" },
+    { { 0x0F }, 1, "decoder acknowledgement request" },
+    { { 0x12, 0x17 }, 2, "consist control" },
+    { { 0x3F, 0xC0 }, 2, "128 speed step control" },
+    { { 0x3E, 0x86 }, 2, "restricted speed step" },
+    { { 0x3D, 0x01, 0x80 }, 3, "analog function" },
+    { { 0x56 }, 1, "speed and direction" },
+    { { 0x95 }, 1, "function group one" },
+    { { 0xB9 }, 1, "function group two" },
+    { { 0xC0, 0x85, 0x02 }, 3, "binary state control long form" },
+    { { 0xDD, 0x0A }, 2, "binary state control short form" },
+    { { 0xDE, 0xA5 }, 2, "F13-F20 function control" },
+    { { 0xDF, 0x0F }, 2, "F21-F28 function control" },
+  };
+  static struct {
+    dcc_Byte bytes[2];
+    size_t bytesSize;
+  } const addresses[] = { { { 0x05 }, 1 }, { { 0xC3, 0xE8 }, 2 } };
+  for (size_t i = 0; i < sizeof(instructions) / sizeof(instructions[0]); i++) {
+    for (size_t j = 0; j < sizeof(addresses) / sizeof(addresses[0]); j++) {
+      struct ParsePacketCase truncated = { .bytesSize = 0, .json = instructions[i].name };
+      for (size_t k = 0; k < addresses[j].bytesSize; k++) truncated.bytes[truncated.bytesSize++] = addresses[j].bytes[k];
+      for (size_t k = 0; k + 1 < instructions[i].bytesSize; k++) {
+        truncated.bytes[truncated.bytesSize++] = instructions[i].bytes[k];
+      }
+      dcc_Byte bytes[6];
+      size_t const bytesSize = makeParsePacketCaseBytes(&truncated, bytes);
+      struct dcc_Packet packet;
+      if (dcc_Failure != dcc_parsePacket(bytes, bytesSize, &packet)) {
+        munit_errorf("truncated %s with %zu byte address is parsed", instructions[i].name, addresses[j].bytesSize);
+      }
+    }
+  }
+  return MUNIT_OK;
+}
+
+static MunitResult test_parsePacket_accessory_packet_is_failure(MunitParameter const params[], void *fixture) {
+  dcc_Byte const bytes[3] = { 0x81, 0xF8, 0x79 };
+  struct dcc_Packet packet;
+  munit_assert_int(dcc_Failure, ==, dcc_parsePacket(bytes, 3, &packet));
+  return MUNIT_OK;
+}
+
+// パースしてからエンコードすると元のバイト列に戻ることを確かめる
+static MunitResult test_encodePacket_is_inverse_of_parsePacket(MunitParameter const params[], void *fixture) {
+  for (size_t i = 0; i < PARSE_PACKET_CASES_SIZE; i++) {
+    dcc_Byte expected[6];
+    size_t const expectedSize = makeParsePacketCaseBytes(&parsePacketCases[i], expected);
+    struct dcc_Packet packet;
+    munit_assert_int(dcc_Success, ==, dcc_parsePacket(expected, expectedSize, &packet));
+    dcc_Byte bytes[DCC_BIT_STREAM_PARSER_BYTES_CAPACITY];
+    size_t bytesSize;
+    munit_assert_int(dcc_Success, ==, dcc_encodePacket(packet, bytes, &bytesSize));
+    munit_assert_size(expectedSize, ==, bytesSize);
+    munit_assert_memory_equal(bytesSize, expected, bytes);
+  }
+  return MUNIT_OK;
+}
+
+static MunitResult test_encodePacket_out_of_range_is_failure(MunitParameter const params[], void *fixture) {
+  dcc_Byte bytes[DCC_BIT_STREAM_PARSER_BYTES_CAPACITY];
+  size_t bytesSize;
+  struct dcc_Packet packet = { .tag = dcc_SpeedStep128ControlPacketForMultiFunctionDecodersTag,
+                               .speedStep128ControlPacket = { .address = 3, .speed = 127 } };
+  munit_assert_int(dcc_Failure, ==, dcc_encodePacket(packet, bytes, &bytesSize));
+  packet = (struct dcc_Packet){ .tag = dcc_ResetPacketForMultiFunctionDecodersTag,
+                                .resetPacketForMultiFunctionDecoders = { .address = 0x2800 } };
+  munit_assert_int(dcc_Failure, ==, dcc_encodePacket(packet, bytes, &bytesSize));
+  packet = (struct dcc_Packet){ .tag = dcc_SpeedAndDirectionPacketForLocomotiveDecodersTag,
+                                .speedAndDirectionPacketForLocomotiveDecoders = { .address = 128 } };
+  munit_assert_int(dcc_Failure, ==, dcc_encodePacket(packet, bytes, &bytesSize));
+  return MUNIT_OK;
+}
+
+// 生成した波形をデコーダーに入力すると元のパケットが得られることを確かめる
+// 生成器を再開できることも確かめるため、小さいバッファーで少しずつ生成する
+static MunitResult test_generateHalfBitPeriods_is_decoded_to_the_same_packet(MunitParameter const params[],
+                                                                               void *fixture) {
+  struct dcc_Decoder decoder = dcc_initializeDecoder(NULL, 0);
+  for (size_t i = 0; i < PARSE_PACKET_CASES_SIZE; i++) {
+    dcc_Byte bytes[6];
+    size_t const bytesSize = makeParsePacketCaseBytes(&parsePacketCases[i], bytes);
+    struct dcc_WaveformGenerator generator =
+      dcc_initializeWaveformGenerator(bytes, bytesSize, DCC_PREAMBLE_SENT_BITS_COUNT);
+    size_t successCount = 0;
+    size_t periodsCount = 0;
+    dcc_HalfBitPeriod periods[7];
+    size_t periodsSize;
+    while (0 < (periodsSize = dcc_generateHalfBitPeriods(&generator, periods, 7))) {
+      for (size_t j = 0; j < periodsSize; j++) {
+        periodsCount++;
+        struct dcc_Packet packet;
+        if (dcc_StreamParserResult_Success != dcc_decodePeriod(&decoder, periods[j], &packet)) continue;
+        successCount++;
+        char json[512];
+        dcc_showPacket(json, sizeof(json), packet);
+        munit_assert_string_equal(parsePacketCases[i].json, json);
+      }
+    }
+    munit_assert_size(1, ==, successCount);
+    munit_assert_size(2 * (DCC_PREAMBLE_SENT_BITS_COUNT + 9 * bytesSize + 1), ==, periodsCount);
+  }
+  return MUNIT_OK;
+}
+
+static MunitResult test_encodeBits_is_read_by_feedBits(MunitParameter const params[], void *fixture) {
+  struct dcc_BitStreamParser parser = dcc_initializeBitStreamParser();
+  for (size_t i = 0; i < PARSE_PACKET_CASES_SIZE; i++) {
+    dcc_Byte expected[6];
+    size_t const expectedSize = makeParsePacketCaseBytes(&parsePacketCases[i], expected);
+    uint32_t bits[4];
+    size_t bitsSize;
+    munit_assert_int(dcc_Success,
+                     ==,
+                     dcc_encodeBits(expected, expectedSize, DCC_PREAMBLE_SENT_BITS_COUNT, bits, 128, &bitsSize));
+    size_t position = 0;
+    dcc_Byte bytes[DCC_BIT_STREAM_PARSER_BYTES_CAPACITY];
+    size_t bytesSize;
+    munit_assert_int(dcc_StreamParserResult_Success,
+                     ==,
+                     dcc_feedBits(&parser, bits, &position, bitsSize, bytes, &bytesSize));
+    munit_assert_size(bitsSize, ==, position);
+    munit_assert_size(expectedSize, ==, bytesSize);
+    munit_assert_memory_equal(bytesSize, expected, bytes);
+  }
+  return MUNIT_OK;
+}
+
+// 波形をデコードし、得られたパケットの数を返す
+static size_t decodeWaveform(struct dcc_Waveform const *const waveform, struct dcc_Packet *const packet) {
+  struct dcc_Decoder decoder = dcc_initializeDecoder(NULL, 0);
+  size_t count = 0;
+  for (size_t i = 0; i < waveform->size; i++) {
+    if (dcc_StreamParserResult_Success == dcc_decodePeriod(&decoder, waveform->periods[i], packet)) count++;
+  }
+  return count;
+}
+
+static struct dcc_Packet makeMultiFunctionSpeedPacket(dcc_AddressForExtendedPacket const address,
+                                                      dcc_Speed5Bit const speed) {
+  return (struct dcc_Packet){ .tag = dcc_SpeedAndDirectionPacketForMultiFunctionDecodersTag,
+                              .speedAndDirectionPacketForMultiFunctionDecoders = {
+                                .address = address, .direction = dcc_Forward, .speed5Bit = speed } };
+}
+
+static MunitResult test_WaveformCache_hits_unchanged_packet(MunitParameter const params[], void *fixture) {
+  struct dcc_WaveformCacheEntry entries[4];
+  struct dcc_WaveformCache cache = dcc_initializeWaveformCache(entries, 4, DCC_PREAMBLE_SENT_BITS_COUNT);
+  struct dcc_Waveform const *first;
+  struct dcc_Waveform const *second;
+  struct dcc_Waveform const *waveform;
+  munit_assert_int(dcc_Success, ==, dcc_getWaveform(&cache, makeMultiFunctionSpeedPacket(1000, 5), &first));
+  munit_assert_int(dcc_Success, ==, dcc_getWaveform(&cache, makeMultiFunctionSpeedPacket(2000, 5), &second));
+  munit_assert_ptr_not_equal(first, second);
+  munit_assert_int(dcc_Success, ==, dcc_getWaveform(&cache, makeMultiFunctionSpeedPacket(1000, 5), &waveform));
+  munit_assert_ptr_equal(first, waveform);
+  munit_assert_int(dcc_Success, ==, dcc_getWaveform(&cache, makeMultiFunctionSpeedPacket(2000, 5), &waveform));
+  munit_assert_ptr_equal(second, waveform);
+  munit_assert_size(2, ==, cache.missesCount);
+  munit_assert_size(2, ==, cache.hitsCount);
+  return MUNIT_OK;
+}
+
+static MunitResult test_WaveformCache_regenerates_only_changed_packet(MunitParameter const params[], void *fixture) {
+  struct dcc_WaveformCacheEntry entries[4];
+  struct dcc_WaveformCache cache = dcc_initializeWaveformCache(entries, 4, DCC_PREAMBLE_SENT_BITS_COUNT);
+  struct dcc_Waveform const *first;
+  struct dcc_Waveform const *second;
+  struct dcc_Waveform const *waveform;
+  munit_assert_int(dcc_Success, ==, dcc_getWaveform(&cache, makeMultiFunctionSpeedPacket(1000, 5), &first));
+  munit_assert_int(dcc_Success, ==, dcc_getWaveform(&cache, makeMultiFunctionSpeedPacket(2000, 5), &second));
+  munit_assert_int(dcc_Success, ==, dcc_getWaveform(&cache, makeMultiFunctionSpeedPacket(1000, 20), &waveform));
+  munit_assert_ptr_equal(first, waveform);
+  munit_assert_size(3, ==, cache.missesCount);
+  struct dcc_Packet packet;
+  munit_assert_size(1, ==, decodeWaveform(waveform, &packet));
+  munit_assert_int(dcc_SpeedAndDirectionPacketForMultiFunctionDecodersTag, ==, packet.tag);
+  munit_assert_int(20, ==, packet.speedAndDirectionPacketForMultiFunctionDecoders.speed5Bit);
+  munit_assert_int(dcc_Success, ==, dcc_getWaveform(&cache, makeMultiFunctionSpeedPacket(2000, 5), &waveform));
+  munit_assert_ptr_equal(second, waveform);
+  munit_assert_size(1, ==, cache.hitsCount);
+  return MUNIT_OK;
+}
+
+static MunitResult test_WaveformCache_full_evicts_entry(MunitParameter const params[], void *fixture) {
+  struct dcc_WaveformCacheEntry entries[2];
+  struct dcc_WaveformCache cache = dcc_initializeWaveformCache(entries, 2, DCC_PREAMBLE_SENT_BITS_COUNT);
+  for (int n = 0; n < 3; n++) {
+    for (dcc_AddressForExtendedPacket address = 1000; address < 1003; address++) {
+      struct dcc_Waveform const *waveform;
+      munit_assert_int(dcc_Success, ==, dcc_getWaveform(&cache, makeMultiFunctionSpeedPacket(address, 5), &waveform));
+      struct dcc_Packet packet;
+      munit_assert_size(1, ==, decodeWaveform(waveform, &packet));
+      munit_assert_int(address, ==, packet.speedAndDirectionPacketForMultiFunctionDecoders.address);
+    }
+  }
+  return MUNIT_OK;
+}
+
+// 次に送るパケットのアドレス、アイドルパケットなら `-1`
+static long nextScheduledAddress(struct dcc_Scheduler *const scheduler) {
+  struct dcc_Packet const packet = dcc_nextScheduledPacket(scheduler);
+  if (packet.tag == dcc_IdlePacketForAllDecodersTag) return -1;
+  dcc_Byte bytes[DCC_BIT_STREAM_PARSER_BYTES_CAPACITY];
+  size_t bytesSize;
+  munit_assert_int(dcc_Success, ==, dcc_encodePacket(packet, bytes, &bytesSize));
+  return dcc_addressOfEncodedPacket(bytes);
+}
+
+static MunitResult test_Scheduler_empty_sends_idle(MunitParameter const params[], void *fixture) {
+  struct dcc_SchedulerDecoder decoders[4];
+  struct dcc_Scheduler scheduler = dcc_initializeScheduler(decoders, 4, 2, 1);
+  for (int i = 0; i < 3; i++) munit_assert_long(-1, ==, nextScheduledAddress(&scheduler));
+  return MUNIT_OK;
+}
+
+static MunitResult test_Scheduler_sends_changed_packets_first(MunitParameter const params[], void *fixture) {
+  struct dcc_SchedulerDecoder decoders[4];
+  struct dcc_Scheduler scheduler = dcc_initializeScheduler(decoders, 4, 2, 1);
+  munit_assert_int(dcc_Success, ==, dcc_schedulePacket(&scheduler, makeMultiFunctionSpeedPacket(1000, 5)));
+  munit_assert_int(dcc_Success, ==, dcc_schedulePacket(&scheduler, makeMultiFunctionSpeedPacket(2000, 5)));
+  // 2回ずつ交互に送ってから巡回する
+  long const expected[] = { 1000, 2000, 1000, 2000, 1000, 2000, 1000 };
+  for (size_t i = 0; i < sizeof(expected) / sizeof(expected[0]); i++) {
+    munit_assert_long(expected[i], ==, nextScheduledAddress(&scheduler));
+  }
+  // 変更されたパケットは巡回を追い越す
+  munit_assert_int(dcc_Success, ==, dcc_schedulePacket(&scheduler, makeMultiFunctionSpeedPacket(2000, 6)));
+  munit_assert_long(2000, ==, nextScheduledAddress(&scheduler));
+  munit_assert_long(1000, ==, nextScheduledAddress(&scheduler));
+  munit_assert_long(2000, ==, nextScheduledAddress(&scheduler));
+  munit_assert_long(1000, ==, nextScheduledAddress(&scheduler));
+  return MUNIT_OK;
+}
+
+static MunitResult test_Scheduler_same_packet_gets_no_priority(MunitParameter const params[], void *fixture) {
+  struct dcc_SchedulerDecoder decoders[4];
+  struct dcc_Scheduler scheduler = dcc_initializeScheduler(decoders, 4, 1, 1);
+  munit_assert_int(dcc_Success, ==, dcc_schedulePacket(&scheduler, makeMultiFunctionSpeedPacket(1000, 5)));
+  munit_assert_long(1000, ==, nextScheduledAddress(&scheduler));
+  munit_assert_int(dcc_Success, ==, dcc_schedulePacket(&scheduler, makeMultiFunctionSpeedPacket(1000, 5)));
+  munit_assert_size(SIZE_MAX, ==, scheduler.queueHead);
+  return MUNIT_OK;
+}
+
+static MunitResult test_Scheduler_caps_back_to_back_packets(MunitParameter const params[], void *fixture) {
+  struct dcc_SchedulerDecoder decoders[4];
+  struct dcc_Scheduler scheduler = dcc_initializeScheduler(decoders, 4, 3, 1);
+  struct dcc_Packet const functions = {
+    .tag = dcc_FunctionGroup1PacketForMultiFunctionDecodersTag,
+    .functionGroup1PacketForMultiFunctionDecoders = { .address = 1000, .f1 = true },
+  };
+  munit_assert_int(dcc_Success, ==, dcc_schedulePacket(&scheduler, makeMultiFunctionSpeedPacket(1000, 5)));
+  munit_assert_int(dcc_Success, ==, dcc_schedulePacket(&scheduler, functions));
+  long last = -1;
+  size_t sent = 0;
+  for (int i = 0; i < 32; i++) {
+    long const address = nextScheduledAddress(&scheduler);
+    if (address != -1) {
+      munit_assert_long(-1, ==, last);
+      sent++;
+    }
+    last = address;
+  }
+  munit_assert_size(16, ==, sent);
+  return MUNIT_OK;
+}
+
+static MunitResult test_Scheduler_refreshes_every_address(MunitParameter const params[], void *fixture) {
+  static struct dcc_SchedulerDecoder decoders[128];
+  struct dcc_Scheduler scheduler = dcc_initializeScheduler(decoders, 128, 1, 1);
+  for (dcc_AddressForExtendedPacket address = 1000; address < 1100; address++) {
+    munit_assert_int(dcc_Success, ==, dcc_schedulePacket(&scheduler, makeMultiFunctionSpeedPacket(address, 5)));
+  }
+  for (int n = 0; n < 3; n++) {
+    bool seen[100] = { false };
+    for (int i = 0; i < 100; i++) {
+      long const address = nextScheduledAddress(&scheduler);
+      munit_assert_long(1000, <=, address);
+      munit_assert_long(address, <, 1100);
+      munit_assert_false(seen[address - 1000]);
+      seen[address - 1000] = true;
+    }
+  }
+  dcc_stopRefreshing(&scheduler, 1050);
+  for (int i = 0; i < 99 * 2; i++) munit_assert_long(1050, !=, nextScheduledAddress(&scheduler));
+  return MUNIT_OK;
+}
+
+static MunitResult test_Scheduler_full_is_failure(MunitParameter const params[], void *fixture) {
+  struct dcc_SchedulerDecoder decoders[2];
+  struct dcc_Scheduler scheduler = dcc_initializeScheduler(decoders, 2, 1, 1);
+  munit_assert_int(dcc_Success, ==, dcc_schedulePacket(&scheduler, makeMultiFunctionSpeedPacket(1000, 5)));
+  munit_assert_int(dcc_Success, ==, dcc_schedulePacket(&scheduler, makeMultiFunctionSpeedPacket(2000, 5)));
+  munit_assert_int(dcc_Failure, ==, dcc_schedulePacket(&scheduler, makeMultiFunctionSpeedPacket(3000, 5)));
+  munit_assert_int(dcc_Success, ==, dcc_schedulePacket(&scheduler, makeMultiFunctionSpeedPacket(2000, 6)));
+  return MUNIT_OK;
+}
+
+static MunitResult test_Scheduler_reuses_released_decoders(MunitParameter const params[], void *fixture) {
+  struct dcc_SchedulerDecoder decoders[4];
+  struct dcc_Scheduler scheduler = dcc_initializeScheduler(decoders, 4, 2, 1);
+  // 同じ位置から探すアドレスが墓標を挟んでも見つかる
+  munit_assert_int(dcc_Success, ==, dcc_schedulePacket(&scheduler, makeMultiFunctionSpeedPacket(1000, 5)));
+  munit_assert_int(dcc_Success, ==, dcc_schedulePacket(&scheduler, makeMultiFunctionSpeedPacket(1004, 5)));
+  for (int i = 0; i < 4; i++) nextScheduledAddress(&scheduler);
+  dcc_stopRefreshing(&scheduler, 1000);
+  munit_assert_int(dcc_Success, ==, dcc_schedulePacket(&scheduler, makeMultiFunctionSpeedPacket(1004, 5)));
+  munit_assert_size(SIZE_MAX, ==, scheduler.queueHead);
+  // 巡回を止めたアドレスを入れ替え続けても空きがなくならない
+  for (dcc_AddressForExtendedPacket address = 2000; address < 2100; address++) {
+    munit_assert_int(dcc_Success, ==, dcc_schedulePacket(&scheduler, makeMultiFunctionSpeedPacket(address, 5)));
+    dcc_stopRefreshing(&scheduler, address);
+    // 待ち行列に残ったパケットは送られる
+    long sent = 0;
+    for (int i = 0; i < 4; i++) {
+      if (nextScheduledAddress(&scheduler) == (long) address) sent++;
+    }
+    munit_assert_long(2, ==, sent);
+  }
+  // 巡回は 1004 だけで、続けて送れないのでアイドルパケットと交互になる
+  for (int i = 0; i < 4; i++) {
+    long const address = nextScheduledAddress(&scheduler);
+    munit_assert_true(address == 1004 || address == -1);
+  }
+  return MUNIT_OK;
+}
+
+// 通し番号から記録を作る
+// 記録が壊れていないことを確かめられるように、すべての値を通し番号から決める
+static struct dcc_PacketRecord makeNumberedRecord(dcc_TimeMicroSec const number) {
+  struct dcc_PacketRecord record = { .packet = makeMultiFunctionSpeedPacket(
+                                       (dcc_AddressForExtendedPacket) (1000 + number % 1000), 5),
+                                     .bytesSize = DCC_BIT_STREAM_PARSER_BYTES_CAPACITY,
+                                     .errors = 0,
+                                     .time = number };
+  memset(record.bytes, (int) (number & 0xFF), sizeof record.bytes);
+  return record;
+}
+
+static void assertNumberedRecord(struct dcc_PacketRecord const *const record) {
+  munit_assert_size(1000 + record->time % 1000,
+                    ==,
+                    record->packet.speedAndDirectionPacketForMultiFunctionDecoders.address);
+  for (size_t i = 0; i < DCC_BIT_STREAM_PARSER_BYTES_CAPACITY; i++) {
+    munit_assert_uint8(record->time & 0xFF, ==, record->bytes[i]);
+  }
+}
+
+static MunitResult test_PacketQueue_delivers_every_record_to_every_reader(MunitParameter const params[],
+                                                                          void *fixture) {
+  struct dcc_PacketRecord records[16];
+  struct dcc_PacketQueue queue = dcc_initializePacketQueue(records, 16);
+  struct dcc_PacketQueueReader readers[2] = { dcc_initializePacketQueueReader(&queue),
+                                              dcc_initializePacketQueueReader(&queue) };
+  dcc_TimeMicroSec expected[2] = { 0, 0 };
+  for (dcc_TimeMicroSec i = 0; i < 40; i++) {
+    struct dcc_PacketRecord const record = makeNumberedRecord(i);
+    dcc_pushPacketQueue(&queue, &record);
+    // 読み出し側ごとに取り出す間隔と量を変える
+    for (size_t k = 0; k < 2; k++) {
+      if (i % (k + 2) != 0) continue;
+      munit_assert_size(i + 1 - expected[k], ==, dcc_getPacketQueueDepth(&readers[k]));
+      struct dcc_PacketRecord popped[3];
+      size_t const size = dcc_popPacketQueue(&readers[k], popped, 3);
+      for (size_t j = 0; j < size; j++) {
+        munit_assert_ulong(expected[k]++, ==, popped[j].time);
+        assertNumberedRecord(&popped[j]);
+      }
+    }
+  }
+  for (size_t k = 0; k < 2; k++) {
+    struct dcc_PacketRecord popped[16];
+    size_t const size = dcc_popPacketQueue(&readers[k], popped, 16);
+    for (size_t j = 0; j < size; j++) munit_assert_ulong(expected[k]++, ==, popped[j].time);
+    munit_assert_ulong(40, ==, expected[k]);
+    munit_assert_size(0, ==, readers[k].lostCount);
+    munit_assert_size(0, ==, dcc_getPacketQueueDepth(&readers[k]));
+  }
+  return MUNIT_OK;
+}
+
+static MunitResult test_PacketQueue_overrun_counts_lost_records(MunitParameter const params[], void *fixture) {
+  struct dcc_PacketRecord records[8];
+  struct dcc_PacketQueue queue = dcc_initializePacketQueue(records, 8);
+  struct dcc_PacketQueueReader reader = dcc_initializePacketQueueReader(&queue);
+  for (dcc_TimeMicroSec i = 0; i < 20; i++) {
+    struct dcc_PacketRecord const record = makeNumberedRecord(i);
+    dcc_pushPacketQueue(&queue, &record);
+  }
+  struct dcc_PacketRecord popped[16];
+  munit_assert_size(8, ==, dcc_popPacketQueue(&reader, popped, 16));
+  munit_assert_size(12, ==, reader.lostCount);
+  for (size_t j = 0; j < 8; j++) munit_assert_ulong(12 + j, ==, popped[j].time);
+  return MUNIT_OK;
+}
+
+struct packetQueueStress {
+  struct dcc_PacketQueue *queue;
+  dcc_TimeMicroSec count;
+};
+
+static void *pushPacketQueueStress(void *arg) {
+  struct packetQueueStress *const stress = arg;
+  for (dcc_TimeMicroSec i = 0; i < stress->count; i++) {
+    struct dcc_PacketRecord const record = makeNumberedRecord(i);
+    dcc_pushPacketQueue(stress->queue, &record);
+    if (i % 64 == 0) sched_yield();
+  }
+  return NULL;
+}
+
+// 書き込み側を待たせずに別スレッドで読み出し、記録が壊れず、順番通りで、失った数と合わせて全数になることを確かめる
+static MunitResult test_PacketQueue_concurrent_push_pop_reads_intact_records(MunitParameter const params[],
+                                                                            void *fixture) {
+  static struct dcc_PacketRecord records[16];
+  struct dcc_PacketQueue queue = dcc_initializePacketQueue(records, 16);
+  struct dcc_PacketQueueReader reader = dcc_initializePacketQueueReader(&queue);
+  struct packetQueueStress stress = { .queue = &queue, .count = UINT32_C(1) << 16 };
+  pthread_t writer;
+  munit_assert_int(0, ==, pthread_create(&writer, NULL, pushPacketQueueStress, &stress));
+  size_t readCount = 0;
+  dcc_TimeMicroSec next = 0;
+  while (readCount + reader.lostCount < stress.count) {
+    struct dcc_PacketRecord popped[4];
+    size_t const size = dcc_popPacketQueue(&reader, popped, 4);
+    if (size == 0) sched_yield();
+    for (size_t j = 0; j < size; j++) {
+      if (popped[j].time < next) munit_errorf("read %lu after %lu", popped[j].time, next);
+      assertNumberedRecord(&popped[j]);
+      next = popped[j].time + 1;
+    }
+    readCount += size;
+  }
+  munit_assert_int(0, ==, pthread_join(writer, NULL));
+  munit_assert_size(stress.count, ==, readCount + reader.lostCount);
+  return MUNIT_OK;
+}
+
+static MunitResult test_makePacketRecord_flags_errors(MunitParameter const params[], void *fixture) {
+  dcc_Byte bytes[DCC_BIT_STREAM_PARSER_BYTES_CAPACITY];
+  size_t bytesSize;
+  struct dcc_Packet const packet = makeMultiFunctionSpeedPacket(1000, 5);
+  munit_assert_int(dcc_Success, ==, dcc_encodePacket(packet, bytes, &bytesSize));
+  struct dcc_PacketRecord record;
+  struct dcc_BytesView const view = { .bytes = bytes, .size = bytesSize };
+  munit_assert_int(dcc_Success, ==, dcc_makePacketRecord(dcc_StreamParserResult_Success, &packet, view, 42, &record));
+  munit_assert_uint8(0, ==, record.errors);
+  munit_assert_ulong(42, ==, record.time);
+  munit_assert_size(bytesSize, ==, record.bytesSize);
+  munit_assert_memory_equal(bytesSize, bytes, record.bytes);
+  // チェックサムが一致しない
+  bytes[1] ^= 1;
+  munit_assert_int(dcc_Success, ==, dcc_makePacketRecord(dcc_StreamParserResult_Failure, &packet, view, 42, &record));
+  munit_assert_uint8(dcc_PacketRecordError_Checksum, ==, record.errors);
+  // チェックサムは一致するがパースできない
+  bytes[bytesSize - 1] ^= 1;
+  munit_assert_int(dcc_Success, ==, dcc_makePacketRecord(dcc_StreamParserResult_Failure, &packet, view, 42, &record));
+  munit_assert_uint8(dcc_PacketRecordError_Unparsed, ==, record.errors);
+  // バイト列が揃っていない
+  struct dcc_BytesView const empty = { .bytes = NULL, .size = 0 };
+  munit_assert_int(dcc_Failure, ==, dcc_makePacketRecord(dcc_StreamParserResult_Failure, &packet, empty, 42, &record));
+  return MUNIT_OK;
+}
+
+static struct dcc_PacketRecord makeEncodedRecord(struct dcc_Packet const packet, dcc_TimeMicroSec const time) {
+  struct dcc_PacketRecord record = { .packet = packet, .errors = 0, .time = time };
+  size_t bytesSize;
+  munit_assert_int(dcc_Success, ==, dcc_encodePacket(packet, record.bytes, &bytesSize));
+  record.bytesSize = (uint_least8_t) bytesSize;
+  return record;
+}
+
+static MunitResult test_PacketLog_round_trips_records(MunitParameter const params[], void *fixture) {
+  struct dcc_PacketRecord records[4] = {
+    makeEncodedRecord(makeMultiFunctionSpeedPacket(1000, 5), 100),
+    makeEncodedRecord((struct dcc_Packet){ .tag = dcc_IdlePacketForAllDecodersTag }, 6100),
+    makeEncodedRecord(makeMultiFunctionSpeedPacket(2000, 20), DCC_TIME_MICRO_SEC_MASK - 10),
+    // 時刻が一周した後のチェックサムの一致しない記録
+    { .bytes = { 0x03, 0x3F, 0x01 }, .bytesSize = 3, .errors = dcc_PacketRecordError_Checksum, .time = 20 },
+  };
+  dcc_Byte buffer[4 * DCC_PACKET_LOG_FRAME_CAPACITY];
+  size_t bufferSize = 0;
+  size_t sizes[4];
+  struct dcc_PacketLog writer = dcc_initializePacketLog();
+  for (size_t i = 0; i < 4; i++) {
+    munit_assert_int(
+      dcc_Success,
+      ==,
+      dcc_writePacketLog(&writer, &records[i], buffer + bufferSize, sizeof buffer - bufferSize, &sizes[i]));
+    munit_assert_uint8(DCC_PACKET_LOG_FRAME_MARKER, ==, buffer[bufferSize]);
+    munit_assert_uint8(DCC_PACKET_LOG_FRAME_MARKER, ==, buffer[bufferSize + sizes[i] - 1]);
+    bufferSize += sizes[i];
+  }
+  // 記録が続いていれば時間差は2バイトで済み、チェックサムは省かれる
+  // 区切りの2バイトと COBS の1バイトが加わる
+  munit_assert_size(2 + 1 + 1 + 2 + records[1].bytesSize - 1, ==, sizes[1]);
+  struct dcc_PacketLog reader = dcc_initializePacketLog();
+  size_t offset = 0;
+  for (size_t i = 0; i < 4; i++) {
+    struct dcc_PacketRecord record;
+    size_t size;
+    munit_assert_int(dcc_StreamParserResult_Success,
+                     ==,
+                     dcc_readPacketLog(&reader, buffer + offset, bufferSize - offset, &record, &size));
+    offset += size;
+    munit_assert_ulong(records[i].time, ==, record.time);
+    munit_assert_uint8(records[i].errors, ==, record.errors);
+    munit_assert_size(records[i].bytesSize, ==, record.bytesSize);
+    munit_assert_memory_equal(record.bytesSize, records[i].bytes, record.bytes);
+    if (record.errors == 0) munit_assert_int(records[i].packet.tag, ==, record.packet.tag);
+  }
+  munit_assert_size(bufferSize, ==, offset);
+  return MUNIT_OK;
+}
+
+static MunitResult test_PacketLog_rejects_broken_frames(MunitParameter const params[], void *fixture) {
+  struct dcc_PacketRecord const record = makeEncodedRecord(makeMultiFunctionSpeedPacket(1000, 5), 100);
+  dcc_Byte buffer[DCC_PACKET_LOG_FRAME_CAPACITY];
+  size_t bufferSize;
+  struct dcc_PacketLog writer = dcc_initializePacketLog();
+  munit_assert_int(dcc_Failure, ==, dcc_writePacketLog(&writer, &record, buffer, 3, &bufferSize));
+  munit_assert_int(dcc_Success, ==, dcc_writePacketLog(&writer, &record, buffer, sizeof buffer, &bufferSize));
+  struct dcc_PacketLog reader = dcc_initializePacketLog();
+  struct dcc_PacketRecord read;
+  size_t size = 0;
+  // フレームが揃っていない
+  munit_assert_int(
+    dcc_StreamParserResult_Continue, ==, dcc_readPacketLog(&reader, buffer, bufferSize - 1, &read, &size));
+  // 区切りでない
+  dcc_Byte const text[] = { 'L', 'O', 'G' };
+  munit_assert_int(dcc_StreamParserResult_Failure, ==, dcc_readPacketLog(&reader, text, sizeof text, &read, &size));
+  munit_assert_size(1, ==, size);
+  // 壊れたバイト列は終わりの区切りの手前まで読み飛ばす
+  buffer[1] = 0xFE;
+  munit_assert_int(dcc_StreamParserResult_Failure, ==, dcc_readPacketLog(&reader, buffer, bufferSize, &read, &size));
+  munit_assert_size(bufferSize - 1, ==, size);
+  munit_assert_ulong(0, ==, reader.time);
+  // 残った区切りは次のフレームを待つ
+  munit_assert_int(
+    dcc_StreamParserResult_Continue, ==, dcc_readPacketLog(&reader, buffer + size, bufferSize - size, &read, &size));
+  return MUNIT_OK;
+}
+
+static MunitResult test_PacketLog_resynchronizes_after_lost_bytes(MunitParameter const params[], void *fixture) {
+  enum { RECORDS_COUNT = DCC_PACKET_LOG_ABSOLUTE_TIME_INTERVAL + 1 };
+  struct dcc_PacketRecord records[RECORDS_COUNT];
+  dcc_Byte buffer[RECORDS_COUNT * DCC_PACKET_LOG_FRAME_CAPACITY + 4];
+  size_t bufferSize = 0;
+  struct dcc_PacketLog writer = dcc_initializePacketLog();
+  for (size_t i = 0; i < RECORDS_COUNT; i++) {
+    // 長いアドレスの下位バイトの 0x0A は改行と同じバイトである
+    struct dcc_Packet const packet = makeMultiFunctionSpeedPacket(0x0A0A, (dcc_Speed5Bit) (4 + i % 16));
+    records[i] = makeEncodedRecord(packet, (dcc_TimeMicroSec) (1000 * i));
+    size_t size;
+    munit_assert_int(dcc_Success,
+                     ==,
+                     dcc_writePacketLog(&writer, &records[i], buffer + bufferSize, sizeof buffer - bufferSize, &size));
+    munit_assert_not_null(memchr(buffer + bufferSize, 0x0A, size));
+    // 時刻 0 の記録もフレームの中には区切りが現れない
+    munit_assert_null(memchr(buffer + bufferSize + 1, DCC_PACKET_LOG_FRAME_MARKER, size - 2));
+    // 2つ目のフレームは後半と終わりの区切りが失われる
+    bufferSize += i == 1 ? size / 2 : size;
+    if (i == 0) {
+      memcpy(buffer + bufferSize, "LOG\n", 4);
+      bufferSize += 4;
+    }
+  }
+  struct dcc_PacketLog reader = dcc_initializePacketLog();
+  size_t offset = 0;
+  size_t recordsCount = 0;
+  size_t brokenCount = 0;
+  while (offset < bufferSize) {
+    // フレームの間のテキストは読み飛ばす
+    if (buffer[offset] != DCC_PACKET_LOG_FRAME_MARKER) {
+      offset++;
+      continue;
+    }
+    struct dcc_PacketRecord record;
+    size_t size = 0;
+    enum dcc_StreamParserResult const result =
+      dcc_readPacketLog(&reader, buffer + offset, bufferSize - offset, &record, &size);
+    munit_assert_int(dcc_StreamParserResult_Continue, !=, result);
+    if (dcc_StreamParserResult_Success == result) {
+      size_t const index = recordsCount == 0 ? 0 : recordsCount + 1;
+      munit_assert_size(records[index].bytesSize, ==, record.bytesSize);
+      munit_assert_memory_equal(record.bytesSize, records[index].bytes, record.bytes);
+      // 失われた時間差の分だけずれた時刻は次の絶対時刻で戻る
+      if (index == 2) munit_assert_ulong(records[index].time, !=, record.time);
+      if (index == 0 || index == RECORDS_COUNT - 1) munit_assert_ulong(records[index].time, ==, record.time);
+      recordsCount++;
+    } else {
+      brokenCount++;
+    }
+    offset += size;
+  }
+  munit_assert_size(RECORDS_COUNT - 1, ==, recordsCount);
+  munit_assert_size(1, ==, brokenCount);
+  return MUNIT_OK;
+}
+
+static MunitResult test_DeferredLog_formats_like_snprintf(MunitParameter const params[], void *fixture) {
+  struct dcc_DeferredLogEntry entries[4];
+  struct dcc_DeferredLog log = dcc_initializeDeferredLog(entries, 4);
+  int const x = 7;
+  dcc_deferred_log = &log;
+  dcc_deferLog("file.c",
+               12,
+               "func",
+               "%d %5zu|%-4lu %p %s %.2f %% %*d",
+               -3,
+               (size_t) 42,
+               9UL,
+               (void const *) &x,
+               "text",
+               1.5,
+               6,
+               x);
+  // 記録できない変換以降はそのまま出力する
+  dcc_deferLog("file.c", 13, "func", "%x %c %hhd %n", 255u, 'z', 300, NULL);
+  dcc_deferred_log = NULL;
+  char expected[128];
+  snprintf(expected,
+           sizeof expected,
+           "%d %5zu|%-4lu %p %s %.2f %% %*d",
+           -3,
+           (size_t) 42,
+           9UL,
+           (void const *) &x,
+           "text",
+           1.5,
+           6,
+           x);
+  struct dcc_DeferredLogEntry entry;
+  munit_assert_int(dcc_Success, ==, dcc_popDeferredLog(&log, &entry));
+  munit_assert_string_equal("file.c", entry.file);
+  munit_assert_int(12, ==, entry.line);
+  munit_assert_string_equal("func", entry.func);
+  char actual[128];
+  munit_assert_int((int) strlen(expected), ==, dcc_formatDeferredLog(actual, sizeof actual, &entry));
+  munit_assert_string_equal(expected, actual);
+  // `snprintf` と同じく切り詰める
+  munit_assert_int((int) strlen(expected), ==, dcc_formatDeferredLog(actual, 5, &entry));
+  munit_assert_string_equal("-3  ", actual);
+  munit_assert_int(dcc_Success, ==, dcc_popDeferredLog(&log, &entry));
+  dcc_formatDeferredLog(actual, sizeof actual, &entry);
+  munit_assert_string_equal("ff z 44 %n", actual);
+  munit_assert_int(dcc_Failure, ==, dcc_popDeferredLog(&log, &entry));
+  return MUNIT_OK;
+}
+
+static MunitResult test_DeferredLog_full_counts_lost_entries(MunitParameter const params[], void *fixture) {
+  struct dcc_DeferredLogEntry entries[4];
+  struct dcc_DeferredLog log = dcc_initializeDeferredLog(entries, 4);
+  dcc_deferred_log = &log;
+  for (int i = 0; i < 6; i++) dcc_deferLog("file.c", i, "func", "%d", i);
+  dcc_deferred_log = NULL;
+  munit_assert_size(2, ==, log.lostCount);
+  // 古いログが残る
+  for (int i = 0; i < 4; i++) {
+    struct dcc_DeferredLogEntry entry;
+    munit_assert_int(dcc_Success, ==, dcc_popDeferredLog(&log, &entry));
+    munit_assert_int(i, ==, entry.line);
+  }
+  return MUNIT_OK;
+}
+
+static MunitResult test_DeferredLog_records_debug_logs(MunitParameter const params[], void *fixture) {
+  static struct dcc_DeferredLogEntry entries[64];
+  struct dcc_DeferredLog log = dcc_initializeDeferredLog(entries, 64);
+  struct dcc_Decoder decoder = dcc_initializeDecoder(NULL, 0);
+  struct dcc_Packet packet;
+  dcc_deferred_log = &log;
+  dcc_debug_log = dcc_deferLog;
+  dcc_decodePeriod(&decoder, 58, &packet);
+  dcc_debug_log = NULL;
+  dcc_deferred_log = NULL;
+  struct dcc_DeferredLogEntry entry;
+  munit_assert_int(dcc_Success, ==, dcc_popDeferredLog(&log, &entry));
+  char expected[128];
+  snprintf(
+    expected, sizeof expected, "dcc_decodePeriod(decoder: %p, period: %lu, packet: %p)", &decoder, 58UL, &packet);
+  char actual[128];
+  dcc_formatDeferredLog(actual, sizeof actual, &entry);
+  munit_assert_string_equal(expected, actual);
+  return MUNIT_OK;
+}
+
+static size_t errorLogsCount = 0;
+
+static void countErrorLog(char const *const file, int const line, char const *func, char const *format, ...) {
+  errorLogsCount++;
+}
+
+// 正しい範囲の値を多めにした乱数の半ビットの継続時間
+static dcc_TimeMicroSec makeRandomPeriod(void) {
+  switch (munit_rand_int_range(0, 9)) {
+    case 0:
+      return (dcc_TimeMicroSec) munit_rand_uint32();
+    case 1:
+    case 2:
+      return (dcc_TimeMicroSec) munit_rand_int_range(0, 12000);
+    case 3:
+    case 4:
+    case 5:
+      return (dcc_TimeMicroSec) munit_rand_int_range(90, 120);
+    default:
+      return (dcc_TimeMicroSec) munit_rand_int_range(48, 68);
+  }
+}
+
+static MunitResult test_decodePeriodView_random_periods_never_fails_internally(MunitParameter const params[],
+                                                                                void *fixture) {
+  errorLogsCount = 0;
+  dcc_error_log = countErrorLog;
+  struct dcc_Decoder decoder = dcc_initializeDecoder(NULL, 0);
+  struct dcc_Decoder signalDecoder = dcc_initializeDecoder(NULL, 0);
+  dcc_TimeMicroSec signal = 0;
+  for (size_t i = 0; i < 200000; i++) {
+    dcc_TimeMicroSec const period = makeRandomPeriod();
+    struct dcc_Packet packet;
+    struct dcc_BytesView bytes = { .bytes = NULL, .size = 0 };
+    enum dcc_StreamParserResult const result = dcc_decodePeriodView(&decoder, period, &packet, &bytes);
+    munit_assert_true(result == dcc_StreamParserResult_Failure || result == dcc_StreamParserResult_Continue ||
+                      result == dcc_StreamParserResult_Success);
+    munit_assert_size(DCC_BIT_STREAM_PARSER_BYTES_CAPACITY, >=, bytes.size);
+    signal = (signal + period) & DCC_TIME_MICRO_SEC_MASK;
+    dcc_decode(&signalDecoder, signal, &packet);
+  }
+  dcc_error_log = NULL;
+  munit_assert_size(0, ==, errorLogsCount);
+  munit_assert_size(0, ==, decoder.bitStreamParser.errorsCount);
+  munit_assert_size(0, ==, signalDecoder.bitStreamParser.errorsCount);
+  return MUNIT_OK;
+}
+
+static MunitResult test_feedBits_random_bits_never_fails_internally(MunitParameter const params[], void *fixture) {
+  errorLogsCount = 0;
+  dcc_error_log = countErrorLog;
+  struct dcc_BitStreamParser parser = dcc_initializeBitStreamParser();
+  for (size_t i = 0; i < 2000; i++) {
+    uint32_t bits[8];
+    // `1` が続くプリアンブルが現れるように、ときどき全ビットを `1` にする
+    for (size_t j = 0; j < 8; j++) bits[j] = munit_rand_int_range(0, 3) == 0 ? UINT32_MAX : munit_rand_uint32();
+    size_t position = 0;
+    while (position < 256) {
+      dcc_Byte bytes[DCC_BIT_STREAM_PARSER_BYTES_CAPACITY];
+      size_t bytesSize = 0;
+      if (dcc_StreamParserResult_Success == dcc_feedBits(&parser, bits, &position, 256, bytes, &bytesSize)) {
+        munit_assert_size(1, <=, bytesSize);
+        munit_assert_size(DCC_BIT_STREAM_PARSER_BYTES_CAPACITY, >=, bytesSize);
+      }
+    }
+  }
+  dcc_error_log = NULL;
+  munit_assert_size(0, ==, errorLogsCount);
+  munit_assert_size(0, ==, parser.errorsCount);
+  return MUNIT_OK;
+}
+
+// 壊れた状態から始めても、パケットを1つ読み捨てれば同期し直してデコードできる
+static MunitResult test_Decoder_corrupted_state_resynchronizes(MunitParameter const params[], void *fixture) {
+  errorLogsCount = 0;
+  dcc_error_log = countErrorLog;
+  dcc_Byte const bytes[] = { 0xFF, 0x00, 0xFF };
+  size_t errorsCount = 0;
+  for (size_t trial = 0; trial < 1000; trial++) {
+    struct dcc_Decoder decoder = dcc_initializeDecoder(NULL, 0);
+    decoder.bitStreamParser.state = (enum dcc_BitStreamParserState) munit_rand_int_range(0, 5);
+    decoder.bitStreamParser.inByte.byte = (dcc_Byte) munit_rand_uint32();
+    decoder.bitStreamParser.inByte.bitCount = (size_t) munit_rand_int_range(0, 12);
+    decoder.bitStreamParser.bytesSize = (size_t) munit_rand_int_range(0, DCC_BIT_STREAM_PARSER_BYTES_CAPACITY + 4);
+    enum dcc_StreamParserResult result = dcc_StreamParserResult_Continue;
+    for (size_t k = 0; k < 3; k++) {
+      struct dcc_WaveformGenerator generator =
+        dcc_initializeWaveformGenerator(bytes, sizeof bytes, DCC_PREAMBLE_SENT_BITS_COUNT);
+      dcc_HalfBitPeriod periods[16];
+      size_t periodsSize;
+      while (0 < (periodsSize = dcc_generateHalfBitPeriods(&generator, periods, 16))) {
+        for (size_t j = 0; j < periodsSize; j++) {
+          struct dcc_Packet packet;
+          result = dcc_decodePeriod(&decoder, periods[j], &packet);
+        }
+      }
+    }
+    munit_assert_int(dcc_StreamParserResult_Success, ==, result);
+    errorsCount += decoder.bitStreamParser.errorsCount;
+  }
+  dcc_error_log = NULL;
+  munit_assert_size(0, <, errorsCount);
+  munit_assert_size(errorsCount, ==, errorLogsCount);
+  return MUNIT_OK;
+}
+
+static MunitResult test_readPacketLog_random_bytes_stays_in_bounds(MunitParameter const params[], void *fixture) {
+  struct dcc_PacketLog log = dcc_initializePacketLog();
+  for (size_t i = 0; i < 100000; i++) {
+    dcc_Byte buffer[2 * DCC_PACKET_LOG_FRAME_CAPACITY];
+    size_t const bufferSize = (size_t) munit_rand_int_range(0, (int) sizeof buffer);
+    for (size_t j = 0; j < bufferSize; j++) buffer[j] = (dcc_Byte) munit_rand_uint32();
+    if (0 < bufferSize && munit_rand_int_range(0, 1) == 0) buffer[0] = DCC_PACKET_LOG_FRAME_MARKER;
+    struct dcc_PacketRecord record;
+    size_t size = 0;
+    switch (dcc_readPacketLog(&log, buffer, bufferSize, &record, &size)) {
+      case dcc_StreamParserResult_Success:
+        munit_assert_size(1, <=, record.bytesSize);
+        munit_assert_size(DCC_BIT_STREAM_PARSER_BYTES_CAPACITY, >=, record.bytesSize);
+        // fallthrough
+      case dcc_StreamParserResult_Failure:
+        munit_assert_size(1, <=, size);
+        munit_assert_size(bufferSize, >=, size);
+        break;
+      default:
+        munit_assert_size(0, ==, size);
+        break;
+    }
+  }
+  return MUNIT_OK;
+}
+
+// 3バイトのパケットを順に送る半ビットの継続時間の列を dcc_generateHalfBitPeriods で作る
+// 1つのパケットは84個の半ビットで、`periods` には `packetsCount * DCC_WAVEFORM_PERIODS_CAPACITY` 個の要素が要る
+// 奇数番目の半ビットを `skew` µs 長く、偶数番目の半ビットを `skew` µs 短くする
+static size_t makePacketPeriods(dcc_Byte const (*const packets)[3], size_t const packetsCount, int const skew,
+                                dcc_HalfBitPeriod *const periods) {
+  size_t size = 0;
+  for (size_t i = 0; i < packetsCount; i++) {
+    struct dcc_WaveformGenerator generator =
+      dcc_initializeWaveformGenerator(packets[i], 3, DCC_PREAMBLE_SENT_BITS_COUNT);
+    size_t generatedSize;
+    while (0 <
+           (generatedSize = dcc_generateHalfBitPeriods(&generator, periods + size, DCC_WAVEFORM_PERIODS_CAPACITY))) {
+      size += generatedSize;
+    }
+  }
+  for (size_t i = 0; i < size; i++) {
+    periods[i] = (dcc_HalfBitPeriod) (i % 2 == 0 ? periods[i] + skew : periods[i] - skew);
+  }
+  return size;
+}
+
+// 3つのアイドルパケット
+// 2番目のバイト `0x00` は最初のパケットの48番目の半ビットから始まる
+static dcc_Byte const idlePackets[3][3] = { { 0xFF, 0x00, 0xFF }, { 0xFF, 0x00, 0xFF }, { 0xFF, 0x00, 0xFF } };
+
+// 正しいパケット、チェックサムの誤ったパケット、アクセサリー用のパケット、正しいパケットを順に送る
+static dcc_Byte const statsPackets[4][3] = {
+  { 0xFF, 0x00, 0xFF }, { 0x01, 0x6A, 0x00 }, { 0x81, 0x88, 0x09 }, { 0xFF, 0x00, 0xFF }
+};
+
+static MunitResult test_DecoderStats_counts_every_stage(MunitParameter const params[], void *fixture) {
+  dcc_HalfBitPeriod periods[4 * DCC_WAVEFORM_PERIODS_CAPACITY];
+  size_t const periodsSize = makePacketPeriods(statsPackets, 4, 0, periods);
+  struct dcc_Decoder decoder = dcc_initializeDecoder(NULL, 0);
+  struct dcc_Packet packets[4];
+  size_t packetsCount;
+  dcc_decodePeriodBatch(&decoder, periods, periodsSize, packets, 4, &packetsCount);
+  munit_assert_size(2, ==, packetsCount);
+  struct dcc_DecoderStats const stats = dcc_getDecoderStats(&decoder);
+  munit_assert_size(periodsSize, ==, stats.edgesCount);
+  munit_assert_size(periodsSize / 2, ==, stats.bitsCount);
+  munit_assert_size(0, ==, stats.timingRejectsCount);
+  munit_assert_size(0, ==, stats.preambleResyncsCount);
+  munit_assert_size(0, ==, stats.framingErrorsCount);
+  munit_assert_size(1, ==, stats.checksumFailuresCount);
+  for (size_t i = 0; i < DCC_ADDRESS_CLASSES_COUNT; i++) {
+    munit_assert_size(i == dcc_AddressClass_Accessory ? 1 : 0, ==, stats.unparsedPacketsCounts[i]);
+  }
+  for (size_t i = 0; i < DCC_PACKET_TAGS_COUNT; i++) {
+    munit_assert_size(i == dcc_IdlePacketForAllDecodersTag ? 2 : 0, ==, stats.packetsCounts[i]);
+  }
+  return MUNIT_OK;
+}
+
+static MunitResult test_DecoderStats_short_preamble_and_noise_counts_rejects(MunitParameter const params[],
+                                                                             void *fixture) {
+  dcc_TimeMicroSec const periods[] = { 58, 58, 58, 58, 100, 100, 58, 80, 58, 75 };
+  struct dcc_Decoder decoder = dcc_initializeDecoder(NULL, 0);
+  for (size_t i = 0; i < sizeof periods / sizeof periods[0]; i++) {
+    struct dcc_Packet packet;
+    dcc_decodePeriod(&decoder, periods[i], &packet);
+  }
+  struct dcc_DecoderStats const stats = dcc_getDecoderStats(&decoder);
+  munit_assert_size(10, ==, stats.edgesCount);
+  munit_assert_size(3, ==, stats.bitsCount);
+  munit_assert_size(1, ==, stats.preambleResyncsCount);
+  munit_assert_size(3, ==, stats.timingRejectsCount);
+  return MUNIT_OK;
+}
+
+static MunitResult test_DecoderStats_snapshots_and_resets(MunitParameter const params[], void *fixture) {
+  dcc_HalfBitPeriod periods[4 * DCC_WAVEFORM_PERIODS_CAPACITY];
+  size_t const periodsSize = makePacketPeriods(statsPackets, 4, 0, periods);
+  struct dcc_Decoder decoder = dcc_initializeDecoder(NULL, 0);
+  struct dcc_Packet packets[4];
+  size_t packetsCount;
+  size_t const half = periodsSize / 2;
+  dcc_decodePeriodBatch(&decoder, periods, half, packets, 4, &packetsCount);
+  struct dcc_DecoderStats const since = dcc_getDecoderStats(&decoder);
+  dcc_decodePeriodBatch(&decoder, periods + half, periodsSize - half, packets, 4, &packetsCount);
+  struct dcc_DecoderStats const until = dcc_getDecoderStats(&decoder);
+  struct dcc_DecoderStats const difference = dcc_subtractDecoderStats(&until, &since);
+  munit_assert_size(periodsSize - half, ==, difference.edgesCount);
+  munit_assert_size(until.checksumFailuresCount - since.checksumFailuresCount, ==, difference.checksumFailuresCount);
+  munit_assert_size(1, ==, difference.unparsedPacketsCounts[dcc_AddressClass_Accessory]);
+  munit_assert_size(1, ==, difference.packetsCounts[dcc_IdlePacketForAllDecodersTag]);
+  dcc_resetDecoderStats(&decoder);
+  struct dcc_DecoderStats const zero = { 0 };
+  struct dcc_DecoderStats const reset = dcc_getDecoderStats(&decoder);
+  munit_assert_memory_equal(sizeof zero, &zero, &reset);
+  return MUNIT_OK;
+}
+
+static MunitResult test_classifyAddress_splits_at_boundaries(MunitParameter const params[], void *fixture) {
+  munit_assert_int(dcc_AddressClass_Broadcast, ==, dcc_classifyAddress(0x00));
+  munit_assert_int(dcc_AddressClass_ShortAddress, ==, dcc_classifyAddress(0x01));
+  munit_assert_int(dcc_AddressClass_ShortAddress, ==, dcc_classifyAddress(0x7F));
+  munit_assert_int(dcc_AddressClass_Accessory, ==, dcc_classifyAddress(0x80));
+  munit_assert_int(dcc_AddressClass_Accessory, ==, dcc_classifyAddress(0xBF));
+  munit_assert_int(dcc_AddressClass_LongAddress, ==, dcc_classifyAddress(0xC0));
+  munit_assert_int(dcc_AddressClass_LongAddress, ==, dcc_classifyAddress(0xE7));
+  munit_assert_int(dcc_AddressClass_Reserved, ==, dcc_classifyAddress(0xE8));
+  munit_assert_int(dcc_AddressClass_Reserved, ==, dcc_classifyAddress(0xFE));
+  munit_assert_int(dcc_AddressClass_Idle, ==, dcc_classifyAddress(0xFF));
+  return MUNIT_OK;
+}
+
+static MunitResult test_TimingProfile_buckets_half_bits(MunitParameter const params[], void *fixture) {
+  struct dcc_TimingProfile profile = dcc_initializeTimingProfile();
+  dcc_TimeMicroSec const periods[] = { 58, 58, 10, 79, 100, 103, 20000 };
+  for (size_t i = 0; i < sizeof periods / sizeof periods[0]; i++) dcc_profileHalfBitPeriod(&profile, periods[i]);
+  dcc_profileHalfBitPair(&profile, 58, 61);
+  dcc_profileHalfBitPair(&profile, 60, 20);
+  dcc_profileHalfBitPair(&profile, 58, 100);
+  struct dcc_TimingProfile const snapshot = dcc_getTimingProfile(&profile);
+  munit_assert_size(2, ==, snapshot.oneHalfBitCounts[58 - DCC_TIMING_PROFILE_ONE_HALF_BIT_MIN]);
+  munit_assert_size(1, ==, snapshot.oneHalfBitCounts[0]);
+  munit_assert_size(1, ==, snapshot.oneHalfBitCounts[DCC_TIMING_PROFILE_BUCKETS_COUNT - 1]);
+  munit_assert_size(2, ==, snapshot.zeroHalfBitCounts[(100 - DCC_TIMING_PROFILE_ZERO_HALF_BIT_MIN) / 4]);
+  munit_assert_size(1, ==, snapshot.zeroHalfBitCounts[DCC_TIMING_PROFILE_BUCKETS_COUNT - 1]);
+  munit_assert_size(1, ==, snapshot.oneBitAsymmetryCounts[3 - DCC_TIMING_PROFILE_ASYMMETRY_MIN]);
+  munit_assert_size(1, ==, snapshot.oneBitAsymmetryCounts[0]);
+  size_t asymmetriesCount = 0;
+  for (size_t i = 0; i < DCC_TIMING_PROFILE_BUCKETS_COUNT; i++) asymmetriesCount += snapshot.oneBitAsymmetryCounts[i];
+  munit_assert_size(2, ==, asymmetriesCount);
+  struct dcc_TimingProfile const difference = dcc_subtractTimingProfile(&snapshot, &snapshot);
+  struct dcc_TimingProfile const zero = dcc_initializeTimingProfile();
+  munit_assert_memory_equal(sizeof zero, &zero, &difference);
+  return MUNIT_OK;
+}
+
+// デコーダーにつないだプロファイルは、バッチ処理でも全ての半ビットとビットの組を数える
+static MunitResult test_TimingProfile_decoder_profiles_every_half_bit(MunitParameter const params[], void *fixture) {
+  dcc_Byte const bytes[3] = { 0xFF, 0x00, 0xFF };
+  dcc_TimeMicroSec signals[1 + 2 * 128];
+  dcc_TimeMicroSec time = 0;
+  size_t signalsSize = 0;
+  signals[signalsSize++] = time;
+  for (int i = 0; i < 2; i++) signalsSize += makeSignals(bytes, 3, &time, signals + signalsSize);
+  struct dcc_TimingProfile decoderProfile = dcc_initializeTimingProfile();
+  struct dcc_Decoder decoder = dcc_initializeDecoder(NULL, 0);
+  decoder.signalStreamParser.timingProfile = &decoderProfile;
+  struct dcc_Packet packets[2];
+  size_t packetsCount;
+  dcc_decodeBatch(&decoder, signals, signalsSize, packets, 2, &packetsCount);
+  munit_assert_size(2, ==, packetsCount);
+  struct dcc_TimingProfile bitsProfile = dcc_initializeTimingProfile();
+  struct dcc_SignalStreamParser parser = dcc_initializeSignalStreamParser();
+  parser.timingProfile = &bitsProfile;
+  uint32_t bits[8];
+  size_t bitsSize;
+  munit_assert_size(signalsSize, ==, dcc_decodeSignalsToBits(&parser, signals, signalsSize, bits, 256, &bitsSize));
+  munit_assert_memory_equal(sizeof decoderProfile, &decoderProfile, &bitsProfile);
+  // 1 のビットはプリアンブル、2つの 0xFF、パケット終了ビットで、0 のビットは開始ビットと 0x00
+  size_t const oneBitsCount = 2 * (14 + 8 + 8 + 1);
+  size_t const zeroBitsCount = 2 * (3 + 8);
+  munit_assert_size(2 * oneBitsCount, ==, decoderProfile.oneHalfBitCounts[58 - DCC_TIMING_PROFILE_ONE_HALF_BIT_MIN]);
+  munit_assert_size(2 * zeroBitsCount,
+                    ==,
+                    decoderProfile.zeroHalfBitCounts[(100 - DCC_TIMING_PROFILE_ZERO_HALF_BIT_MIN) / 4]);
+  munit_assert_size(oneBitsCount, ==, decoderProfile.oneBitAsymmetryCounts[-DCC_TIMING_PROFILE_ASYMMETRY_MIN]);
+  return MUNIT_OK;
+}
+
+static MunitResult test_TimingProfile_shows_JSON(MunitParameter const params[], void *fixture) {
+  struct dcc_TimingProfile profile = dcc_initializeTimingProfile();
+  dcc_profileHalfBitPeriod(&profile, DCC_TIMING_PROFILE_ONE_HALF_BIT_MIN);
+  char buffer[1024];
+  int const size = dcc_showTimingProfile(buffer, sizeof buffer, &profile);
+  munit_assert_int(0, <, size);
+  munit_assert_size(strlen(buffer), ==, (size_t) size);
+  char const prefix[] = "{\"oneHalfBit\":{\"min\":40,\"width\":1,\"counts\":[1,0,";
+  munit_assert_memory_equal(sizeof prefix - 1, prefix, buffer);
+  munit_assert_char('}', ==, buffer[size - 1]);
+  // 足りないバッファーには書き込める分だけ書き込み、必要な文字数を返す
+  char small[16];
+  munit_assert_int(size, ==, dcc_showTimingProfile(small, sizeof small, &profile));
+  munit_assert_memory_equal(sizeof small - 1, buffer, small);
+  munit_assert_char('\0', ==, small[sizeof small - 1]);
+  return MUNIT_OK;
+}
+
+static MunitResult test_ReceiveTiming_strict_is_the_NMRA_constants(MunitParameter const params[], void *fixture) {
+  munit_assert_ulong(dcc_minOneHalfBitReceivedPeriod, ==, dcc_strictReceiveTiming.minOneHalfBitPeriod);
+  munit_assert_ulong(dcc_maxOneHalfBitReceivedPeriod, ==, dcc_strictReceiveTiming.maxOneHalfBitPeriod);
+  munit_assert_ulong(dcc_minZeroHalfBitReceivedPeriod, ==, dcc_strictReceiveTiming.minZeroHalfBitPeriod);
+  munit_assert_ulong(dcc_maxZeroHalfBitReceivedPeriod, ==, dcc_strictReceiveTiming.maxZeroHalfBitPeriod);
+  munit_assert_ulong(dcc_maxOneHalfBitReceivedPeriodDiff, ==, dcc_strictReceiveTiming.maxOneHalfBitPeriodDiff);
+  munit_assert_ulong(dcc_maxStretchedZeroBitPeriod, ==, dcc_strictReceiveTiming.maxStretchedZeroBitPeriod);
+  munit_assert_int(dcc_Success, ==, dcc_validateReceiveTiming(&dcc_strictReceiveTiming));
+  munit_assert_int(dcc_Success, ==, dcc_validateReceiveTiming(&dcc_tolerantReceiveTiming));
+  munit_assert_int(dcc_Success, ==, dcc_validateReceiveTiming(&dcc_defaultReceiveTiming));
+  return MUNIT_OK;
+}
+
+static MunitResult test_ReceiveTiming_tolerant_accepts_drifted_half_bits(MunitParameter const params[], void *fixture) {
+  dcc_TimeMicroSec const drifted[][2] = { { 48, 48 }, { 68, 60 }, { 60, 69 }, { 84, 84 } };
+  dcc_Bit const expectedBits[] = { 1, 1, 1, 0 };
+  for (size_t i = 0; i < sizeof drifted / sizeof drifted[0]; i++) {
+    dcc_Bit bit;
+    munit_assert_int(dcc_Failure,
+                     ==,
+                     dcc_decodeSignalWithTiming(&dcc_strictReceiveTiming, drifted[i][0], drifted[i][1], &bit));
+    munit_assert_int(dcc_Success,
+                     ==,
+                     dcc_decodeSignalWithTiming(&dcc_tolerantReceiveTiming, drifted[i][0], drifted[i][1], &bit));
+    munit_assert_int(expectedBits[i], ==, bit);
+  }
+  // 切り替えたデコーダーは同じ信号をパケットにできる
+  dcc_Byte const bytes[3] = { 0xFF, 0x00, 0xFF };
+  struct dcc_WaveformGenerator generator =
+    dcc_initializeWaveformGenerator(bytes, sizeof bytes, DCC_PREAMBLE_SENT_BITS_COUNT);
+  dcc_HalfBitPeriod periods[DCC_WAVEFORM_PERIODS_CAPACITY];
+  size_t const periodsSize = dcc_generateHalfBitPeriods(&generator, periods, DCC_WAVEFORM_PERIODS_CAPACITY);
+  struct dcc_Decoder strict = dcc_initializeDecoder(NULL, 0);
+  struct dcc_Decoder tolerant = dcc_initializeDecoder(NULL, 0);
+  tolerant.signalStreamParser.receiveTiming = &dcc_tolerantReceiveTiming;
+  size_t strictCount = 0;
+  size_t tolerantCount = 0;
+  for (size_t i = 0; i < periodsSize; i++) {
+    // `1` の半ビットを 10µs 短く、`0` の半ビットを 14µs 短くする
+    dcc_TimeMicroSec const period = periods[i] < 80 ? periods[i] - 10 : periods[i] - 14;
+    struct dcc_Packet packet;
+    if (dcc_StreamParserResult_Success == dcc_decodePeriod(&strict, period, &packet)) strictCount++;
+    if (dcc_StreamParserResult_Success == dcc_decodePeriod(&tolerant, period, &packet)) tolerantCount++;
+  }
+  munit_assert_size(0, ==, strictCount);
+  munit_assert_size(1, ==, tolerantCount);
+  return MUNIT_OK;
+}
+
+static MunitResult test_validateReceiveTiming_rejects_overlapping_ranges(MunitParameter const params[],
+                                                                         void *fixture) {
+  struct dcc_ReceiveTiming timing = dcc_strictReceiveTiming;
+  timing.minZeroHalfBitPeriod = timing.maxOneHalfBitPeriod;
+  munit_assert_int(dcc_Failure, ==, dcc_validateReceiveTiming(&timing));
+  timing = dcc_strictReceiveTiming;
+  timing.maxOneHalfBitPeriod = timing.minOneHalfBitPeriod - 1;
+  munit_assert_int(dcc_Failure, ==, dcc_validateReceiveTiming(&timing));
+  timing = dcc_strictReceiveTiming;
+  timing.maxZeroHalfBitPeriod = DCC_TIME_MICRO_SEC_MASK;
+  munit_assert_int(dcc_Failure, ==, dcc_validateReceiveTiming(&timing));
+  // 独自のタイミングも範囲が重ならなければ使える
+  struct dcc_ReceiveTiming const custom = { 40UL, 75UL, 76UL, 20000UL, 20UL, 30000UL };
+  munit_assert_int(dcc_Success, ==, dcc_validateReceiveTiming(&custom));
+  return MUNIT_OK;
+}
+
+static MunitResult test_ClockRecovery_skewed_recovers_packets_the_fixed_ranges_reject(MunitParameter const params[],
+                                                                                      void *fixture) {
+  // High の半ビットを常に 8µs 長くする入力は、`1` の組の差が dcc_maxOneHalfBitReceivedPeriodDiff を超える
+  dcc_HalfBitPeriod periods[3 * DCC_WAVEFORM_PERIODS_CAPACITY];
+  size_t const periodsSize = makePacketPeriods(idlePackets, 3, 4, periods);
+  struct dcc_Decoder fixed = dcc_initializeDecoder(NULL, 0);
+  struct dcc_Decoder adaptive = dcc_initializeDecoder(NULL, 0);
+  struct dcc_ClockRecovery recovery = dcc_initializeClockRecovery(&dcc_strictReceiveTiming);
+  dcc_attachClockRecovery(&adaptive.signalStreamParser, &recovery);
+  size_t fixedCount = 0;
+  size_t adaptiveCount = 0;
+  for (size_t i = 0; i < periodsSize; i++) {
+    struct dcc_Packet packet;
+    if (dcc_StreamParserResult_Success == dcc_decodePeriod(&fixed, periods[i], &packet)) fixedCount++;
+    if (dcc_StreamParserResult_Success == dcc_decodePeriod(&adaptive, periods[i], &packet)) {
+      munit_assert_int(dcc_IdlePacketForAllDecodersTag, ==, packet.tag);
+      adaptiveCount++;
+    }
+  }
+  munit_assert_size(0, ==, fixedCount);
+  // 最初のプリアンブルは学習に使われるので、残りのパケットを取り出せる
+  munit_assert_size(2, ==, adaptiveCount);
+  munit_assert_ulong(58, ==, recovery.oneHalfBitPeriod);
+  // 取り付けてから最初の半ビットを1番目と数えるので、長い High の半ビットは奇数番目である
+  munit_assert_long(8, ==, recovery.oneHalfBitPeriodSkew);
+  munit_assert_int(dcc_Success, ==, dcc_validateReceiveTiming(&recovery.timing));
+  // 取り外すと既定のタイミングに戻る
+  dcc_attachClockRecovery(&adaptive.signalStreamParser, NULL);
+  munit_assert_null(adaptive.signalStreamParser.receiveTiming);
+  munit_assert_null(adaptive.signalStreamParser.clockRecovery);
+  return MUNIT_OK;
+}
+
+// 偏りのない信号は固定の範囲と同じパケットになり、dcc_decodeSignalsToBits も1つずつ処理した結果と同じになる
+static MunitResult test_ClockRecovery_nominal_decodes_the_same_packets(MunitParameter const params[],
+                                                                       void *fixture) {
+  dcc_Byte const bytes[3] = { 0xFF, 0x00, 0xFF };
+  dcc_TimeMicroSec signals[1 + 3 * 128];
+  dcc_TimeMicroSec time = 0;
+  size_t signalsSize = 0;
+  signals[signalsSize++] = time;
+  for (int i = 0; i < 3; i++) signalsSize += makeSignals(bytes, 3, &time, signals + signalsSize);
+  struct dcc_Decoder decoder = dcc_initializeDecoder(NULL, 0);
+  struct dcc_ClockRecovery decoderRecovery = dcc_initializeClockRecovery(&dcc_defaultReceiveTiming);
+  dcc_attachClockRecovery(&decoder.signalStreamParser, &decoderRecovery);
+  struct dcc_Packet packets[3];
+  size_t packetsCount;
+  dcc_decodeBatch(&decoder, signals, signalsSize, packets, 3, &packetsCount);
+  munit_assert_size(3, ==, packetsCount);
+  munit_assert_ulong(58, ==, decoderRecovery.oneHalfBitPeriod);
+  munit_assert_long(0, ==, decoderRecovery.oneHalfBitPeriodSkew);
+  struct dcc_SignalStreamParser reference = dcc_initializeSignalStreamParser();
+  struct dcc_ClockRecovery referenceRecovery = dcc_initializeClockRecovery(&dcc_defaultReceiveTiming);
+  dcc_attachClockRecovery(&reference, &referenceRecovery);
+  dcc_Bit expected[512];
+  size_t const expectedSize = decodeSignalsToBitsReference(&reference, signals, signalsSize, expected);
+  struct dcc_SignalStreamParser parser = dcc_initializeSignalStreamParser();
+  struct dcc_ClockRecovery recovery = dcc_initializeClockRecovery(&dcc_defaultReceiveTiming);
+  dcc_attachClockRecovery(&parser, &recovery);
+  uint32_t bits[16];
+  size_t bitsSize;
+  munit_assert_size(signalsSize, ==, dcc_decodeSignalsToBits(&parser, signals, signalsSize, bits, 512, &bitsSize));
+  munit_assert_size(expectedSize, ==, bitsSize);
+  for (size_t i = 0; i < bitsSize; i++) munit_assert_int(expected[i], ==, packedBit(bits, i));
+  munit_assert_size(referenceRecovery.learnedCount, ==, recovery.learnedCount);
+  munit_assert_memory_equal(sizeof recovery.timing, &referenceRecovery.timing, &recovery.timing);
+  return MUNIT_OK;
+}
+
+static size_t decodeIdlePeriods(struct dcc_Decoder *const decoder, dcc_HalfBitPeriod const *const periods,
+                                size_t const periodsSize) {
+  size_t count = 0;
+  for (size_t i = 0; i < periodsSize; i++) {
+    struct dcc_Packet packet;
+    if (dcc_StreamParserResult_Success == dcc_decodePeriod(decoder, periods[i], &packet)) {
+      munit_assert_int(dcc_IdlePacketForAllDecodersTag, ==, packet.tag);
+      count++;
+    }
+  }
+  return count;
+}
+
+static MunitResult test_Resynchronization_timing_failure_in_packet_waits_for_next_preamble(
+  MunitParameter const params[], void *fixture) {
+  dcc_HalfBitPeriod periods[3 * DCC_WAVEFORM_PERIODS_CAPACITY];
+  size_t const periodsSize = makePacketPeriods(idlePackets, 3, 0, periods);
+  // `1` と `0` の間の継続時間でパケットの途中のビットを壊す
+  periods[50] = 75;
+  struct dcc_Decoder decoder = dcc_initializeDecoder(NULL, 0);
+  munit_assert_size(2, ==, decodeIdlePeriods(&decoder, periods, periodsSize));
+  struct dcc_DecoderStats const stats = dcc_getDecoderStats(&decoder);
+  munit_assert_size(1, ==, stats.timingRejectsCount);
+  munit_assert_size(1, ==, stats.timingResyncsCount);
+  munit_assert_size(0, ==, stats.framingErrorsCount);
+  munit_assert_size(0, ==, stats.checksumFailuresCount);
+  return MUNIT_OK;
+}
+
+static MunitResult test_Resynchronization_spike_in_half_bit_is_merged(MunitParameter const params[], void *fixture) {
+  dcc_HalfBitPeriod idle[3 * DCC_WAVEFORM_PERIODS_CAPACITY];
+  size_t const idleSize = makePacketPeriods(idlePackets, 3, 0, idle);
+  // 最初のパケットの `0` の半ビットをスパイクで3つに分ける
+  dcc_HalfBitPeriod periods[3 * DCC_WAVEFORM_PERIODS_CAPACITY + 2];
+  size_t periodsSize = 0;
+  for (size_t i = 0; i < idleSize; i++) {
+    if (i == 50) {
+      periods[periodsSize++] = 30;
+      periods[periodsSize++] = 10;
+      periods[periodsSize++] = 60;
+    } else {
+      periods[periodsSize++] = idle[i];
+    }
+  }
+  struct dcc_Decoder decoder = dcc_initializeDecoder(NULL, 0);
+  munit_assert_size(3, ==, decodeIdlePeriods(&decoder, periods, periodsSize));
+  struct dcc_DecoderStats const stats = dcc_getDecoderStats(&decoder);
+  munit_assert_size(periodsSize, ==, stats.edgesCount);
+  munit_assert_size(0, ==, stats.timingRejectsCount);
+  munit_assert_size(0, ==, stats.timingResyncsCount);
+  return MUNIT_OK;
+}
+
+// 最初の断片が半ビットとして読める長さなら、残りの断片を合わせても元の半ビットには戻らない
+// その半ビットを含むパケットは失われるが、次のプリアンブルから同期し直す
+static MunitResult test_Resynchronization_spike_after_long_first_piece_loses_the_packet(MunitParameter const params[],
+                                                                                       void *fixture) {
+  dcc_HalfBitPeriod idle[3 * DCC_WAVEFORM_PERIODS_CAPACITY];
+  size_t const idleSize = makePacketPeriods(idlePackets, 3, 0, idle);
+  dcc_HalfBitPeriod periods[3 * DCC_WAVEFORM_PERIODS_CAPACITY + 2];
+  size_t periodsSize = 0;
+  for (size_t i = 0; i < idleSize; i++) {
+    if (i == 50) {
+      periods[periodsSize++] = 60;
+      periods[periodsSize++] = 5;
+      periods[periodsSize++] = 35;
+    } else {
+      periods[periodsSize++] = idle[i];
+    }
+  }
+  struct dcc_Decoder decoder = dcc_initializeDecoder(NULL, 0);
+  munit_assert_size(2, ==, decodeIdlePeriods(&decoder, periods, periodsSize));
+  struct dcc_DecoderStats const stats = dcc_getDecoderStats(&decoder);
+  munit_assert_size(1, ==, stats.timingRejectsCount);
+  munit_assert_size(1, ==, stats.timingResyncsCount);
+  munit_assert_size(0, ==, stats.framingErrorsCount);
+  munit_assert_size(0, ==, stats.checksumFailuresCount);
+  return MUNIT_OK;
+}
+
+// 極性が分かっていれば、失敗した組の後半の半ビットはビットを始めないので読み捨てる
+static MunitResult test_Resynchronization_known_polarity_drops_the_pair(MunitParameter const params[], void *fixture) {
+  struct dcc_SignalStreamParser known = dcc_initializeSignalStreamParser();
+  struct dcc_SignalStreamParser unknown = dcc_initializeSignalStreamParser();
+  dcc_Bit bit;
+  dcc_TimeMicroSec const periods[] = { 58, 58, 75, 100 };
+  for (size_t i = 0; i < sizeof periods / sizeof periods[0]; i++) {
+    enum dcc_StreamParserResult const expected = i == 1   ? dcc_StreamParserResult_Success
+                                                 : i == 3 ? dcc_StreamParserResult_Failure
+                                                          : dcc_StreamParserResult_Continue;
+    munit_assert_int(expected, ==, dcc_feedPeriod(&known, periods[i], &bit));
+    munit_assert_int(expected, ==, dcc_feedPeriod(&unknown, periods[i], &bit));
+    // 3番目の半ビットから次のビットが始まる
+    if (i == 1) known.polarity = dcc_SignalPolarity_OddPeriodFirst;
+  }
+  munit_assert_int(dcc_SignalPolarity_Unknown, ==, known.polarity);
+  munit_assert_false(known.periodExists);
+  munit_assert_int(dcc_StreamParserResult_Continue, ==, dcc_feedPeriod(&known, 58, &bit));
+  munit_assert_int(dcc_StreamParserResult_Success, ==, dcc_feedPeriod(&known, 58, &bit));
+  munit_assert_int(1, ==, bit);
+  // 極性が分からなければ後半の半ビットを次のビットの前半として扱う
+  munit_assert_int(dcc_StreamParserResult_Failure, ==, dcc_feedPeriod(&unknown, 58, &bit));
+  return MUNIT_OK;
+}
+
+static MunitSuite const suite = {
+  "/okdcc",
+  NULL,
+  (MunitSuite[]){
+    { // name, tests, suites, iterations, options
+      "/SignalBuffer",
+      (MunitTest[]){
+        { "(1)/write is success", test_writeSignalBuffer_1_is_success, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL },
+        { "(1)/read is failure", test_SignalBuffer_1_read_is_failure, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL },
+        { "(1)/write write is failure",
+          test_writeSignalBuffer_1_2_is_failure,
+          NULL,
+          NULL,
+          MUNIT_TEST_OPTION_NONE,
+          NULL },
+        { "(1)/write read write read is success",
+          test_SignalBuffer_1_write_read_write_read_is_success,
+          NULL,
+          NULL,
+          MUNIT_TEST_OPTION_NONE,
+          NULL },
+        { "(1)/write write read is failure once and success",
+          test_SignalBuffer_1_write_write_read_is_failure_once_and_success,
+          NULL,
+          NULL,
+          MUNIT_TEST_OPTION_NONE,
+          NULL },
+        { "(3)/has 2 elements", test_SignalBuffer_3_has_2_elements, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL },
+        { "(4)/wraps around", test_SignalBuffer_4_wraps_around, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL },
+        { "(1)/concurrent write and read loses nothing",
+          test_SignalBuffer_1_concurrent_write_read_loses_nothing,
+          NULL,
+          NULL,
+          MUNIT_TEST_OPTION_NONE,
+          NULL },
+        { "(1024)/concurrent write and read loses nothing",
+          test_SignalBuffer_1024_concurrent_write_read_loses_nothing,
+          NULL,
+          NULL,
+          MUNIT_TEST_OPTION_NONE,
+          NULL },
+        { NULL, NULL, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL } },
+      NULL,
+      1,
+      MUNIT_SUITE_OPTION_NONE },
+    { "/dcc_readSignalBufferSpans",
+      (MunitTest[]){
+        { "(4)/wrapped is 2 spans",
+          test_readSignalBufferSpans_4_wrapped_is_2_spans,
+          NULL,
+          NULL,
+          MUNIT_TEST_OPTION_NONE,
+          NULL },
+        { NULL, NULL, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL } },
+      NULL,
+      1,
+      MUNIT_SUITE_OPTION_NONE },
+    { "/dcc_decodeBatch",
+      (MunitTest[]){
+        { "(3 idle packets) is 3 packets",
+          test_decodeBatch_3_idle_packets_is_3_packets,
+          NULL,
+          NULL,
+          MUNIT_TEST_OPTION_NONE,
+          NULL },
+        { "stops when packets is full",
+          test_decodeBatch_stops_when_packets_is_full,
+          NULL,
+          NULL,
+          MUNIT_TEST_OPTION_NONE,
+          NULL },
+        { "(empty packets)/discards packets",
+          test_decodeBatch_empty_packets_discards_packets,
+          NULL,
+          NULL,
+          MUNIT_TEST_OPTION_NONE,
+          NULL },
+        { NULL, NULL, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL } },
+      NULL,
+      1,
+      MUNIT_SUITE_OPTION_NONE },
+    { "/PeriodBuffer",
+      (MunitTest[]){
+        { "/saturates long period", test_PeriodBuffer_saturates_long_period, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL },
+        { "/lost signal is marked as gap",
+          test_PeriodBuffer_lost_signal_is_marked_as_gap,
+          NULL,
+          NULL,
+          MUNIT_TEST_OPTION_NONE,
+          NULL },
+        { NULL, NULL, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL } },
+      NULL,
+      1,
+      MUNIT_SUITE_OPTION_NONE },
+    { "/dcc_decodePeriodBatch",
+      (MunitTest[]){
+        { "(3 idle packets) is 3 packets",
+          test_decodePeriodBatch_3_idle_packets_is_3_packets,
+          NULL,
+          NULL,
+          MUNIT_TEST_OPTION_NONE,
+          NULL },
+        { NULL, NULL, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL } },
+      NULL,
+      1,
+      MUNIT_SUITE_OPTION_NONE },
+    { "/dcc_elapsedTime",
+      (MunitTest[]){ { "(0xFFFFFFF0, 0x10) is 0x20",
+                       test_elapsedTime_0xFFFFFFF0_0x10_is_0x20,
+                       NULL,
+                       NULL,
+                       MUNIT_TEST_OPTION_NONE,
+                       NULL },
+                     { NULL, NULL, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL } },
+      NULL,
+      1,
+      MUNIT_SUITE_OPTION_NONE },
+    { "/dcc_decode",
+      (MunitTest[]){ { "/across wrap points loses nothing",
+                       test_decode_across_wrap_points_loses_nothing,
+                       NULL,
+                       NULL,
+                       MUNIT_TEST_OPTION_NONE,
+                       NULL },
+                     { NULL, NULL, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL } },
+      NULL,
+      1,
+      MUNIT_SUITE_OPTION_NONE },
+    { "/dcc_decodeSignalsToBits",
+      (MunitTest[]){ { "/is the same as dcc_feedSignal",
+                       test_decodeSignalsToBits_is_the_same_as_feedSignal,
+                       NULL,
+                       NULL,
+                       MUNIT_TEST_OPTION_NONE,
+                       NULL },
+                     { "/with small capacity is the same as dcc_feedSignal",
+                       test_decodeSignalsToBits_with_small_capacity_is_the_same_as_feedSignal,
+                       NULL,
+                       NULL,
+                       MUNIT_TEST_OPTION_NONE,
+                       NULL },
+                     { "(tolerant)/is the same as dcc_feedSignal",
+                       test_decodeSignalsToBits_tolerant_is_the_same_as_feedSignal,
+                       NULL,
+                       NULL,
+                       MUNIT_TEST_OPTION_NONE,
+                       NULL },
+                     { NULL, NULL, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL } },
+      NULL,
+      1,
+      MUNIT_SUITE_OPTION_NONE },
+    { "/dcc_feedBits",
+      (MunitTest[]){ { "/is the same as dcc_feedBit",
+                       test_feedBits_is_the_same_as_feedBit,
+                       NULL,
+                       NULL,
+                       MUNIT_TEST_OPTION_NONE,
+                       NULL },
+                     { NULL, NULL, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL } },
+      NULL,
+      1,
+      MUNIT_SUITE_OPTION_NONE },
+    { "/dcc_decodeView",
+      (MunitTest[]){ { "(speed packet) is raw bytes in decoder",
+                       test_decodeView_speed_packet_is_raw_bytes_in_decoder,
+                       NULL,
+                       NULL,
+                       MUNIT_TEST_OPTION_NONE,
+                       NULL },
+                     { NULL, NULL, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL } },
+      NULL,
+      1,
+      MUNIT_SUITE_OPTION_NONE },
+    { "/dcc_decodeSignal",
+      (MunitTest[]){
+        // name, test, setup, tear down, options, parameters
+        { "(58, 58) is 1", test_decodeSignal_58_58_is_1, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL },
+        { "(100, 9000) is 0", test_decodeSignal_100_9000_is_0, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL },
+        { "(51, 58) is failure", test_decodeSignal_51_58_is_failure, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL },
+        { "/is the same as reference around every threshold",
+          test_decodeSignal_is_the_same_as_reference_around_every_threshold,
+          NULL,
+          NULL,
+          MUNIT_TEST_OPTION_NONE,
+          NULL },
+        { NULL, NULL, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL } },
+      NULL,
+      1,
+      MUNIT_SUITE_OPTION_NONE },
+    { "/dcc_feedSignal",
+      (MunitTest[]){
+        { "([0]) is continue", test_feedSignal_0_is_continue, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL },
+        { "([0, 1]) is continue", test_feedSignal_0_1_is_continue, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL },
+        { "([0, 1, 2]) is fragment", test_feedSignal_0_1_2_is_fragment, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL },
+        { "([0, 58, 158]) is failure",
+          test_feedSignal_0_58_158_is_failure,
+          NULL,
+          NULL,
+          MUNIT_TEST_OPTION_NONE,
+          NULL },
+        { "([0, 57, 114]) is success", test_feedSignal_0_57_114_is_1, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL },
+        { NULL, NULL, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL } },
+      NULL,
+      1,
+      MUNIT_SUITE_OPTION_NONE },
+    { "/dcc_validatePacket",
+      (MunitTest[]){ { "([0x00], 0x00) is success",
+                       test_validatePacket_0x00_0x00_is_success,
+                       NULL,
+                       NULL,
+                       MUNIT_TEST_OPTION_NONE,
+                       NULL },
+                     { "([0x00], 0x01) is failure",
+                       test_validatePacket_0x00_0x01_is_failure,
+                       NULL,
+                       NULL,
+                       MUNIT_TEST_OPTION_NONE,
+                       NULL },
+                     { "([0x00, 0x01], 0x01) is success",
+                       test_validatePacket_0x00_0x01_0x01_is_success,
+                       NULL,
+                       NULL,
+                       MUNIT_TEST_OPTION_NONE,
+                       NULL },
+                     { NULL, NULL, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL } },
+      NULL,
+      1,
+      MUNIT_SUITE_OPTION_NONE },
+    { "/dcc_parseSpeedAndDirectionPacketForLocomotiveDecoders",
+      (MunitTest[]){
+        { "([0b00000001, 0b01101010], 0b01101011) is { address = 1, direction = forward, emergencyStop = false, "
+          "flControl = false, speed5Step = 17, directionMayBeIgnored = false }",
+          test_parseSpeedAndDirectionPacketForLocomotiveDecoders_0b00000001_0b01101010_0b01101011_is_1_forward_20,
+          NULL,
+          NULL,
+          MUNIT_TEST_OPTION_NONE,
+          NULL },
+        { "([0b00000001, 0b01101010], 0b01101011) is { address = 1, direction = forward, emergencyStop = false, "
+          "flControl = true, speed4Step = 9, fl = false }",
+          test_parseSpeedAndDirectionPacketForLocomotiveDecoders_0b00000001_0b01101010_0b01101011_is_1_forward_9_off,
+          NULL,
+          NULL,
+          MUNIT_TEST_OPTION_NONE,
+          NULL },
+        { NULL, NULL, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL } },
+      NULL,
+      1,
+      MUNIT_SUITE_OPTION_NONE },
+    { "/dcc_parseResetPacketForAllDecoders",
+      (MunitTest[]){ { "([0b00000000, 0b00000000, 0b00000000]) is success",
+                       test_parseResetPacketForAllDecoders_0b00000000_0b00000000_0b00000000_is_success,
+                       NULL,
+                       NULL,
+                       MUNIT_TEST_OPTION_NONE,
+                       NULL },
+                     { NULL, NULL, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL } },
+      NULL,
+      1,
+      MUNIT_SUITE_OPTION_NONE },
+    { "/dcc_parseIdlePacketForAllDecoders",
+      (MunitTest[]){ { "([0b11111111, 0b00000000, 0b11111111]) is success",
+                       test_parseIdlePacketForAllDecoders_0b11111111_0b00000000_0b11111111_is_success,
+                       NULL,
+                       NULL,
+                       MUNIT_TEST_OPTION_NONE,
+                       NULL },
+                     { NULL, NULL, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL } },
+      NULL,
+      1,
+      MUNIT_SUITE_OPTION_NONE },
+    { "/dcc_parseResetPacketForMultiFunctionDecoders",
+      (MunitTest[]){ { "([0b00000110, 0b0000000, 0b00000110]) is { address = 3 }",
+                       test_parseResetPacketForMultiFunctionDecoders_0b00000011_0b0000000_0b00000011_is_3,
+                       NULL,
+                       NULL,
+                       MUNIT_TEST_OPTION_NONE,
+                       NULL },
+                     { "([0b11000011, 0b0000000, 0b0000000, 0b11000011]) is { address = 768 }",
+                       test_parseResetPacketForMultiFunctionDecoders_0b11000011_0b0000000_0b0000000_0b11000011_is_768,
+                       NULL,
+                       NULL,
+                       MUNIT_TEST_OPTION_NONE,
+                       NULL },
+                     { NULL, NULL, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL } },
+      NULL,
+      1,
+      MUNIT_SUITE_OPTION_NONE },
+    { "/dcc_parseFactoryTestInstructionPacketForMultiFunctionDecoders",
+      (MunitTest[]){ { "(without data) is success",
+                       test_parseFactoryTestInstructionPacketForMultiFunctionDecoders_without_data,
+                       NULL,
+                       NULL,
+                       MUNIT_TEST_OPTION_NONE,
+                       NULL },
+                     { "(with data) is success",
+                       test_parseFactoryTestInstructionPacketForMultiFunctionDecoders_with_data,
+                       NULL,
+                       NULL,
+                       MUNIT_TEST_OPTION_NONE,
+                       NULL },
+                     { "(too short) is failure",
+                       test_parseFactoryTestInstructionPacketForMultiFunctionDecoders_too_short_is_failure,
+                       NULL,
+                       NULL,
+                       MUNIT_TEST_OPTION_NONE,
+                       NULL },
+                     { "(too long) is failure",
+                       test_parseFactoryTestInstructionPacketForMultiFunctionDecoders_too_long_is_failure,
+                       NULL,
+                       NULL,
+                       MUNIT_TEST_OPTION_NONE,
+                       NULL },
+                     { NULL, NULL, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL } },
+      NULL,
+      1,
+      MUNIT_SUITE_OPTION_NONE },
+    { "/dcc_parsePacket",
+      (MunitTest[]){ { "/is the same as sequential parsers",
+                       test_parsePacket_is_the_same_as_sequential_parsers,
+                       NULL,
+                       NULL,
+                       MUNIT_TEST_OPTION_NONE,
+                       NULL },
+                     { "/parses every tag",
+                       test_parsePacket_parses_every_tag,
+                       NULL,
+                       NULL,
+                       MUNIT_TEST_OPTION_NONE,
+                       NULL },
+                     { "(truncated packets) are failure",
+                       test_parsePacket_truncated_packets_are_failure,
+                       NULL,
+                       NULL,
+                       MUNIT_TEST_OPTION_NONE,
+                       NULL },
+                     { "(accessory packet) is failure",
+                       test_parsePacket_accessory_packet_is_failure,
+                       NULL,
+                       NULL,
+                       MUNIT_TEST_OPTION_NONE,
+                       NULL },
+                     { NULL, NULL, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL } },
+      NULL,
+      1,
+      MUNIT_SUITE_OPTION_NONE },
+    { "/dcc_encodePacket",
+      (MunitTest[]){ { "/is inverse of dcc_parsePacket",
+                       test_encodePacket_is_inverse_of_parsePacket,
+                       NULL,
+                       NULL,
+                       MUNIT_TEST_OPTION_NONE,
+                       NULL },
+                     { "(out of range) is failure",
+                       test_encodePacket_out_of_range_is_failure,
+                       NULL,
+                       NULL,
+                       MUNIT_TEST_OPTION_NONE,
+                       NULL },
+                     { NULL, NULL, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL } },
+      NULL,
+      1,
+      MUNIT_SUITE_OPTION_NONE },
+    { "/dcc_generateHalfBitPeriods",
+      (MunitTest[]){ { "/is decoded to the same packet",
+                       test_generateHalfBitPeriods_is_decoded_to_the_same_packet,
+                       NULL,
+                       NULL,
+                       MUNIT_TEST_OPTION_NONE,
+                       NULL },
+                     { NULL, NULL, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL } },
+      NULL,
+      1,
+      MUNIT_SUITE_OPTION_NONE },
+    { "/dcc_encodeBits",
+      (MunitTest[]){ { "/is read by dcc_feedBits",
+                       test_encodeBits_is_read_by_feedBits,
+                       NULL,
+                       NULL,
+                       MUNIT_TEST_OPTION_NONE,
+                       NULL },
+                     { NULL, NULL, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL } },
+      NULL,
+      1,
+      MUNIT_SUITE_OPTION_NONE },
+    { "/WaveformCache",
+      (MunitTest[]){ { "/hits unchanged packet",
+                       test_WaveformCache_hits_unchanged_packet,
+                       NULL,
+                       NULL,
+                       MUNIT_TEST_OPTION_NONE,
+                       NULL },
+                     { "/regenerates only changed packet",
+                       test_WaveformCache_regenerates_only_changed_packet,
+                       NULL,
+                       NULL,
+                       MUNIT_TEST_OPTION_NONE,
+                       NULL },
+                     { "(full)/evicts entry",
+                       test_WaveformCache_full_evicts_entry,
+                       NULL,
+                       NULL,
+                       MUNIT_TEST_OPTION_NONE,
+                       NULL },
+                     { NULL, NULL, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL } },
+      NULL,
+      1,
+      MUNIT_SUITE_OPTION_NONE },
+    { "/Scheduler",
+      (MunitTest[]){ { "(empty)/sends idle",
+                       test_Scheduler_empty_sends_idle,
+                       NULL,
+                       NULL,
+                       MUNIT_TEST_OPTION_NONE,
+                       NULL },
+                     { "/sends changed packets first",
+                       test_Scheduler_sends_changed_packets_first,
+                       NULL,
+                       NULL,
+                       MUNIT_TEST_OPTION_NONE,
+                       NULL },
+                     { "/same packet gets no priority",
+                       test_Scheduler_same_packet_gets_no_priority,
+                       NULL,
+                       NULL,
+                       MUNIT_TEST_OPTION_NONE,
+                       NULL },
+                     { "/caps back to back packets",
+                       test_Scheduler_caps_back_to_back_packets,
+                       NULL,
+                       NULL,
+                       MUNIT_TEST_OPTION_NONE,
+                       NULL },
+                     { "/refreshes every address",
+                       test_Scheduler_refreshes_every_address,
+                       NULL,
+                       NULL,
+                       MUNIT_TEST_OPTION_NONE,
+                       NULL },
+                     { "(full)/is failure",
+                       test_Scheduler_full_is_failure,
+                       NULL,
+                       NULL,
+                       MUNIT_TEST_OPTION_NONE,
+                       NULL },
+                     { "/reuses released decoders",
+                       test_Scheduler_reuses_released_decoders,
+                       NULL,
+                       NULL,
+                       MUNIT_TEST_OPTION_NONE,
+                       NULL },
+                     { NULL, NULL, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL } },
+      NULL,
+      1,
+      MUNIT_SUITE_OPTION_NONE },
+    { "/PacketQueue",
+      (MunitTest[]){ { "/delivers every record to every reader",
+                       test_PacketQueue_delivers_every_record_to_every_reader,
+                       NULL,
+                       NULL,
+                       MUNIT_TEST_OPTION_NONE,
+                       NULL },
+                     { "(overrun)/counts lost records",
+                       test_PacketQueue_overrun_counts_lost_records,
+                       NULL,
+                       NULL,
+                       MUNIT_TEST_OPTION_NONE,
+                       NULL },
+                     { "(concurrent push pop)/reads intact records",
+                       test_PacketQueue_concurrent_push_pop_reads_intact_records,
+                       NULL,
+                       NULL,
+                       MUNIT_TEST_OPTION_NONE,
+                       NULL },
+                     { NULL, NULL, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL } },
+      NULL,
+      1,
+      MUNIT_SUITE_OPTION_NONE },
+    { "/dcc_makePacketRecord",
+      (MunitTest[]){ { "/flags errors", test_makePacketRecord_flags_errors, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL },
+                     { NULL, NULL, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL } },
+      NULL,
+      1,
+      MUNIT_SUITE_OPTION_NONE },
+    { "/PacketLog",
+      (MunitTest[]){
+        { "/round trips records", test_PacketLog_round_trips_records, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL },
+        { "/rejects broken frames", test_PacketLog_rejects_broken_frames, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL },
+        { "/resynchronizes after lost bytes",
+          test_PacketLog_resynchronizes_after_lost_bytes,
+          NULL,
+          NULL,
+          MUNIT_TEST_OPTION_NONE,
+          NULL },
+        { NULL, NULL, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL } },
+      NULL,
+      1,
+      MUNIT_SUITE_OPTION_NONE },
+    { "/DeferredLog",
+      (MunitTest[]){
+        { "/formats like snprintf", test_DeferredLog_formats_like_snprintf, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL },
+        { "(full)/counts lost entries",
+          test_DeferredLog_full_counts_lost_entries,
+          NULL,
+          NULL,
+          MUNIT_TEST_OPTION_NONE,
+          NULL },
+        { "/records debug logs", test_DeferredLog_records_debug_logs, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL },
+        { NULL, NULL, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL } },
+      NULL,
+      1,
+      MUNIT_SUITE_OPTION_NONE },
+    { "/dcc_decodePeriodView",
+      (MunitTest[]){ { "(random periods)/never fails internally",
+                       test_decodePeriodView_random_periods_never_fails_internally,
+                       NULL,
+                       NULL,
+                       MUNIT_TEST_OPTION_NONE,
+                       NULL },
+                     { NULL, NULL, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL } },
+      NULL,
+      1,
+      MUNIT_SUITE_OPTION_NONE },
+    { "/dcc_feedBits",
+      (MunitTest[]){ { "(random bits)/never fails internally",
+                       test_feedBits_random_bits_never_fails_internally,
+                       NULL,
+                       NULL,
+                       MUNIT_TEST_OPTION_NONE,
+                       NULL },
+                     { NULL, NULL, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL } },
+      NULL,
+      1,
+      MUNIT_SUITE_OPTION_NONE },
+    { "/Decoder",
+      (MunitTest[]){ { "(corrupted state)/resynchronizes",
+                       test_Decoder_corrupted_state_resynchronizes,
+                       NULL,
+                       NULL,
+                       MUNIT_TEST_OPTION_NONE,
+                       NULL },
+                     { NULL, NULL, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL } },
+      NULL,
+      1,
+      MUNIT_SUITE_OPTION_NONE },
+    { "/dcc_readPacketLog",
+      (MunitTest[]){ { "(random bytes)/stays in bounds",
+                       test_readPacketLog_random_bytes_stays_in_bounds,
+                       NULL,
+                       NULL,
+                       MUNIT_TEST_OPTION_NONE,
+                       NULL },
+                     { NULL, NULL, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL } },
+      NULL,
+      1,
+      MUNIT_SUITE_OPTION_NONE },
+    { "/DecoderStats",
+      (MunitTest[]){ { "/counts every stage",
+                       test_DecoderStats_counts_every_stage,
+                       NULL,
+                       NULL,
+                       MUNIT_TEST_OPTION_NONE,
+                       NULL },
+                     { "(short preamble and noise)/counts rejects",
+                       test_DecoderStats_short_preamble_and_noise_counts_rejects,
+                       NULL,
+                       NULL,
+                       MUNIT_TEST_OPTION_NONE,
+                       NULL },
+                     { "/snapshots and resets",
+                       test_DecoderStats_snapshots_and_resets,
+                       NULL,
+                       NULL,
+                       MUNIT_TEST_OPTION_NONE,
+                       NULL },
+                     { NULL, NULL, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL } },
+      NULL,
+      1,
+      MUNIT_SUITE_OPTION_NONE },
+    { "/dcc_classifyAddress",
+      (MunitTest[]){ { "/splits at boundaries",
+                       test_classifyAddress_splits_at_boundaries,
+                       NULL,
+                       NULL,
+                       MUNIT_TEST_OPTION_NONE,
+                       NULL },
+                     { NULL, NULL, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL } },
+      NULL,
+      1,
+      MUNIT_SUITE_OPTION_NONE },
+    { "/TimingProfile",
+      (MunitTest[]){ { "/buckets half bits",
+                       test_TimingProfile_buckets_half_bits,
+                       NULL,
+                       NULL,
+                       MUNIT_TEST_OPTION_NONE,
+                       NULL },
+                     { "(decoder)/profiles every half bit",
+                       test_TimingProfile_decoder_profiles_every_half_bit,
+                       NULL,
+                       NULL,
+                       MUNIT_TEST_OPTION_NONE,
+                       NULL },
+                     { "/shows JSON", test_TimingProfile_shows_JSON, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL },
+                     { NULL, NULL, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL } },
+      NULL,
+      1,
+      MUNIT_SUITE_OPTION_NONE },
+    { "/ReceiveTiming",
+      (MunitTest[]){ { "(strict)/is the NMRA constants",
+                       test_ReceiveTiming_strict_is_the_NMRA_constants,
+                       NULL,
+                       NULL,
+                       MUNIT_TEST_OPTION_NONE,
+                       NULL },
+                     { "(tolerant)/accepts drifted half bits",
+                       test_ReceiveTiming_tolerant_accepts_drifted_half_bits,
+                       NULL,
+                       NULL,
+                       MUNIT_TEST_OPTION_NONE,
+                       NULL },
+                     { NULL, NULL, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL } },
+      NULL,
+      1,
+      MUNIT_SUITE_OPTION_NONE },
+    { "/dcc_validateReceiveTiming",
+      (MunitTest[]){ { "/rejects overlapping ranges",
+                       test_validateReceiveTiming_rejects_overlapping_ranges,
+                       NULL,
+                       NULL,
+                       MUNIT_TEST_OPTION_NONE,
+                       NULL },
+                     { NULL, NULL, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL } },
+      NULL,
+      1,
+      MUNIT_SUITE_OPTION_NONE },
+    { "/ClockRecovery",
+      (MunitTest[]){ { "(skewed)/recovers packets the fixed ranges reject",
+                       test_ClockRecovery_skewed_recovers_packets_the_fixed_ranges_reject,
+                       NULL,
+                       NULL,
+                       MUNIT_TEST_OPTION_NONE,
+                       NULL },
+                     { "(nominal)/decodes the same packets",
+                       test_ClockRecovery_nominal_decodes_the_same_packets,
+                       NULL,
+                       NULL,
+                       MUNIT_TEST_OPTION_NONE,
+                       NULL },
+                     { NULL, NULL, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL } },
+      NULL,
+      1,
+      MUNIT_SUITE_OPTION_NONE },
+    { "/Resynchronization",
+      (MunitTest[]){ { "/timing failure in packet waits for next preamble",
+                       test_Resynchronization_timing_failure_in_packet_waits_for_next_preamble,
+                       NULL,
+                       NULL,
+                       MUNIT_TEST_OPTION_NONE,
+                       NULL },
+                     { "/spike in half bit is merged",
+                       test_Resynchronization_spike_in_half_bit_is_merged,
+                       NULL,
+                       NULL,
+                       MUNIT_TEST_OPTION_NONE,
+                       NULL },
+                     { "/spike after long first piece loses the packet",
+                       test_Resynchronization_spike_after_long_first_piece_loses_the_packet,
+                       NULL,
+                       NULL,
+                       MUNIT_TEST_OPTION_NONE,
+                       NULL },
+                     { "/known polarity drops the pair",
+                       test_Resynchronization_known_polarity_drops_the_pair,
                        NULL,
                        NULL,
                        MUNIT_TEST_OPTION_NONE,